@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dbengine.h"
+#include "../database/database.h"
+#include "../query/prepared.h"
+#include "../util/extsort.h"
+#include "../constants.h"
+
+#define CURSOR_TEXT_MIN 32 // Room for a formatted number in db_column_text
+
+// --- Cursor ---
+// The executor pushes rows into a callback. db_query runs the whole query
+// on the caller's thread, so nothing of the engine runs behind the
+// caller's back. The first CURSOR_BATCH_BYTES of rows stay in memory; the
+// rest go to an unlinked temp file in the database directory, which
+// db_cursor_next reads back a batch at a time. A cursor keeps its own copy
+// of the result layout, so it does not depend on the query or its tables
+// once it is open.
+
+struct DbCursor {
+    ColumnDefinition* columns;   // Result layout (copied)
+    int num_columns;
+    size_t row_size;
+    char* rows;                  // Batch of result rows
+    int capacity;                // Rows per batch
+    int count;                   // Rows in the batch
+    int pos;                     // Next row of the batch
+    FILE* spill;                 // Rows beyond the first batch (NULL if they all fit)
+    const char* row;             // Current row
+    char* text;                  // Scratch for db_column_text
+};
+
+typedef struct {
+    DbCursor* cursor;
+    const char* temp_dir;        // Where the spill file goes
+    int failed;
+} CursorFill;
+
+// Append one row, moving a full batch out to the spill file first.
+static int cursor_sink(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    CursorFill* fill = (CursorFill*)ctx;
+    DbCursor* cursor = fill->cursor;
+    if (cursor->count == cursor->capacity) {
+        if (!cursor->spill && !(cursor->spill = open_temp_file(fill->temp_dir, "cursor result file"))) {
+            fill->failed = 1;
+            return 1;
+        }
+        if (fwrite(cursor->rows, cursor->row_size, (size_t)cursor->count, cursor->spill) != (size_t)cursor->count) {
+            perror("Failed to write cursor result file");
+            fill->failed = 1;
+            return 1;
+        }
+        cursor->count = 0;
+    }
+    memcpy(cursor->rows + (size_t)cursor->count++ * cursor->row_size, row, cursor->row_size);
+    return 0;
+}
+
+/**
+ * Run a SELECT and open a cursor on its result.
+ * @param query Prepared SELECT with all parameters bound.
+ * @return The cursor, positioned before the first row, or NULL on error.
+ */
+DbCursor* db_query(DbQuery* query) {
+    if (!query) return NULL;
+    if (query->type != STMT_SELECT) {
+        fprintf(stderr, "Error: db_query needs a SELECT; run other statements with db_execute.\n");
+        return NULL;
+    }
+    if (stmt_check_tables(query) != 0) return NULL;
+    const TableSchema* output = query->plan->output;
+    DbCursor* cursor = calloc(1, sizeof(DbCursor));
+    if (!cursor) {
+        perror("Failed to allocate cursor");
+        return NULL;
+    }
+    cursor->num_columns = output->num_columns;
+    cursor->row_size = output->row_size > 0 ? output->row_size : 1;
+    cursor->capacity = CURSOR_BATCH_BYTES / cursor->row_size > 0 ? (int)(CURSOR_BATCH_BYTES / cursor->row_size) : 1;
+    size_t text_size = CURSOR_TEXT_MIN;
+    for (int i = 0; i < output->num_columns; i++) {
+        if (output->columns[i].size + 1 > text_size) text_size = output->columns[i].size + 1;
+    }
+    cursor->columns = malloc((size_t)output->num_columns * sizeof(ColumnDefinition));
+    cursor->rows = malloc((size_t)cursor->capacity * cursor->row_size);
+    cursor->text = malloc(text_size);
+    if (!cursor->columns || !cursor->rows || !cursor->text) {
+        perror("Failed to allocate cursor buffers");
+        db_cursor_close(cursor);
+        return NULL;
+    }
+    memcpy(cursor->columns, output->columns, (size_t)output->num_columns * sizeof(ColumnDefinition));
+
+    CursorFill fill = {cursor, query->db->data_dir, 0};
+    long result = stmt_execute(query, cursor_sink, &fill);
+    if (result >= 0 && !fill.failed && cursor->spill) {
+        // Everything goes through the file: move the last batch there too
+        if (fwrite(cursor->rows, cursor->row_size, (size_t)cursor->count, cursor->spill) != (size_t)cursor->count ||
+            fflush(cursor->spill) != 0) {
+            perror("Failed to write cursor result file");
+            fill.failed = 1;
+        }
+        rewind(cursor->spill);
+        cursor->count = 0;
+    }
+    if (result < 0 || fill.failed) {
+        db_cursor_close(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+/**
+ * Move to the next result row.
+ * @return 1 if there is a row, 0 at the end, -1 on error.
+ */
+int db_cursor_next(DbCursor* cursor) {
+    if (!cursor) return -1;
+    cursor->row = NULL;
+    if (cursor->pos == cursor->count && cursor->spill) {
+        cursor->count = (int)fread(cursor->rows, cursor->row_size, (size_t)cursor->capacity, cursor->spill);
+        cursor->pos = 0;
+        if (cursor->count == 0 && ferror(cursor->spill)) {
+            perror("Failed to read cursor result file");
+            return -1;
+        }
+    }
+    if (cursor->pos == cursor->count) return 0;
+    cursor->row = cursor->rows + (size_t)cursor->pos++ * cursor->row_size;
+    return 1;
+}
+
+/**
+ * Free the cursor and its spill file.
+ * @return 0.
+ */
+int db_cursor_close(DbCursor* cursor) {
+    if (!cursor) return 0;
+    if (cursor->spill) fclose(cursor->spill);
+    free(cursor->columns);
+    free(cursor->rows);
+    free(cursor->text);
+    free(cursor);
+    return 0;
+}
+
+// --- Result Columns ---
+
+static const ColumnDefinition* cursor_column(const DbCursor* cursor, int column) {
+    if (!cursor || !cursor->row || column < 0 || column >= cursor->num_columns) return NULL;
+    return &cursor->columns[column];
+}
+
+int db_column_count(const DbCursor* cursor) {
+    return cursor ? cursor->num_columns : 0;
+}
+
+const char* db_column_name(const DbCursor* cursor, int column) {
+    if (!cursor || column < 0 || column >= cursor->num_columns) return NULL;
+    return cursor->columns[column].name;
+}
+
+DbType db_column_type(const DbCursor* cursor, int column) {
+    if (!cursor || column < 0 || column >= cursor->num_columns) return DB_TYPE_INT;
+    switch (cursor->columns[column].type) {
+        case COL_TYPE_STRING: return DB_TYPE_TEXT;
+        case COL_TYPE_LONG:   return DB_TYPE_LONG;
+        case COL_TYPE_DOUBLE: return DB_TYPE_DOUBLE;
+        default:              return DB_TYPE_INT;
+    }
+}
+
+long long db_column_long(const DbCursor* cursor, int column) {
+    const ColumnDefinition* col = cursor_column(cursor, column);
+    if (!col) return 0;
+    const char* field = cursor->row + col->offset;
+    switch (col->type) {
+        case COL_TYPE_INT: {
+            int value;
+            memcpy(&value, field, sizeof(value));
+            return value;
+        }
+        case COL_TYPE_LONG: {
+            int64_t value;
+            memcpy(&value, field, sizeof(value));
+            return value;
+        }
+        case COL_TYPE_DOUBLE: {
+            double value;
+            memcpy(&value, field, sizeof(value));
+            return (long long)value;
+        }
+        default:
+            return 0;
+    }
+}
+
+int db_column_int(const DbCursor* cursor, int column) {
+    return (int)db_column_long(cursor, column);
+}
+
+double db_column_double(const DbCursor* cursor, int column) {
+    const ColumnDefinition* col = cursor_column(cursor, column);
+    if (col && col->type == COL_TYPE_DOUBLE) {
+        double value;
+        memcpy(&value, cursor->row + col->offset, sizeof(value));
+        return value;
+    }
+    return (double)db_column_long(cursor, column);
+}
+
+const char* db_column_text(DbCursor* cursor, int column) {
+    const ColumnDefinition* col = cursor_column(cursor, column);
+    if (!col) return NULL;
+    switch (col->type) {
+        case COL_TYPE_STRING: {
+            const char* field = cursor->row + col->offset;
+            size_t length = strnlen(field, col->size);
+            memcpy(cursor->text, field, length);
+            cursor->text[length] = '\0';
+            break;
+        }
+        case COL_TYPE_DOUBLE:
+            snprintf(cursor->text, CURSOR_TEXT_MIN, "%.4f", db_column_double(cursor, column));
+            break;
+        default:
+            snprintf(cursor->text, CURSOR_TEXT_MIN, "%lld", db_column_long(cursor, column));
+            break;
+    }
+    return cursor->text;
+}
+
+// --- Databases and Queries ---
+
+DbHandle* db_open(const char* path) {
+    if (!path) return NULL;
+    return open_database(path);
+}
+
+void db_close(DbHandle* db) {
+    if (!db) return;
+    stmt_deallocate_all(db);
+    close_database(db);
+}
+
+void db_checkpoint(DbHandle* db) {
+    if (db) checkpoint_database(db);
+}
+
+DbQuery* db_prepare(DbHandle* db, const char* sql) {
+    return stmt_prepare(db, sql);
+}
+
+void db_finalize(DbQuery* query) {
+    stmt_finalize(query);
+}
+
+int db_bind_int(DbQuery* query, int index, int value) {
+    return stmt_bind_int(query, index, value);
+}
+
+int db_bind_text(DbQuery* query, int index, const char* value) {
+    return stmt_bind_text(query, index, value);
+}
+
+static int discard_row(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    (void)row;
+    (void)ctx;
+    return 0;
+}
+
+long db_execute(DbQuery* query) {
+    return stmt_execute(query, discard_row, NULL);
+}
+
+/**
+ * Convert text values to rows and insert them as one batch.
+ * @return 0 on success, 1 on a duplicate primary key, -1 on error.
+ */
+int db_insert_batch(DbHandle* db, const char* table, int num_rows, int num_columns,
+                    const char* const* values) {
+    if (!db || !table || !values || num_rows <= 0) return -1;
+    TableSchema* schema = find_table_schema(db, table);
+    if (!schema) {
+        fprintf(stderr, "Error: Table '%s' not found for insert.\n", table);
+        return -1;
+    }
+    if (num_columns != schema->num_columns) {
+        fprintf(stderr, "Error: Table '%s' has %d columns, got %d values per row.\n",
+                table, schema->num_columns, num_columns);
+        return -1;
+    }
+    char* rows = calloc((size_t)num_rows, schema->row_size);
+    if (!rows) {
+        perror("Failed to allocate memory for insert batch");
+        return -1;
+    }
+    int status = 0;
+    for (int r = 0; r < num_rows && status == 0; r++) {
+        for (int c = 0; c < num_columns; c++) {
+            if (set_value_by_index(schema, rows + (size_t)r * schema->row_size, c,
+                                   values[(size_t)r * num_columns + c]) != 0) {
+                status = -1;
+                break;
+            }
+        }
+    }
+    if (status == 0) {
+        status = (num_rows == 1) ? insert_row_into(schema, rows) : insert_rows_into(schema, rows, num_rows);
+    }
+    free(rows);
+    return status;
+}
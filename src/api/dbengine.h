@@ -0,0 +1,106 @@
+#ifndef DBENGINE_H
+#define DBENGINE_H
+
+#include <stddef.h>
+
+// --- Embedding API ---
+// The stable C interface of libdbengine. Everything is reached through
+// opaque handles: a process may open several databases (each in its own
+// directory) and nothing is written to stdout. Errors are reported on
+// stderr, and engine diagnostics go through the logger (DB_LOG_LEVEL).
+//
+//   DbHandle* db = db_open("/var/lib/app/db");
+//   DbQuery* q = db_prepare(db, "SELECT id, name FROM users WHERE id > ?");
+//   db_bind_int(q, 0, 100);
+//   DbCursor* c = db_query(q);
+//   while (db_cursor_next(c) == 1) use(db_column_int(c, 0), db_column_text(c, 1));
+//   db_cursor_close(c);
+//   db_finalize(q);
+//   db_close(db);
+//
+// Threads: every call does its work on the calling thread and is finished
+// when it returns (a parallel scan's helper threads are joined before the
+// call returns). A handle, and the queries and cursors made from it, may be
+// used by one thread at a time; different handles may be used from
+// different threads at once. Within that one thread calls may interleave
+// freely: several cursors may be open, and INSERT, CREATE TABLE or DROP
+// TABLE may run while they are, because an open cursor holds a copy of its
+// result and no longer touches the tables.
+
+#if defined(__GNUC__)
+#define DB_API __attribute__((visibility("default")))
+#else
+#define DB_API
+#endif
+
+typedef struct Database DbHandle;            // An open database
+typedef struct PreparedStatement DbQuery;    // A prepared INSERT or SELECT
+typedef struct DbCursor DbCursor;            // Result rows of a SELECT
+
+typedef enum {
+    DB_TYPE_INT,     // 32-bit integer
+    DB_TYPE_TEXT,    // Fixed-width string column
+    DB_TYPE_LONG,    // 64-bit integer (COUNT, SUM)
+    DB_TYPE_DOUBLE   // AVG
+} DbType;
+
+// Open the database in directory `path`, creating it (with the default
+// schema) if needed. Returns NULL on error.
+DB_API DbHandle* db_open(const char* path);
+
+// Flush and close the database. Finalize its queries and close their
+// cursors first.
+DB_API void db_close(DbHandle* db);
+
+// Write deferred index headers, Bloom filters, zone maps and statistics.
+DB_API void db_checkpoint(DbHandle* db);
+
+// Parse and plan an INSERT or SELECT ('?' marks parameters, numbered from
+// 0 left to right), or a CREATE TABLE / DROP TABLE. A query whose table is
+// dropped fails from then on. Returns NULL on error.
+DB_API DbQuery* db_prepare(DbHandle* db, const char* sql);
+DB_API void db_finalize(DbQuery* query);
+
+// Bind parameter `index`; values stay bound across executions. Return 0,
+// or -1 on error (bad index or value).
+DB_API int db_bind_int(DbQuery* query, int index, int value);
+DB_API int db_bind_text(DbQuery* query, int index, const char* value);
+
+// Run a query to completion. INSERT: 0 on success, 1 on a duplicate
+// primary key (nothing inserted), -1 on error. SELECT: the number of rows
+// (which are discarded), or -1. CREATE TABLE / DROP TABLE: 0, 1 if the
+// table already exists / does not exist, or -1.
+DB_API long db_execute(DbQuery* query);
+
+// Insert `num_rows` rows into `table` in one all-or-nothing batch. Values
+// are text, row by row, one per column in table order (`num_columns` must
+// match the table). Returns 0, 1 on a duplicate primary key, or -1.
+DB_API int db_insert_batch(DbHandle* db, const char* table, int num_rows, int num_columns,
+                           const char* const* values);
+
+// Run a SELECT to completion and open a cursor on its result. The first
+// rows are kept in memory and the rest spill to an unlinked temp file in
+// the database directory, so a result larger than memory still works. The
+// cursor sees the result as of this call; the query may be bound and run
+// again while it is open. Use LIMIT to bound the work: closing a cursor
+// early does not make the query cheaper. Returns NULL on error.
+DB_API DbCursor* db_query(DbQuery* query);
+
+// Advance to the next row: 1 if there is one, 0 at the end, -1 on error.
+DB_API int db_cursor_next(DbCursor* cursor);
+
+// Free the cursor and its temp file. Returns 0.
+DB_API int db_cursor_close(DbCursor* cursor);
+
+// Result columns. Values are of the current row; numeric getters convert
+// between numeric types and return 0 for text, db_column_text formats any
+// value (the string is valid until the next call on the cursor).
+DB_API int db_column_count(const DbCursor* cursor);
+DB_API const char* db_column_name(const DbCursor* cursor, int column);
+DB_API DbType db_column_type(const DbCursor* cursor, int column);
+DB_API int db_column_int(const DbCursor* cursor, int column);
+DB_API long long db_column_long(const DbCursor* cursor, int column);
+DB_API double db_column_double(const DbCursor* cursor, int column);
+DB_API const char* db_column_text(DbCursor* cursor, int column);
+
+#endif // DBENGINE_H
@@ -2,7 +2,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#include <stddef.h>     // For offsetof
 #include "btree.h"
+#include "../util/crc32c.h"
+#include "../util/log.h"
+#include "../io/io.h"
 #include "../constants.h" // Adjust path if needed
 #include "../structs.h"  // Adjust path if needed
 
@@ -15,18 +20,154 @@
  * @param handle The B+ Tree instance handle.
  */
 void update_btree_header(BTreeHandle* handle) {
-    if (!handle || !handle->fp) return;
-    fseek(handle->fp, 0, SEEK_SET);
-    fwrite(&handle->header, sizeof(BTreeHeader), 1, handle->fp);
-    fflush(handle->fp); // Ensure header is written
+    if (!handle || !handle->file) return;
+    if (io_pwrite(handle->file, &handle->header, sizeof(BTreeHeader), 0) != sizeof(BTreeHeader)) {
+        fprintf(stderr, "Error writing header of '%s': %s\n", handle->index_path, strerror(errno));
+        return;
+    }
+    handle->header_dirty = 0;
+}
+
+/**
+ * Write the header if it has pending changes (checkpoint boundary).
+ * @param handle The B+ Tree instance handle.
+ */
+void btree_checkpoint(BTreeHandle* handle) {
+    if (handle && handle->header_dirty) {
+        update_btree_header(handle);
+    }
+}
+
+// --- Node Checksums ---
+
+static uint32_t node_checksum(const Node* node) {
+    return crc32c(node, offsetof(Node, checksum));
+}
+
+/**
+ * Reconcile next_id with the nodes actually present in the file.
+ * next_id is only persisted at checkpoints, so after a crash the header may
+ * lag behind nodes that were allocated and written since. Trailing slots
+ * that do not checksum (a torn write, or the zero padding an O_DIRECT write
+ * leaves after the last node) were never completed and are not counted.
+ * @param handle The B+ Tree instance handle.
+ */
+static void recover_next_id(BTreeHandle* handle) {
+    long file_size = (long)io_size(handle->file);
+    if (file_size < HEADER_SIZE) return;
+
+    int nodes_on_disk = (int)((file_size - HEADER_SIZE) / (long)sizeof(Node));
+    Node node;
+    while (nodes_on_disk > handle->header.next_id) {
+        long offset = (long)HEADER_SIZE + (long)(nodes_on_disk - 1) * (long)sizeof(Node);
+        if (io_pread(handle->file, &node, sizeof(Node), offset) == (ssize_t)sizeof(Node) &&
+            node.checksum == node_checksum(&node)) {
+            break;
+        }
+        nodes_on_disk--;
+    }
+    if (nodes_on_disk > handle->header.next_id) {
+        fprintf(stderr, "Recovered next_id for '%s': header %d, file holds %d node(s).\n",
+                handle->index_path, handle->header.next_id, nodes_on_disk);
+        handle->header.next_id = nodes_on_disk;
+        handle->header_dirty = 1;
+    }
+}
+
+// --- Pinned Upper Levels ---
+
+/**
+ * Find the resident copy of a node, if it belongs to the pinned upper levels.
+ * @param handle The B+ Tree instance handle.
+ * @param id Node ID.
+ * @return Pointer to the pinned entry, or NULL if the node is not pinned.
+ */
+static PinnedNode* find_pinned(BTreeHandle* handle, int id) {
+    for (int i = 0; i < handle->num_pinned; i++) {
+        if (handle->pinned[i].node_id == id) {
+            return &handle->pinned[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Keep a copy of a node resident in the handle (no-op if already pinned or full).
+ * @param handle The B+ Tree instance handle.
+ * @param id Node ID.
+ * @param node Current contents of the node.
+ */
+static void pin_node(BTreeHandle* handle, int id, const Node* node) {
+    PinnedNode* pinned = find_pinned(handle, id);
+    if (!pinned) {
+        if (handle->num_pinned >= handle->pinned_capacity) return;
+        pinned = &handle->pinned[handle->num_pinned++];
+        pinned->node_id = id;
+    }
+    memcpy(&pinned->node, node, sizeof(Node));
+}
+
+/**
+ * Move a pinned node to the ID its copy-on-write replacement was written to.
+ * @param handle The B+ Tree instance handle.
+ * @param old_id ID of the superseded node.
+ * @param new_id ID of the replacement.
+ * @param node Contents of the replacement.
+ */
+static void repin_node(BTreeHandle* handle, int old_id, int new_id, const Node* node) {
+    PinnedNode* pinned = find_pinned(handle, old_id);
+    if (pinned) {
+        pinned->node_id = new_id;
+        memcpy(&pinned->node, node, sizeof(Node));
+    } else {
+        pin_node(handle, new_id, node);
+    }
+}
+
+/**
+ * (Re)load the root and the top BTREE_PINNED_LEVELS levels into memory.
+ * Called on open and whenever the root changes, since a root split pushes
+ * every existing node one level deeper.
+ * @param handle The B+ Tree instance handle.
+ */
+void btree_pin_upper_levels(BTreeHandle* handle) {
+    if (!handle || !handle->pinned) return;
+    handle->num_pinned = 0; // Drop stale copies so read_node goes to disk below
+
+    // Breadth-first walk; the pinned array doubles as the queue.
+    Node* root = read_node(handle, handle->header.root_id);
+    if (!root) {
+        handle->num_pinned = 0;
+        return;
+    }
+    pin_node(handle, handle->header.root_id, root);
+    free(root);
+
+    int level_start = 0;
+    for (int depth = 1; depth < BTREE_PINNED_LEVELS; depth++) {
+        int depth_end = handle->num_pinned; // Nodes of the previous level end here
+        for (int i = level_start; i < depth_end; i++) {
+            Node parent = handle->pinned[i].node;
+            if (parent.is_leaf) continue;
+            for (int c = 0; c <= parent.num_keys; c++) {
+                Node* child = read_node(handle, parent.children[c]);
+                if (!child) continue;
+                pin_node(handle, parent.children[c], child);
+                free(child);
+            }
+        }
+        level_start = depth_end;
+    }
 }
 
 /**
  * Initialize or open a B+ Tree index file.
  * @param index_path Path to the index file.
+ * @param flags BTREE_FLAG_* options for a newly created file (existing files keep theirs).
+ * @param io_flags Extra IO_OPEN_* flags (e.g. IO_OPEN_DIRECT) for this session.
  * @return Pointer to a BTreeHandle structure, or NULL on failure.
  */
-BTreeHandle* init_btree(const char* index_path) {
+BTreeHandle* init_btree(const char* index_path, int flags, int io_flags) {
     BTreeHandle* handle = malloc(sizeof(BTreeHandle));
     if (!handle) {
         perror("Failed to allocate memory for BTreeHandle");
@@ -34,13 +175,17 @@ BTreeHandle* init_btree(const char* index_path) {
     }
     strncpy(handle->index_path, index_path, MAX_PATH_LEN - 1);
     handle->index_path[MAX_PATH_LEN - 1] = '\0';
-    handle->fp = NULL; // Initialize fp
+    handle->file = NULL; // Initialize file
+    handle->header_dirty = 0;
+    handle->pinned = NULL;
+    handle->num_pinned = 0;
+    handle->pinned_capacity = 0;
 
-    handle->fp = fopen(index_path, "r+b"); // Open existing for read/write binary
-    if (handle->fp == NULL) {
+    handle->file = io_open(index_path, io_flags); // Open existing for read/write
+    if (handle->file == NULL) {
         // File doesn't exist, create it
-        handle->fp = fopen(index_path, "w+b"); // Create new for read/write binary
-        if (handle->fp == NULL) {
+        handle->file = io_open(index_path, io_flags | IO_OPEN_CREATE);
+        if (handle->file == NULL) {
             fprintf(stderr, "Failed to create B+ Tree index file '%s': %s\n", index_path, strerror(errno));
             free(handle);
             return NULL;
@@ -49,10 +194,11 @@ BTreeHandle* init_btree(const char* index_path) {
         // Initialize header for new file
         memset(&handle->header, 0, sizeof(BTreeHeader)); // Zero out header
         handle->header.magic = MAGIC;
-        handle->header.version = 1;
+        handle->header.version = BTREE_VERSION;
         handle->header.node_size = sizeof(Node); // Store size of Node struct
         handle->header.root_id = 0;             // Root is initially node 0
         handle->header.next_id = 1;             // Next available node ID is 1
+        handle->header.flags = flags;
         update_btree_header(handle);
 
         // Create an empty leaf node as the initial root (node 0)
@@ -63,26 +209,46 @@ BTreeHandle* init_btree(const char* index_path) {
         root_node.next_leaf = -1; // No next leaf yet
         write_node(handle, 0, &root_node); // Write root node at ID 0
 
-        printf("Initialized new B+ Tree index file: %s\n", index_path);
+        log_debug("Initialized new B+ Tree index file: %s%s", index_path,
+                  (flags & BTREE_FLAG_COW) ? " (copy-on-write)" : "");
 
     } else {
         // File exists, read header
-        size_t read_count = fread(&handle->header, sizeof(BTreeHeader), 1, handle->fp);
-        if (read_count != 1 || handle->header.magic != MAGIC) {
+        ssize_t read_count = io_pread(handle->file, &handle->header, sizeof(BTreeHeader), 0);
+        if (read_count != sizeof(BTreeHeader) || handle->header.magic != MAGIC) {
             fprintf(stderr, "Error: Invalid or corrupted B+ Tree index file '%s'. Magic: %x\n", index_path, handle->header.magic);
-            fclose(handle->fp);
+            io_close(handle->file);
             free(handle);
             return NULL;
         }
-        if (handle->header.node_size != sizeof(Node)) {
-             fprintf(stderr, "Warning: Node size mismatch in '%s'. File: %d, Expected: %zu. Trying to continue.\n",
-                     index_path, handle->header.node_size, sizeof(Node));
-             // Decide how critical this is. Maybe exit? For now, warn.
+        // Older layouts (version 1: no node checksums, smaller nodes) cannot
+        // be read or extended in place; the index is rebuilt from the data file
+        if (handle->header.version != BTREE_VERSION || handle->header.node_size != (int)sizeof(Node)) {
+            fprintf(stderr, "Error: Index '%s' has format version %d (%d-byte nodes); this build needs version %d "
+                    "(%zu-byte nodes). Delete it to have it rebuilt from the data file.\n",
+                    index_path, handle->header.version, handle->header.node_size, BTREE_VERSION, sizeof(Node));
+            io_close(handle->file);
+            free(handle);
+            return NULL;
         }
-         printf("Opened existing B+ Tree index file: %s (Root ID: %d, Next ID: %d)\n",
-                index_path, handle->header.root_id, handle->header.next_id);
+        recover_next_id(handle);
+        log_debug("Opened existing B+ Tree index file: %s (Root ID: %d, Next ID: %d)",
+                  index_path, handle->header.root_id, handle->header.next_id);
     }
 
+    // Size the pinned area for full upper levels: 1 + M + M^2 + ...
+    int level_nodes = 1;
+    for (int depth = 0; depth < BTREE_PINNED_LEVELS; depth++) {
+        handle->pinned_capacity += level_nodes;
+        level_nodes *= M;
+    }
+    handle->pinned = malloc(handle->pinned_capacity * sizeof(PinnedNode));
+    if (!handle->pinned) {
+        fprintf(stderr, "Warning: Could not pin upper levels of '%s'; continuing without.\n", index_path);
+        handle->pinned_capacity = 0;
+    }
+    btree_pin_upper_levels(handle);
+
     return handle;
 }
 
@@ -92,9 +258,11 @@ BTreeHandle* init_btree(const char* index_path) {
  */
 void close_btree(BTreeHandle* handle) {
     if (handle) {
-        if (handle->fp) {
-            fclose(handle->fp);
+        if (handle->file) {
+            btree_checkpoint(handle);
+            io_close(handle->file);
         }
+        free(handle->pinned);
         free(handle);
     }
 }
@@ -107,26 +275,27 @@ void close_btree(BTreeHandle* handle) {
  * @return Pointer to the node (must be freed by caller), or NULL on failure.
  */
 Node* read_node(BTreeHandle* handle, int id) {
-    if (!handle || !handle->fp) return NULL;
+    if (!handle || !handle->file) return NULL;
 
-    Node* node = malloc(handle->header.node_size); // Use size from header
+    Node* node = malloc(sizeof(Node)); // init_btree only opens files with this node size
     if (!node) {
         perror("Memory allocation failed for node");
         return NULL;
     }
 
-    // Calculate offset: Header size + node_id * node_size
-    long offset = (long)HEADER_SIZE + (long)id * handle->header.node_size;
-    if (fseek(handle->fp, offset, SEEK_SET) != 0) {
-        fprintf(stderr, "Error seeking to node %d in '%s': %s\n", id, handle->index_path, strerror(errno));
-        free(node);
-        return NULL;
+    // Upper levels are served from memory
+    PinnedNode* pinned = find_pinned(handle, id);
+    if (pinned) {
+        memcpy(node, &pinned->node, sizeof(Node));
+        return node;
     }
 
-    size_t read_count = fread(node, handle->header.node_size, 1, handle->fp);
-    if (read_count != 1) {
+    // Calculate offset: Header size + node_id * node_size
+    long offset = (long)HEADER_SIZE + (long)id * handle->header.node_size;
+    ssize_t read_count = io_pread(handle->file, node, handle->header.node_size, offset);
+    if (read_count != handle->header.node_size) {
         // Check for EOF vs error
-        if(feof(handle->fp)) {
+        if (read_count >= 0) {
              fprintf(stderr, "Error: Unexpected EOF reading node %d from '%s' at offset %ld.\n", id, handle->index_path, offset);
         } else {
              fprintf(stderr, "Error reading node %d from '%s': %s\n", id, handle->index_path, strerror(errno));
@@ -134,6 +303,12 @@ Node* read_node(BTreeHandle* handle, int id) {
         free(node);
         return NULL;
     }
+
+    if (node->checksum != node_checksum(node)) {
+        fprintf(stderr, "Error: Checksum mismatch on node %d in '%s' (torn or corrupted write).\n", id, handle->index_path);
+        free(node);
+        return NULL;
+    }
     return node;
 }
 
@@ -144,32 +319,109 @@ Node* read_node(BTreeHandle* handle, int id) {
  * @param node Pointer to the node to write.
  */
 void write_node(BTreeHandle* handle, int id, Node* node) {
-     if (!handle || !handle->fp || !node) return;
+     if (!handle || !handle->file || !node) return;
 
     // Calculate offset: Header size + node_id * node_size
     long offset = (long)HEADER_SIZE + (long)id * handle->header.node_size;
-     if (fseek(handle->fp, offset, SEEK_SET) != 0) {
-        fprintf(stderr, "Error seeking to write node %d in '%s': %s\n", id, handle->index_path, strerror(errno));
-        return; // Or maybe exit?
-    }
 
-    size_t write_count = fwrite(node, handle->header.node_size, 1, handle->fp);
-    if (write_count != 1) {
+    node->checksum = node_checksum(node);
+    ssize_t write_count = io_pwrite(handle->file, node, handle->header.node_size, offset);
+    if (write_count != handle->header.node_size) {
          fprintf(stderr, "Error writing node %d to '%s': %s\n", id, handle->index_path, strerror(errno));
          // What to do here? File might be corrupted.
     }
-    fflush(handle->fp); // Ensure data is written
+
+    // Keep the resident copy coherent (write-through)
+    PinnedNode* pinned = find_pinned(handle, id);
+    if (pinned) {
+        memcpy(&pinned->node, node, sizeof(Node));
+    }
+}
+
+/**
+ * Check the checksum of every allocated node, reading the file directly
+ * (bypassing pinned copies) through a private handle, so it can run on its
+ * own thread while other files are verified. Reads are issued in batches of
+ * VERIFY_READS_IN_FLIGHT chunks.
+ * @param handle The B+ Tree instance handle.
+ * @param nodes_checked Receives the number of nodes read (may be NULL).
+ * @return Number of corrupted or missing nodes, or -1 on I/O error.
+ */
+int btree_verify(const BTreeHandle* handle, int* nodes_checked) {
+    if (nodes_checked) *nodes_checked = 0;
+    if (!handle) return -1;
+
+    IoFile* file = io_open(handle->index_path, IO_OPEN_READONLY | (handle->file ? handle->file->flags & IO_OPEN_DIRECT : 0));
+    if (!file) {
+        fprintf(stderr, "Error opening '%s' for verification: %s\n", handle->index_path, strerror(errno));
+        return -1;
+    }
+
+    size_t node_size = (size_t)handle->header.node_size;
+    int chunk_nodes = (int)(VERIFY_CHUNK_SIZE / node_size);
+    if (chunk_nodes < 1) chunk_nodes = 1;
+    char* buffer = io_alloc_aligned((size_t)VERIFY_READS_IN_FLIGHT * chunk_nodes * node_size);
+    if (!buffer) {
+        perror("Memory allocation failed for verify buffer");
+        io_close(file);
+        return -1;
+    }
+
+    int bad = 0;
+    int next_id = 0;
+    int total = handle->header.next_id;
+    while (next_id < total && bad >= 0) {
+        IoRequest reqs[VERIFY_READS_IN_FLIGHT];
+        int n = 0;
+        for (int first = next_id; n < VERIFY_READS_IN_FLIGHT && first < total; n++, first += chunk_nodes) {
+            int count = (total - first < chunk_nodes) ? total - first : chunk_nodes;
+            reqs[n] = (IoRequest){file, buffer + (size_t)n * chunk_nodes * node_size,
+                                  (size_t)count * node_size, HEADER_SIZE + (off_t)first * node_size, -1, 0, 0};
+        }
+        if (io_read_batch(reqs, n) != 0) {
+            fprintf(stderr, "Error reading '%s' for verification: %s\n", handle->index_path, strerror(errno));
+            bad = -1;
+            break;
+        }
+        for (int r = 0; r < n; r++) {
+            int complete = (int)(reqs[r].result / (ssize_t)node_size);
+            int expected = (int)(reqs[r].len / node_size);
+            for (int k = 0; k < complete; k++) {
+                const Node* node = (const Node*)((char*)reqs[r].buf + (size_t)k * node_size);
+                if (node->checksum != node_checksum(node)) {
+                    fprintf(stderr, "VERIFY: Checksum mismatch on node %d in '%s'.\n", next_id + k, handle->index_path);
+                    bad++;
+                }
+            }
+            if (complete < expected) {
+                fprintf(stderr, "VERIFY: '%s' ends before node %d (expected %d nodes).\n",
+                        handle->index_path, next_id + complete, total);
+                bad += total - (next_id + complete);
+                next_id += complete;
+                total = next_id; // Stop here
+                break;
+            }
+            next_id += complete;
+        }
+        if (nodes_checked) *nodes_checked = next_id;
+    }
+
+    io_free_aligned(buffer);
+    io_close(file);
+    return bad;
 }
 
 /**
  * Allocate a new node ID for a specific B+ Tree.
+ * The header is only marked dirty; it is persisted at the next checkpoint
+ * (or root change), and init_btree recovers next_id from the file size.
  * @param handle The B+ Tree instance handle.
  * @return New node ID.
  */
 int allocate_node(BTreeHandle* handle) {
     if (!handle) return -1; // Should not happen
     int id = handle->header.next_id++;
-    update_btree_header(handle); // Save the updated header (with new next_id)
+    handle->header_dirty = 1;
     return id;
 }
 
@@ -231,6 +483,71 @@ long search(BTreeHandle* handle, int key) {
      return search_recursive(handle, key, handle->header.root_id);
 }
 
+/**
+ * Visit the entries under a node with keys in [low, high], in key order
+ * (recursive part). Child i of an internal node holds keys in
+ * [keys[i-1], keys[i]), so children outside the range are not read.
+ * @param handle The B+ Tree instance handle.
+ * @param node_id ID of the current node.
+ * @param low Smallest key to visit.
+ * @param high Largest key to visit.
+ * @param visit Callback; a nonzero return stops the walk.
+ * @param ctx Passed through to the callback.
+ * @return 0 when done, 1 if stopped by the callback, -1 on read error.
+ */
+static int for_each_recursive(BTreeHandle* handle, int node_id, int low, int high, BTreeVisitFn visit, void* ctx) {
+    Node* node = read_node(handle, node_id);
+    if (!node) {
+        fprintf(stderr, "Traversal failed: Could not read node %d in '%s'\n", node_id, handle->index_path);
+        return -1;
+    }
+    int status = 0;
+    if (node->is_leaf) {
+        for (int i = 0; i < node->num_keys && status == 0; i++) {
+            if (node->keys[i] < low) continue;
+            if (node->keys[i] > high) break;
+            if (visit(node->keys[i], node->offsets[i], ctx) != 0) status = 1;
+        }
+    } else {
+        for (int i = 0; i <= node->num_keys && status == 0; i++) {
+            if (i < node->num_keys && node->keys[i] <= low) continue; // Child holds only keys < low
+            if (i > 0 && node->keys[i - 1] > high) break;             // Children from here on hold keys > high
+            status = for_each_recursive(handle, node->children[i], low, high, visit, ctx);
+        }
+    }
+    free(node);
+    return status;
+}
+
+/**
+ * Visit every key/offset in a specific B+ tree in ascending key order.
+ * Walks the tree rather than the leaf chain, so it works for copy-on-write
+ * trees too.
+ * @param handle The B+ Tree instance handle.
+ * @param visit Callback; a nonzero return stops the walk.
+ * @param ctx Passed through to the callback.
+ * @return 0 when done, 1 if stopped by the callback, -1 on read error.
+ */
+int btree_for_each(BTreeHandle* handle, BTreeVisitFn visit, void* ctx) {
+    return btree_for_each_range(handle, INT_MIN, INT_MAX, visit, ctx);
+}
+
+/**
+ * Visit the keys in [low, high] of a specific B+ tree in ascending order,
+ * reading only the nodes whose key range overlaps the interval.
+ * @param handle The B+ Tree instance handle.
+ * @param low Smallest key to visit.
+ * @param high Largest key to visit.
+ * @param visit Callback; a nonzero return stops the walk.
+ * @param ctx Passed through to the callback.
+ * @return 0 when done, 1 if stopped by the callback, -1 on read error.
+ */
+int btree_for_each_range(BTreeHandle* handle, int low, int high, BTreeVisitFn visit, void* ctx) {
+    if (!handle || !visit) return -1;
+    if (low > high) return 0;
+    return for_each_recursive(handle, handle->header.root_id, low, high, visit, ctx);
+}
+
 
 /**
  * Insert a key/offset into a node in a specific tree, handling splits.
@@ -238,12 +555,17 @@ long search(BTreeHandle* handle, int key) {
  * @param key Key to insert.
  * @param offset Offset of the row in data file.
  * @param node_id ID of the current node.
+ * @param depth Depth of the current node (root = 0), used to pin new upper-level nodes.
  * @return InsertResult indicating if a split occurred.
  */
-InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int node_id) {
-    InsertResult result = {0, 0, 0}; // Initialize result (no split yet)
+InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int node_id, int depth) {
+    InsertResult result = {0, 0, 0, node_id}; // Initialize result (no split yet)
     if (!handle) return result; // Should not happen
 
+    // Under copy-on-write a modified node is never overwritten in place; it
+    // is written to a fresh ID and the parent is redirected to it.
+    int cow = handle->header.flags & BTREE_FLAG_COW;
+
     Node* node = read_node(handle, node_id);
      if (!node) {
          fprintf(stderr, "Insert failed: Could not read node %d in '%s'\n", node_id, handle->index_path);
@@ -265,7 +587,8 @@ InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int nod
             node->keys[i + 1] = key;
             node->offsets[i + 1] = offset;
             node->num_keys++;
-            write_node(handle, node_id, node);
+            result.node_id = cow ? allocate_node(handle) : node_id;
+            write_node(handle, result.node_id, node);
             // result remains {0, 0, 0}
         } else {
             // Leaf is full, need to split
@@ -317,13 +640,21 @@ InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int nod
             // Allocate ID for the new node
             int new_node_id = allocate_node(handle);
 
-            // Update leaf node links
-            new_leaf.next_leaf = node->next_leaf;
-            node->next_leaf = new_node_id;
+            // Update leaf node links. Copy-on-write trees don't keep the leaf
+            // chain: the left neighbour would still point at the superseded copy.
+            if (cow) {
+                new_leaf.next_leaf = -1;
+                node->next_leaf = -1;
+                result.node_id = allocate_node(handle);
+            } else {
+                new_leaf.next_leaf = node->next_leaf;
+                node->next_leaf = new_node_id;
+            }
 
             // Write both nodes back to disk
-            write_node(handle, node_id, node);
+            write_node(handle, result.node_id, node);
             write_node(handle, new_node_id, &new_leaf);
+            if (depth < BTREE_PINNED_LEVELS) pin_node(handle, new_node_id, &new_leaf);
 
             // Prepare result for parent
             result.split_occurred = 1;
@@ -341,7 +672,13 @@ InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int nod
         int child_id = node->children[i];
 
         // Recursively insert into the child
-        InsertResult child_result = insert_into_node(handle, key, offset, child_id);
+        InsertResult child_result = insert_into_node(handle, key, offset, child_id, depth + 1);
+
+        // Redirect to the child's new copy; this node must then be copied too
+        node->children[i] = child_result.node_id;
+        if (cow) {
+            result.node_id = allocate_node(handle);
+        }
 
         // Check if the child split
         if (child_result.split_occurred) {
@@ -357,7 +694,7 @@ InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int nod
                 node->keys[i] = child_result.separator_key;
                 node->children[i + 1] = child_result.new_node_id;
                 node->num_keys++;
-                write_node(handle, node_id, node);
+                write_node(handle, result.node_id, node);
                 // result remains {0, 0, 0} - split was handled here
             } else {
                 // Internal node is full, need to split it
@@ -419,23 +756,49 @@ InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int nod
                 int new_node_id = allocate_node(handle);
 
                 // Write nodes
-                write_node(handle, node_id, node);
+                write_node(handle, result.node_id, node);
                 write_node(handle, new_node_id, &new_internal);
+                if (depth < BTREE_PINNED_LEVELS) pin_node(handle, new_node_id, &new_internal);
 
                 // Prepare result for parent (this node split)
                 result.split_occurred = 1;
                 result.separator_key = middle_key; // The middle key goes up
                 result.new_node_id = new_node_id;
             }
+        } else if (cow) {
+            // Child did not split, but its new ID must be recorded in our copy
+            write_node(handle, result.node_id, node);
         }
         // else: Child did not split, nothing more to do here. result remains {0,0,0}
     }
 
+    if (cow && depth < BTREE_PINNED_LEVELS) {
+        repin_node(handle, node_id, result.node_id, node);
+    }
+
     free(node); // Free the node read in this function call
     return result;
 }
 
 
+/**
+ * Make a copy-on-write tree's new root visible.
+ * All nodes of the new version are forced to disk first; the header write
+ * that follows is the single commit point, so a crash leaves either the old
+ * or the new tree, never a mix. Superseded pages are not reclaimed.
+ * @param handle The B+ Tree instance handle.
+ * @param new_root_id Root of the new tree version.
+ */
+static void commit_root(BTreeHandle* handle, int new_root_id) {
+    if (io_sync(handle->file) != 0) {
+        fprintf(stderr, "Error syncing '%s' before root swap: %s\n", handle->index_path, strerror(errno));
+        return; // Keep the old root; the new pages are unreachable garbage
+    }
+    handle->header.root_id = new_root_id;
+    update_btree_header(handle);
+    io_sync(handle->file);
+}
+
 /**
  * Insert a key and offset into a specific B+ tree (Public entry point).
  * @param handle The B+ Tree instance handle.
@@ -446,7 +809,8 @@ void btree_insert(BTreeHandle* handle, int key, long offset) {
     if (!handle) return;
 
     // Start insertion from the root node
-    InsertResult result = insert_into_node(handle, key, offset, handle->header.root_id);
+    InsertResult result = insert_into_node(handle, key, offset, handle->header.root_id, 0);
+    int root_id = result.node_id; // Differs from the current root under copy-on-write
 
     // Check if the root node itself was split
     if (result.split_occurred) {
@@ -456,7 +820,7 @@ void btree_insert(BTreeHandle* handle, int key, long offset) {
         new_root.is_leaf = 0; // New root is always internal (unless tree has only 1 node total, handled implicitly)
         new_root.num_keys = 1;
         new_root.keys[0] = result.separator_key;    // The key that came up from the split
-        new_root.children[0] = handle->header.root_id; // Old root is the left child
+        new_root.children[0] = root_id;             // Old root is the left child
         new_root.children[1] = result.new_node_id;     // New node from split is the right child
 
         // Allocate an ID for the new root
@@ -464,10 +828,342 @@ void btree_insert(BTreeHandle* handle, int key, long offset) {
 
         // Write the new root node to disk
         write_node(handle, new_root_id, &new_root);
+        root_id = new_root_id;
+        log_debug("Root split. New root ID: %d", new_root_id);
+    }
 
-        // Update the handle's header to point to the new root
-        handle->header.root_id = new_root_id;
+    if (handle->header.flags & BTREE_FLAG_COW) {
+        commit_root(handle, root_id);
+    } else if (result.split_occurred) {
+        // Update the handle's header to point to the new root.
+        // Unlike next_id, root_id cannot be rebuilt after a crash, so it is
+        // written immediately; root splits are rare (once per tree level).
+        handle->header.root_id = root_id;
         update_btree_header(handle); // Save the updated header
-        printf("Root split. New root ID: %d\n", new_root_id);
     }
+
+    if (result.split_occurred) {
+        btree_pin_upper_levels(handle); // Every level moved down by one
+    }
+}
+
+// --- Batched Operations ---
+// Sorted key batches are pushed down the tree together: each node on the
+// way is read once and the keys are partitioned among its children, so a
+// batch costs one descent per leaf touched instead of one per key.
+
+/**
+ * Look up a sorted batch of keys under a node (recursive part).
+ * @return 0 on success, -1 on read error.
+ */
+static int search_batch_recursive(BTreeHandle* handle, const int* keys, int n, long* offsets_out, int node_id) {
+    Node* node = read_node(handle, node_id);
+    if (!node) {
+        fprintf(stderr, "Batch search failed: Could not read node %d in '%s'\n", node_id, handle->index_path);
+        return -1;
+    }
+    int status = 0;
+    if (node->is_leaf) {
+        // Merge the batch against the leaf's sorted keys
+        int j = 0;
+        for (int i = 0; i < n; i++) {
+            while (j < node->num_keys && node->keys[j] < keys[i]) j++;
+            offsets_out[i] = (j < node->num_keys && node->keys[j] == keys[i]) ? node->offsets[j] : -1;
+        }
+    } else {
+        int start = 0;
+        for (int c = 0; c <= node->num_keys && start < n && status == 0; c++) {
+            int end = start;
+            while (end < n && (c == node->num_keys || keys[end] < node->keys[c])) end++;
+            if (end > start) {
+                status = search_batch_recursive(handle, keys + start, end - start, offsets_out + start, node->children[c]);
+            }
+            start = end;
+        }
+    }
+    free(node);
+    return status;
+}
+
+/**
+ * Look up a batch of keys in a specific B+ tree.
+ * @param handle The B+ Tree instance handle.
+ * @param keys Keys in ascending order.
+ * @param n Number of keys.
+ * @param offsets_out Receives each key's offset, or -1 if absent.
+ * @return 0 on success, -1 on error.
+ */
+int btree_search_batch(BTreeHandle* handle, const int* keys, int n, long* offsets_out) {
+    if (!handle || n < 0 || (n > 0 && (!keys || !offsets_out))) return -1;
+    if (n == 0) return 0;
+    return search_batch_recursive(handle, keys, n, offsets_out, handle->header.root_id);
+}
+
+// New right siblings produced when a batch overflows a node
+typedef struct {
+    int count;
+    int capacity;
+    int* separators;  // First key under each new sibling
+    int* node_ids;
+} BatchSplit;
+
+static int batch_split_push(BatchSplit* split, int separator, int node_id) {
+    if (split->count == split->capacity) {
+        int new_capacity = split->capacity ? split->capacity * 2 : 8;
+        int* separators = realloc(split->separators, new_capacity * sizeof(int));
+        if (!separators) return -1;
+        split->separators = separators;
+        int* node_ids = realloc(split->node_ids, new_capacity * sizeof(int));
+        if (!node_ids) return -1;
+        split->node_ids = node_ids;
+        split->capacity = new_capacity;
+    }
+    split->separators[split->count] = separator;
+    split->node_ids[split->count] = node_id;
+    split->count++;
+    return 0;
+}
+
+static void batch_split_free(BatchSplit* split) {
+    free(split->separators);
+    free(split->node_ids);
+    memset(split, 0, sizeof(BatchSplit));
+}
+
+/**
+ * Write k sorted entries as ceil(k / (M-1)) evenly filled, chained leaves.
+ * @param first_id ID for the first leaf; the others are allocated and reported in split.
+ * @param next_leaf Leaf chain successor of the last leaf.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int write_leaf_parts(BTreeHandle* handle, const int* keys, const long* offsets, int k,
+                            int first_id, int next_leaf, BatchSplit* split) {
+    int parts = (k + M - 2) / (M - 1);
+    int pos = 0;
+    int id = first_id;
+    for (int p = 0; p < parts; p++) {
+        Node leaf;
+        memset(&leaf, 0, sizeof(Node));
+        leaf.is_leaf = 1;
+        leaf.num_keys = k / parts + (p < k % parts);
+        for (int i = 0; i < leaf.num_keys; i++) {
+            leaf.keys[i] = keys[pos + i];
+            leaf.offsets[i] = offsets[pos + i];
+        }
+        int next_id = (p + 1 < parts) ? allocate_node(handle) : next_leaf;
+        leaf.next_leaf = next_id;
+        write_node(handle, id, &leaf);
+        pos += leaf.num_keys;
+        if (p + 1 < parts) {
+            if (batch_split_push(split, keys[pos], next_id) != 0) return -1;
+            id = next_id;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Write c children (with the c-1 keys separating them) as ceil(c / M)
+ * evenly filled internal nodes. The key between two nodes moves up.
+ * @param first_id ID for the first node, or -1 to allocate one.
+ * @param split Receives the nodes after the first.
+ * @return ID of the first node, or -1 on allocation failure.
+ */
+static int write_internal_parts(BTreeHandle* handle, const int* children, const int* keys, int c,
+                                int first_id, BatchSplit* split) {
+    int parts = (c + M - 1) / M;
+    int pos = 0;
+    int id = (first_id >= 0) ? first_id : allocate_node(handle);
+    int result = id;
+    for (int p = 0; p < parts; p++) {
+        Node node;
+        memset(&node, 0, sizeof(Node));
+        node.is_leaf = 0;
+        int count = c / parts + (p < c % parts);
+        node.num_keys = count - 1;
+        for (int i = 0; i < count; i++) node.children[i] = children[pos + i];
+        for (int i = 0; i < node.num_keys; i++) node.keys[i] = keys[pos + i];
+        write_node(handle, id, &node);
+        pos += count;
+        if (p + 1 < parts) {
+            id = allocate_node(handle);
+            if (batch_split_push(split, keys[pos - 1], id) != 0) return -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * Pin the new siblings of a split node that is itself pinned. They sit on
+ * the same level, so the upper levels stay resident without reloading them.
+ * @param handle The B+ Tree instance handle.
+ * @param node_id The node that was split.
+ * @param split Its new right siblings.
+ */
+static void pin_split_siblings(BTreeHandle* handle, int node_id, const BatchSplit* split) {
+    if (split->count == 0 || !find_pinned(handle, node_id)) return;
+    for (int s = 0; s < split->count; s++) {
+        Node* sibling = read_node(handle, split->node_ids[s]);
+        if (!sibling) continue;
+        pin_node(handle, split->node_ids[s], sibling);
+        free(sibling);
+    }
+}
+
+/**
+ * Insert a sorted batch under a node, splitting it into as many nodes as
+ * needed (recursive part, in-place trees only).
+ * @param split Receives the node's new right siblings.
+ * @return 0 on success, -1 on error.
+ */
+static int insert_batch_recursive(BTreeHandle* handle, const int* keys, const long* offsets, int n,
+                                  int node_id, BatchSplit* split) {
+    Node* node = read_node(handle, node_id);
+    if (!node) {
+        fprintf(stderr, "Batch insert failed: Could not read node %d in '%s'\n", node_id, handle->index_path);
+        return -1;
+    }
+    int status = 0;
+
+    if (node->is_leaf) {
+        int k = node->num_keys + n;
+        int* merged_keys = malloc(k * sizeof(int));
+        long* merged_offsets = malloc(k * sizeof(long));
+        if (!merged_keys || !merged_offsets) {
+            status = -1;
+        } else {
+            int i = 0, j = 0, out = 0;
+            while (i < node->num_keys || j < n) {
+                if (j == n || (i < node->num_keys && node->keys[i] < keys[j])) {
+                    merged_keys[out] = node->keys[i];
+                    merged_offsets[out++] = node->offsets[i++];
+                } else {
+                    merged_keys[out] = keys[j];
+                    merged_offsets[out++] = offsets[j++];
+                }
+            }
+            status = write_leaf_parts(handle, merged_keys, merged_offsets, k, node_id, node->next_leaf, split);
+            if (status == 0) pin_split_siblings(handle, node_id, split);
+        }
+        free(merged_keys);
+        free(merged_offsets);
+        free(node);
+        return status;
+    }
+
+    // Internal node: route each run of keys to its child, collecting the
+    // children's new siblings in key order
+    BatchSplit child_splits[M];
+    memset(child_splits, 0, sizeof(child_splits));
+    int start = 0;
+    int total_children = node->num_keys + 1;
+    for (int c = 0; c <= node->num_keys && status == 0; c++) {
+        int end = start;
+        while (end < n && (c == node->num_keys || keys[end] < node->keys[c])) end++;
+        if (end > start) {
+            status = insert_batch_recursive(handle, keys + start, offsets + start, end - start,
+                                            node->children[c], &child_splits[c]);
+            total_children += child_splits[c].count;
+        }
+        start = end;
+    }
+
+    if (status == 0) {
+        int* children = malloc(total_children * sizeof(int));
+        int* separators = malloc(total_children * sizeof(int));
+        if (!children || !separators) {
+            status = -1;
+        } else {
+            // separators[i] divides children[i] and children[i + 1]
+            int c_out = 0;
+            for (int c = 0; c <= node->num_keys; c++) {
+                if (c > 0) separators[c_out - 1] = node->keys[c - 1];
+                children[c_out++] = node->children[c];
+                for (int s = 0; s < child_splits[c].count; s++) {
+                    separators[c_out - 1] = child_splits[c].separators[s];
+                    children[c_out++] = child_splits[c].node_ids[s];
+                }
+            }
+            if (total_children > node->num_keys + 1) {
+                if (write_internal_parts(handle, children, separators, total_children, node_id, split) < 0) {
+                    status = -1;
+                } else {
+                    pin_split_siblings(handle, node_id, split);
+                }
+            }
+        }
+        free(children);
+        free(separators);
+    }
+
+    for (int c = 0; c < M; c++) batch_split_free(&child_splits[c]);
+    free(node);
+    return status;
+}
+
+/**
+ * Insert a batch of new keys into a specific B+ tree, one descent per leaf
+ * touched. Copy-on-write trees fall back to one insert (and root commit)
+ * per key.
+ * @param handle The B+ Tree instance handle.
+ * @param keys Keys in ascending order, none already present.
+ * @param offsets Offset of each key's row in the data file.
+ * @param n Number of keys.
+ * @return 0 on success, -1 on error.
+ */
+int btree_insert_batch(BTreeHandle* handle, const int* keys, const long* offsets, int n) {
+    if (!handle || n < 0 || (n > 0 && (!keys || !offsets))) return -1;
+    if (handle->header.flags & BTREE_FLAG_COW) {
+        for (int i = 0; i < n; i++) btree_insert(handle, keys[i], offsets[i]);
+        return 0;
+    }
+    if (n == 0) return 0;
+
+    BatchSplit split;
+    memset(&split, 0, sizeof(split));
+    int root_changed = 0;
+    int status = insert_batch_recursive(handle, keys, offsets, n, handle->header.root_id, &split);
+
+    if (status == 0 && split.count > 0) {
+        // The root overflowed: grow new levels until one node holds them all
+        int c = split.count + 1;
+        int* children = malloc(c * sizeof(int));
+        int* separators = malloc(c * sizeof(int));
+        if (!children || !separators) {
+            status = -1;
+        } else {
+            children[0] = handle->header.root_id;
+            memcpy(children + 1, split.node_ids, split.count * sizeof(int));
+            memcpy(separators, split.separators, split.count * sizeof(int));
+            while (status == 0) {
+                BatchSplit level;
+                memset(&level, 0, sizeof(level));
+                int first = write_internal_parts(handle, children, separators, c, -1, &level);
+                if (first < 0) {
+                    status = -1;
+                } else if (level.count == 0) {
+                    handle->header.root_id = first;
+                    update_btree_header(handle); // Written immediately, as in btree_insert
+                    log_debug("Root split. New root ID: %d", first);
+                    root_changed = 1;
+                    batch_split_free(&level);
+                    break;
+                } else {
+                    children[0] = first;
+                    memcpy(children + 1, level.node_ids, level.count * sizeof(int));
+                    memcpy(separators, level.separators, level.count * sizeof(int));
+                    c = level.count + 1;
+                }
+                batch_split_free(&level);
+            }
+        }
+        free(children);
+        free(separators);
+    }
+    batch_split_free(&split);
+
+    // Rewritten pinned nodes were updated in place and split ones had their
+    // siblings pinned; only new root levels push everything down a level
+    if (root_changed) btree_pin_upper_levels(handle);
+    return status;
 }
@@ -7,7 +7,7 @@
 // --- Function Prototypes (Now take BTreeHandle*) ---
 
 // Initialize/Open a B+ Tree index file
-BTreeHandle* init_btree(const char* index_path);
+BTreeHandle* init_btree(const char* index_path, int flags, int io_flags);
 
 // Close a B+ Tree index file and free handle
 void close_btree(BTreeHandle* handle);
@@ -20,13 +20,30 @@ void write_node(BTreeHandle* handle, int node_id, Node* node);
 long search(BTreeHandle* handle, int key); // Entry point for search
 long search_recursive(BTreeHandle* handle, int key, int node_id); // Internal recursive part
 
+// Visit every key/offset in ascending key order; a nonzero return from
+// `visit` stops the walk. Returns 0 when done, 1 if stopped, -1 on error.
+typedef int (*BTreeVisitFn)(int key, long offset, void* ctx);
+int btree_for_each(BTreeHandle* handle, BTreeVisitFn visit, void* ctx);
+int btree_for_each_range(BTreeHandle* handle, int low, int high, BTreeVisitFn visit, void* ctx); // Keys in [low, high]
+
 // Insert into a specific tree
 void btree_insert(BTreeHandle* handle, int key, long offset); // Entry point
-InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int node_id); // Internal recursive part
+InsertResult insert_into_node(BTreeHandle* handle, int key, long offset, int node_id, int depth); // Internal recursive part
+
+// Batched lookups/inserts for keys in ascending order: one descent per leaf touched
+int btree_search_batch(BTreeHandle* handle, const int* keys, int n, long* offsets_out);
+int btree_insert_batch(BTreeHandle* handle, const int* keys, const long* offsets, int n);
 
 // Helper functions (internal or public if needed)
 void update_btree_header(BTreeHandle* handle);
+void btree_checkpoint(BTreeHandle* handle); // Persist header if dirty
+
+// Check every node checksum on disk; returns number of bad nodes or -1
+int btree_verify(const BTreeHandle* handle, int* nodes_checked);
 int allocate_node(BTreeHandle* handle);
 
+// Reload the resident root and upper levels (after open or a root change)
+void btree_pin_upper_levels(BTreeHandle* handle);
+
 
 #endif // BTREE_H
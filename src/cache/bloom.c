@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "bloom.h"
+#include "../btree/btree.h"
+#include "../util/crc32c.h"
+#include "../util/log.h"
+
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_WORDS * 64)
+
+// On-disk header, followed by the blocks
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dirty;       // 1 while the in-memory filter has unsaved changes
+    uint32_t checksum;    // CRC32C of the blocks
+    uint64_t num_blocks;
+    uint64_t num_keys;
+} BloomHeader;
+
+/**
+ * Mix a key into a well-distributed 64-bit hash (splitmix64 finalizer).
+ * The high half picks the block, the low bits pick positions inside it.
+ */
+static uint64_t hash_key(int key) {
+    uint64_t h = (uint32_t)key;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static uint64_t* block_for(const BloomFilter* filter, uint64_t hash) {
+    // Multiply-shift maps the hash onto [0, num_blocks) without a division
+    size_t block = (size_t)(((hash >> 32) * (uint64_t)filter->num_blocks) >> 32);
+    return &filter->bits[block * BLOOM_BLOCK_WORDS];
+}
+
+static size_t capacity_for(size_t num_blocks) {
+    return num_blocks * BLOOM_BLOCK_BITS / BLOOM_BITS_PER_KEY;
+}
+
+/**
+ * Allocate zeroed, cache-line aligned blocks.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int alloc_blocks(BloomFilter* filter, size_t num_blocks) {
+    uint64_t* bits = aligned_alloc(64, num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    if (!bits) {
+        perror("Error allocating Bloom filter");
+        return -1;
+    }
+    memset(bits, 0, num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    free(filter->bits);
+    filter->bits = bits;
+    filter->num_blocks = num_blocks;
+    filter->capacity = capacity_for(num_blocks);
+    return 0;
+}
+
+static void set_bits(BloomFilter* filter, int key) {
+    uint64_t hash = hash_key(key);
+    uint64_t* block = block_for(filter, hash);
+    // Double hashing inside the block: positions a, a+b, a+2b, ... (b odd)
+    uint32_t a = (uint32_t)hash & (BLOOM_BLOCK_BITS - 1);
+    uint32_t b = ((uint32_t)(hash >> 9) & (BLOOM_BLOCK_BITS - 1)) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (a + i * b) & (BLOOM_BLOCK_BITS - 1);
+        block[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+/**
+ * Write the header, with the given dirty flag, to the sidecar file.
+ * @return 0 on success, -1 on error.
+ */
+static int write_header(BloomFilter* filter, int dirty) {
+    BloomHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = BLOOM_MAGIC;
+    header.version = 1;
+    header.dirty = (uint32_t)dirty;
+    header.checksum = crc32c(filter->bits, filter->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    header.num_blocks = filter->num_blocks;
+    header.num_keys = filter->num_keys;
+    if (io_pwrite(filter->file, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        fprintf(stderr, "Error writing Bloom filter header '%s': %s\n", filter->file->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int add_visit(int key, long offset, void* ctx) {
+    (void)offset;
+    BloomFilter* filter = ctx;
+    set_bits(filter, key);
+    filter->num_keys++;
+    return 0;
+}
+
+static int count_visit(int key, long offset, void* ctx) {
+    (void)key;
+    (void)offset;
+    (*(size_t*)ctx)++;
+    return 0;
+}
+
+/**
+ * Repopulate the filter from every key in the index, sized with room for
+ * the table to double before the next rebuild. The new blocks are filled
+ * on the side and only swapped in once they hold every key, so a failure
+ * leaves the current filter as it was.
+ * @return 0 on success, -1 on error.
+ */
+static int rebuild(BloomFilter* filter) {
+    size_t keys = 0;
+    if (btree_for_each(filter->index, count_visit, &keys) < 0) return -1;
+    size_t num_blocks = (2 * keys * BLOOM_BITS_PER_KEY + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    if (num_blocks < BLOOM_MIN_BLOCKS) num_blocks = BLOOM_MIN_BLOCKS;
+    BloomFilter fresh = *filter;
+    fresh.bits = NULL;
+    fresh.num_keys = 0;
+    if (alloc_blocks(&fresh, num_blocks) != 0) return -1;
+    if (btree_for_each(filter->index, add_visit, &fresh) < 0) {
+        free(fresh.bits);
+        return -1;
+    }
+    free(filter->bits);
+    filter->bits = fresh.bits;
+    filter->num_blocks = fresh.num_blocks;
+    filter->capacity = fresh.capacity;
+    filter->num_keys = fresh.num_keys;
+    filter->dirty = 1;
+    return 0;
+}
+
+/**
+ * Read a clean filter from the sidecar file.
+ * @return 0 if a usable filter was loaded, -1 if it must be rebuilt.
+ */
+static int load(BloomFilter* filter) {
+    BloomHeader header;
+    if (io_pread(filter->file, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return -1;
+    if (header.magic != BLOOM_MAGIC || header.version != 1 || header.dirty ||
+        header.num_blocks == 0 || header.num_blocks > SIZE_MAX / (BLOOM_BLOCK_WORDS * sizeof(uint64_t))) {
+        return -1;
+    }
+    if (alloc_blocks(filter, (size_t)header.num_blocks) != 0) return -1;
+    size_t bytes = filter->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    if (io_pread(filter->file, filter->bits, bytes, sizeof(header)) != (ssize_t)bytes) return -1;
+    if (crc32c(filter->bits, bytes) != header.checksum) return -1;
+    filter->num_keys = (size_t)header.num_keys;
+    return 0;
+}
+
+/**
+ * Open (or build) the primary key filter for an index.
+ * @param path Path to the filter file.
+ * @param index The table's primary key index.
+ * @return The filter, or NULL on error.
+ */
+BloomFilter* bloom_filter_open(const char* path, BTreeHandle* index) {
+    if (!index) return NULL;
+    BloomFilter* filter = calloc(1, sizeof(BloomFilter));
+    if (!filter) {
+        perror("Failed to allocate memory for BloomFilter");
+        return NULL;
+    }
+    filter->index = index;
+    filter->file = io_open(path, IO_OPEN_CREATE);
+    if (!filter->file) {
+        fprintf(stderr, "Warning: Could not open Bloom filter '%s': %s\n", path, strerror(errno));
+        free(filter);
+        return NULL;
+    }
+
+    if (load(filter) != 0) {
+        if (rebuild(filter) != 0) {
+            fprintf(stderr, "Warning: Could not rebuild Bloom filter '%s' from the index.\n", path);
+            io_close(filter->file);
+            free(filter->bits);
+            free(filter);
+            return NULL;
+        }
+        log_info("Rebuilt Bloom filter '%s' from index (%zu keys)", path, filter->num_keys);
+        bloom_filter_save(filter);
+    }
+    return filter;
+}
+
+/**
+ * Check whether a key may be present.
+ * @param filter The filter (NULL means "may be present").
+ * @param key Primary key value.
+ * @return 0 if the key is definitely absent, 1 otherwise.
+ */
+int bloom_filter_may_contain(BloomFilter* filter, int key) {
+    if (!filter) return 1;
+    uint64_t hash = hash_key(key);
+    const uint64_t* block = block_for(filter, hash);
+    uint32_t a = (uint32_t)hash & (BLOOM_BLOCK_BITS - 1);
+    uint32_t b = ((uint32_t)(hash >> 9) & (BLOOM_BLOCK_BITS - 1)) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (a + i * b) & (BLOOM_BLOCK_BITS - 1);
+        if (!(block[bit >> 6] & (1ULL << (bit & 63)))) {
+            filter->negatives++;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Mark the file dirty ahead of an index write, so a crash before the new
+ * keys reach the filter forces a rebuild instead of leaving a file that
+ * claims to be complete without them.
+ * @param filter The filter (may be NULL).
+ * @return 0 on success, -1 if the file still claims to be complete (the
+ *         caller must stop using the filter and call bloom_filter_discard).
+ */
+int bloom_filter_mark_dirty(BloomFilter* filter) {
+    if (!filter || filter->dirty) return 0;
+    if (write_header(filter, 1) != 0) return -1;
+    filter->dirty = 1;
+    return 0;
+}
+
+/**
+ * Add a key that was just inserted into the index.
+ * @param filter The filter (may be NULL).
+ * @param key Primary key value.
+ * @return 0 on success, -1 if the filter can no longer be trusted (the
+ *         caller must stop using it and call bloom_filter_discard).
+ */
+int bloom_filter_add(BloomFilter* filter, int key) {
+    if (!filter) return 0;
+    if (bloom_filter_mark_dirty(filter) != 0) return -1;
+    if (filter->num_keys >= filter->capacity) {
+        // Full: false positive rate would climb, so resize from the index
+        // (which already holds `key`)
+        if (rebuild(filter) == 0) return 0;
+        fprintf(stderr, "Warning: Bloom filter rebuild failed; keeping the overfull filter.\n");
+    }
+    set_bits(filter, key);
+    filter->num_keys++;
+    return 0;
+}
+
+/**
+ * Write the filter to its file if it changed, then clear the dirty flag.
+ * @param filter The filter (may be NULL).
+ * @return 0 on success, -1 on error.
+ */
+int bloom_filter_save(BloomFilter* filter) {
+    if (!filter || !filter->dirty) return 0;
+    size_t bytes = filter->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    if (io_pwrite(filter->file, filter->bits, bytes, sizeof(BloomHeader)) != (ssize_t)bytes) {
+        fprintf(stderr, "Error writing Bloom filter '%s': %s\n", filter->file->path, strerror(errno));
+        return -1;
+    }
+    if (write_header(filter, 0) != 0) return -1;
+    filter->dirty = 0;
+    return 0;
+}
+
+/**
+ * Save and free a filter.
+ * @param filter The filter (may be NULL).
+ */
+void bloom_filter_close(BloomFilter* filter) {
+    if (!filter) return;
+    bloom_filter_save(filter);
+    io_close(filter->file);
+    free(filter->bits);
+    free(filter);
+}
+
+/**
+ * Free a filter that missed a key, without saving it. The file is removed
+ * so the next open rebuilds it from the index instead of trusting it.
+ * @param filter The filter (may be NULL).
+ */
+void bloom_filter_discard(BloomFilter* filter) {
+    if (!filter) return;
+    if (unlink(filter->file->path) != 0 && errno != ENOENT) {
+        fprintf(stderr, "Error removing Bloom filter '%s': %s\n", filter->file->path, strerror(errno));
+    }
+    io_close(filter->file);
+    free(filter->bits);
+    free(filter);
+}
@@ -0,0 +1,54 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../structs.h"
+
+// --- Primary Key Bloom Filter ---
+// Blocked Bloom filter over a table's primary keys. Every key maps to one
+// 512-bit (cache-line sized) block and sets BLOOM_HASHES bits inside it, so a
+// lookup touches a single cache line. A "no" answer is definite and lets
+// inserts and selects skip the B+ tree descent; "maybe" falls through to the
+// index. The filter is saved next to the index at checkpoints. A dirty flag
+// is written to the file before the index first changes after a save, so a
+// filter left dirty by a crash (or missing) is rebuilt from the index on open.
+
+#define BLOOM_BLOCK_WORDS 8 // 64-bit words per 512-bit block
+
+typedef struct BloomFilter {
+    IoFile* file;            // Sidecar file
+    BTreeHandle* index;      // Source of truth for rebuilds
+    uint64_t* bits;          // num_blocks * BLOOM_BLOCK_WORDS words, cache-line aligned
+    size_t num_blocks;
+    size_t num_keys;         // Keys added since the last rebuild
+    size_t capacity;         // Keys the filter holds at BLOOM_BITS_PER_KEY before growing
+    int dirty;               // 1 if changed since the last save (flag also set on disk)
+    size_t negatives;        // Lookups answered "absent" without touching the index
+} BloomFilter;
+
+// Load the filter at `path`, rebuilding it from `index` if it is missing,
+// dirty or corrupt. Returns NULL on error (callers run without a filter).
+BloomFilter* bloom_filter_open(const char* path, BTreeHandle* index);
+
+// 0 if `key` is definitely not in the index, 1 if it may be.
+int bloom_filter_may_contain(BloomFilter* filter, int key);
+
+// Set the dirty flag on disk before writing keys to the index. Returns -1
+// if that failed and the filter must be discarded.
+int bloom_filter_mark_dirty(BloomFilter* filter);
+
+// Record a key just inserted into the index (grows the filter when full).
+// Returns -1 if the filter may now miss keys; discard it then.
+int bloom_filter_add(BloomFilter* filter, int key);
+
+// Persist the filter if it changed; 0 on success, -1 on error.
+int bloom_filter_save(BloomFilter* filter);
+
+// Save and free the filter.
+void bloom_filter_close(BloomFilter* filter);
+
+// Free the filter without saving and delete its file (after a failed add).
+void bloom_filter_discard(BloomFilter* filter);
+
+#endif // BLOOM_H
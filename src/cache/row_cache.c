@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "row_cache.h"
+
+/**
+ * Mix a key into a well-distributed 32-bit hash (murmur3 finalizer).
+ * Sequential primary keys would otherwise all land in neighbouring buckets.
+ */
+static uint32_t hash_key(int key) {
+    uint32_t h = (uint32_t)key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+static RowCacheShard* shard_for(RowCache* cache, uint32_t hash) {
+    return &cache->shards[hash & (ROW_CACHE_SHARDS - 1)];
+}
+
+static size_t home_bucket(const RowCacheShard* shard, uint32_t hash) {
+    // Low bits pick the shard, so use the high bits for the bucket.
+    return (size_t)(hash >> 8) & (shard->index_size - 1);
+}
+
+/**
+ * Find the hash bucket holding `key`.
+ * @return Bucket position, or -1 if the key is not cached.
+ */
+static long find_bucket(const RowCacheShard* shard, int key, uint32_t hash) {
+    size_t pos = home_bucket(shard, hash);
+    while (shard->index[pos] != -1) {
+        if (shard->entries[shard->index[pos]].key == key) {
+            return (long)pos;
+        }
+        pos = (pos + 1) & (shard->index_size - 1);
+    }
+    return -1;
+}
+
+/**
+ * Remove a bucket from the linear-probing index, shifting later entries of the
+ * same probe run back so lookups never hit a premature empty slot.
+ */
+static void remove_bucket(RowCacheShard* shard, size_t pos) {
+    size_t mask = shard->index_size - 1;
+    size_t hole = pos;
+    size_t next = (pos + 1) & mask;
+
+    while (shard->index[next] != -1) {
+        int slot = shard->index[next];
+        size_t home = home_bucket(shard, hash_key(shard->entries[slot].key));
+        // Move the entry into the hole if its home is not between hole and next (cyclically)
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            shard->index[hole] = slot;
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    shard->index[hole] = -1;
+}
+
+/**
+ * Pick an entry slot to (re)use, sweeping the CLOCK hand past recently
+ * referenced entries and evicting the first cold one.
+ */
+static size_t claim_slot(RowCacheShard* shard) {
+    if (shard->used < shard->capacity) {
+        // Slots are filled in order before any eviction happens
+        return shard->used++;
+    }
+    while (1) {
+        RowCacheEntry* entry = &shard->entries[shard->hand];
+        size_t slot = shard->hand;
+        shard->hand = (shard->hand + 1) % shard->capacity;
+        if (entry->referenced) {
+            entry->referenced = 0; // Second chance
+            continue;
+        }
+        if (entry->valid) {
+            long pos = find_bucket(shard, entry->key, hash_key(entry->key));
+            if (pos != -1) remove_bucket(shard, (size_t)pos);
+            entry->valid = 0;
+        }
+        return slot;
+    }
+}
+
+/**
+ * Create a row cache.
+ * @param row_size Size in bytes of each cached row.
+ * @param capacity Total number of rows to keep (split evenly across shards).
+ * @return Pointer to the cache, or NULL on failure.
+ */
+RowCache* row_cache_create(size_t row_size, size_t capacity) {
+    if (row_size == 0 || capacity == 0) return NULL;
+
+    RowCache* cache = calloc(1, sizeof(RowCache));
+    if (!cache) {
+        perror("Failed to allocate memory for RowCache");
+        return NULL;
+    }
+    cache->row_size = row_size;
+    for (int i = 0; i < ROW_CACHE_SHARDS; ++i) {
+        pthread_mutex_init(&cache->shards[i].lock, NULL);
+    }
+
+    size_t per_shard = (capacity + ROW_CACHE_SHARDS - 1) / ROW_CACHE_SHARDS;
+    size_t index_size = 1;
+    while (index_size < per_shard * 2) index_size <<= 1; // Keep load factor <= 0.5
+
+    for (int i = 0; i < ROW_CACHE_SHARDS; ++i) {
+        RowCacheShard* shard = &cache->shards[i];
+        shard->capacity = per_shard;
+        shard->index_size = index_size;
+        shard->entries = calloc(per_shard, sizeof(RowCacheEntry));
+        shard->rows = malloc(per_shard * row_size);
+        shard->index = malloc(index_size * sizeof(int));
+        if (!shard->entries || !shard->rows || !shard->index) {
+            perror("Failed to allocate memory for row cache shard");
+            row_cache_destroy(cache);
+            return NULL;
+        }
+        memset(shard->index, -1, index_size * sizeof(int));
+    }
+    return cache;
+}
+
+/**
+ * Free a row cache and all cached rows.
+ * @param cache The cache (may be NULL).
+ */
+void row_cache_destroy(RowCache* cache) {
+    if (!cache) return;
+    for (int i = 0; i < ROW_CACHE_SHARDS; ++i) {
+        free(cache->shards[i].entries);
+        free(cache->shards[i].rows);
+        free(cache->shards[i].index);
+        pthread_mutex_destroy(&cache->shards[i].lock);
+    }
+    free(cache);
+}
+
+/**
+ * Look up a row by primary key.
+ * @param cache The cache.
+ * @param key Primary key value.
+ * @param row_out Buffer of at least row_size bytes receiving the row on a hit.
+ * @return 1 on hit, 0 on miss.
+ */
+int row_cache_get(RowCache* cache, int key, void* row_out) {
+    if (!cache) return 0;
+    uint32_t hash = hash_key(key);
+    RowCacheShard* shard = shard_for(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    long pos = find_bucket(shard, key, hash);
+    if (pos == -1) {
+        shard->misses++;
+        pthread_mutex_unlock(&shard->lock);
+        return 0;
+    }
+    int slot = shard->index[pos];
+    shard->entries[slot].referenced = 1;
+    memcpy(row_out, shard->rows + (size_t)slot * cache->row_size, cache->row_size);
+    shard->hits++;
+    pthread_mutex_unlock(&shard->lock);
+    return 1;
+}
+
+/**
+ * Insert or refresh a row in the cache.
+ * @param cache The cache.
+ * @param key Primary key value.
+ * @param row_data Row body (row_size bytes).
+ */
+void row_cache_put(RowCache* cache, int key, const void* row_data) {
+    if (!cache || !row_data) return;
+    uint32_t hash = hash_key(key);
+    RowCacheShard* shard = shard_for(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    long pos = find_bucket(shard, key, hash);
+    if (pos != -1) {
+        int slot = shard->index[pos];
+        memcpy(shard->rows + (size_t)slot * cache->row_size, row_data, cache->row_size);
+        shard->entries[slot].referenced = 1;
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+
+    size_t slot = claim_slot(shard);
+    RowCacheEntry* entry = &shard->entries[slot];
+    entry->key = key;
+    entry->valid = 1;
+    entry->referenced = 0; // New entries must earn their second chance
+    memcpy(shard->rows + slot * cache->row_size, row_data, cache->row_size);
+
+    size_t bucket = home_bucket(shard, hash);
+    while (shard->index[bucket] != -1) {
+        bucket = (bucket + 1) & (shard->index_size - 1);
+    }
+    shard->index[bucket] = (int)slot;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/**
+ * Drop a row from the cache. Safe to call for keys that are not cached.
+ * @param cache The cache.
+ * @param key Primary key value.
+ */
+void row_cache_invalidate(RowCache* cache, int key) {
+    if (!cache) return;
+    uint32_t hash = hash_key(key);
+    RowCacheShard* shard = shard_for(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    long pos = find_bucket(shard, key, hash);
+    if (pos != -1) {
+        int slot = shard->index[pos];
+        remove_bucket(shard, (size_t)pos);
+        shard->entries[slot].valid = 0;
+        shard->entries[slot].referenced = 0;
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/**
+ * Collect hit/miss counters and occupancy summed over all shards.
+ * @param cache The cache.
+ * @param out Receives the totals.
+ */
+void row_cache_stats(RowCache* cache, RowCacheStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(RowCacheStats));
+    if (!cache) return;
+    for (int i = 0; i < ROW_CACHE_SHARDS; ++i) {
+        RowCacheShard* shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        out->hits += shard->hits;
+        out->misses += shard->misses;
+        out->capacity += shard->capacity;
+        for (size_t j = 0; j < shard->used; ++j) {
+            if (shard->entries[j].valid) out->entries++;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
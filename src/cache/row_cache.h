@@ -0,0 +1,61 @@
+#ifndef ROW_CACHE_H
+#define ROW_CACHE_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "../constants.h"
+
+// --- Hot-Row Cache ---
+// Bounded cache of row bodies keyed by primary key. Entries are spread over
+// ROW_CACHE_SHARDS independent shards; each shard evicts with CLOCK
+// (second-chance), so hot keys survive while one-off lookups age out.
+// Each shard has its own lock, so lookups from parallel scan workers only
+// wait for each other when they hit the same shard.
+
+typedef struct {
+    int key;          // Primary key value
+    int valid;        // 1 if the slot holds a row
+    int referenced;   // CLOCK reference bit
+} RowCacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;   // Guards everything below
+    RowCacheEntry* entries; // Entry slots, evicted in CLOCK order
+    char* rows;             // Row bodies, entries[i] owns rows[i * row_size]
+    int* index;             // Open-addressing hash: key -> entry slot (-1 = empty)
+    size_t capacity;        // Number of entry slots
+    size_t index_size;      // Number of hash buckets (power of two)
+    size_t used;            // Number of valid entries
+    size_t hand;            // CLOCK hand
+    size_t hits;
+    size_t misses;
+} RowCacheShard;
+
+typedef struct RowCache {
+    size_t row_size;
+    RowCacheShard shards[ROW_CACHE_SHARDS];
+} RowCache;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t entries;
+    size_t capacity;
+} RowCacheStats;
+
+// Create a cache holding up to `capacity` rows of `row_size` bytes.
+RowCache* row_cache_create(size_t row_size, size_t capacity);
+void row_cache_destroy(RowCache* cache);
+
+// Copy the cached row for `key` into `row_out`. Returns 1 on hit, 0 on miss.
+int row_cache_get(RowCache* cache, int key, void* row_out);
+
+// Insert or refresh the row for `key`, evicting a cold entry if needed.
+void row_cache_put(RowCache* cache, int key, const void* row_data);
+
+// Drop `key` from the cache (call when the row is updated or deleted).
+void row_cache_invalidate(RowCache* cache, int key);
+
+void row_cache_stats(RowCache* cache, RowCacheStats* out);
+
+#endif // ROW_CACHE_H
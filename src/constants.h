@@ -4,17 +4,63 @@
 // Constants
 #define M 3             // Order of the B+ tree (max children)
 #define HEADER_SIZE 32  // Fixed size for the file header
+#define BTREE_FLAG_COW 0x1     // Index header flag: copy-on-write updates with atomic root swap
+#define BTREE_PINNED_LEVELS 4 // Upper B+ tree levels kept resident in memory (root = level 0)
 #define MAGIC 0x12345678 // Magic number to identify the file format
+#define BTREE_VERSION 2  // Index file format version (2 = checksummed nodes)
 #define NAME_LEN 50      // Max length for name field NOTE: remove if unused
 #define MAX_TABLE_NAME_LEN 64
 #define MAX_COLUMN_NAME_LEN 64
-#define MAX_COLUMNS 32 // Max columns per table
-#define MAX_TABLES 16 // Max tables in the database
+#define MAX_STRING_COLUMN_SIZE (1024 * 10) // Largest STRING(n) column
 
-#define DATA_DIR "db_data"       // Root directory for database files
-#define METADATA_FILE "metadata.dbm"
+#define DATA_DIR "db_data"       // Database directory the REPL opens by default
+#define METADATA_FILE "metadata.dbm"  // Catalog of tables and columns; rewritten by CREATE/DROP TABLE
 #define TABLE_DATA_EXT ".tbl"
 #define PK_INDEX_EXT ".idx"
+#define ROW_CHECKSUM_SIZE 4 // CRC32C trailer stored after every row in the data file
+#define DATA_FORMAT_VERSION 2 // Row format of data files (1 = bare rows, 2 = CRC32C trailer), kept in the metadata file
 #define MAX_PATH_LEN 256
 
+#define VERIFY_CHUNK_SIZE (256 * 1024) // Bytes per read when verifying files
+#define VERIFY_READS_IN_FLIGHT 4        // Concurrent reads per file during VERIFY
+#define SCAN_READ_SIZE (1024 * 1024)    // Bytes per aligned read in table scans (double-buffered)
+
+#define ROW_CACHE_CAPACITY 4096 // Max rows kept in each table's hot-row cache
+#define ROW_CACHE_SHARDS 8      // Number of row cache shards (power of two)
+
+#define PK_BLOOM_EXT ".bloom"  // Bloom filter over primary keys, stored beside the pk index
+#define BLOOM_MAGIC 0x424C4F4D // "BLOM"
+#define BLOOM_BITS_PER_KEY 10  // Filter bits per key (~1% false positives with 7 hashes)
+#define BLOOM_HASHES 7         // Bits set per key inside its 512-bit block
+#define BLOOM_MIN_BLOCKS 64    // Smallest filter: 64 blocks = 4 KiB
+
+#define MAX_PREPARED_STATEMENTS 64 // Named statements kept by PREPARE
+#define MAX_STATEMENT_NAME_LEN 64
+
+#define ZONE_MAP_EXT ".zmap"              // Sidecar file with per-block min/max of INT columns
+#define ZONE_MAP_MAGIC 0x5A4D4150         // "ZMAP"
+#define ZONE_MAP_BLOCK_SIZE (64 * 1024)   // Data file bytes summarized by one zone map entry
+
+#define STATS_FILE "stats.dbm"        // Table statistics from ANALYZE, beside the metadata file
+#define STATS_HLL_BITS 10             // HyperLogLog index bits: 2^10 registers per column (~3% error)
+#define STATS_HISTOGRAM_BUCKETS 32    // Equi-depth histogram buckets per INT column
+#define STATS_SAMPLE_ROWS 30000       // Rows reservoir-sampled by ANALYZE to build histograms
+
+#define PARALLEL_SCAN_MIN_BYTES (8 * 1024 * 1024) // Full scans of smaller tables stay single-threaded
+#define MAX_SCAN_THREADS 8                        // Worker threads for a parallel full scan
+#define PLAN_ROW_FETCH_COST 4.0 // Cost of fetching one row through the index, in sequential page reads
+
+#define JOIN_MEMORY_BUDGET (64 * 1024 * 1024)  // Build rows a hash join holds in memory before it spills to disk
+#define JOIN_SPILL_PARTITION_BITS 5            // A spilling hash join splits each input into 2^5 temp files
+#define JOIN_SPILL_MAX_SPLITS 3                // Times a partition still over the budget is split again
+#define JOIN_RADIX_CLUSTER_BYTES (256 * 1024)  // Target build rows per radix cluster (about one L2 cache)
+#define JOIN_RADIX_MAX_BITS 10                 // At most 2^10 radix clusters
+
+#define SORT_MEMORY_BUDGET (32 * 1024 * 1024)  // Rows ORDER BY sorts in memory before it writes sorted runs to disk
+#define SORT_MERGE_FANIN 64                    // Runs merged at once; more runs take extra merge passes
+#define SORT_RUN_BUFFER_BYTES (64 * 1024)      // Read buffer per run during a merge
+#define REINDEX_BATCH_KEYS 4096                // Sorted keys per batched insert when building an index
+
+#define CURSOR_BATCH_BYTES (64 * 1024) // Result rows a library cursor keeps in memory before spilling to a temp file
+
 #endif
@@ -4,18 +4,24 @@
 #include <errno.h>
 #include <sys/stat.h>   // For mkdir
 #include <sys/types.h> // For mkdir types
+#include <pthread.h>
+#include <limits.h>
+#include <unistd.h>    // For unlink
+#include <dirent.h>    // For removing table directories
 #include "database.h"
 #include "../btree/btree.h" // Include new btree prototypes
+#include "../cache/row_cache.h"
+#include "../cache/bloom.h"
+#include "../util/crc32c.h"
+#include "../util/extsort.h"
+#include "../util/log.h"
+#include "../io/io.h"
+#include "scan.h"
+#include "zonemap.h"
+#include "stats.h"
 #include "../constants.h"
 #include "../structs.h"
 
-// --- Global Schema Storage ---
-TableSchema database_schema[MAX_TABLES];
-int num_tables = 0;
-
-// --- Remove Global File Pointers ---
-// FILE *metadata_fp, *data_fp;
-
 // --- Path Helper ---
 void build_path(char *dest, size_t dest_size, const char *part1, const char *part2, const char *part3) {
     if (!dest || dest_size == 0) return;
@@ -51,7 +57,7 @@ int ensure_directory_exists(const char *path) {
             fprintf(stderr, "Failed to create directory '%s': %s\n", path, strerror(errno));
             return -1; // Failure
         }
-        printf("Created directory: %s\n", path);
+        log_info("Created directory: %s", path);
     } else if (!S_ISDIR(st.st_mode)) {
         fprintf(stderr, "Error: Path '%s' exists but is not a directory.\n", path);
         return -1; // Failure - path exists but isn't a directory
@@ -60,21 +66,312 @@ int ensure_directory_exists(const char *path) {
 }
 
 
-// --- Schema Management (Modified load_schema) ---
+static int save_schema(Database* db, const TableSchema* skip);
+
+// --- Table Files ---
+
+static void set_table_paths(const Database* db, TableSchema* schema) {
+    build_path(schema->table_dir, sizeof(schema->table_dir), db->data_dir, schema->name, NULL);
+    char data_filename[MAX_TABLE_NAME_LEN + sizeof(TABLE_DATA_EXT)];
+    snprintf(data_filename, sizeof(data_filename), "%s%s", schema->name, TABLE_DATA_EXT);
+    build_path(schema->data_path, sizeof(schema->data_path), schema->table_dir, data_filename, NULL);
+}
+
 /**
- * @brief Finds a table schema by name.
- * @param table_name Name of the table.
- * @return Pointer to the TableSchema, or NULL if not found.
+ * Open a table's primary key index with its Bloom filter and row cache
+ * (a table without a primary key has none of them).
+ * @return 0 on success, -1 if the index cannot be opened.
  */
-TableSchema* find_table_schema(const char* table_name) {
-    for (int i = 0; i < num_tables; ++i) {
-        if (strcmp(database_schema[i].name, table_name) == 0) {
-            return &database_schema[i];
+static int open_table_index(TableSchema* schema) {
+    if (schema->pk_column_index == -1) return 0;
+    char index_filename[MAX_TABLE_NAME_LEN + 10];
+    snprintf(index_filename, sizeof(index_filename), "pk%s", PK_INDEX_EXT);
+    char index_path[MAX_PATH_LEN];
+    build_path(index_path, sizeof(index_path), schema->table_dir, index_filename, NULL);
+
+    schema->pk_index = init_btree(index_path, schema->pk_index_flags, schema->io_flags);
+    if (!schema->pk_index) {
+        fprintf(stderr, "FATAL: Failed to initialize primary key index for table '%s' at '%s'\n", schema->name, index_path);
+        return -1;
+    }
+    log_debug("Initialized PK index for table '%s' at '%s'", schema->name, index_path);
+
+    char filter_filename[MAX_TABLE_NAME_LEN + 10];
+    snprintf(filter_filename, sizeof(filter_filename), "pk%s", PK_BLOOM_EXT);
+    char filter_path[MAX_PATH_LEN];
+    build_path(filter_path, sizeof(filter_path), schema->table_dir, filter_filename, NULL);
+    schema->pk_filter = bloom_filter_open(filter_path, schema->pk_index);
+    if (!schema->pk_filter) {
+        fprintf(stderr, "Warning: Primary key Bloom filter disabled for table '%s'.\n", schema->name);
+    }
+
+    schema->row_cache = row_cache_create(schema->row_size, ROW_CACHE_CAPACITY);
+    if (!schema->row_cache) {
+        fprintf(stderr, "Warning: Row cache disabled for table '%s'.\n", schema->name);
+    }
+    return 0;
+}
+
+static int stop_at_first_key(int key, long offset, void* ctx) {
+    (void)key;
+    (void)offset;
+    (void)ctx;
+    return 1;
+}
+
+static int is_zero_filled(const char* bytes, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (bytes[i] != 0) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Find the end of the last whole row. Appends are not atomic, so a crash
+ * can leave a partial last record, and an O_DIRECT append writes its whole
+ * last block, leaving zeros after the last row; neither is a row and the
+ * next append overwrites it. An all-zero record can never pass its
+ * checksum, so zero records inside the last block are padding. A whole
+ * record that fails its checksum is corruption: it stays in the table (so
+ * its offset is not reused under an index entry that still points at it)
+ * and is reported here, on reads and by VERIFY.
+ * @return 0 on success, -1 on a read error (reported).
+ */
+static int trim_torn_tail(TableSchema* schema) {
+    off_t size = io_size(schema->data_file);
+    schema->data_size = size - size % (off_t)schema->record_size;
+    char* record = malloc(schema->record_size);
+    if (!record) {
+        perror("Failed to allocate record buffer");
+        return -1;
+    }
+    int status = 0;
+    while (schema->data_size > 0) {
+        off_t offset = schema->data_size - (off_t)schema->record_size;
+        if (io_pread(schema->data_file, record, schema->record_size, offset) != (ssize_t)schema->record_size) {
+            fprintf(stderr, "Error reading '%s': %s\n", schema->data_path, strerror(errno));
+            status = -1;
+            break;
+        }
+        if (offset + IO_ALIGNMENT > size && is_zero_filled(record, schema->record_size)) {
+            schema->data_size = offset;
+            continue;
+        }
+        if (!record_is_valid(schema, record)) {
+            fprintf(stderr, "Warning: Checksum mismatch for the last row (offset %ld) in '%s'; run VERIFY.\n",
+                    (long)offset, schema->data_path);
         }
+        break;
     }
-    return NULL;
+    free(record);
+    return status;
+}
+
+/**
+ * Open (creating if needed) a table's data file and zone map. A missing
+ * (freshly created) index over existing rows is rebuilt in bulk.
+ * @return 0 on success, -1 if the data file cannot be opened (reported).
+ */
+static int open_table_data(TableSchema* schema) {
+    schema->data_file = io_open(schema->data_path, IO_OPEN_CREATE | schema->io_flags);
+    if (!schema->data_file) {
+        fprintf(stderr, "Warning: Could not open/create data file %s: %s\n", schema->data_path, strerror(errno));
+        return -1;
+    }
+    if (trim_torn_tail(schema) != 0) {
+        io_close(schema->data_file);
+        schema->data_file = NULL;
+        return -1;
+    }
+    off_t size = io_size(schema->data_file);
+    if (schema->data_size != size) {
+        // Padding is expected after an O_DIRECT append, so only a partial
+        // record is worth a warning
+        if (schema->data_file->direct && size - schema->data_size < IO_ALIGNMENT) {
+            log_debug("Ignoring %ld byte(s) of block padding after the last row in '%s'.",
+                      (long)(size - schema->data_size), schema->data_path);
+        } else {
+            fprintf(stderr, "Warning: Ignoring %ld trailing byte(s) after the last row in '%s'.\n",
+                    (long)(size - schema->data_size), schema->data_path);
+        }
+    }
+    schema->zone_map = zone_map_open(schema);
+
+    if (schema->pk_index && schema->data_size > 0 &&
+        btree_for_each(schema->pk_index, stop_at_first_key, NULL) == 0) {
+        log_warn("Primary key index of table '%s' is empty; rebuilding it from the data file.", schema->name);
+        if (rebuild_pk_index(schema) != 0) {
+            fprintf(stderr, "Warning: Could not rebuild primary key index of table '%s'.\n", schema->name);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Close a table's files and free its caches and statistics (the schema
+ * itself stays allocated).
+ */
+static void close_table(TableSchema* schema) {
+    if (schema->pk_filter) {
+        log_info("Bloom filter for table '%s': %zu lookups skipped the index",
+                 schema->name, schema->pk_filter->negatives);
+        bloom_filter_close(schema->pk_filter);
+        schema->pk_filter = NULL;
+    }
+    if (schema->pk_index) {
+        log_debug("Closing index for table '%s'", schema->name);
+        close_btree(schema->pk_index);
+        schema->pk_index = NULL;
+    }
+    if (schema->zone_map) {
+        zone_map_close(schema->zone_map, schema);
+        schema->zone_map = NULL;
+    }
+    if (schema->data_file) {
+        io_close(schema->data_file);
+        schema->data_file = NULL;
+    }
+    if (schema->row_cache) {
+        RowCacheStats stats;
+        row_cache_stats(schema->row_cache, &stats);
+        log_info("Row cache for table '%s': %zu hits, %zu misses, %zu/%zu rows cached",
+                 schema->name, stats.hits, stats.misses, stats.entries, stats.capacity);
+        row_cache_destroy(schema->row_cache);
+        schema->row_cache = NULL;
+    }
+    free(schema->stats);
+    schema->stats = NULL;
+}
+
+/**
+ * Delete every file in a table's directory (data file, index, Bloom filter,
+ * zone map).
+ * @return Number of files deleted, or -1 on error (reported).
+ */
+static int remove_table_files(const TableSchema* schema) {
+    DIR* dir = opendir(schema->table_dir);
+    if (!dir) return (errno == ENOENT) ? 0 : -1;
+    int removed = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char path[MAX_PATH_LEN];
+        build_path(path, sizeof(path), schema->table_dir, entry->d_name, NULL);
+        if (unlink(path) != 0) {
+            fprintf(stderr, "Error removing '%s': %s\n", path, strerror(errno));
+            removed = -1;
+            break;
+        }
+        removed++;
+    }
+    closedir(dir);
+    return removed;
+}
+
+
+/**
+ * Unlink one file of a table's directory if it exists.
+ * @return 0 on success (or no such file), -1 on error (reported).
+ */
+static int remove_table_file(const TableSchema* schema, const char* filename) {
+    char path[MAX_PATH_LEN];
+    build_path(path, sizeof(path), schema->table_dir, filename, NULL);
+    if (unlink(path) != 0 && errno != ENOENT) {
+        fprintf(stderr, "Error removing '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 1 if a data file already holds whole, checksum-valid records of the
+ * current format (an upgrade that was interrupted before the metadata file
+ * recorded it), else 0.
+ */
+static int data_file_is_current(const TableSchema* schema, FILE* in, off_t size) {
+    if (size % (off_t)schema->record_size != 0) return 0;
+    char* record = malloc(schema->record_size);
+    int current = (record != NULL);
+    while (current && fread(record, schema->record_size, 1, in) == 1) {
+        current = record_is_valid(schema, record);
+    }
+    if (ferror(in)) current = 0;
+    free(record);
+    rewind(in);
+    return current;
 }
 
+/**
+ * Bring a data file written in format 1 (bare rows) to the current format
+ * by rewriting it with a checksum trailer after every row. The index, Bloom
+ * filter and zone map address rows by their old offsets, so they are
+ * deleted first (and rebuilt on open); then the copy is written to a
+ * temporary file and renamed over the original. An interrupted upgrade
+ * therefore leaves either the old file or the finished new one, which is
+ * recognised and kept. A file that is not a whole number of old rows is
+ * left alone.
+ * @return 0 on success (or nothing to do), -1 on error (reported).
+ */
+static int upgrade_table_data(TableSchema* schema) {
+    FILE* in = fopen(schema->data_path, "rb");
+    if (!in) return (errno == ENOENT) ? 0 : -1;
+    struct stat st;
+    if (fstat(fileno(in), &st) != 0) {
+        fclose(in);
+        return -1;
+    }
+    if (st.st_size == 0 || data_file_is_current(schema, in, st.st_size)) {
+        fclose(in);
+        return 0;
+    }
+    if (st.st_size % (off_t)schema->row_size != 0) {
+        fprintf(stderr, "Error: Data file '%s' (%ld bytes) is not a whole number of %zu-byte rows of format 1; "
+                "not upgrading table '%s'.\n", schema->data_path, (long)st.st_size, schema->row_size, schema->name);
+        fclose(in);
+        return -1;
+    }
+
+    char filename[MAX_TABLE_NAME_LEN + sizeof(ZONE_MAP_EXT)];
+    snprintf(filename, sizeof(filename), "pk%s", PK_INDEX_EXT);
+    int status = remove_table_file(schema, filename);
+    snprintf(filename, sizeof(filename), "pk%s", PK_BLOOM_EXT);
+    status |= remove_table_file(schema, filename);
+    snprintf(filename, sizeof(filename), "%s%s", schema->name, ZONE_MAP_EXT);
+    status |= remove_table_file(schema, filename);
+    if (status != 0) {
+        fclose(in);
+        return -1;
+    }
+
+    char temp_path[MAX_PATH_LEN + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.upgrade", schema->data_path);
+    FILE* out = fopen(temp_path, "wb");
+    char* record = malloc(schema->record_size);
+    if (!out || !record) status = -1;
+    long rows = 0;
+    while (status == 0 && fread(record, schema->row_size, 1, in) == 1) {
+        uint32_t checksum = crc32c(record, schema->row_size);
+        memcpy(record + schema->row_size, &checksum, sizeof(checksum));
+        if (fwrite(record, schema->record_size, 1, out) != 1) status = -1;
+        rows++;
+    }
+    if (status == 0 && ferror(in)) status = -1;
+    if (out && (fflush(out) != 0 || fsync(fileno(out)) != 0)) status = -1;
+    if (out && fclose(out) != 0) status = -1;
+    fclose(in);
+    free(record);
+    if (status == 0 && rename(temp_path, schema->data_path) != 0) status = -1;
+    if (status != 0) {
+        fprintf(stderr, "Error upgrading data file '%s': %s\n", schema->data_path, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+    log_warn("Upgraded data file of table '%s' to format %d (%ld rows); its index will be rebuilt.",
+             schema->name, DATA_FORMAT_VERSION, rows);
+    return 0;
+}
+
+// --- Schema Management (Modified load_schema) ---
 /**
  * @brief Finds a column definition within a table schema by name.
  * @param schema Pointer to the table schema.
@@ -91,33 +388,30 @@ const ColumnDefinition* find_column(const TableSchema* schema, const char* col_n
     return NULL;
 }
 
-/**
- * Loads table schemas from the metadata file, initializes BTree handles.
- * Return 0 on success, -1 on error.
- */
 /**
  * Loads table schemas from the metadata file, initializes BTree handles.
  * Creates a default metadata file if it doesn't exist.
  * Return 0 on success, -1 on error.
  */
-int load_schema() {
+int load_schema(Database* db) {
     char metadata_path[MAX_PATH_LEN];
-    build_path(metadata_path, sizeof(metadata_path), DATA_DIR, METADATA_FILE, NULL);
+    build_path(metadata_path, sizeof(metadata_path), db->data_dir, METADATA_FILE, NULL);
 
     FILE *meta_fp = fopen(metadata_path, "r");
     if (!meta_fp) {
-        fprintf(stderr, "Metadata file '%s' not found. Creating default schema.\n", metadata_path);
+        log_info("Metadata file '%s' not found. Creating default schema.", metadata_path);
 
         // --- START: Create Default Metadata File ---
         meta_fp = fopen(metadata_path, "w"); // Open for writing
         if (!meta_fp) {
              fprintf(stderr, "FATAL: Failed to create metadata file '%s': %s\n", metadata_path, strerror(errno));
-             num_tables = 0; // Ensure num_tables is 0 on failure
+             db->num_tables = 0; // Ensure num_tables is 0 on failure
              return -1; // Critical error
         }
 
         // Write default schema (e.g., users and products)
         fprintf(meta_fp, "# Default database schema\n");
+        fprintf(meta_fp, "format:%d\n", DATA_FORMAT_VERSION);
         fprintf(meta_fp, "table:users\n");
         fprintf(meta_fp, "column:id:int:primary_key\n");
         fprintf(meta_fp, "column:name:string:%d\n", NAME_LEN); // Use constant if still defined, or hardcode like 50
@@ -134,10 +428,10 @@ int load_schema() {
         if (!meta_fp) {
             // This should not happen if writing succeeded, but check anyway
             fprintf(stderr, "FATAL: Failed to reopen metadata file '%s' for reading after creating it.\n", metadata_path);
-            num_tables = 0;
+            db->num_tables = 0;
             return -1;
         }
-        printf("Created and reopened '%s' for reading.\n", metadata_path);
+        log_info("Created default metadata file '%s'", metadata_path);
         // --- END: Create Default Metadata File ---
     }
 
@@ -145,7 +439,8 @@ int load_schema() {
     char line[256];
     TableSchema* current_schema = NULL;
     size_t current_offset = 0;
-    num_tables = 0; // Reset count before parsing
+    int column_capacity = 0;
+    int format = 1; // Catalogs without a format line predate row checksums
 
     while (fgets(line, sizeof(line), meta_fp)) {
         line[strcspn(line, "\r\n")] = 0;
@@ -156,34 +451,72 @@ int load_schema() {
         token = strtok_r(rest, ":", &rest);
         if (!token) continue;
 
-        if (strcmp(token, "table") == 0) {
-            if (num_tables >= MAX_TABLES) { /* error handling */ break; }
-            current_schema = &database_schema[num_tables++]; // Increment num_tables HERE
-            memset(current_schema, 0, sizeof(TableSchema));
-            current_schema->pk_column_index = -1;
-            current_schema->pk_index = NULL;
-
+        if (strcmp(token, "format") == 0) {
+            token = strtok_r(rest, ":", &rest);
+            format = token ? atoi(token) : 0;
+            if (format < 1 || format > DATA_FORMAT_VERSION) {
+                fprintf(stderr, "FATAL: Metadata file '%s' has data format '%s'; this build reads formats 1 to %d.\n",
+                        metadata_path, token ? token : "", DATA_FORMAT_VERSION);
+                fclose(meta_fp);
+                return -1;
+            }
+        } else if (strcmp(token, "table") == 0) {
+            current_schema = NULL;
             token = strtok_r(rest, ":", &rest); // Get table name
-            if (!token) { /* error handling */ num_tables--; current_schema=NULL; continue; }
+            if (!token) { /* error handling */ continue; }
+
+            TableSchema* schema = calloc(1, sizeof(TableSchema));
+            if (!schema) {
+                perror("Failed to allocate table schema");
+                fclose(meta_fp);
+                return -1;
+            }
+            current_schema = schema;
+            current_schema->pk_column_index = -1;
 
             strncpy(current_schema->name, token, MAX_TABLE_NAME_LEN - 1);
             current_schema->name[MAX_TABLE_NAME_LEN - 1] = '\0';
-            current_schema->num_columns = 0;
-            current_schema->row_size = 0;
+
+            // Optional table options, e.g. "table:users:cow"
+            char* option;
+            while ((option = strtok_r(rest, ":", &rest)) != NULL) {
+                if (strcmp(option, "cow") == 0) {
+                    current_schema->pk_index_flags |= BTREE_FLAG_COW;
+                } else if (strcmp(option, "direct") == 0) {
+                    current_schema->io_flags |= IO_OPEN_DIRECT;
+                } else {
+                    fprintf(stderr, "Warning: Unknown option '%s' for table '%s'\n", option, current_schema->name);
+                }
+            }
             current_offset = 0;
+            column_capacity = 0;
 
-            build_path(current_schema->table_dir, sizeof(current_schema->table_dir), DATA_DIR, current_schema->name, NULL);
-            if (ensure_directory_exists(current_schema->table_dir) != 0) {
-                 /* error handling */ num_tables--; current_schema = NULL; continue;
+            set_table_paths(db, current_schema);
+            int status = ensure_directory_exists(current_schema->table_dir);
+            if (status == 0) {
+                status = registry_add(db, current_schema);
+                if (status == 1) fprintf(stderr, "Warning: Duplicate table '%s' in metadata.dbm ignored.\n", current_schema->name);
+            }
+            if (status != 0) {
+                free(current_schema);
+                current_schema = NULL;
+                continue;
             }
-            char data_filename[MAX_TABLE_NAME_LEN + sizeof(TABLE_DATA_EXT)];
-            snprintf(data_filename, sizeof(data_filename), "%s%s", current_schema->name, TABLE_DATA_EXT);
-            build_path(current_schema->data_path, sizeof(current_schema->data_path), current_schema->table_dir, data_filename, NULL);
-            printf("Loading schema for table: %s (Data: %s)\n", current_schema->name, current_schema->data_path);
+            log_debug("Loading schema for table: %s (Data: %s)", current_schema->name, current_schema->data_path);
 
         } else if (strcmp(token, "column") == 0) {
              if (!current_schema) { /* error handling */ continue; }
-             if (current_schema->num_columns >= MAX_COLUMNS) { /* error handling */ continue; }
+             if (current_schema->num_columns == column_capacity) {
+                 int capacity = column_capacity ? column_capacity * 2 : 8;
+                 ColumnDefinition* columns = realloc(current_schema->columns, (size_t)capacity * sizeof(ColumnDefinition));
+                 if (!columns) {
+                     perror("Failed to allocate column definitions");
+                     fclose(meta_fp);
+                     return -1;
+                 }
+                 current_schema->columns = columns;
+                 column_capacity = capacity;
+             }
 
              ColumnDefinition* col = &(current_schema->columns[current_schema->num_columns]); // Get address BEFORE incrementing num_columns
              memset(col, 0, sizeof(ColumnDefinition));
@@ -221,7 +554,7 @@ int load_schema() {
                       continue; // Skip this invalid string column
                  }
                  col->size = atoi(col_arg);
-                 if (col->size <= 0 || col->size > 1024*10) {
+                 if (col->size <= 0 || col->size > MAX_STRING_COLUMN_SIZE) {
                      fprintf(stderr, "Warning: Invalid size %d for string column '%s'. Using default %d.\n", (int)col->size, col_name, NAME_LEN);
                      col->size = NAME_LEN;
                  }
@@ -243,144 +576,394 @@ int load_schema() {
                  } else {
                      col->is_primary_key = 1;
                      current_schema->pk_column_index = current_schema->num_columns; // Use current index BEFORE increment
-                     printf("  -> Primary Key set to column: %s\n", col->name);
+                     log_debug("  -> Primary Key set to column: %s", col->name);
                  }
              }
 
              // Increment counts and update sizes AFTER successful parsing
              current_offset += col->size;
              current_schema->row_size = current_offset;
+             current_schema->record_size = current_offset + ROW_CHECKSUM_SIZE;
              current_schema->num_columns++; // Increment count HERE
-             printf("    Column: %s, Type: %d, Size: %zu, Offset: %zu, PK: %d\n", col->name, col->type, col->size, col->offset, col->is_primary_key);
+             log_debug("    Column: %s, Type: %d, Size: %zu, Offset: %zu, PK: %d", col->name, col->type, col->size, col->offset, col->is_primary_key);
         } else {
             fprintf(stderr, "Warning: Unrecognized line type '%s' in metadata.dbm\n", token);
         }
     }
     fclose(meta_fp);
 
-    // --- Initialize B+ Tree (Same as before) ---
-    for (int i = 0; i < num_tables; ++i) {
-        TableSchema* schema = &database_schema[i];
-        if (schema->pk_column_index != -1) {
-            char index_filename[MAX_TABLE_NAME_LEN + 10];
-            snprintf(index_filename, sizeof(index_filename), "pk%s", PK_INDEX_EXT);
-            char index_path[MAX_PATH_LEN];
-            build_path(index_path, sizeof(index_path), schema->table_dir, index_filename, NULL);
-
-            schema->pk_index = init_btree(index_path);
-            if (!schema->pk_index) {
-                fprintf(stderr, "FATAL: Failed to initialize primary key index for table '%s' at '%s'\n", schema->name, index_path);
-                // Cleanup already opened B-trees
-                for (int j = 0; j < i; ++j) {
-                    if(database_schema[j].pk_index) {
-                        close_btree(database_schema[j].pk_index);
-                        database_schema[j].pk_index = NULL;
-                    }
-                }
+    // --- Upgrade data files of an older format, then record the new one ---
+    if (format < DATA_FORMAT_VERSION) {
+        for (int i = 0; i < db->num_tables; ++i) {
+            if (upgrade_table_data(db->tables[i]) != 0) {
+                fprintf(stderr, "FATAL: Could not upgrade table '%s'; its files were left unchanged.\n", db->tables[i]->name);
                 return -1;
             }
-            printf("Initialized PK index for table '%s' at '%s'\n", schema->name, index_path);
-        } else {
-            /* warning */
         }
+        if (save_schema(db, NULL) != 0) return -1;
     }
 
-    printf("Schema loading complete. %d table(s) loaded.\n", num_tables);
+    // --- Open indexes (a failure leaves the rest to close_database) ---
+    for (int i = 0; i < db->num_tables; ++i) {
+        if (open_table_index(db->tables[i]) != 0) return -1;
+    }
+
+    log_info("Schema loading complete. %d table(s) loaded.", db->num_tables);
     return 0; // Success
 }
 
 // --- Database Initialization & Shutdown ---
 
 /**
- * Initialize the database: Create data dir, load schema.
- * Return 0 on success, -1 on failure.
+ * Open the database in a directory: create it if needed, load the schema
+ * and open every table's files.
+ * @param data_dir Directory holding the metadata file and table directories.
+ * @return The database handle, or NULL on failure (reported).
  */
-int init_database() {
-    printf("Initializing database in directory: %s\n", DATA_DIR);
+Database* open_database(const char* data_dir) {
+    if (strlen(data_dir) >= MAX_PATH_LEN - MAX_TABLE_NAME_LEN - 16) {
+        fprintf(stderr, "Error: Data directory path '%s' is too long.\n", data_dir);
+        return NULL;
+    }
+    Database* db = calloc(1, sizeof(Database));
+    if (!db) {
+        perror("Failed to allocate database handle");
+        return NULL;
+    }
+    strcpy(db->data_dir, data_dir);
+    log_info("Initializing database in directory: %s", db->data_dir);
 
     // Ensure the main data directory exists
-    if (ensure_directory_exists(DATA_DIR) != 0) {
-        return -1;
+    if (ensure_directory_exists(db->data_dir) != 0) {
+        free(db);
+        return NULL;
     }
 
     // Load schema (this will also create table dirs and init B-Trees)
-    if (load_schema() != 0) {
+    if (load_schema(db) != 0) {
         fprintf(stderr, "Database initialization failed during schema loading.\n");
-        // Perform partial cleanup maybe?
-        shutdown_database(); // Close any B-Trees that were opened
-        return -1;
+        close_database(db); // Close any B-Trees that were opened
+        return NULL;
     }
 
-    // Check if data files exist (optional, could be created on first write)
-    for(int i=0; i < num_tables; ++i) {
-        FILE *fp_check = fopen(database_schema[i].data_path, "ab"); // Try opening in append mode
-        if(!fp_check) {
-             fprintf(stderr, "Warning: Could not open/create data file %s: %s\n", database_schema[i].data_path, strerror(errno));
-             // Decide if this is fatal
+    // Open (creating if needed) the data files; they stay open until shutdown
+    for (int i = 0; i < db->num_tables; ++i) {
+        open_table_data(db->tables[i]); // A table without its data file stays unusable (reported)
+    }
+    if (stats_load_all(db) != 0) {
+        fprintf(stderr, "Warning: Could not read table statistics; run ANALYZE to rebuild them.\n");
+    }
+
+    log_info("Database initialization complete.");
+    return db;
+}
+
+/**
+ * Checkpoint the database: persist deferred B-Tree header changes.
+ */
+void checkpoint_database(Database* db) {
+    for (int i = 0; i < db->num_tables; ++i) {
+        TableSchema* schema = db->tables[i];
+        if (!schema) continue;
+        btree_checkpoint(schema->pk_index);
+        bloom_filter_save(schema->pk_filter);
+        zone_map_save(schema->zone_map, schema);
+    }
+    stats_save_all(db);
+}
+
+/**
+ * Close the database: save statistics, close every table's files and free
+ * the handle.
+ */
+void close_database(Database* db) {
+    if (!db) return;
+    log_info("Shutting down database...");
+    stats_save_all(db);
+    for (int i = 0; i < db->num_tables; ++i) {
+        TableSchema* schema = db->tables[i];
+        if (!schema) continue; // Dropped
+        close_table(schema);
+        free(schema->columns);
+        free(schema);
+    }
+    registry_free(db);
+    log_info("Database shutdown complete.");
+    free(db);
+}
+
+
+// --- Table DDL ---
+// metadata.dbm is the catalog: CREATE and DROP rewrite it whole into a
+// temporary file and rename it over the old one, so a crash leaves either
+// the old or the new catalog. A table's files exist exactly while it is in
+// the catalog, except after a crash between the rename and creating or
+// deleting them; those leftovers are removed when the name is created again.
+
+static void write_table_entry(FILE* fp, const TableSchema* schema) {
+    fprintf(fp, "table:%s%s%s\n", schema->name,
+            (schema->pk_index_flags & BTREE_FLAG_COW) ? ":cow" : "",
+            (schema->io_flags & IO_OPEN_DIRECT) ? ":direct" : "");
+    for (int i = 0; i < schema->num_columns; i++) {
+        const ColumnDefinition* col = &schema->columns[i];
+        if (col->type == COL_TYPE_STRING) {
+            fprintf(fp, "column:%s:string:%zu%s\n", col->name, col->size, col->is_primary_key ? ":primary_key" : "");
         } else {
-            fclose(fp_check);
+            fprintf(fp, "column:%s:int%s\n", col->name, col->is_primary_key ? ":primary_key" : "");
         }
     }
+}
 
-    printf("Database initialization complete.\n");
-    return 0; // Success
+/**
+ * Rewrite the catalog from the registry (atomically, via a temporary file
+ * and rename).
+ * @param db Open database.
+ * @param skip Table to leave out (being dropped), or NULL.
+ * @return 0 on success, -1 on error (the old catalog is untouched).
+ */
+static int save_schema(Database* db, const TableSchema* skip) {
+    char path[MAX_PATH_LEN], temp_path[MAX_PATH_LEN + 4];
+    build_path(path, sizeof(path), db->data_dir, METADATA_FILE, NULL);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* fp = fopen(temp_path, "w");
+    if (!fp) {
+        fprintf(stderr, "Error creating metadata file '%s': %s\n", temp_path, strerror(errno));
+        return -1;
+    }
+    fprintf(fp, "# Database schema (written by CREATE TABLE / DROP TABLE)\n");
+    fprintf(fp, "format:%d\n", DATA_FORMAT_VERSION);
+    for (int i = 0; i < db->num_tables; i++) {
+        if (db->tables[i] && db->tables[i] != skip) write_table_entry(fp, db->tables[i]);
+    }
+    int failed = (fflush(fp) != 0 || fsync(fileno(fp)) != 0);
+    if (fclose(fp) != 0) failed = 1;
+    if (failed || rename(temp_path, path) != 0) {
+        fprintf(stderr, "Error writing metadata file '%s': %s\n", path, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static void free_table(TableSchema* schema) {
+    free(schema->columns);
+    free(schema);
 }
 
 /**
- * Shutdown the database: Close B-Tree files, free handles.
+ * Create a table: its directory, data file and index are created and opened
+ * right away, then the catalog is rewritten to include it.
+ * @param db Open database.
+ * @param definition Name, options and laid-out columns of the new table
+ *        (copied; only the name, columns, row sizes, primary key and flags
+ *        are used).
+ * @return 0 on success, 1 if the table exists, -1 on error (reported).
  */
-void shutdown_database() {
-    printf("Shutting down database...\n");
-    for (int i = 0; i < num_tables; ++i) {
-        if (database_schema[i].pk_index) {
-            printf("Closing index for table '%s'\n", database_schema[i].name);
-            close_btree(database_schema[i].pk_index);
-            database_schema[i].pk_index = NULL; // Avoid double free
-        }
+int create_table(Database* db, const TableSchema* definition) {
+    if (find_table_schema(db, definition->name)) return 1;
+    TableSchema* schema = calloc(1, sizeof(TableSchema));
+    ColumnDefinition* columns = malloc((size_t)definition->num_columns * sizeof(ColumnDefinition));
+    if (!schema || !columns) {
+        perror("Failed to allocate table schema");
+        free(schema);
+        free(columns);
+        return -1;
+    }
+    memcpy(schema->name, definition->name, sizeof(schema->name));
+    memcpy(columns, definition->columns, (size_t)definition->num_columns * sizeof(ColumnDefinition));
+    schema->columns = columns;
+    schema->num_columns = definition->num_columns;
+    schema->row_size = definition->row_size;
+    schema->record_size = definition->record_size;
+    schema->pk_column_index = definition->pk_column_index;
+    schema->pk_index_flags = definition->pk_index_flags;
+    schema->io_flags = definition->io_flags;
+    set_table_paths(db, schema);
+
+    if (ensure_directory_exists(schema->table_dir) != 0) {
+        free_table(schema);
+        return -1;
+    }
+    int leftovers = remove_table_files(schema);
+    if (leftovers > 0) log_warn("Removed %d leftover file(s) of an earlier table '%s'.", leftovers, schema->name);
+    if (leftovers < 0 || registry_add(db, schema) != 0) {
+        free_table(schema);
+        return -1;
     }
-    num_tables = 0; // Reset table count
-    printf("Database shutdown complete.\n");
+    if (open_table_index(schema) != 0 || open_table_data(schema) != 0 || save_schema(db, NULL) != 0) {
+        registry_remove(db, schema);
+        close_table(schema);
+        remove_table_files(schema);
+        rmdir(schema->table_dir);
+        free_table(schema);
+        return -1;
+    }
+    log_info("Created table '%s' (%d columns, %zu-byte rows).", schema->name, schema->num_columns, schema->row_size);
+    return 0;
 }
 
+/**
+ * Drop a table: it leaves the catalog first, then its files are closed and
+ * deleted. Statements prepared against it fail from then on.
+ * @param db Open database.
+ * @param table_name Table to drop.
+ * @return 0 on success, 1 if there is no such table, -1 on error (reported;
+ *         the table is still there).
+ */
+int drop_table(Database* db, const char* table_name) {
+    TableSchema* schema = find_table_schema(db, table_name);
+    if (!schema) return 1;
+    if (save_schema(db, schema) != 0) return -1;
+
+    registry_remove(db, schema);
+    if (schema->stats) db->stats_dirty = 1;
+    close_table(schema);
+    if (remove_table_files(schema) < 0 || rmdir(schema->table_dir) != 0) {
+        // The catalog no longer lists it; a later CREATE of the name clears the rest
+        fprintf(stderr, "Warning: Could not delete all files of dropped table '%s' in '%s'.\n",
+                schema->name, schema->table_dir);
+    }
+    log_info("Dropped table '%s'.", schema->name);
+    free_table(schema);
+    if (db->stats_dirty && stats_save_all(db) != 0) {
+        fprintf(stderr, "Warning: Statistics could not be saved.\n");
+    }
+    return 0;
+}
 
-// --- Row Operations (Using Schema Paths and BTree Handles) ---
+
+// --- Record Checksums ---
+// Each row is stored as row_size bytes followed by a CRC32C of those bytes.
+
+static uint32_t row_checksum(const TableSchema* schema, const void* row_data) {
+    return crc32c(row_data, schema->row_size);
+}
 
 /**
- * Append a generic row buffer to the table's data file.
- * @param schema Pointer to the table schema (contains data_path).
- * @param row_data Pointer to the raw row data buffer.
- * @return Offset where the row is written, or -1 on error.
+ * Check a record (row followed by its checksum trailer) read from disk.
+ * @return 1 if the stored checksum matches the row, 0 otherwise.
  */
-long append_row_to_file(const TableSchema* schema, const void* row_data) {
-    if (!schema || !row_data) return -1;
+int record_is_valid(const TableSchema* schema, const void* record) {
+    uint32_t stored;
+    memcpy(&stored, (const char*)record + schema->row_size, sizeof(stored));
+    return stored == row_checksum(schema, record);
+}
 
-    FILE *data_fp = fopen(schema->data_path, "ab"); // Open in append binary mode
-    if (!data_fp) {
-        fprintf(stderr, "Error opening data file '%s' for appending: %s\n", schema->data_path, strerror(errno));
+// --- Row Operations (Using Schema Paths and BTree Handles) ---
+
+/**
+ * Append consecutive row buffers (each plus its checksum trailer) to the
+ * table's data file with a single write.
+ * @param schema Pointer to the table schema (contains the open data file).
+ * @param rows Pointer to num_rows raw rows of row_size bytes each.
+ * @param num_rows Number of rows.
+ * @return Offset of the first row, or -1 on error.
+ */
+long append_rows_to_file(TableSchema* schema, const void* rows, int num_rows) {
+    if (!schema || !rows || num_rows <= 0) return -1;
+    if (!schema->data_file) {
+        fprintf(stderr, "Error: Data file '%s' is not open for appending.\n", schema->data_path);
         return -1;
     }
 
-    // We are in append mode, ftell gives current end-of-file position *before* write
-    long offset = ftell(data_fp);
-    if (offset == -1) {
-        perror("Error getting file position");
-        fclose(data_fp);
+    size_t total = (size_t)num_rows * schema->record_size;
+    char* records = malloc(total);
+    if (!records) {
+        perror("Error allocating memory for record buffer");
         return -1;
     }
+    for (int i = 0; i < num_rows; i++) {
+        const char* row_data = (const char*)rows + (size_t)i * schema->row_size;
+        char* record = records + (size_t)i * schema->record_size;
+        memcpy(record, row_data, schema->row_size);
+        uint32_t checksum = row_checksum(schema, row_data);
+        memcpy(record + schema->row_size, &checksum, sizeof(checksum));
+    }
 
-    size_t written = fwrite(row_data, schema->row_size, 1, data_fp);
-    // fflush(data_fp); // Append mode often buffers less aggressively, but fflush ensures it
-    fclose(data_fp);
+    long offset = (long)schema->data_size;
+    ssize_t written = io_pwrite(schema->data_file, records, total, offset);
+    free(records);
 
-    if (written != 1) {
-        fprintf(stderr, "Error writing row data to '%s' (expected %zu bytes)\n", schema->data_path, schema->row_size);
+    if (written != (ssize_t)total) {
+        fprintf(stderr, "Error writing row data to '%s' (expected %zu bytes): %s\n",
+                schema->data_path, total, strerror(errno));
         // Difficult to recover cleanly here. Offset is likely useless now.
         return -1;
     }
+    schema->data_size += (off_t)total;
 
     return offset;
 }
 
+/**
+ * Append a generic row buffer (plus checksum trailer) to the table's data file.
+ * @param schema Pointer to the table schema (contains the open data file).
+ * @param row_data Pointer to the raw row data buffer.
+ * @return Offset where the row is written, or -1 on error.
+ */
+long append_row_to_file(TableSchema* schema, const void* row_data) {
+    return append_rows_to_file(schema, row_data, 1);
+}
+
+/**
+ * Convert a value string according to a column's type and store it in a row buffer.
+ * @param schema Table schema.
+ * @param row_data Row buffer.
+ * @param col_index Index of the column to set.
+ * @param value_str Value as text (already trimmed).
+ * @return 0 on success, -1 on error.
+ */
+int set_value_by_index(const TableSchema* schema, void* row_data, int col_index, const char* value_str) {
+    if (!schema || !row_data || !value_str) return -1;
+    if (col_index < 0 || col_index >= schema->num_columns) {
+        fprintf(stderr, "Error: Invalid column index %d.\n", col_index);
+        return -1;
+    }
+
+    const ColumnDefinition* col = &schema->columns[col_index];
+    char* dest = (char*)row_data + col->offset;
+
+     // Check bounds
+     if (col->offset + col->size > schema->row_size) {
+         fprintf(stderr, "Error: Column '%s' offset/size exceeds row size.\n", col->name);
+         return -1;
+     }
+
+    if (col->type == COL_TYPE_INT) {
+        // Use strtol for better error checking than atoi
+        char *endptr;
+        errno = 0;
+        long val = strtol(value_str, &endptr, 10);
+        // Check for conversion errors
+        if (endptr == value_str || *endptr != '\0' || errno == ERANGE || val < INT_MIN || val > INT_MAX) {
+             fprintf(stderr, "Error: Invalid integer value '%s' for column '%s'.\n", value_str, col->name);
+             return -1;
+        }
+        int int_val = (int)val;
+        memcpy(dest, &int_val, sizeof(int));
+
+    } else if (col->type == COL_TYPE_STRING) {
+        size_t len = strlen(value_str);
+
+        if (len >= col->size) {
+            fprintf(stderr, "Warning: String value '%.*s...' too long for column '%s' (max %zu chars). Truncating.\n",
+                    15, value_str, col->name, col->size -1);
+            memcpy(dest, value_str, col->size - 1);
+            dest[col->size - 1] = '\0'; // Ensure null termination on truncation
+        } else {
+            memcpy(dest, value_str, len + 1); // Copy including null terminator
+            // Zero out remaining buffer space (optional, good practice)
+            if (len + 1 < col->size) {
+                memset(dest + len + 1, 0, col->size - (len + 1));
+            }
+        }
+    } else {
+         fprintf(stderr, "Error: Unsupported column type %d for column '%s'.\n", col->type, col->name);
+         return -1;
+    }
+    return 0; // Success
+}
+
 int get_int_pk_value(const TableSchema* schema, const void* row_data) {
     // ... (no changes needed, but ensure fatal errors are handled if desired)
      if (!schema || !row_data) { exit(EXIT_FAILURE); } // Example fatal exit
@@ -392,18 +975,53 @@ int get_int_pk_value(const TableSchema* schema, const void* row_data) {
      return pk_value;
 }
 
+// Drop a Bloom filter that may miss keys; the table runs without one until
+// the next open rebuilds it
+static void filter_drop(TableSchema* schema) {
+    fprintf(stderr, "Warning: Primary key Bloom filter disabled for table '%s'.\n", schema->name);
+    bloom_filter_discard(schema->pk_filter);
+    schema->pk_filter = NULL;
+}
+
+/**
+ * Mark the table's Bloom filter dirty on disk before the index changes, so
+ * a crash before the new keys reach the filter leaves it to be rebuilt.
+ */
+static void filter_mark_dirty(TableSchema* schema) {
+    if (bloom_filter_mark_dirty(schema->pk_filter) != 0) filter_drop(schema);
+}
+
+/**
+ * Record a newly indexed key in the table's Bloom filter. A filter that
+ * could not take the key would answer "absent" for it, so it is dropped.
+ */
+static void filter_add(TableSchema* schema, int key) {
+    if (bloom_filter_add(schema->pk_filter, key) != 0) filter_drop(schema);
+}
+
 /**
  * Insert a generic row into the database.
  * @param table_name Name of the table to insert into.
  * @param row_data Pointer to the raw row data buffer.
  * @return 0 on success, -1 on error, 1 for duplicate key.
  */
-int insert_row(const char* table_name, const void* row_data) {
-    TableSchema* schema = find_table_schema(table_name);
+int insert_row(Database* db, const char* table_name, const void* row_data) {
+    TableSchema* schema = find_table_schema(db, table_name);
     if (!schema) {
         fprintf(stderr, "Error: Table '%s' not found for insert.\n", table_name);
         return -1;
     }
+    return insert_row_into(schema, row_data);
+}
+
+/**
+ * Insert a generic row into an already resolved table.
+ * @param schema Schema of the table to insert into.
+ * @param row_data Pointer to the raw row data buffer.
+ * @return 0 on success, -1 on error, 1 for duplicate key.
+ */
+int insert_row_into(TableSchema* schema, const void* row_data) {
+    const char* table_name = schema->name;
     if (!schema->pk_index) { // Check if BTree handle exists
          fprintf(stderr, "Error: Cannot insert into table '%s' without a valid primary key index.\n", table_name);
          return -1;
@@ -412,9 +1030,10 @@ int insert_row(const char* table_name, const void* row_data) {
     // Extract primary key (must be int)
     int pk_value = get_int_pk_value(schema, row_data);
 
-    // Check for duplicates using the table's specific B+ Tree
-    long existing_offset = search(schema->pk_index, pk_value); // Use handle
-    if (existing_offset != -1) {
+    // Check for duplicates using the table's specific B+ Tree, unless the
+    // Bloom filter already rules the key out
+    if (bloom_filter_may_contain(schema->pk_filter, pk_value) &&
+        search(schema->pk_index, pk_value) != -1) {
         fprintf(stderr, "Error: Duplicate primary key value %d in table '%s'.\n", pk_value, table_name);
         return 1; // Indicate duplicate key
     }
@@ -427,18 +1046,161 @@ int insert_row(const char* table_name, const void* row_data) {
     }
 
     // Insert key (PK value) and offset into the table's B+ Tree
+    filter_mark_dirty(schema);
     btree_insert(schema->pk_index, pk_value, offset); // Use handle
+    filter_add(schema, pk_value);
+    zone_map_update(schema->zone_map, schema, offset, row_data);
+    stats_update(schema, row_data);
 
-    printf("Inserted into %s: PK=%d at offset=%ld (Data: %s, Index: %s)\n",
-           table_name, pk_value, offset, schema->data_path, schema->pk_index->index_path);
+    log_debug("Inserted into %s: PK=%d at offset=%ld (Data: %s, Index: %s)",
+              table_name, pk_value, offset, schema->data_path, schema->pk_index->index_path);
     return 0; // Success
 }
 
+// A batch row's primary key and its position in the caller's array
+typedef struct {
+    int key;
+    int index;
+} BatchEntry;
+
+static int compare_batch_entries(const void* a, const void* b) {
+    int ka = ((const BatchEntry*)a)->key;
+    int kb = ((const BatchEntry*)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/**
+ * Insert a batch of rows. The batch is sorted by primary key, checked for
+ * duplicates (within the batch and, in one merged index lookup, against the
+ * table), appended with one write and indexed with one descent per leaf.
+ * Either every row is inserted or none is.
+ * @param table_name Name of the table to insert into.
+ * @param rows Pointer to num_rows raw rows of row_size bytes each.
+ * @param num_rows Number of rows.
+ * @return 0 on success, -1 on error, 1 for duplicate key.
+ */
+int insert_rows(Database* db, const char* table_name, const void* rows, int num_rows) {
+    TableSchema* schema = find_table_schema(db, table_name);
+    if (!schema) {
+        fprintf(stderr, "Error: Table '%s' not found for insert.\n", table_name);
+        return -1;
+    }
+    return insert_rows_into(schema, rows, num_rows);
+}
+
+/**
+ * Insert a batch of rows into an already resolved table (see insert_rows).
+ * @param schema Schema of the table to insert into.
+ * @param rows Pointer to num_rows raw rows of row_size bytes each.
+ * @param num_rows Number of rows.
+ * @return 0 on success, -1 on error, 1 for duplicate key.
+ */
+int insert_rows_into(TableSchema* schema, const void* rows, int num_rows) {
+    const char* table_name = schema->name;
+    if (!schema->pk_index) {
+         fprintf(stderr, "Error: Cannot insert into table '%s' without a valid primary key index.\n", table_name);
+         return -1;
+    }
+    if (!rows || num_rows <= 0) return -1;
+
+    BatchEntry* entries = malloc((size_t)num_rows * sizeof(BatchEntry));
+    int* keys = malloc((size_t)num_rows * sizeof(int));
+    long* offsets = malloc((size_t)num_rows * sizeof(long));
+    if (!entries || !keys || !offsets) {
+        perror("Error allocating memory for insert batch");
+        free(entries);
+        free(keys);
+        free(offsets);
+        return -1;
+    }
+    int status = 0;
+
+    // 1. Sort by primary key; duplicates inside the batch end up adjacent
+    for (int i = 0; i < num_rows; i++) {
+        entries[i].key = get_int_pk_value(schema, (const char*)rows + (size_t)i * schema->row_size);
+        entries[i].index = i;
+    }
+    qsort(entries, num_rows, sizeof(BatchEntry), compare_batch_entries);
+    for (int i = 1; i < num_rows; i++) {
+        if (entries[i].key == entries[i - 1].key) {
+            fprintf(stderr, "Error: Duplicate primary key value %d in batch for table '%s'.\n", entries[i].key, table_name);
+            status = 1;
+            goto cleanup;
+        }
+    }
+
+    // 2. Check the table for keys the Bloom filter cannot rule out
+    int num_candidates = 0;
+    for (int i = 0; i < num_rows; i++) {
+        if (bloom_filter_may_contain(schema->pk_filter, entries[i].key)) {
+            keys[num_candidates++] = entries[i].key;
+        }
+    }
+    if (btree_search_batch(schema->pk_index, keys, num_candidates, offsets) != 0) {
+        status = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < num_candidates; i++) {
+        if (offsets[i] != -1) {
+            fprintf(stderr, "Error: Duplicate primary key value %d in table '%s'.\n", keys[i], table_name);
+            status = 1;
+            goto cleanup;
+        }
+    }
+
+    // 3. Append every row with one write
+    long first_offset = append_rows_to_file(schema, rows, num_rows);
+    if (first_offset == -1) {
+        fprintf(stderr, "Error: Failed to append row data for table '%s'.\n", table_name);
+        status = -1;
+        goto cleanup;
+    }
+
+    // 4. Index the rows in key order
+    for (int i = 0; i < num_rows; i++) {
+        keys[i] = entries[i].key;
+        offsets[i] = first_offset + (long)entries[i].index * (long)schema->record_size;
+    }
+    filter_mark_dirty(schema);
+    int indexed = btree_insert_batch(schema->pk_index, keys, offsets, num_rows);
+    // Keys indexed before a failure must not read as absent, so the filter
+    // gets the whole batch either way
+    for (int i = 0; i < num_rows; i++) filter_add(schema, keys[i]);
+    if (indexed != 0) {
+        // Take the rows back out of the table. Index entries written before
+        // the failure point past the end; lookups through them fail the
+        // key check once later rows reuse those offsets.
+        fprintf(stderr, "Error: Failed to index rows for table '%s'.\n", table_name);
+        schema->data_size = (off_t)first_offset;
+        if (io_truncate(schema->data_file, schema->data_size) != 0) {
+            fprintf(stderr, "Error truncating '%s': %s\n", schema->data_path, strerror(errno));
+        }
+        status = -1;
+        goto cleanup;
+    }
+    for (int i = 0; i < num_rows; i++) {
+        // File order, so each zone map block is summarized from its own rows
+        zone_map_update(schema->zone_map, schema, first_offset + (long)i * (long)schema->record_size,
+                        (const char*)rows + (size_t)i * schema->row_size);
+        stats_update(schema, (const char*)rows + (size_t)i * schema->row_size);
+    }
+
+    log_debug("Inserted %d rows into %s at offsets %ld-%ld (Data: %s, Index: %s)",
+              num_rows, table_name, first_offset, first_offset + (long)(num_rows - 1) * (long)schema->record_size,
+              schema->data_path, schema->pk_index->index_path);
+
+cleanup:
+    free(entries);
+    free(keys);
+    free(offsets);
+    return status;
+}
+
 /**
  * Selects a row by primary key value and returns its raw data via output parameter.
  * Caller is responsible for freeing the returned buffer (*row_data_out).
  */
-int select_row(const char* table_name, int primary_key_value, void** row_data_out) {
+int select_row(Database* db, const char* table_name, int primary_key_value, void** row_data_out) {
     // Validate output parameter pointer
     if (!row_data_out) {
         fprintf(stderr, "Error: Output parameter row_data_out cannot be NULL.\n");
@@ -447,268 +1209,383 @@ int select_row(const char* table_name, int primary_key_value, void** row_data_ou
     *row_data_out = NULL; // Initialize output to NULL
 
     // Find schema
-    TableSchema* schema = find_table_schema(table_name);
+    TableSchema* schema = find_table_schema(db, table_name);
     if (!schema) {
         fprintf(stderr, "Error: Table '%s' not found for select.\n", table_name);
         return -1;
     }
+    return select_row_from(schema, primary_key_value, row_data_out);
+}
+
+/**
+ * Selects a row by primary key value from an already resolved table.
+ * Caller is responsible for freeing the returned buffer (*row_data_out).
+ * @return 0 if found, 1 if not found, -1 on error.
+ */
+int select_row_from(TableSchema* schema, int primary_key_value, void** row_data_out) {
+    if (!row_data_out) {
+        fprintf(stderr, "Error: Output parameter row_data_out cannot be NULL.\n");
+        return -1;
+    }
+    *row_data_out = NULL;
+    const char* table_name = schema->name;
     if (!schema->pk_index) {
         fprintf(stderr, "Error: Cannot select from table '%s' without a valid primary key index.\n", table_name);
         return -1;
     }
 
-    // Search the table's B+ Tree for the offset
-    long offset = search(schema->pk_index, primary_key_value);
-    if (offset == -1) {
-        // This is not an error, just not found
-        // printf("Record with PK %d not found in table '%s'\n", primary_key_value, table_name); // Keep message? Optional.
+    // Keys the Bloom filter has never seen are answered without any I/O
+    if (!bloom_filter_may_contain(schema->pk_filter, primary_key_value)) {
         return 1; // Not found
     }
 
-    // Open the table's data file
-    FILE *data_fp = fopen(schema->data_path, "rb");
-    if (!data_fp) {
-        fprintf(stderr, "Error opening data file '%s' for reading: %s\n", schema->data_path, strerror(errno));
-        return -1; // Error
-    }
-
-    // Seek to the offset
-    if (fseek(data_fp, offset, SEEK_SET) != 0) {
-        fprintf(stderr, "Error seeking to offset %ld in '%s': %s\n", offset, schema->data_path, strerror(errno));
-        fclose(data_fp);
-        return -1; // Error
-    }
-
-    // Allocate buffer to hold the row data
+    // Allocate buffer to hold the row data (sized for the checksum trailer too)
     // NOTE: This memory must be freed by the CALLER on success!
-    void* row_data_buffer = malloc(schema->row_size);
+    void* row_data_buffer = malloc(schema->record_size);
     if (!row_data_buffer) {
         perror("Error allocating memory for row buffer");
-        fclose(data_fp);
         return -1;
     }
 
-    // Read the row data into the buffer
-    size_t read_count = fread(row_data_buffer, schema->row_size, 1, data_fp);
-    fclose(data_fp); // Close file now that reading is done
+    // Hot keys are served from the row cache without touching index or data file
+    if (row_cache_get(schema->row_cache, primary_key_value, row_data_buffer)) {
+        *row_data_out = row_data_buffer;
+        return 0; // Found
+    }
 
-    if (read_count != 1) {
-        fprintf(stderr, "Error reading row at offset %ld from '%s'. Expected %zu bytes, read count %zu.\n",
-                offset, schema->data_path, schema->row_size, read_count);
+    // Search the table's B+ Tree for the offset
+    long offset = search(schema->pk_index, primary_key_value);
+    if (offset == -1) {
+        // This is not an error, just not found
+        // printf("Record with PK %d not found in table '%s'\n", primary_key_value, table_name); // Keep message? Optional.
         free(row_data_buffer);
-        return -1;
+        return 1; // Not found
     }
 
+    if (read_row_at(schema, primary_key_value, offset, row_data_buffer) != 0) {
+        free(row_data_buffer);
+        return -1; // Error
+    }
+
+    row_cache_put(schema->row_cache, primary_key_value, row_data_buffer);
     *row_data_out = row_data_buffer;
 
     return 0; // Found
 }
 
 /**
- * @brief Compares a filter value string with data in a buffer based on column definition.
- * @param col The column definition.
- * @param field_ptr Pointer to the start of the field data within the row buffer.
- * @param filter_val_str The filter value as a string from the query.
- * @return 1 if match, 0 if no match, -1 on error (e.g., bad filter value type).
+ * Read the record the pk index gives for a key and check its checksum and
+ * that it holds that key (an index entry left over from a lost row can
+ * point at an offset a newer row now occupies).
+ * @param schema Schema of the table.
+ * @param key Primary key the index entry belongs to.
+ * @param offset File offset of the record (from the pk index).
+ * @param record_out Buffer of at least record_size bytes.
+ * @return 0 on success, -1 on read error, checksum mismatch or wrong key.
  */
-int compare_value(const ColumnDefinition* col, const void* field_ptr, const char* filter_val_str) {
-    if (!col || !field_ptr || !filter_val_str) return -1;
+int read_row_at(const TableSchema* schema, int key, long offset, void* record_out) {
+    if (!schema->data_file) {
+        fprintf(stderr, "Error: Data file '%s' is not open for reading.\n", schema->data_path);
+        return -1;
+    }
+    // Read the row data and its checksum trailer in one positional read
+    ssize_t read_count = io_pread(schema->data_file, record_out, schema->record_size, offset);
+    if (read_count != (ssize_t)schema->record_size) {
+        fprintf(stderr, "Error reading row at offset %ld from '%s'. Expected %zu bytes, read %zd.\n",
+                offset, schema->data_path, schema->record_size, read_count);
+        return -1;
+    }
+    if (!record_is_valid(schema, record_out)) {
+        fprintf(stderr, "Error: Checksum mismatch for row at offset %ld in '%s' (torn or corrupted write).\n",
+                offset, schema->data_path);
+        return -1;
+    }
+    int stored_key = get_int_pk_value(schema, record_out);
+    if (stored_key != key) {
+        fprintf(stderr, "Error: Index entry for key %d points at the row with key %d (offset %ld) in '%s'.\n",
+                key, stored_key, offset, schema->data_path);
+        return -1;
+    }
+    return 0;
+}
 
-    if (col->type == COL_TYPE_INT) {
-        int stored_value;
-        memcpy(&stored_value, field_ptr, sizeof(int));
+// --- Bulk Index Build ---
 
-        // Convert filter string to int
-        char *endptr;
-        errno = 0;
-        long filter_val_long = strtol(filter_val_str, &endptr, 10);
-        // Check conversion errors
-        if (endptr == filter_val_str || *endptr != '\0' || errno == ERANGE || (errno != 0 && filter_val_long == 0)) {
-            fprintf(stderr, "Error: Invalid integer filter value '%s' for column '%s'.\n", filter_val_str, col->name);
-            return -1; // Indicate error
-        }
-        int filter_value = (int)filter_val_long; // Assume fits in int
+// One primary key index entry, as sorted by a bulk build
+typedef struct {
+    int key;
+    long offset;
+} IndexEntry;
 
-        return (stored_value == filter_value); // Return 1 if match, 0 if not
+static int compare_index_entries(const void* a, const void* b, void* ctx) {
+    (void)ctx;
+    int x = ((const IndexEntry*)a)->key;
+    int y = ((const IndexEntry*)b)->key;
+    return (x > y) - (x < y);
+}
 
-    } else if (col->type == COL_TYPE_STRING) {
-        // Compare strings carefully, up to the defined size.
-        // The stored string might not be null-terminated if it fills the space.
-        // The filter string *is* null-terminated.
-
-        // Use strncmp for safety. Compare up to col->size bytes.
-        // We need to check if the filter string *exactly matches* the potentially
-        // non-null-terminated stored string within its boundary.
-
-        int result = strncmp((const char*)field_ptr, filter_val_str, col->size);
-
-        if (result == 0) {
-            // First col->size bytes match. Now check if filter string is *also*
-            // exactly col->size long OR if the stored string has a null terminator
-            // right after the matched part.
-            size_t filter_len = strlen(filter_val_str);
-            if (filter_len == col->size) {
-                // Filter string fills the buffer exactly, matches.
-                return 1;
-            } else if (filter_len < col->size) {
-                // Filter string is shorter. Check if the stored data has a
-                // null terminator or padding right after the filter length.
-                return (((const char*)field_ptr)[filter_len] == '\0');
-            } else {
-                // Filter string is longer than the column size, cannot match exactly.
-                return 0;
-            }
-        } else {
-            // Initial strncmp failed.
-            return 0;
+/**
+ * Build a new primary key index file from the data file: the (key, offset)
+ * pair of every row goes through an external sort and the sorted pairs are
+ * inserted in batches, so each leaf is written once rather than once per key.
+ * @param schema Table to index.
+ * @param index_path File to create (replaced if it exists).
+ * @return 0 on success, -1 on error (reported).
+ */
+static int bulk_build_index(const TableSchema* schema, const char* index_path) {
+    ExternalSort sorter;
+    ScanReader reader;
+    if (sort_init(&sorter, sizeof(IndexEntry), SORT_MEMORY_BUDGET, schema->db->data_dir, compare_index_entries, NULL) != 0 ||
+        scan_reader_open(&reader, schema, 0, schema->data_size) != 0) {
+        sort_free(&sorter);
+        return -1;
+    }
+    const char* record;
+    off_t offset;
+    long rows = 0;
+    while ((record = scan_reader_next(&reader, &offset)) != NULL) {
+        IndexEntry entry = {get_int_pk_value(schema, record), (long)offset};
+        if (sort_add(&sorter, &entry) != 0) break;
+        rows++;
+    }
+    int status = (reader.error || sorter.error) ? -1 : 0; // Already reported
+    scan_reader_close(&reader);
+    if (status == 0) status = sort_finish(&sorter);
+
+    BTreeHandle* index = NULL;
+    if (status == 0) {
+        unlink(index_path); // Leftover of an interrupted rebuild
+        if (!(index = init_btree(index_path, schema->pk_index_flags, schema->io_flags))) status = -1;
+    }
+    int keys[REINDEX_BATCH_KEYS];
+    long offsets[REINDEX_BATCH_KEYS];
+    int n = 0;
+    long added = 0;
+    int last_key = 0;
+    const IndexEntry* entry;
+    while (status == 0 && (entry = sort_next(&sorter)) != NULL) {
+        if (added++ > 0 && entry->key == last_key) {
+            fprintf(stderr, "Error: Primary key %d appears more than once in '%s'.\n", entry->key, schema->data_path);
+            status = -1;
+            break;
         }
-
-    } else {
-        fprintf(stderr, "Error: Comparison not implemented for this column type.\n");
-        return -1; // Error for unsupported type
+        last_key = entry->key;
+        keys[n] = entry->key;
+        offsets[n] = entry->offset;
+        if (++n == REINDEX_BATCH_KEYS) {
+            status = btree_insert_batch(index, keys, offsets, n);
+            n = 0;
+        }
+    }
+    if (status == 0 && sorter.error) status = -1;
+    if (status == 0) status = btree_insert_batch(index, keys, offsets, n);
+    sort_free(&sorter);
+    if (index) {
+        btree_checkpoint(index);
+        if (status == 0 && io_sync(index->file) != 0) {
+            fprintf(stderr, "Error syncing '%s': %s\n", index_path, strerror(errno));
+            status = -1;
+        }
+        close_btree(index);
     }
+    if (status == 0) log_info("Built primary key index for table '%s' (%ld keys)", schema->name, rows);
+    return status;
 }
 
-
 /**
- * @brief Performs a full table scan to find rows matching a filter condition.
- * Currently only supports equality check ('=').
- * @param table_name Name of the table to scan.
- * @param filter_col_name Name of the column to filter on.
- * @param filter_val_str The value to filter for (as a string).
- * @return Number of matching rows found, or -1 on error.
+ * Rebuild a table's primary key index from its data file (REINDEX). The new
+ * index is built beside the old one and renamed over it, so a failed build
+ * leaves the old index in use. The Bloom filter is then rebuilt from it.
+ * @param schema The table.
+ * @return 0 on success, -1 on error (reported).
  */
-int select_scan(const char* table_name, const char* filter_col_name, const char* filter_val_str) {
-    printf("Executing Full Table Scan on %s WHERE %s = '%s'\n", table_name, filter_col_name, filter_val_str);
-
-    // 1. Find Schema and Column Definition
-    TableSchema* schema = find_table_schema(table_name);
-    if (!schema) {
-        fprintf(stderr, "Error: Table '%s' not found for scan.\n", table_name);
+int rebuild_pk_index(TableSchema* schema) {
+    if (!schema->pk_index) {
+        fprintf(stderr, "Error: Table '%s' has no primary key index.\n", schema->name);
         return -1;
     }
-    const ColumnDefinition* filter_col = find_column(schema, filter_col_name);
-    if (!filter_col) {
-        fprintf(stderr, "Error: Column '%s' not found in table '%s'.\n", filter_col_name, table_name);
+    char index_path[MAX_PATH_LEN];
+    char temp_path[MAX_PATH_LEN + 8];
+    strcpy(index_path, schema->pk_index->index_path);
+    snprintf(temp_path, sizeof(temp_path), "%s.build", index_path);
+    if (bulk_build_index(schema, temp_path) != 0) {
+        unlink(temp_path);
         return -1;
     }
 
-    // 2. Open Data File
-    FILE *data_fp = fopen(schema->data_path, "rb");
-    if (!data_fp) {
-        fprintf(stderr, "Error opening data file '%s' for scanning: %s\n", schema->data_path, strerror(errno));
+    close_btree(schema->pk_index);
+    schema->pk_index = NULL;
+    int replaced = (rename(temp_path, index_path) == 0);
+    if (!replaced) {
+        fprintf(stderr, "Error replacing index '%s': %s\n", index_path, strerror(errno));
+        unlink(temp_path);
+    }
+    if (!(schema->pk_index = init_btree(index_path, schema->pk_index_flags, schema->io_flags))) {
+        fprintf(stderr, "FATAL: Could not reopen primary key index for table '%s'\n", schema->name);
         return -1;
     }
-
-    // 3. Allocate Row Buffer
-    void* row_data = malloc(schema->row_size);
-    if (!row_data) {
-        perror("Error allocating memory for row buffer during scan");
-        fclose(data_fp);
+    if (!replaced) {
+        // The old index stays in use, and so does its filter
+        if (schema->pk_filter) schema->pk_filter->index = schema->pk_index;
         return -1;
     }
 
-    // 4. Scan Loop
-    int found_count = 0;
-    long current_offset = 0; // Keep track for potential debugging info
-    size_t rows_read = 0;
-
-    while (1) {
-        // Read one row
-        size_t read_count = fread(row_data, schema->row_size, 1, data_fp);
-
-        if (read_count == 1) {
-            rows_read++;
-            // Get pointer to the specific field within the row buffer
-            const void* field_ptr = (const char*)row_data + filter_col->offset;
+    char filter_filename[MAX_TABLE_NAME_LEN + 10];
+    snprintf(filter_filename, sizeof(filter_filename), "pk%s", PK_BLOOM_EXT);
+    char filter_path[MAX_PATH_LEN];
+    build_path(filter_path, sizeof(filter_path), schema->table_dir, filter_filename, NULL);
+    bloom_filter_close(schema->pk_filter);
+    unlink(filter_path); // A missing filter is rebuilt from the index on open
+    schema->pk_filter = bloom_filter_open(filter_path, schema->pk_index);
+    if (!schema->pk_filter) {
+        fprintf(stderr, "Warning: Primary key Bloom filter disabled for table '%s'.\n", schema->name);
+    }
+    return 0;
+}
 
-            // Compare the value
-            int match_result = compare_value(filter_col, field_ptr, filter_val_str);
+// --- Integrity Verification ---
 
-            if (match_result == 1) {
-                // Match found! Print the row.
-                printf("Found Match at Offset ~%ld:\n", current_offset); // Offset is approximate start
-                print_row(schema, row_data);
-                found_count++;
-            } else if (match_result == -1) {
-                 // Error during comparison (e.g., bad filter value format)
-                 fprintf(stderr, "Scan aborted due to comparison error.\n");
-                 found_count = -1; // Signal error
-                 break; // Stop scanning
-            }
-            // If match_result == 0, continue to next row
+typedef struct {
+    const TableSchema* schema;
+    int is_index;     // 1 = verify pk index nodes, 0 = verify data records
+    long checked;     // Nodes or records examined
+    long bad;         // Corrupted items found, or -1 on I/O error
+} VerifyTask;
 
-            current_offset += schema->row_size; // Update approximate offset
+/**
+ * Check the checksum of every record in a table's data file, keeping
+ * VERIFY_READS_IN_FLIGHT chunk reads outstanding at a time.
+ * @param task Verification task (schema in, counters out).
+ */
+static void verify_data_file(VerifyTask* task) {
+    const TableSchema* schema = task->schema;
+    IoFile* file = io_open(schema->data_path, IO_OPEN_READONLY | schema->io_flags);
+    if (!file) {
+        fprintf(stderr, "Error opening data file '%s' for verification: %s\n", schema->data_path, strerror(errno));
+        task->bad = -1;
+        return;
+    }
+    size_t rows_per_chunk = VERIFY_CHUNK_SIZE / schema->record_size;
+    if (rows_per_chunk == 0) rows_per_chunk = 1;
+    size_t chunk_bytes = rows_per_chunk * schema->record_size;
+    char* buffer = io_alloc_aligned(VERIFY_READS_IN_FLIGHT * chunk_bytes);
+    if (!buffer) {
+        perror("Error allocating memory for record buffer during verify");
+        io_close(file);
+        task->bad = -1;
+        return;
+    }
 
-        } else {
-            // fread returned 0 or less than 1
-            if (feof(data_fp)) {
-                // End Of File reached normally
-                break;
-            } else if (ferror(data_fp)) {
-                // Actual read error occurred
-                perror("Error reading from data file during scan");
-                found_count = -1; // Signal error
-                break;
-            } else {
-                // Short read (unexpected EOF?) - treat as error/end
-                 fprintf(stderr, "Warning: Unexpected end of data file or short read after %zu rows.\n", rows_read);
-                 break;
+    // Bytes past data_size were found torn when the table was opened
+    off_t whole_rows_end = schema->data_size;
+    off_t offset = 0;
+    while (offset < whole_rows_end) {
+        IoRequest reqs[VERIFY_READS_IN_FLIGHT];
+        int n = 0;
+        for (off_t pos = offset; n < VERIFY_READS_IN_FLIGHT && pos < whole_rows_end; n++, pos += (off_t)chunk_bytes) {
+            size_t len = (whole_rows_end - pos < (off_t)chunk_bytes) ? (size_t)(whole_rows_end - pos) : chunk_bytes;
+            reqs[n] = (IoRequest){file, buffer + n * chunk_bytes, len, pos, -1, 0, 0};
+        }
+        if (io_read_batch(reqs, n) != 0) {
+            fprintf(stderr, "Error reading '%s' for verification: %s\n", schema->data_path, strerror(errno));
+            task->bad = -1;
+            break;
+        }
+        for (int r = 0; r < n; r++) {
+            size_t rows = (size_t)reqs[r].result / schema->record_size;
+            for (size_t k = 0; k < rows; k++) {
+                if (!record_is_valid(schema, (char*)reqs[r].buf + k * schema->record_size)) {
+                    fprintf(stderr, "VERIFY: Checksum mismatch for row at offset %ld in '%s'.\n",
+                            task->checked * (long)schema->record_size, schema->data_path);
+                    task->bad++;
+                }
+                task->checked++;
             }
+            offset += (off_t)reqs[r].len;
         }
-    } // End while loop
+    }
 
-    // 5. Cleanup
-    free(row_data);
-    fclose(data_fp);
+    io_free_aligned(buffer);
+    io_close(file);
+}
 
-    return found_count; // Return number of matches found (or -1 on error)
+static void* verify_worker(void* arg) {
+    VerifyTask* task = (VerifyTask*)arg;
+    if (task->is_index) {
+        int checked = 0;
+        task->bad = btree_verify(task->schema->pk_index, &checked);
+        task->checked = checked;
+    } else {
+        verify_data_file(task);
+    }
+    io_thread_cleanup();
+    return NULL;
 }
 
 /**
- * @brief Prints the content of a generic row buffer based on its schema.
- * @param schema Pointer to the table schema.
- * @param row_data Pointer to the raw row data buffer.
+ * Verify checksums of index and data files, one thread per file.
+ * @param db Open database.
+ * @param table_name Table to verify, or NULL for all tables.
+ * @param report Receives one line per file checked (NULL for none).
+ * @return Number of corrupted items found, or -1 on error.
  */
-void print_row(const TableSchema* schema, const void* row_data) {
-    if (!schema || !row_data) return;
-
-    const char* current_byte = (const char*)row_data;
+long verify_database(Database* db, const char* table_name, FILE* report) {
+    size_t max_tasks = (size_t)db->num_tables * 2 + 1; // Data file and index per table
+    VerifyTask* tasks = malloc(max_tasks * sizeof(VerifyTask));
+    pthread_t* threads = malloc(max_tasks * sizeof(pthread_t));
+    int* started = calloc(max_tasks, sizeof(int));
+    if (!tasks || !threads || !started) {
+        perror("Failed to allocate verify tasks");
+        free(tasks);
+        free(threads);
+        free(started);
+        return -1;
+    }
+    int num_tasks = 0;
+
+    for (int i = 0; i < db->num_tables; ++i) {
+        const TableSchema* schema = db->tables[i];
+        if (!schema || (table_name && strcmp(schema->name, table_name) != 0)) continue;
+        tasks[num_tasks++] = (VerifyTask){schema, 0, 0, 0};
+        if (schema->pk_index) {
+            btree_checkpoint(schema->pk_index); // Verify against a current header
+            tasks[num_tasks++] = (VerifyTask){schema, 1, 0, 0};
+        }
+    }
+    if (num_tasks == 0) {
+        fprintf(stderr, "Error: Table '%s' not found for verify.\n", table_name ? table_name : "");
+        free(tasks);
+        free(threads);
+        free(started);
+        return -1;
+    }
 
-    printf("  Row (size %zu bytes): {\n", schema->row_size);
-    for (int i = 0; i < schema->num_columns; ++i) {
-        const ColumnDefinition* col = &schema->columns[i];
-        const void* field_ptr = current_byte + col->offset;
-
-        printf("    %s (%s, size %zu): ", col->name,
-               (col->type == COL_TYPE_INT ? "int" : "string"), col->size);
-
-        if (col->type == COL_TYPE_INT) {
-            int value;
-            memcpy(&value, field_ptr, sizeof(int)); // Use memcpy for safety
-            printf("%d", value);
-        } else if (col->type == COL_TYPE_STRING) {
-            // Print string, ensuring null termination within its allocated size
-            // Create a temporary buffer to guarantee null termination for printing
-            char* temp_str = malloc(col->size + 1);
-            if(temp_str) {
-                memcpy(temp_str, field_ptr, col->size);
-                temp_str[col->size] = '\0'; // Ensure null termination
-                printf("\"%s\"", temp_str);
-                free(temp_str);
-            } else {
-                printf("[memory error]");
-            }
-            // Direct printing (less safe if data isn't null-terminated):
-            // printf("\"%.*s\"", (int)col->size, (const char*)field_ptr);
+    for (int i = 0; i < num_tasks; ++i) {
+        if (pthread_create(&threads[i], NULL, verify_worker, &tasks[i]) == 0) {
+            started[i] = 1;
+        } else {
+            verify_worker(&tasks[i]); // Fall back to verifying inline
         }
-        // Add other types here
-        // else if (col->type == COL_TYPE_FLOAT) { ... }
+    }
 
-        if (col->is_primary_key) {
-            printf(" [PK]");
+    long total_bad = 0;
+    for (int i = 0; i < num_tasks; ++i) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        const char* path = tasks[i].is_index ? tasks[i].schema->pk_index->index_path : tasks[i].schema->data_path;
+        if (tasks[i].bad < 0) {
+            if (report) fprintf(report, "  %s: I/O error\n", path);
+            total_bad = -1;
+        } else {
+            if (report) {
+                fprintf(report, "  %s: %ld %s checked, %ld corrupted\n", path, tasks[i].checked,
+                        tasks[i].is_index ? "nodes" : "rows", tasks[i].bad);
+            }
+            if (total_bad >= 0) total_bad += tasks[i].bad;
         }
-        printf("\n");
     }
-    printf("  }\n");
+    free(tasks);
+    free(threads);
+    free(started);
+    return total_bad;
 }
+
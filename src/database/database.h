@@ -4,31 +4,67 @@
 #include <stdio.h>
 #include "../structs.h" // Adjust path
 
-// --- Global Schema Storage ---
-extern TableSchema database_schema[MAX_TABLES];
-extern int num_tables;
+// --- Database Handle ---
+// Everything of one open database: its directory, tables and named
+// statements. Nothing is global, so a process can open several databases.
+typedef struct Database {
+    char data_dir[MAX_PATH_LEN];             // Metadata, statistics, table directories and temp files
+    TableSchema** tables;                    // Indexed by table ID; each schema has its own allocation, NULL once dropped
+    int num_tables;
+    int tables_capacity;
+    TableSchema** buckets;                   // Name hash table (chained through hash_next)
+    size_t num_buckets;                      // Power of two
+    struct PreparedStatement* statements[MAX_PREPARED_STATEMENTS]; // Named by PREPARE
+    int num_statements;
+    int stats_dirty;                         // The statistics file still holds a dropped table
+} Database;
 
 // --- Function Prototypes ---
 
 // Initialization & Cleanup
-int init_database(); // Return status (0 success, -1 error)
-void shutdown_database(); // Close files, free handles
-int load_schema(); // Return status
+Database* open_database(const char* data_dir); // NULL on error
+void close_database(Database* db); // Close files, free the handle
+void checkpoint_database(Database* db); // Persist deferred index header changes
+int load_schema(Database* db); // Return status
 
-// Schema Lookup (no change needed)
-TableSchema* find_table_schema(const char* table_name);
+// Table DDL; the catalog file is rewritten atomically (new file, then rename)
+int create_table(Database* db, const TableSchema* definition); // 0, 1 if it exists, -1 on error
+int drop_table(Database* db, const char* table_name);         // 0, 1 if not found, -1 on error
+
+// Table Registry (grows as tables are added; IDs stay stable)
+int registry_add(Database* db, TableSchema* schema); // 0, 1 if the name exists, -1 on error
+void registry_remove(Database* db, TableSchema* schema); // The ID slot stays empty
+TableSchema* find_table_schema(Database* db, const char* table_name); // Hashed lookup
+TableSchema* table_by_id(Database* db, int table_id); // NULL if no such table
+void registry_free(Database* db); // Free the arrays, not the tables
+
+// Schema Lookup
 const ColumnDefinition* find_column(const TableSchema* schema, const char* col_name);
 
-int select_scan(const char* table_name, const char* filter_col_name, const char* filter_val_str);
+// Integrity check of index and data checksums (table_name NULL = all
+// tables); one line per file goes to `report` unless it is NULL
+long verify_database(Database* db, const char* table_name, FILE* report);
+
+// Rebuild a table's primary key index from its data file (bulk, sorted)
+int rebuild_pk_index(TableSchema* schema);
 
 // Row Operations (Take table name, data file path is in schema)
-long append_row_to_file(const TableSchema* schema, const void* row_data);
-int insert_row(const char* table_name, const void* row_data); // Return status
-int select_row(const char* table_name, int primary_key_value, void** row_data_out);
+long append_row_to_file(TableSchema* schema, const void* row_data);
+long append_rows_to_file(TableSchema* schema, const void* rows, int num_rows); // One write for the batch
+int insert_row(Database* db, const char* table_name, const void* row_data); // Return status
+int insert_rows(Database* db, const char* table_name, const void* rows, int num_rows); // Sorted, all-or-nothing batch
+int select_row(Database* db, const char* table_name, int primary_key_value, void** row_data_out);
+
+// Variants for callers that already resolved the table (e.g. prepared statements)
+int insert_row_into(TableSchema* schema, const void* row_data);
+int insert_rows_into(TableSchema* schema, const void* rows, int num_rows);
+int select_row_from(TableSchema* schema, int primary_key_value, void** row_data_out);
+int read_row_at(const TableSchema* schema, int key, long offset, void* record_out); // Record of key at an index offset, checksum and key verified
 
 // Helpers (no change needed)
-void print_row(const TableSchema* schema, const void* row_data);
 int get_int_pk_value(const TableSchema* schema, const void* row_data);
+int set_value_by_index(const TableSchema* schema, void* row_data, int col_index, const char* value_str); // Text -> column value
+int record_is_valid(const TableSchema* schema, const void* record); // Checksum trailer check
 
 // Path Helper
 void build_path(char *dest, size_t dest_size, const char *part1, const char *part2, const char *part3);
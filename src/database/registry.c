@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "database.h"
+
+#define REGISTRY_INITIAL_TABLES 16  // First allocation of the table array
+#define REGISTRY_INITIAL_BUCKETS 16 // First name hash table size (power of two)
+
+/**
+ * Hash a table name (FNV-1a, then mixed).
+ */
+static uint64_t hash_name(const char* name) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Double the bucket array, rechaining every table.
+ * @return 0 on success, -1 on error.
+ */
+static int grow_buckets(Database* db) {
+    size_t num_buckets = db->num_buckets ? db->num_buckets * 2 : REGISTRY_INITIAL_BUCKETS;
+    TableSchema** buckets = calloc(num_buckets, sizeof(TableSchema*));
+    if (!buckets) {
+        perror("Failed to allocate memory for table registry");
+        return -1;
+    }
+    for (int i = 0; i < db->num_tables; i++) {
+        TableSchema* schema = db->tables[i];
+        if (!schema) continue; // Dropped
+        size_t bucket = (size_t)schema->name_hash & (num_buckets - 1);
+        schema->hash_next = buckets[bucket];
+        buckets[bucket] = schema;
+    }
+    free(db->buckets);
+    db->buckets = buckets;
+    db->num_buckets = num_buckets;
+    return 0;
+}
+
+/**
+ * Register a table under its name and give it the next table ID.
+ * @param db Database that takes ownership of the schema.
+ * @param schema Heap-allocated schema with its name set.
+ * @return 0 on success, 1 if a table of that name exists, -1 on error.
+ */
+int registry_add(Database* db, TableSchema* schema) {
+    if (find_table_schema(db, schema->name)) return 1;
+    if (db->num_tables == db->tables_capacity) {
+        int capacity = db->tables_capacity ? db->tables_capacity * 2 : REGISTRY_INITIAL_TABLES;
+        TableSchema** tables = realloc(db->tables, (size_t)capacity * sizeof(TableSchema*));
+        if (!tables) {
+            perror("Failed to allocate memory for table registry");
+            return -1;
+        }
+        db->tables = tables;
+        db->tables_capacity = capacity;
+    }
+    // Keep chains short: at most one table per bucket on average
+    if ((size_t)db->num_tables + 1 > db->num_buckets && grow_buckets(db) != 0) return -1;
+
+    schema->db = db;
+    schema->table_id = db->num_tables;
+    schema->name_hash = hash_name(schema->name);
+    size_t bucket = (size_t)schema->name_hash & (db->num_buckets - 1);
+    schema->hash_next = db->buckets[bucket];
+    db->buckets[bucket] = schema;
+    db->tables[db->num_tables++] = schema;
+    return 0;
+}
+
+/**
+ * Unregister a table (DROP TABLE). Its ID is not reused, so a statement
+ * that remembers the ID finds the slot empty.
+ */
+void registry_remove(Database* db, TableSchema* schema) {
+    TableSchema** link = &db->buckets[(size_t)schema->name_hash & (db->num_buckets - 1)];
+    while (*link && *link != schema) link = &(*link)->hash_next;
+    if (*link) *link = schema->hash_next;
+    db->tables[schema->table_id] = NULL;
+    schema->hash_next = NULL;
+}
+
+/**
+ * @brief Finds a table schema by name (one hash probe).
+ * @param db Open database.
+ * @param table_name Name of the table.
+ * @return Pointer to the TableSchema, or NULL if not found.
+ */
+TableSchema* find_table_schema(Database* db, const char* table_name) {
+    if (!db->num_buckets) return NULL;
+    uint64_t hash = hash_name(table_name);
+    for (TableSchema* schema = db->buckets[(size_t)hash & (db->num_buckets - 1)]; schema; schema = schema->hash_next) {
+        if (schema->name_hash == hash && strcmp(schema->name, table_name) == 0) return schema;
+    }
+    return NULL;
+}
+
+/**
+ * Look a table up by the ID it was registered with.
+ * @return The table, or NULL if there is no such ID or it was dropped.
+ */
+TableSchema* table_by_id(Database* db, int table_id) {
+    if (table_id < 0 || table_id >= db->num_tables) return NULL;
+    return db->tables[table_id];
+}
+
+/**
+ * Free the registry's arrays (the tables themselves are freed by the caller).
+ */
+void registry_free(Database* db) {
+    free(db->tables);
+    free(db->buckets);
+    db->tables = NULL;
+    db->buckets = NULL;
+    db->num_tables = db->tables_capacity = 0;
+    db->num_buckets = 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "scan.h"
+#include "database.h"
+
+/**
+ * Issue the read for the next block (up to SCAN_READ_SIZE, stopping at the
+ * aligned end of the range) into a buffer slot.
+ * @param reader The scan reader.
+ * @param slot Buffer slot (0 or 1) that is free.
+ */
+static void submit_read(ScanReader* reader, int slot) {
+    off_t aligned_end = (reader->end + IO_ALIGNMENT - 1) & ~(off_t)(IO_ALIGNMENT - 1);
+    size_t len = SCAN_READ_SIZE;
+    if (aligned_end - reader->next_read < (off_t)len) len = (size_t)(aligned_end - reader->next_read);
+    reader->reqs[slot] = (IoRequest){reader->schema->data_file, reader->buffers[slot], len,
+                                     reader->next_read, reader->registered ? slot : -1, 0, 0};
+    if (io_read_submit(&reader->reqs[slot], 1) != 0) {
+        reader->reqs[slot].result = -errno;
+        reader->reqs[slot].done = 1;
+    }
+    reader->next_read += (off_t)len;
+    reader->ahead_pending = 1;
+}
+
+/**
+ * Wait for the read-ahead still in flight, if any.
+ * @param reader The scan reader.
+ */
+static void drain_read_ahead(ScanReader* reader) {
+    if (reader->ahead_pending) {
+        int slot = (reader->current < 0) ? 0 : !reader->current;
+        io_read_wait(&reader->reqs[slot]);
+        reader->ahead_pending = 0;
+    }
+}
+
+/**
+ * Start reading the records in [start, end) into the reader's buffers.
+ * @param reader The scan reader (buffers allocated).
+ * @param start Offset of the first record.
+ * @param end End offset (exclusive); clamped to the data file size.
+ */
+static void start_range(ScanReader* reader, off_t start, off_t end) {
+    const TableSchema* schema = reader->schema;
+    if (end > schema->data_size) end = schema->data_size;
+    reader->end = end;
+    reader->record_offset = start;
+    reader->next_read = start & ~(off_t)(IO_ALIGNMENT - 1); // Reads stay aligned
+    reader->current = -1;
+    reader->chunk_start = 0;
+    reader->chunk_len = 0;
+    if (start < end) {
+        io_advise(schema->data_file, start, end - start, IO_ADVISE_SEQUENTIAL);
+        submit_read(reader, 0);
+    }
+}
+
+/**
+ * Make the read-ahead buffer current and start reading the block after it.
+ * The block just consumed is dropped from the page cache.
+ * @param reader The scan reader.
+ * @return 1 if new data is available, 0 at end of data or on error.
+ */
+static int advance_chunk(ScanReader* reader) {
+    if (!reader->ahead_pending) return 0;
+    int slot = (reader->current < 0) ? 0 : !reader->current;
+
+    ssize_t n = io_read_wait(&reader->reqs[slot]);
+    reader->ahead_pending = 0;
+    if (n < 0) {
+        fprintf(stderr, "Error reading from data file '%s' during scan: %s\n",
+                reader->schema->data_path, strerror(errno));
+        reader->error = 1;
+        return 0;
+    }
+    if (reader->current >= 0) {
+        io_advise(reader->schema->data_file, reader->chunk_start, (off_t)reader->chunk_len, IO_ADVISE_DONTNEED);
+    }
+    reader->current = slot;
+    reader->chunk_start = reader->reqs[slot].offset;
+    reader->chunk_len = (size_t)n;
+
+    if (reader->next_read < reader->end) {
+        submit_read(reader, !slot);
+    }
+    return n > 0;
+}
+
+/**
+ * Prepare a scan over the records in [start, end) of a table's data file.
+ * @param reader Reader state to initialize.
+ * @param schema Table schema (data file must be open).
+ * @param start Offset of the first record.
+ * @param end End offset (exclusive); clamped to the data file size.
+ * @return 0 on success, -1 on error.
+ */
+int scan_reader_open(ScanReader* reader, const TableSchema* schema, off_t start, off_t end) {
+    memset(reader, 0, sizeof(ScanReader));
+    reader->schema = schema;
+    reader->current = -1;
+    if (!schema->data_file) {
+        fprintf(stderr, "Error: Data file '%s' is not open for scanning.\n", schema->data_path);
+        return -1;
+    }
+    reader->buffers[0] = io_alloc_aligned(SCAN_READ_SIZE);
+    reader->buffers[1] = io_alloc_aligned(SCAN_READ_SIZE);
+    reader->stage = malloc(schema->record_size);
+    if (!reader->buffers[0] || !reader->buffers[1] || !reader->stage) {
+        perror("Error allocating memory for scan buffers");
+        scan_reader_close(reader);
+        return -1;
+    }
+    // Not fatal if it fails: the reads just go through unregistered buffers
+    reader->registered = (io_register_buffers((void**)reader->buffers, SCAN_READ_SIZE, 2) == 0);
+
+    start_range(reader, start, end);
+    return 0;
+}
+
+/**
+ * Move an open reader to a new range, reusing its buffers.
+ * @param reader The scan reader.
+ * @param start Offset of the first record.
+ * @param end End offset (exclusive); clamped to the data file size.
+ */
+void scan_reader_reset(ScanReader* reader, off_t start, off_t end) {
+    drain_read_ahead(reader);
+    if (reader->error) return;
+    start_range(reader, start, end);
+}
+
+/**
+ * Return the next record of the range.
+ * @param reader The scan reader.
+ * @param offset_out Receives the record's file offset (may be NULL).
+ * @return Pointer to the record, or NULL at the end of the range or on error.
+ */
+const char* scan_reader_next(ScanReader* reader, off_t* offset_out) {
+    if (reader->error || reader->record_offset >= reader->end) return NULL;
+    const TableSchema* schema = reader->schema;
+    size_t record_size = schema->record_size;
+
+    while (reader->current < 0 || reader->record_offset >= reader->chunk_start + (off_t)reader->chunk_len) {
+        if (!advance_chunk(reader)) return NULL;
+    }
+
+    size_t in_chunk = (size_t)(reader->record_offset - reader->chunk_start);
+    size_t available = reader->chunk_len - in_chunk;
+    const char* record;
+    if (available >= record_size) {
+        record = reader->buffers[reader->current] + in_chunk;
+    } else {
+        // Record straddles the buffer boundary: assemble it in the stage buffer
+        memcpy(reader->stage, reader->buffers[reader->current] + in_chunk, available);
+        size_t copied = available;
+        while (copied < record_size) {
+            if (!advance_chunk(reader)) {
+                if (!reader->error) {
+                    fprintf(stderr, "Warning: Unexpected end of data file '%s' inside a row.\n", schema->data_path);
+                }
+                return NULL;
+            }
+            size_t take = record_size - copied;
+            if (take > reader->chunk_len) take = reader->chunk_len;
+            memcpy(reader->stage + copied, reader->buffers[reader->current], take);
+            copied += take;
+        }
+        record = reader->stage;
+    }
+
+    if (!record_is_valid(schema, record)) {
+        fprintf(stderr, "Scan aborted: Checksum mismatch for row at offset %ld in '%s'.\n",
+                (long)reader->record_offset, schema->data_path);
+        reader->error = 1;
+        return NULL;
+    }
+    if (offset_out) *offset_out = reader->record_offset;
+    reader->record_offset += (off_t)record_size;
+    return record;
+}
+
+/**
+ * Release scan buffers, waiting for any read still in flight into them.
+ * @param reader The scan reader.
+ */
+void scan_reader_close(ScanReader* reader) {
+    drain_read_ahead(reader);
+    if (reader->registered) io_unregister_buffers();
+    reader->registered = 0;
+    io_free_aligned(reader->buffers[0]);
+    io_free_aligned(reader->buffers[1]);
+    free(reader->stage);
+    reader->buffers[0] = reader->buffers[1] = NULL;
+    reader->stage = NULL;
+}
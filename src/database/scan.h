@@ -0,0 +1,47 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "../structs.h"
+#include "../io/io.h"
+
+// --- Sequential Table Scan Reader ---
+// Streams the records of a byte range of a table's data file using large
+// aligned reads. While one SCAN_READ_SIZE buffer is being consumed the next
+// one is already in flight (double buffering), and ranges behind the cursor
+// are dropped from the page cache so a cold scan doesn't evict other data.
+// Where the thread's io_uring ring is free, the buffers are registered with
+// it, so the reads skip mapping the buffer on every request.
+
+typedef struct {
+    const TableSchema* schema;
+    off_t end;               // End of the range (exclusive, whole records only)
+    off_t record_offset;     // File offset of the next record to return
+
+    char* buffers[2];        // Aligned read buffers
+    int registered;          // 1 if the buffers are registered with this thread's ring
+    IoRequest reqs[2];       // Read for each buffer
+    int current;             // Buffer being consumed
+    int ahead_pending;       // 1 if reqs[!current] has been submitted
+    off_t chunk_start;       // File offset of buffers[current][0]
+    size_t chunk_len;        // Valid bytes in buffers[current]
+    off_t next_read;         // File offset of the next read to issue
+
+    char* stage;             // Holds a record that straddles two buffers
+    int error;               // 1 after an I/O or checksum error
+} ScanReader;
+
+// Prepare to scan records in [start, end). Offsets must be record-aligned.
+int scan_reader_open(ScanReader* reader, const TableSchema* schema, off_t start, off_t end);
+
+// Return the next record (row followed by its checksum trailer), or NULL at
+// the end of the range or on error (reader->error set). The pointer is valid
+// until the next call. *offset_out receives the record's file offset.
+const char* scan_reader_next(ScanReader* reader, off_t* offset_out);
+
+// Continue with another range [start, end), reusing the reader's buffers.
+// Used to jump over blocks a zone map has ruled out.
+void scan_reader_reset(ScanReader* reader, off_t start, off_t end);
+
+void scan_reader_close(ScanReader* reader);
+
+#endif // SCAN_H
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include "stats.h"
+#include "scan.h"
+#include "database.h"
+
+#define STATS_LINE_LEN (4 * STATS_HLL_REGISTERS) // Longest line in the statistics file
+
+// --- Hashing ---
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * Hash a column value: INTs by value, strings by their bytes up to the NUL
+ * (FNV-1a, then mixed so the top bits are well distributed).
+ */
+static uint64_t hash_value(const ColumnDefinition* col, const char* field) {
+    if (col->type == COL_TYPE_INT) {
+        int value;
+        memcpy(&value, field, sizeof(int));
+        return mix64((uint32_t)value);
+    }
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < col->size && field[i]; i++) {
+        h ^= (unsigned char)field[i];
+        h *= 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+// --- HyperLogLog ---
+
+static void hll_add(uint8_t* registers, uint64_t hash) {
+    size_t index = (size_t)(hash >> (64 - STATS_HLL_BITS));
+    // Rank of the first 1 bit in the remaining bits; the guard bit caps it
+    uint64_t rest = (hash << STATS_HLL_BITS) | (1ULL << (STATS_HLL_BITS - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > registers[index]) registers[index] = rank;
+}
+
+static double hll_estimate(const uint8_t* registers) {
+    const double m = STATS_HLL_REGISTERS;
+    double sum = 0.0;
+    int zeros = 0;
+    for (int i = 0; i < STATS_HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -registers[i]);
+        if (registers[i] == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros); // Linear counting for small sets
+    }
+    return estimate;
+}
+
+/**
+ * Estimated number of distinct values in a column (at most the row count).
+ */
+long stats_distinct(const TableStats* stats, int col_index) {
+    long distinct = (long)(hll_estimate(stats->columns[col_index].hll) + 0.5);
+    if (distinct > stats->row_count) distinct = stats->row_count;
+    if (distinct < 1 && stats->row_count > 0) distinct = 1;
+    return distinct;
+}
+
+// --- Histograms ---
+
+/**
+ * Bucket a value falls into: the last bucket whose lower bound is <= value
+ * (values outside the histogram go to the first or last bucket).
+ */
+static int find_bucket(const ColumnStats* col, int value) {
+    int lo = 0, hi = col->num_buckets - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (col->bounds[mid] <= value) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Build an equi-depth histogram from a sample: boundaries at the sample's
+ * quantiles, counts scaled from the sample to the whole table.
+ */
+static void build_histogram(ColumnStats* col, int* sample, long sample_size, long row_count, int min, int max) {
+    col->num_buckets = 0;
+    if (sample_size == 0) return;
+    qsort(sample, (size_t)sample_size, sizeof(int), compare_ints);
+
+    int buckets = STATS_HISTOGRAM_BUCKETS;
+    if (sample_size < buckets) buckets = (int)sample_size;
+    col->num_buckets = buckets;
+    for (int i = 0; i < buckets; i++) {
+        col->bounds[i] = sample[(long)i * sample_size / buckets];
+        col->counts[i] = 0;
+    }
+    // The outer bounds are the table's true extremes, which the sample may miss
+    col->bounds[0] = min;
+    col->bounds[buckets] = max;
+
+    long sampled[STATS_HISTOGRAM_BUCKETS] = {0};
+    for (long i = 0; i < sample_size; i++) sampled[find_bucket(col, sample[i])]++;
+    for (int i = 0; i < buckets; i++) {
+        col->counts[i] = (long)((double)sampled[i] * row_count / sample_size + 0.5);
+    }
+}
+
+/**
+ * Estimated fraction of rows with INT column value in [low, high], assuming
+ * values are spread evenly inside each bucket.
+ * @return The fraction, or -1 if the column has no histogram.
+ */
+double stats_range_selectivity(const TableStats* stats, int col_index, long low, long high) {
+    const ColumnStats* col = &stats->columns[col_index];
+    if (col->num_buckets == 0) return -1.0;
+    double total = 0.0, matched = 0.0;
+    for (int i = 0; i < col->num_buckets; i++) {
+        long a = col->bounds[i];
+        long b = (i == col->num_buckets - 1) ? (long)col->bounds[i + 1] : (long)col->bounds[i + 1] - 1;
+        total += (double)col->counts[i];
+        if (b < a) continue; // Empty bucket (repeated boundary)
+        long from = (low > a) ? low : a;
+        long to = (high < b) ? high : b;
+        if (from > to) continue;
+        matched += (double)col->counts[i] * (double)(to - from + 1) / (double)(b - a + 1);
+    }
+    return (total > 0.0) ? matched / total : 0.0;
+}
+
+/**
+ * Estimated fraction of rows with INT column value equal to `value`. A value
+ * that several histogram boundaries share is frequent: each boundary stands
+ * for 1/num_buckets of the rows. Other values get 1/distinct.
+ */
+double stats_eq_selectivity(const TableStats* stats, int col_index, long value) {
+    const ColumnStats* col = &stats->columns[col_index];
+    int repeats = 0;
+    for (int i = 0; i < col->num_buckets; i++) repeats += (col->bounds[i] == value);
+    if (repeats >= 2) return (double)repeats / (double)col->num_buckets;
+    return 1.0 / (double)stats_distinct(stats, col_index);
+}
+
+// --- ANALYZE ---
+
+static TableStats* new_stats(const TableSchema* schema) {
+    TableStats* stats = calloc(1, sizeof(TableStats) + (size_t)schema->num_columns * sizeof(ColumnStats));
+    if (!stats) perror("Failed to allocate memory for table statistics");
+    return stats;
+}
+
+/**
+ * Scan a table and rebuild its statistics: exact row count, a HyperLogLog
+ * sketch of every column and equi-depth histograms of INT columns from a
+ * reservoir sample of STATS_SAMPLE_ROWS rows.
+ * @param schema Table to analyze.
+ * @return 0 on success, -1 on error.
+ */
+int analyze_table(TableSchema* schema) {
+    TableStats* stats = new_stats(schema);
+    int** samples = calloc((size_t)schema->num_columns + 1, sizeof(int*));
+    int* mins = malloc(((size_t)schema->num_columns + 1) * sizeof(int));
+    int* maxs = malloc(((size_t)schema->num_columns + 1) * sizeof(int));
+    int status = -1;
+    if (!stats || !samples || !mins || !maxs) {
+        if (stats) perror("Failed to allocate memory for ANALYZE");
+        goto cleanup;
+    }
+    for (int c = 0; c < schema->num_columns; c++) {
+        if (schema->columns[c].type != COL_TYPE_INT) continue;
+        mins[c] = INT_MAX;
+        maxs[c] = INT_MIN;
+        if (!(samples[c] = malloc(STATS_SAMPLE_ROWS * sizeof(int)))) {
+            perror("Failed to allocate memory for ANALYZE sample");
+            goto cleanup;
+        }
+    }
+
+    ScanReader reader;
+    if (scan_reader_open(&reader, schema, 0, schema->data_size) != 0) goto cleanup;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL; // Fixed seed: repeatable histograms
+    const char* record;
+    while ((record = scan_reader_next(&reader, NULL)) != NULL) {
+        long row = stats->row_count++;
+        for (int c = 0; c < schema->num_columns; c++) {
+            const char* field = record + schema->columns[c].offset;
+            hll_add(stats->columns[c].hll, hash_value(&schema->columns[c], field));
+            if (samples[c]) {
+                int value;
+                memcpy(&value, field, sizeof(int));
+                if (value < mins[c]) mins[c] = value;
+                if (value > maxs[c]) maxs[c] = value;
+            }
+        }
+        // Reservoir sampling: row n replaces a random slot with probability k/n
+        long slot = row;
+        if (row >= STATS_SAMPLE_ROWS) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            slot = (long)(rng % (uint64_t)(row + 1));
+            if (slot >= STATS_SAMPLE_ROWS) continue;
+        }
+        for (int c = 0; c < schema->num_columns; c++) {
+            if (samples[c]) memcpy(&samples[c][slot], record + schema->columns[c].offset, sizeof(int));
+        }
+    }
+    int scan_error = reader.error;
+    scan_reader_close(&reader);
+    if (scan_error) goto cleanup; // Already reported
+
+    long sample_size = (stats->row_count < STATS_SAMPLE_ROWS) ? stats->row_count : STATS_SAMPLE_ROWS;
+    for (int c = 0; c < schema->num_columns; c++) {
+        if (samples[c]) build_histogram(&stats->columns[c], samples[c], sample_size, stats->row_count, mins[c], maxs[c]);
+    }
+    stats->dirty = 1;
+    free(schema->stats);
+    schema->stats = stats;
+    stats = NULL;
+    status = 0;
+
+cleanup:
+    for (int c = 0; samples && c < schema->num_columns; c++) free(samples[c]);
+    free(samples);
+    free(mins);
+    free(maxs);
+    free(stats);
+    return status;
+}
+
+/**
+ * Fold an inserted row into the table's statistics.
+ * @param schema Table the row was inserted into.
+ * @param row_data The row.
+ */
+void stats_update(TableSchema* schema, const void* row_data) {
+    TableStats* stats = schema->stats;
+    if (!stats) return;
+    stats->row_count++;
+    for (int c = 0; c < schema->num_columns; c++) {
+        const ColumnDefinition* def = &schema->columns[c];
+        const char* field = (const char*)row_data + def->offset;
+        ColumnStats* col = &stats->columns[c];
+        hll_add(col->hll, hash_value(def, field));
+        if (col->num_buckets == 0) continue;
+        int value;
+        memcpy(&value, field, sizeof(int));
+        if (value < col->bounds[0]) col->bounds[0] = value;
+        if (value > col->bounds[col->num_buckets]) col->bounds[col->num_buckets] = value;
+        col->counts[find_bucket(col, value)]++;
+    }
+    stats->dirty = 1;
+}
+
+// --- Persistence ---
+// Text format, one table after another:
+//   table:<name>:<row_count>
+//   column:<name>:<hll registers as hex>:<buckets>[:<bounds,...>:<counts,...>]
+
+static void write_column(FILE* fp, const ColumnDefinition* def, const ColumnStats* col) {
+    fprintf(fp, "column:%s:", def->name);
+    for (int i = 0; i < STATS_HLL_REGISTERS; i++) fprintf(fp, "%02x", col->hll[i]);
+    fprintf(fp, ":%d", col->num_buckets);
+    if (col->num_buckets > 0) {
+        for (int i = 0; i <= col->num_buckets; i++) fprintf(fp, "%c%d", i == 0 ? ':' : ',', col->bounds[i]);
+        for (int i = 0; i < col->num_buckets; i++) fprintf(fp, "%c%ld", i == 0 ? ':' : ',', col->counts[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+/**
+ * Write the statistics of all analyzed tables if any of them changed.
+ * @return 0 on success (or nothing to do), -1 on error.
+ */
+int stats_save_all(Database* db) {
+    int dirty = db->stats_dirty;
+    for (int i = 0; i < db->num_tables; i++) {
+        if (db->tables[i] && db->tables[i]->stats && db->tables[i]->stats->dirty) dirty = 1;
+    }
+    if (!dirty) return 0;
+
+    char path[MAX_PATH_LEN], temp_path[MAX_PATH_LEN + 4];
+    build_path(path, sizeof(path), db->data_dir, STATS_FILE, NULL);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* fp = fopen(temp_path, "w");
+    if (!fp) {
+        fprintf(stderr, "Error creating statistics file '%s': %s\n", temp_path, strerror(errno));
+        return -1;
+    }
+    fprintf(fp, "# Table statistics (ANALYZE)\n");
+    for (int i = 0; i < db->num_tables; i++) {
+        const TableSchema* schema = db->tables[i];
+        if (!schema || !schema->stats) continue;
+        fprintf(fp, "table:%s:%ld\n", schema->name, schema->stats->row_count);
+        for (int c = 0; c < schema->num_columns; c++) {
+            write_column(fp, &schema->columns[c], &schema->stats->columns[c]);
+        }
+    }
+    // Replace the old file only once the new one is complete on disk
+    int failed = (fflush(fp) != 0 || fsync(fileno(fp)) != 0);
+    if (fclose(fp) != 0) failed = 1;
+    if (failed || rename(temp_path, path) != 0) {
+        fprintf(stderr, "Error writing statistics file '%s': %s\n", path, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+    for (int i = 0; i < db->num_tables; i++) {
+        if (db->tables[i] && db->tables[i]->stats) db->tables[i]->stats->dirty = 0;
+    }
+    db->stats_dirty = 0;
+    return 0;
+}
+
+/**
+ * Parse a column line (after "column:<name>:") into `col`.
+ * @return 0 on success, -1 if malformed.
+ */
+static int parse_column(char* rest, ColumnStats* col) {
+    char* hex = strtok_r(rest, ":", &rest);
+    char* buckets = strtok_r(rest, ":", &rest);
+    if (!hex || !buckets || strlen(hex) != 2 * STATS_HLL_REGISTERS) return -1;
+    for (int i = 0; i < STATS_HLL_REGISTERS; i++) {
+        unsigned int value;
+        if (sscanf(hex + 2 * i, "%2x", &value) != 1) return -1;
+        col->hll[i] = (uint8_t)value;
+    }
+    col->num_buckets = atoi(buckets);
+    if (col->num_buckets < 0 || col->num_buckets > STATS_HISTOGRAM_BUCKETS) return -1;
+    if (col->num_buckets == 0) return 0;
+
+    char* bounds = strtok_r(rest, ":", &rest);
+    char* counts = strtok_r(rest, ":", &rest);
+    if (!bounds || !counts) return -1;
+    for (int i = 0; i <= col->num_buckets; i++) {
+        char* token = strtok_r(bounds, ",", &bounds);
+        if (!token) return -1;
+        col->bounds[i] = atoi(token);
+    }
+    for (int i = 0; i < col->num_buckets; i++) {
+        char* token = strtok_r(counts, ",", &counts);
+        if (!token) return -1;
+        col->counts[i] = atol(token);
+    }
+    return 0;
+}
+
+/**
+ * Load the statistics file and attach statistics to the loaded tables.
+ * Tables or columns that no longer exist are skipped.
+ * @return 0 on success (or no file), -1 on error.
+ */
+int stats_load_all(Database* db) {
+    char path[MAX_PATH_LEN];
+    build_path(path, sizeof(path), db->data_dir, STATS_FILE, NULL);
+    FILE* fp = fopen(path, "r");
+    if (!fp) return (errno == ENOENT) ? 0 : -1;
+
+    char* line = malloc(STATS_LINE_LEN);
+    if (!line) {
+        fclose(fp);
+        return -1;
+    }
+    TableSchema* schema = NULL;
+    while (fgets(line, STATS_LINE_LEN, fp)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '\0' || line[0] == '#') continue;
+        char* rest = line;
+        char* kind = strtok_r(rest, ":", &rest);
+        char* name = strtok_r(rest, ":", &rest);
+        if (!kind || !name) continue;
+
+        if (strcmp(kind, "table") == 0) {
+            schema = find_table_schema(db, name);
+            char* rows = strtok_r(rest, ":", &rest);
+            if (!schema || !rows) {
+                schema = NULL;
+                continue;
+            }
+            free(schema->stats);
+            if (!(schema->stats = new_stats(schema))) break;
+            schema->stats->row_count = atol(rows);
+        } else if (strcmp(kind, "column") == 0 && schema) {
+            const ColumnDefinition* def = find_column(schema, name);
+            if (!def) continue;
+            ColumnStats* col = &schema->stats->columns[def - schema->columns];
+            if (parse_column(rest, col) != 0 || (col->num_buckets > 0 && def->type != COL_TYPE_INT)) {
+                fprintf(stderr, "Warning: Ignoring malformed statistics for '%s.%s'.\n", schema->name, name);
+                memset(col, 0, sizeof(ColumnStats));
+            }
+        }
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "../structs.h"
+
+// --- Table Statistics ---
+// ANALYZE scans a table once and records its row count, a HyperLogLog
+// sketch per column (distinct value estimate) and an equi-depth histogram
+// per INT column built from a reservoir sample. Inserts keep them
+// approximately current: the row count and sketches are exact updates,
+// histogram buckets only grow their counts (and the outer bounds), so the
+// bucket boundaries drift until the next ANALYZE. Statistics of all tables
+// are kept in one text file beside the metadata file.
+
+#define STATS_HLL_REGISTERS (1 << STATS_HLL_BITS)
+
+typedef struct {
+    uint8_t hll[STATS_HLL_REGISTERS];          // HyperLogLog registers
+    int num_buckets;                           // 0 = no histogram (STRING columns)
+    int bounds[STATS_HISTOGRAM_BUCKETS + 1];   // Bucket i holds [bounds[i], bounds[i+1]); the last includes its upper bound
+    long counts[STATS_HISTOGRAM_BUCKETS];      // Rows per bucket
+} ColumnStats;
+
+typedef struct TableStats {
+    long row_count;
+    int dirty;                                 // 1 if changed since the last save
+    ColumnStats columns[];                     // One per table column
+} TableStats;
+
+// Scan a table and (re)build its statistics. Returns 0 on success, -1 on error.
+int analyze_table(TableSchema* schema);
+
+// Fold an inserted row into the table's statistics (no-op if not analyzed).
+void stats_update(TableSchema* schema, const void* row_data);
+
+// Estimated number of distinct values in a column.
+long stats_distinct(const TableStats* stats, int col_index);
+
+// Estimated fraction of rows with INT column value in [low, high], or -1
+// if the column has no histogram.
+double stats_range_selectivity(const TableStats* stats, int col_index, long low, long high);
+
+// Estimated fraction of rows with INT column value equal to `value`
+// (frequent values are recognised from repeated histogram boundaries).
+double stats_eq_selectivity(const TableStats* stats, int col_index, long value);
+
+// Load the statistics file into the loaded tables / write it if any table's
+// statistics changed (atomically, via a temporary file and rename).
+int stats_load_all(struct Database* db);
+int stats_save_all(struct Database* db);
+
+#endif // STATS_H
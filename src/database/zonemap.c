@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "zonemap.h"
+#include "scan.h"
+#include "database.h"
+#include "../util/crc32c.h"
+
+// On-disk header of the sidecar file, followed by the ranges array
+typedef struct {
+    int magic;
+    int block_size;     // ZONE_MAP_BLOCK_SIZE when written
+    int num_cols;
+    int num_blocks;
+    int record_size;    // Detects schema changes
+    uint32_t checksum;  // CRC32C of the ranges array
+    long covered;
+} ZoneMapHeader;
+
+static ZoneRange* block_ranges(const ZoneMap* map, int block) {
+    return &map->ranges[(size_t)block * map->num_cols];
+}
+
+/**
+ * Make room for blocks up to and including `block`.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int ensure_blocks(ZoneMap* map, int block) {
+    if (block < map->capacity) return 0;
+    int new_capacity = map->capacity ? map->capacity : 64;
+    while (new_capacity <= block) new_capacity *= 2;
+    ZoneRange* ranges = realloc(map->ranges, (size_t)new_capacity * map->num_cols * sizeof(ZoneRange));
+    if (!ranges) {
+        perror("Error growing zone map");
+        return -1;
+    }
+    map->ranges = ranges;
+    map->capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * Read the sidecar file into the map.
+ * @return 0 if a usable map was loaded, -1 if it must be rebuilt.
+ */
+static int load_map(ZoneMap* map, const TableSchema* schema) {
+    ZoneMapHeader header;
+    if (io_pread(map->file, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) return -1;
+    if (header.magic != ZONE_MAP_MAGIC || header.block_size != ZONE_MAP_BLOCK_SIZE ||
+        header.num_cols != map->num_cols || header.record_size != (int)schema->record_size ||
+        header.num_blocks < 0 || header.covered < 0 || header.covered > (long)schema->data_size) {
+        return -1;
+    }
+    if (header.num_blocks > 0) {
+        if (ensure_blocks(map, header.num_blocks - 1) != 0) return -1;
+        size_t bytes = (size_t)header.num_blocks * map->num_cols * sizeof(ZoneRange);
+        if (io_pread(map->file, map->ranges, bytes, sizeof(header)) != (ssize_t)bytes) return -1;
+        if (crc32c(map->ranges, bytes) != header.checksum) return -1;
+    }
+    map->num_blocks = header.num_blocks;
+    map->covered = header.covered;
+    return 0;
+}
+
+/**
+ * Summarize rows appended after the last save (or all rows when rebuilding).
+ * @return 0 on success, -1 on error.
+ */
+static int catch_up(ZoneMap* map, const TableSchema* schema) {
+    if (map->covered >= schema->data_size) return 0;
+    ScanReader reader;
+    if (scan_reader_open(&reader, schema, map->covered, schema->data_size) != 0) return -1;
+    const char* record;
+    off_t offset;
+    while ((record = scan_reader_next(&reader, &offset)) != NULL) {
+        zone_map_update(map, schema, offset, record);
+    }
+    int status = reader.error ? -1 : 0;
+    scan_reader_close(&reader);
+    return status;
+}
+
+/**
+ * Load (or create) the zone map for a table and bring it up to date.
+ * @param schema Table schema (data file must be open).
+ * @return The zone map, or NULL if the table has no INT columns or on error.
+ */
+ZoneMap* zone_map_open(const TableSchema* schema) {
+    int int_cols = 0;
+    for (int i = 0; i < schema->num_columns; ++i) {
+        if (schema->columns[i].type == COL_TYPE_INT) int_cols++;
+    }
+    if (int_cols == 0) return NULL;
+    ZoneMap* map = calloc(1, sizeof(ZoneMap) + (size_t)int_cols * sizeof(int));
+    if (!map) {
+        perror("Failed to allocate memory for ZoneMap");
+        return NULL;
+    }
+    for (int i = 0; i < schema->num_columns; ++i) {
+        if (schema->columns[i].type == COL_TYPE_INT) {
+            map->col_index[map->num_cols++] = i;
+        }
+    }
+
+    char filename[MAX_TABLE_NAME_LEN + sizeof(ZONE_MAP_EXT)];
+    snprintf(filename, sizeof(filename), "%s%s", schema->name, ZONE_MAP_EXT);
+    char path[MAX_PATH_LEN];
+    build_path(path, sizeof(path), schema->table_dir, filename, NULL);
+    map->file = io_open(path, IO_OPEN_CREATE);
+    if (!map->file) {
+        fprintf(stderr, "Warning: Could not open zone map '%s': %s\n", path, strerror(errno));
+        free(map);
+        return NULL;
+    }
+
+    if (load_map(map, schema) != 0) {
+        map->num_blocks = 0;
+        map->covered = 0;
+    }
+    off_t loaded = map->covered;
+    if (catch_up(map, schema) != 0) {
+        fprintf(stderr, "Warning: Zone map for table '%s' disabled (data file unreadable).\n", schema->name);
+        zone_map_close(map, NULL);
+        return NULL;
+    }
+    map->dirty = (map->covered != loaded);
+    return map;
+}
+
+/**
+ * Fold a row into the summary of the block holding its first byte.
+ * @param map The zone map (may be NULL).
+ * @param schema Table schema.
+ * @param offset Data file offset of the row.
+ * @param row_data Row bytes.
+ */
+void zone_map_update(ZoneMap* map, const TableSchema* schema, off_t offset, const void* row_data) {
+    if (!map) return;
+    int block = (int)(offset / ZONE_MAP_BLOCK_SIZE);
+    if (ensure_blocks(map, block) != 0) {
+        map->covered = 0; // Forces a rebuild on next open
+        return;
+    }
+    // Blocks skipped over (none for appends) start out as "may contain anything"
+    while (map->num_blocks <= block) {
+        ZoneRange* ranges = block_ranges(map, map->num_blocks);
+        for (int c = 0; c < map->num_cols; ++c) {
+            ranges[c].min = (map->num_blocks == block) ? 0 : -2147483647 - 1;
+            ranges[c].max = (map->num_blocks == block) ? -1 : 2147483647;
+        }
+        map->num_blocks++;
+    }
+
+    ZoneRange* ranges = block_ranges(map, block);
+    for (int c = 0; c < map->num_cols; ++c) {
+        int value;
+        memcpy(&value, (const char*)row_data + schema->columns[map->col_index[c]].offset, sizeof(int));
+        if (ranges[c].min > ranges[c].max) { // Empty range
+            ranges[c].min = ranges[c].max = value;
+        } else {
+            if (value < ranges[c].min) ranges[c].min = value;
+            if (value > ranges[c].max) ranges[c].max = value;
+        }
+    }
+    off_t end = offset + (off_t)schema->record_size;
+    if (end > map->covered) map->covered = end;
+    map->dirty = 1;
+}
+
+/**
+ * Check whether a block can hold rows with a column value in [lo, hi].
+ * @param map The zone map (may be NULL).
+ * @param block Block number.
+ * @param col_index Schema column index.
+ * @param lo Lowest value of interest.
+ * @param hi Highest value of interest.
+ * @return 0 if the block can be skipped, 1 otherwise.
+ */
+int zone_map_may_contain(const ZoneMap* map, int block, int col_index, int lo, int hi) {
+    if (!map || block >= map->num_blocks) return 1;
+    for (int c = 0; c < map->num_cols; ++c) {
+        if (map->col_index[c] == col_index) {
+            const ZoneRange* range = &block_ranges(map, block)[c];
+            return !(hi < range->min || lo > range->max);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Overall min/max of a tracked column across all summarized blocks.
+ * @param map The zone map (may be NULL).
+ * @param col_index Schema index of the column.
+ * @param min_out Receives the smallest value.
+ * @param max_out Receives the largest value.
+ * @return 1 if known, 0 if the column is untracked or the map is empty.
+ */
+int zone_map_column_range(const ZoneMap* map, int col_index, int* min_out, int* max_out) {
+    if (!map || map->num_blocks == 0) return 0;
+    for (int c = 0; c < map->num_cols; ++c) {
+        if (map->col_index[c] != col_index) continue;
+        int min = INT_MAX, max = INT_MIN;
+        for (int b = 0; b < map->num_blocks; ++b) {
+            const ZoneRange* range = &block_ranges(map, b)[c];
+            if (range->min > range->max) continue; // Empty block
+            if (range->min < min) min = range->min;
+            if (range->max > max) max = range->max;
+        }
+        if (min > max) return 0;
+        *min_out = min;
+        *max_out = max;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Write the map to its sidecar file if it changed.
+ * @param map The zone map (may be NULL).
+ * @param schema Table schema.
+ * @return 0 on success, -1 on error.
+ */
+int zone_map_save(ZoneMap* map, const TableSchema* schema) {
+    if (!map || !map->dirty) return 0;
+    size_t ranges_bytes = (size_t)map->num_blocks * map->num_cols * sizeof(ZoneRange);
+    char* buffer = malloc(sizeof(ZoneMapHeader) + ranges_bytes);
+    if (!buffer) {
+        perror("Error allocating zone map buffer");
+        return -1;
+    }
+    ZoneMapHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ZONE_MAP_MAGIC;
+    header.block_size = ZONE_MAP_BLOCK_SIZE;
+    header.num_cols = map->num_cols;
+    header.num_blocks = map->num_blocks;
+    header.record_size = (int)schema->record_size;
+    header.checksum = crc32c(map->ranges, ranges_bytes);
+    header.covered = (long)map->covered;
+    memcpy(buffer, &header, sizeof(header));
+    if (ranges_bytes) memcpy(buffer + sizeof(header), map->ranges, ranges_bytes);
+
+    ssize_t written = io_pwrite(map->file, buffer, sizeof(header) + ranges_bytes, 0);
+    free(buffer);
+    if (written != (ssize_t)(sizeof(header) + ranges_bytes)) {
+        fprintf(stderr, "Error writing zone map '%s': %s\n", map->file->path, strerror(errno));
+        return -1;
+    }
+    map->dirty = 0;
+    return 0;
+}
+
+/**
+ * Save (if schema is given) and free a zone map.
+ * @param map The zone map (may be NULL).
+ * @param schema Table schema, or NULL to discard unsaved changes.
+ */
+void zone_map_close(ZoneMap* map, const TableSchema* schema) {
+    if (!map) return;
+    if (schema) zone_map_save(map, schema);
+    io_close(map->file);
+    free(map->ranges);
+    free(map);
+}
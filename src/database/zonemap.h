@@ -0,0 +1,50 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include "../structs.h"
+#include "../io/io.h"
+
+// --- Zone Maps ---
+// Per-block min/max summaries of a table's INT columns. The data file is
+// divided into ZONE_MAP_BLOCK_SIZE blocks; a row belongs to the block its
+// first byte falls in. Scans skip blocks whose range cannot satisfy the
+// predicate. The map is kept in memory, updated on append and written to a
+// sidecar file at checkpoints; rows appended after the last save are
+// re-summarized from the data file on open.
+
+typedef struct {
+    int min;
+    int max;
+} ZoneRange;
+
+typedef struct ZoneMap {
+    IoFile* file;                 // Sidecar file
+    int num_cols;                 // Number of INT columns tracked
+    int num_blocks;               // Blocks with at least one row
+    int capacity;                 // Allocated blocks in ranges
+    ZoneRange* ranges;            // num_blocks * num_cols, block-major
+    off_t covered;                // Data bytes summarized by ranges
+    int dirty;                    // 1 if ranges changed since the last save
+    int col_index[];              // Schema column index of each tracked column
+} ZoneMap;
+
+// Load (or create) the zone map for a table and catch up with its data file.
+ZoneMap* zone_map_open(const TableSchema* schema);
+
+// Fold a newly appended row at data file offset `offset` into the map.
+void zone_map_update(ZoneMap* map, const TableSchema* schema, off_t offset, const void* row_data);
+
+// 0 if no row in `block` can have column `col_index` within [lo, hi], else 1.
+// Untracked columns and blocks always report 1.
+int zone_map_may_contain(const ZoneMap* map, int block, int col_index, int lo, int hi);
+
+// Overall min/max of a tracked column; returns 1 if known, else 0.
+int zone_map_column_range(const ZoneMap* map, int col_index, int* min_out, int* max_out);
+
+// Persist the map if it changed (checkpoint); 0 on success, -1 on error.
+int zone_map_save(ZoneMap* map, const TableSchema* schema);
+
+// Save and free the map.
+void zone_map_close(ZoneMap* map, const TableSchema* schema);
+
+#endif // ZONEMAP_H
@@ -0,0 +1,645 @@
+#define _GNU_SOURCE // O_DIRECT
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "io.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+
+#define IO_URING_ENTRIES 64 // Max reads in flight per thread
+
+static IoBackend current_backend;
+static int backend_initialized = 0;
+
+// --- Backend Selection ---
+
+static void init_backend(void) {
+    if (backend_initialized) return;
+    const char* env = getenv("DB_IO_BACKEND");
+    current_backend = (env && strcmp(env, "pread") == 0) ? IO_BACKEND_PREAD : IO_BACKEND_IO_URING;
+#ifndef HAVE_IO_URING
+    current_backend = IO_BACKEND_PREAD;
+#endif
+    backend_initialized = 1;
+}
+
+void io_set_backend(IoBackend backend) {
+    backend_initialized = 1;
+    current_backend = backend;
+#ifndef HAVE_IO_URING
+    current_backend = IO_BACKEND_PREAD;
+#endif
+}
+
+IoBackend io_get_backend(void) {
+    init_backend();
+    return current_backend;
+}
+
+const char* io_backend_name(void) {
+    return io_get_backend() == IO_BACKEND_IO_URING ? "io_uring" : "pread";
+}
+
+// --- Aligned Frames ---
+
+static size_t round_up_aligned(size_t size) {
+    return (size + IO_ALIGNMENT - 1) & ~(size_t)(IO_ALIGNMENT - 1);
+}
+
+/**
+ * Allocate a buffer usable for O_DIRECT transfers.
+ * @param size Requested size (rounded up to a multiple of IO_ALIGNMENT).
+ * @return Aligned buffer, or NULL on failure.
+ */
+void* io_alloc_aligned(size_t size) {
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, IO_ALIGNMENT, round_up_aligned(size ? size : 1)) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void io_free_aligned(void* ptr) {
+    free(ptr);
+}
+
+static int is_aligned(const void* buf, size_t len, off_t offset) {
+    return ((uintptr_t)buf % IO_ALIGNMENT) == 0 && (len % IO_ALIGNMENT) == 0 && (offset % IO_ALIGNMENT) == 0;
+}
+
+// --- File Handles ---
+
+/**
+ * Open a file for positional I/O.
+ * @param path Path to the file.
+ * @param flags IO_OPEN_* flags.
+ * @return Pointer to an IoFile, or NULL on failure (errno set).
+ */
+IoFile* io_open(const char* path, int flags) {
+    IoFile* file = malloc(sizeof(IoFile));
+    if (!file) return NULL;
+
+    int os_flags = (flags & IO_OPEN_READONLY) ? O_RDONLY : O_RDWR;
+    if (flags & IO_OPEN_CREATE) os_flags |= O_CREAT;
+    os_flags |= O_CLOEXEC;
+
+    file->direct = 0;
+#ifdef O_DIRECT
+    if (flags & IO_OPEN_DIRECT) {
+        file->fd = open(path, os_flags | O_DIRECT, 0664);
+        if (file->fd >= 0) {
+            file->direct = 1;
+        } else if (errno == EINVAL) {
+            // Filesystem (e.g. tmpfs) refuses O_DIRECT: fall back to buffered I/O
+            fprintf(stderr, "Warning: O_DIRECT not supported for '%s'; using buffered I/O.\n", path);
+        } else {
+            int saved = errno;
+            free(file);
+            errno = saved;
+            return NULL;
+        }
+    }
+    if (!file->direct)
+#endif
+    file->fd = open(path, os_flags, 0664);
+    if (file->fd < 0) {
+        int saved = errno;
+        free(file);
+        errno = saved;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(file->fd, &st) != 0) {
+        int saved = errno;
+        close(file->fd);
+        free(file);
+        errno = saved;
+        return NULL;
+    }
+    file->size = st.st_size;
+    file->flags = flags;
+    strncpy(file->path, path, MAX_PATH_LEN - 1);
+    file->path[MAX_PATH_LEN - 1] = '\0';
+    return file;
+}
+
+void io_close(IoFile* file) {
+    if (!file) return;
+    close(file->fd);
+    free(file);
+}
+
+/**
+ * Size of the file in bytes: its size when opened, extended by every write
+ * through this handle since (no system call). -1 for a NULL handle.
+ */
+off_t io_size(IoFile* file) {
+    if (!file) return -1;
+    return file->size;
+}
+
+int io_sync(IoFile* file) {
+    if (!file) return -1;
+    return fsync(file->fd);
+}
+
+/**
+ * Cut the file back to `size` bytes (drops data written past it).
+ * @return 0 on success, -1 on error (errno set).
+ */
+int io_truncate(IoFile* file, off_t size) {
+    if (!file) return -1;
+    if (ftruncate(file->fd, size) != 0) return -1;
+    file->size = size;
+    return 0;
+}
+
+/**
+ * Pass an access pattern hint to the kernel. Hints are best effort: errors
+ * are ignored, and O_DIRECT files bypass the page cache anyway.
+ */
+void io_advise(IoFile* file, off_t offset, off_t len, IoAdvice advice) {
+    if (!file || file->direct) return;
+#ifdef POSIX_FADV_SEQUENTIAL
+    int native = (advice == IO_ADVISE_SEQUENTIAL) ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_DONTNEED;
+    posix_fadvise(file->fd, offset, len, native);
+#else
+    (void)offset; (void)len; (void)advice;
+#endif
+}
+
+// --- Synchronous I/O ---
+
+// Loops over pread until len bytes or EOF
+static ssize_t pread_full(IoFile* file, void* buf, size_t len, off_t offset) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = pread(file->fd, (char*)buf + total, len - total, offset + (off_t)total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break; // EOF
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+// Loops over pwrite until all len bytes are written
+static ssize_t pwrite_full(IoFile* file, const void* buf, size_t len, off_t offset) {
+    size_t total = 0;
+    while (total < len) {
+        ssize_t n = pwrite(file->fd, (const char*)buf + total, len - total, offset + (off_t)total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        total += (size_t)n;
+    }
+    return (ssize_t)total;
+}
+
+/**
+ * Unaligned read on an O_DIRECT file: read the covering aligned range into a
+ * bounce buffer and copy out the requested bytes.
+ */
+static ssize_t bounce_pread(IoFile* file, void* buf, size_t len, off_t offset) {
+    off_t start = offset & ~(off_t)(IO_ALIGNMENT - 1);
+    size_t span = round_up_aligned((size_t)(offset - start) + len);
+    char* frame = io_alloc_aligned(span);
+    if (!frame) {
+        errno = ENOMEM;
+        return -1;
+    }
+    ssize_t n = pread_full(file, frame, span, start);
+    if (n >= 0) {
+        ssize_t available = n - (ssize_t)(offset - start);
+        if (available < 0) available = 0;
+        n = ((size_t)available < len) ? available : (ssize_t)len;
+        memcpy(buf, frame + (offset - start), (size_t)n);
+    }
+    int saved = errno;
+    io_free_aligned(frame);
+    errno = saved;
+    return n;
+}
+
+/**
+ * Unaligned write on an O_DIRECT file: read-modify-write the covering
+ * aligned blocks. Blocks past the end of the data are zero-filled rather
+ * than read, and the last block is written whole, so the file may end in
+ * zero padding beyond its logical size.
+ */
+static ssize_t bounce_pwrite(IoFile* file, const void* buf, size_t len, off_t offset) {
+    off_t start = offset & ~(off_t)(IO_ALIGNMENT - 1);
+    size_t span = round_up_aligned((size_t)(offset - start) + len);
+    char* frame = io_alloc_aligned(span);
+    if (!frame) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(frame, 0, span);
+    // Only the partially covered first/last blocks need their old contents
+    if (start < file->size && pread_full(file, frame, IO_ALIGNMENT, start) < 0) goto fail;
+    off_t last = start + (off_t)span - IO_ALIGNMENT;
+    if (last > start && last < file->size && pread_full(file, frame + (last - start), IO_ALIGNMENT, last) < 0) goto fail;
+
+    memcpy(frame + (offset - start), buf, len);
+    if (pwrite_full(file, frame, span, start) < 0) goto fail;
+
+    io_free_aligned(frame);
+    return (ssize_t)len;
+
+fail:;
+    int saved = errno;
+    io_free_aligned(frame);
+    errno = saved;
+    return -1;
+}
+
+/**
+ * Read up to len bytes at offset, retrying short reads until EOF.
+ * @return Bytes read (less than len only at EOF), or -1 on error.
+ */
+ssize_t io_pread(IoFile* file, void* buf, size_t len, off_t offset) {
+    if (file->direct && !is_aligned(buf, len, offset)) {
+        return bounce_pread(file, buf, len, offset);
+    }
+    return pread_full(file, buf, len, offset);
+}
+
+/**
+ * Write len bytes at offset, retrying short writes.
+ * @return Bytes written (== len), or -1 on error.
+ */
+ssize_t io_pwrite(IoFile* file, const void* buf, size_t len, off_t offset) {
+    ssize_t n = (file->direct && !is_aligned(buf, len, offset)) ? bounce_pwrite(file, buf, len, offset)
+                                                                 : pwrite_full(file, buf, len, offset);
+    if (n > 0 && offset + n > file->size) file->size = offset + n;
+    return n;
+}
+
+// Completes a request synchronously (pread backend, or io_uring fallback)
+static void complete_with_pread(IoRequest* req) {
+    ssize_t n = io_pread(req->file, req->buf, req->len, req->offset);
+    req->result = (n < 0) ? -errno : n;
+    req->done = 1;
+}
+
+// --- io_uring Backend ---
+#ifdef HAVE_IO_URING
+
+typedef struct {
+    int ring_fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned entries;
+    unsigned in_flight;
+    int buffers_registered;
+} UringRing;
+
+// One ring per thread, so parallel scans/verification need no locking
+static __thread UringRing* thread_ring = NULL;
+static __thread int thread_ring_failed = 0;
+static int fallback_reported = 0;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void destroy_ring(UringRing* ring) {
+    if (!ring) return;
+    if (ring->sqes && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr && ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_len);
+    if (ring->sq_ptr && ring->sq_ptr != MAP_FAILED) munmap(ring->sq_ptr, ring->sq_len);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    free(ring);
+}
+
+/**
+ * Get (creating on first use) the calling thread's ring.
+ * @return The ring, or NULL if io_uring is unavailable (caller falls back to pread).
+ */
+static UringRing* get_ring(void) {
+    if (thread_ring) return thread_ring;
+    if (thread_ring_failed) return NULL;
+
+    UringRing* ring = calloc(1, sizeof(UringRing));
+    if (!ring) {
+        thread_ring_failed = 1;
+        return NULL;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->ring_fd = sys_io_uring_setup(IO_URING_ENTRIES, &params);
+    if (ring->ring_fd < 0) {
+        if (!fallback_reported) {
+            fprintf(stderr, "Warning: io_uring unavailable (%s); using pread backend.\n", strerror(errno));
+            fallback_reported = 1;
+        }
+        free(ring);
+        thread_ring_failed = 1;
+        return NULL;
+    }
+    ring->entries = params.sq_entries;
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) goto fail;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) goto fail;
+    }
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    char* sq = (char*)ring->sq_ptr;
+    char* cq = (char*)ring->cq_ptr;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    thread_ring = ring;
+    return ring;
+
+fail:
+    fprintf(stderr, "Warning: io_uring ring mapping failed (%s); using pread backend.\n", strerror(errno));
+    destroy_ring(ring);
+    thread_ring_failed = 1;
+    return NULL;
+}
+
+/**
+ * Move completed entries from the completion queue into their requests.
+ * A short read before EOF is finished synchronously.
+ */
+static void reap_completions(UringRing* ring) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        IoRequest* req = (IoRequest*)(uintptr_t)cqe->user_data;
+        req->result = cqe->res;
+        if (cqe->res > 0 && (size_t)cqe->res < req->len) {
+            ssize_t rest = io_pread(req->file, (char*)req->buf + cqe->res,
+                                    req->len - (size_t)cqe->res, req->offset + cqe->res);
+            req->result = (rest < 0) ? -errno : cqe->res + rest;
+        }
+        req->done = 1;
+        ring->in_flight--;
+        head++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Queue one read on the submission ring (does not enter the kernel).
+ * @return 0 on success, -1 if the submission ring is full.
+ */
+static int queue_read(UringRing* ring, IoRequest* req) {
+    unsigned tail = *ring->sq_tail;
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->entries || ring->in_flight >= ring->entries) return -1;
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = req->file->fd;
+    sqe->addr = (unsigned long)req->buf;
+    sqe->len = (unsigned)req->len;
+    sqe->off = (unsigned long long)req->offset;
+    sqe->user_data = (unsigned long long)(uintptr_t)req;
+    if (req->buf_index >= 0 && ring->buffers_registered) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = (unsigned short)req->buf_index;
+    } else {
+        sqe->opcode = IORING_OP_READ;
+    }
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->in_flight++;
+    return 0;
+}
+
+/**
+ * Take back the queued reads the kernel has not consumed and complete them
+ * with pread, so no request waits on a read that was never submitted.
+ */
+static void reclaim_unsubmitted(UringRing* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail;
+    for (unsigned i = head; i != tail; i++) {
+        struct io_uring_sqe* sqe = &ring->sqes[ring->sq_array[i & *ring->sq_mask]];
+        complete_with_pread((IoRequest*)(uintptr_t)sqe->user_data);
+        ring->in_flight--;
+    }
+    __atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Hand `to_submit` queued reads to the kernel, then wait for `min_complete`
+ * completions. The kernel may consume fewer entries than asked (and then
+ * skips the wait); the rest are passed again until all are taken. Entries
+ * it refuses with an error are reclaimed and read with pread.
+ * @return 0 on success, -1 if waiting failed (errno set).
+ */
+static int submit_queued(UringRing* ring, unsigned to_submit, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    while (1) {
+        int ret = sys_io_uring_enter(ring->ring_fd, to_submit, min_complete, flags);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret >= 0 && (unsigned)ret == to_submit) return 0;
+        if (ret > 0) {
+            to_submit -= (unsigned)ret;
+            continue;
+        }
+        if (to_submit == 0) return -1;
+        reclaim_unsubmitted(ring);
+        return 0;
+    }
+}
+
+#endif // HAVE_IO_URING
+
+// --- Asynchronous Reads ---
+
+/**
+ * Start a set of reads. With io_uring they proceed in the background until
+ * io_read_wait(); with pread they complete before this returns.
+ * @param reqs Requests (file, buf, len, offset, buf_index filled in).
+ * @param n Number of requests.
+ * @return 0 on success, -1 on error.
+ */
+int io_read_submit(IoRequest* reqs, int n) {
+    for (int i = 0; i < n; i++) {
+        reqs[i].done = 0;
+        reqs[i].result = 0;
+    }
+#ifdef HAVE_IO_URING
+    UringRing* ring = (io_get_backend() == IO_BACKEND_IO_URING) ? get_ring() : NULL;
+    if (ring) {
+        int i = 0;
+        while (i < n) {
+            unsigned queued = 0;
+            while (i < n) {
+                if (reqs[i].file->direct && !is_aligned(reqs[i].buf, reqs[i].len, reqs[i].offset)) {
+                    complete_with_pread(&reqs[i]); // Needs a bounce buffer
+                } else if (queue_read(ring, &reqs[i]) == 0) {
+                    queued++;
+                } else {
+                    break;
+                }
+                i++;
+            }
+            // Ring full: wait for one completion to make room
+            unsigned min_complete = (i < n) ? 1 : 0;
+            if (submit_queued(ring, queued, min_complete) < 0) {
+                return -1;
+            }
+            if (min_complete) reap_completions(ring);
+        }
+        return 0;
+    }
+#endif
+    for (int i = 0; i < n; i++) {
+        complete_with_pread(&reqs[i]);
+    }
+    return 0;
+}
+
+/**
+ * Wait for one submitted read.
+ * @param req A request passed to io_read_submit().
+ * @return Bytes read, or -1 on error (errno set).
+ */
+ssize_t io_read_wait(IoRequest* req) {
+#ifdef HAVE_IO_URING
+    while (!req->done) {
+        UringRing* ring = thread_ring;
+        if (!ring) {
+            complete_with_pread(req); // Should not happen: submitted without a ring
+            break;
+        }
+        reap_completions(ring);
+        if (req->done) break;
+        if (submit_queued(ring, 0, 1) < 0) {
+            return -1;
+        }
+    }
+#endif
+    if (req->result < 0) {
+        errno = (int)-req->result;
+        return -1;
+    }
+    return req->result;
+}
+
+/**
+ * Read a batch of ranges with all reads in flight at once.
+ * @return 0 if every read succeeded, -1 otherwise (check each result).
+ */
+int io_read_batch(IoRequest* reqs, int n) {
+    if (io_read_submit(reqs, n) != 0) return -1;
+    int status = 0;
+    for (int i = 0; i < n; i++) {
+        if (io_read_wait(&reqs[i]) < 0) status = -1;
+    }
+    return status;
+}
+
+/**
+ * Release the calling thread's ring. Worker threads call this before exiting.
+ */
+void io_thread_cleanup(void) {
+#ifdef HAVE_IO_URING
+    if (thread_ring) {
+        destroy_ring(thread_ring);
+        thread_ring = NULL;
+    }
+    thread_ring_failed = 0;
+#endif
+}
+
+// --- Registered Buffers ---
+
+/**
+ * Register fixed page frames with the calling thread's ring. An existing
+ * set is left alone: its owner may still have reads in flight into it.
+ * @param bufs Frame addresses.
+ * @param buf_len Size of each frame.
+ * @param n Number of frames.
+ * @return 0 if registered, 1 if not (no ring, or a set is already
+ *         registered), -1 on error.
+ */
+int io_register_buffers(void** bufs, size_t buf_len, int n) {
+#ifdef HAVE_IO_URING
+    UringRing* ring = (io_get_backend() == IO_BACKEND_IO_URING) ? get_ring() : NULL;
+    if (!ring || ring->buffers_registered) return 1;
+
+    struct iovec* iov = malloc((size_t)n * sizeof(struct iovec));
+    if (!iov) return -1;
+    for (int i = 0; i < n; i++) {
+        iov[i].iov_base = bufs[i];
+        iov[i].iov_len = buf_len;
+    }
+    int ret = sys_io_uring_register(ring->ring_fd, IORING_REGISTER_BUFFERS, iov, (unsigned)n);
+    free(iov);
+    if (ret < 0) return -1;
+    ring->buffers_registered = 1;
+    return 0;
+#else
+    (void)bufs; (void)buf_len; (void)n;
+    return 1;
+#endif
+}
+
+void io_unregister_buffers(void) {
+#ifdef HAVE_IO_URING
+    UringRing* ring = thread_ring;
+    if (!ring || !ring->buffers_registered) return;
+    sys_io_uring_register(ring->ring_fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    ring->buffers_registered = 0;
+#endif
+}
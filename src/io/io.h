@@ -0,0 +1,95 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "../constants.h"
+
+// --- Page I/O Layer ---
+// Positional file I/O used for index and data files. Single reads and writes
+// are plain pread/pwrite; batches and asynchronous reads go through the
+// selected backend so several reads can be in flight at once.
+
+typedef enum {
+    IO_BACKEND_PREAD,    // Synchronous pread/pwrite (always available)
+    IO_BACKEND_IO_URING  // Linux io_uring, falls back to pread if unavailable
+} IoBackend;
+
+// io_open flags
+#define IO_OPEN_CREATE   0x1 // Create the file if it does not exist
+#define IO_OPEN_READONLY 0x2 // Open for reading only
+#define IO_OPEN_DIRECT   0x4 // Bypass the OS page cache (O_DIRECT) where supported
+
+#define IO_ALIGNMENT 4096    // Buffer/offset/length alignment required by O_DIRECT
+
+typedef struct {
+    int fd;
+    int flags;                 // IO_OPEN_* flags used to open the file
+    int direct;                // 1 if O_DIRECT is actually in effect
+    off_t size;                // End of the data: size at open, grown by writes
+    char path[MAX_PATH_LEN];   // For error messages
+} IoFile;
+
+// One asynchronous read. Fill file/buf/len/offset (and buf_index for a
+// registered buffer, else -1); result and done are set on completion.
+typedef struct {
+    IoFile* file;
+    void* buf;
+    size_t len;
+    off_t offset;
+    int buf_index;   // Index into io_register_buffers() set, or -1
+    ssize_t result;  // Bytes read (short only at EOF), or -errno
+    int done;
+} IoRequest;
+
+// Backend selection (default: DB_IO_BACKEND env var, else io_uring)
+void io_set_backend(IoBackend backend);
+IoBackend io_get_backend(void);
+const char* io_backend_name(void);
+
+// File handles
+IoFile* io_open(const char* path, int flags);
+void io_close(IoFile* file);
+off_t io_size(IoFile* file);
+int io_sync(IoFile* file);
+int io_truncate(IoFile* file, off_t size);
+
+// Access pattern hints (posix_fadvise); ignored for O_DIRECT files
+typedef enum {
+    IO_ADVISE_SEQUENTIAL, // Range will be read front to back: read ahead aggressively
+    IO_ADVISE_DONTNEED    // Range is done with: drop it from the page cache
+} IoAdvice;
+
+void io_advise(IoFile* file, off_t offset, off_t len, IoAdvice advice);
+
+// Page frames aligned to IO_ALIGNMENT (size rounded up); free with io_free_aligned.
+void* io_alloc_aligned(size_t size);
+void io_free_aligned(void* ptr);
+
+// Synchronous positional I/O. On O_DIRECT files, unaligned requests are
+// served through an aligned bounce buffer (read-modify-write for writes).
+// The last block is written in full, so the file on disk may end in zero
+// padding past io_size(); callers recovering after a crash must treat
+// trailing records that do not validate as torn. Return bytes transferred
+// (reads are short only at EOF), or -1 with errno set.
+ssize_t io_pread(IoFile* file, void* buf, size_t len, off_t offset);
+ssize_t io_pwrite(IoFile* file, const void* buf, size_t len, off_t offset);
+
+// Asynchronous reads: submit returns once the reads are queued; wait blocks
+// until one request is complete. batch = submit + wait for all.
+int io_read_submit(IoRequest* reqs, int n);
+ssize_t io_read_wait(IoRequest* req);
+int io_read_batch(IoRequest* reqs, int n);
+
+// Release the calling thread's io_uring ring (call before a worker thread exits)
+void io_thread_cleanup(void);
+
+// Register page frames with the calling thread's ring so reads into them
+// skip per-I/O buffer mapping (pass the frame's index as buf_index). A
+// thread holds one set at a time: returns 0 if the frames were registered
+// (release them with io_unregister_buffers), 1 if not (pread backend, or
+// the thread already has a set; use buf_index -1), -1 on error.
+int io_register_buffers(void** bufs, size_t buf_len, int n);
+void io_unregister_buffers(void);
+
+#endif // IO_H
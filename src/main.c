@@ -5,8 +5,13 @@
 #include <string.h>
 #include <ctype.h> // For toupper, isspace
 #include "database/database.h"
+#include "query/prepared.h"
+#include "query/tokenizer.h"
+#include "database/stats.h"
 
-#define MAX_INPUT_LEN 512
+#define MAX_INPUT_LEN 8192 // Room for multi-row INSERT batches
+
+static Database* db; // The database this REPL session works on
 
 // Helper function to set a field value in a generic row buffer
 // NOTE: Add more robust error checking as needed.
@@ -98,61 +103,6 @@ char* trim_whitespace(char *str) {
     return str;
 }
 
-// Helper to convert string value based on column type and set in buffer
-// Returns 0 on success, -1 on error
-int set_value_by_index(const TableSchema* schema, void* row_data, int col_index, const char* value_str) {
-    if (!schema || !row_data || !value_str) return -1;
-    if (col_index < 0 || col_index >= schema->num_columns) {
-        fprintf(stderr, "Error: Invalid column index %d.\n", col_index);
-        return -1;
-    }
-
-    const ColumnDefinition* col = &schema->columns[col_index];
-    char* dest = (char*)row_data + col->offset;
-
-     // Check bounds
-     if (col->offset + col->size > schema->row_size) {
-         fprintf(stderr, "Error: Column '%s' offset/size exceeds row size.\n", col->name);
-         return -1;
-     }
-
-    if (col->type == COL_TYPE_INT) {
-        // Use strtol for better error checking than atoi
-        char *endptr;
-        long val = strtol(value_str, &endptr, 10);
-        // Check for conversion errors
-        if (endptr == value_str || *endptr != '\0' || errno == ERANGE) {
-             fprintf(stderr, "Error: Invalid integer value '%s' for column '%s'.\n", value_str, col->name);
-             return -1;
-        }
-        int int_val = (int)val; // Assuming long fits in int for simplicity here
-        memcpy(dest, &int_val, sizeof(int));
-
-    } else if (col->type == COL_TYPE_STRING) {
-        // Trim whitespace from the value string itself before copying
-        char* trimmed_value = trim_whitespace((char*)value_str); // Cast needed as value_str is const
-        size_t len = strlen(trimmed_value);
-
-        if (len >= col->size) {
-            fprintf(stderr, "Warning: String value '%.*s...' too long for column '%s' (max %zu chars). Truncating.\n",
-                    15, trimmed_value, col->name, col->size -1);
-            memcpy(dest, trimmed_value, col->size - 1);
-            dest[col->size - 1] = '\0'; // Ensure null termination on truncation
-        } else {
-            memcpy(dest, trimmed_value, len + 1); // Copy including null terminator
-            // Zero out remaining buffer space (optional, good practice)
-            if (len + 1 < col->size) {
-                memset(dest + len + 1, 0, col->size - (len + 1));
-            }
-        }
-    } else {
-         fprintf(stderr, "Error: Unsupported column type %d for column '%s'.\n", col->type, col->name);
-         return -1;
-    }
-    return 0; // Success
-}
-
-
 // --- Command Handlers ---
 
 // Handle INSERT INTO table VALUES (val1, val2, ...);
@@ -164,246 +114,291 @@ char* skip_whitespace(char* str) {
     return str;
 }
 
-// Handle INSERT INTO table VALUES (val1, val2, ...);
-void handle_insert(char* original_input) {
-    char input_copy[MAX_INPUT_LEN];
-    strncpy(input_copy, original_input, MAX_INPUT_LEN - 1);
-    input_copy[MAX_INPUT_LEN - 1] = '\0';
+/**
+ * @brief Prints the content of a generic row buffer based on its schema.
+ * Result formatting is the REPL's job; the engine only hands rows over.
+ * @param schema Pointer to the table schema.
+ * @param row_data Pointer to the raw row data buffer.
+ */
+static void print_row(const TableSchema* schema, const void* row_data) {
+    if (!schema || !row_data) return;
+
+    const char* current_byte = (const char*)row_data;
+
+    static const char* type_names[] = {"int", "string", "long", "double"};
+    printf("  Row (size %zu bytes): {\n", schema->row_size);
+    for (int i = 0; i < schema->num_columns; ++i) {
+        const ColumnDefinition* col = &schema->columns[i];
+        const void* field_ptr = current_byte + col->offset;
+
+        printf("    %s (%s, size %zu): ", col->name, type_names[col->type], col->size);
+
+        if (col->type == COL_TYPE_INT) {
+            int value;
+            memcpy(&value, field_ptr, sizeof(int)); // Use memcpy for safety
+            printf("%d", value);
+        } else if (col->type == COL_TYPE_LONG) {
+            int64_t value;
+            memcpy(&value, field_ptr, sizeof(value));
+            printf("%lld", (long long)value);
+        } else if (col->type == COL_TYPE_DOUBLE) {
+            double value;
+            memcpy(&value, field_ptr, sizeof(value));
+            printf("%.4f", value);
+        } else if (col->type == COL_TYPE_STRING) {
+            // Bounded by the column size, so no terminator is needed in the row
+            printf("\"%.*s\"", (int)strnlen((const char*)field_ptr, col->size), (const char*)field_ptr);
+        }
+        // Add other types here
+        // else if (col->type == COL_TYPE_FLOAT) { ... }
 
-    char *cursor = input_copy; // Pointer to traverse the command
-    char table_name_buf[MAX_TABLE_NAME_LEN] = {0};
-    char *values_part = NULL;
-    char *end_values = NULL;
+        if (col->is_primary_key) {
+            printf(" [PK]");
+        }
+        printf("\n");
+    }
+    printf("  }\n");
+}
 
-    // --- Parse Manually ---
+static int print_result_row(const TableSchema* schema, const void* row, void* ctx) {
+    (void)ctx;
+    print_row(schema, row);
+    return 0; // Keep going
+}
 
-    // 1. Skip leading spaces & check "INSERT" (case-insensitive)
-    cursor = skip_whitespace(cursor);
-    if (strncasecmp(cursor, "INSERT ", 7) != 0) goto syntax_error;
-    cursor += 6; // Move past "INSERT"
-    cursor = skip_whitespace(cursor); // Skip space after INSERT
-
-    // 2. Check "INTO"
-    if (strncasecmp(cursor, "INTO ", 5) != 0) goto syntax_error;
-    cursor += 4; // Move past "INTO"
-    cursor = skip_whitespace(cursor); // Skip space after INTO
-
-    // 3. Extract table_name
-    char *table_name_start = cursor;
-    while (*cursor != '\0' && !isspace((unsigned char)*cursor)) {
-        cursor++; // Find end of table name (space or end of string)
+// Execute a statement and print its outcome in the REPL's usual wording.
+static void execute_and_report(PreparedStatement* stmt) {
+    if (stmt->type == STMT_INSERT) {
+        long result = stmt_execute(stmt, NULL, NULL);
+        if (result == 0) {
+            printf("Inserted %d row%s into %s.\n", stmt->num_rows, stmt->num_rows == 1 ? "" : "s", stmt->schema->name);
+        } else if (result == 1) {
+            printf("Insert failed: Duplicate primary key.\n");
+        } else {
+            printf("Insert failed (error code %ld).\n", result);
+        }
+        return;
+    }
+    if (stmt->type == STMT_CREATE_TABLE || stmt->type == STMT_DROP_TABLE) {
+        int create = (stmt->type == STMT_CREATE_TABLE);
+        long result = stmt_execute(stmt, NULL, NULL);
+        if (result == 0) {
+            printf("%s table %s.\n", create ? "Created" : "Dropped", stmt->schema->name);
+        } else if (result == 1) {
+            printf(create ? "Create failed: Table %s already exists.\n" : "Drop failed: No table %s.\n", stmt->schema->name);
+        } else {
+            printf("%s failed (error code %ld).\n", create ? "Create" : "Drop", result);
+        }
+        return;
     }
-    size_t table_name_len = cursor - table_name_start;
-    if (table_name_len == 0 || table_name_len >= MAX_TABLE_NAME_LEN) {
-        fprintf(stderr, "Error: Invalid or missing table name.\n");
-        goto syntax_error;
+    long count = stmt_execute(stmt, print_result_row, NULL);
+    if (count < 0) {
+        printf("Select failed (error code %ld).\n", count);
+    } else {
+        printf("%ld row%s found.\n", count, count == 1 ? "" : "s");
     }
-    strncpy(table_name_buf, table_name_start, table_name_len);
-    table_name_buf[table_name_len] = '\0'; // Null terminate the extracted name
-    cursor = skip_whitespace(cursor); // Skip space after table name
-
-    // 4. Check "VALUES"
-    if (strncasecmp(cursor, "VALUES", 6) != 0) goto syntax_error;
-    cursor += 6; // Move past "VALUES"
-    cursor = skip_whitespace(cursor); // Skip space after VALUES
-
-    // 5. Find '('
-    if (*cursor != '(') goto syntax_error;
-    values_part = cursor + 1; // Point just after '('
-
-    // 6. Find matching ')' - more robustly
-    end_values = strrchr(values_part, ')'); // Find the LAST ')'
-    if (!end_values || end_values < values_part) goto syntax_error; // Must exist and be after '('
-    // Check for nested parentheses if needed (simplification: assume none)
+}
 
-    // Temporarily null-terminate at ')' to isolate the values string for strtok
-    *end_values = '\0';
+// Run one statement typed at the prompt as an unnamed prepared statement.
+static void run_statement(const char* input) {
+    PreparedStatement* stmt = stmt_prepare(db, input);
+    if (!stmt) return; // Error already reported
+    if (stmt->num_params > 0) {
+        fprintf(stderr, "Error: '?' parameters are only allowed in PREPARE.\n");
+        stmt_finalize(stmt);
+        return;
+    }
+    execute_and_report(stmt);
+    stmt_finalize(stmt);
+}
 
-    // --- End Manual Parse ---
+// Handle INSERT INTO table [(col, ...)] VALUES (val1, val2, ...)[, (...) ...];
+void handle_insert(char* original_input) {
+    run_statement(original_input);
+}
 
+// Handle SELECT * | item, ... FROM table [WHERE condition] [GROUP BY col, ...];
+void handle_select(char* original_input) {
+    run_statement(original_input);
+}
 
-    // 7. Find table schema (using extracted table_name_buf)
-    TableSchema* schema = find_table_schema(table_name_buf);
-    if (!schema) {
-        fprintf(stderr, "Error: Table '%s' not found.\n", table_name_buf);
-        return;
+// Handle EXPLAIN SELECT ...; prints the plan without running it
+void handle_explain(char* original_input) {
+    char* statement = skip_whitespace(original_input) + 7; // Past "EXPLAIN"
+    PreparedStatement* stmt = stmt_prepare(db, statement);
+    if (!stmt) return; // Error already reported
+    if (stmt->type == STMT_SELECT) {
+        plan_explain(stmt->plan, stdout);
+    } else {
+        fprintf(stderr, "Error: EXPLAIN supports SELECT statements only.\n");
     }
+    stmt_finalize(stmt);
+}
 
-    // 8. Allocate row buffer
-    void* row_data = malloc(schema->row_size);
-    if (!row_data) {
-        perror("Error allocating memory for row data");
-        return;
-    }
-    memset(row_data, 0, schema->row_size); // Zero out buffer
-
-    // 9. Parse values and populate buffer (using strtok on the isolated values_part)
-    char *value_token;
-    int col_index = 0;
-    value_token = strtok(values_part, ","); // First value
-
-    while (value_token != NULL) {
-        if (col_index >= schema->num_columns) {
-            fprintf(stderr, "Error: Too many values provided for table '%s'. Expected %d.\n", table_name_buf, schema->num_columns);
-            free(row_data);
-            // Restore ')' before returning if necessary, though buffer is discarded
-            *end_values = ')'; // Restore ')' - good practice
-            return;
+// Handle ANALYZE [table]; (all tables if none given)
+void handle_analyze(const char* table_name) {
+    int analyzed = 0;
+    for (int i = 0; i < db->num_tables; i++) {
+        TableSchema* schema = db->tables[i];
+        if (!schema || (table_name && strcmp(schema->name, table_name) != 0)) continue;
+        analyzed++;
+        if (analyze_table(schema) != 0) {
+            printf("Analyze of '%s' failed.\n", schema->name);
+            continue;
         }
-
-        char* trimmed_val = trim_whitespace(value_token); // Trim each value
-
-        if (strlen(trimmed_val) == 0 && col_index < (schema->num_columns -1) ) {
-             fprintf(stderr, "Warning: Empty value encountered for column %d. Behavior undefined.\n", col_index);
+        printf("Analyzed '%s': %ld rows\n", schema->name, schema->stats->row_count);
+        for (int c = 0; c < schema->num_columns; c++) {
+            const ColumnStats* col = &schema->stats->columns[c];
+            printf("  %s: ~%ld distinct", schema->columns[c].name, stats_distinct(schema->stats, c));
+            if (col->num_buckets > 0) {
+                printf(", range [%d, %d], %d histogram buckets",
+                       col->bounds[0], col->bounds[col->num_buckets], col->num_buckets);
+            }
+            printf("\n");
         }
+    }
+    if (analyzed == 0) {
+        fprintf(stderr, "Error: Table '%s' not found.\n", table_name ? table_name : "");
+    } else if (stats_save_all(db) != 0) {
+        fprintf(stderr, "Warning: Statistics could not be saved.\n");
+    }
+}
 
-        if (set_value_by_index(schema, row_data, col_index, trimmed_val) != 0) {
-            // Error message already printed by set_value_by_index
-            free(row_data);
-            *end_values = ')'; // Restore ')'
-            return;
+// Handle REINDEX [table]; (all tables with a primary key if none given)
+void handle_reindex(const char* table_name) {
+    int found = 0;
+    for (int i = 0; i < db->num_tables; i++) {
+        TableSchema* schema = db->tables[i];
+        if (!schema || (table_name ? strcmp(schema->name, table_name) != 0 : !schema->pk_index)) continue;
+        found++;
+        if (rebuild_pk_index(schema) != 0) {
+            printf("Reindex of '%s' failed.\n", schema->name);
+        } else {
+            printf("Reindexed '%s'.\n", schema->name);
         }
-
-        col_index++;
-        value_token = strtok(NULL, ","); // Get next value
     }
+    if (found == 0 && table_name) {
+        fprintf(stderr, "Error: Table '%s' not found.\n", table_name);
+    }
+}
 
-    // Restore ')' in the input_copy string
-     *end_values = ')';
+// Handle PREPARE name AS statement;
+void handle_prepare(char* original_input) {
+    char input_copy[MAX_INPUT_LEN];
+    strncpy(input_copy, original_input, MAX_INPUT_LEN - 1);
+    input_copy[MAX_INPUT_LEN - 1] = '\0';
 
-    // 10. Check if enough values were provided
-    if (col_index < schema->num_columns) {
-        fprintf(stderr, "Error: Not enough values provided for table '%s'. Expected %d, got %d.\n", table_name_buf, schema->num_columns, col_index);
-        free(row_data);
-        return;
-    }
+    char* cursor = skip_whitespace(input_copy) + 7; // Past "PREPARE"
+    cursor = skip_whitespace(cursor);
+    char* name = cursor;
+    while (*cursor != '\0' && !isspace((unsigned char)*cursor)) cursor++;
+    if (cursor == name || *cursor == '\0') goto syntax_error;
+    *cursor++ = '\0';
+    cursor = skip_whitespace(cursor);
+    if (strncasecmp(cursor, "AS", 2) != 0 || !isspace((unsigned char)cursor[2])) goto syntax_error;
 
-    // 11. Insert the row
-    int result = insert_row(table_name_buf, row_data); // Use extracted table name
-    if (result == 0) {
-        printf("Inserted 1 row into %s.\n", table_name_buf);
-    } else if (result == 1) {
-        printf("Insert failed: Duplicate primary key.\n");
-    } else {
-        printf("Insert failed (error code %d).\n", result);
+    PreparedStatement* stmt = stmt_prepare(db, trim_whitespace(cursor + 2));
+    if (!stmt) return; // Error already reported
+    if (stmt_register(db, name, stmt) != 0) {
+        stmt_finalize(stmt);
+        return;
     }
-
-    // 12. Clean up
-    free(row_data);
-    return; // Success or handled error
+    printf("Prepared statement '%s' (%d parameter%s).\n", name, stmt->num_params, stmt->num_params == 1 ? "" : "s");
+    return;
 
 syntax_error:
-    fprintf(stderr, "Syntax error parsing INSERT statement. Check format near: %s\n", cursor);
-    fprintf(stderr, "Expected: INSERT INTO table VALUES (val1, val2, ...);\n");
+    fprintf(stderr, "Syntax error. Expected: PREPARE name AS statement;\n");
 }
 
-void handle_select(char* original_input) {
-    char input_copy[MAX_INPUT_LEN];
-    strncpy(input_copy, original_input, MAX_INPUT_LEN - 1);
-    input_copy[MAX_INPUT_LEN - 1] = '\0';
-
-    // --- Parsing (same as previous correct version) ---
-    char *token;
-    char *table_name = NULL;
-    char *where_col = NULL;
-    char *where_val_str = NULL;
-
-    token = strtok(input_copy, " \t\n"); // SELECT
-    if (!token || strcasecmp(token, "SELECT") != 0) goto syntax_error;
-    token = strtok(NULL, " \t\n"); // *
-    if (!token || strcmp(token, "*") != 0) goto syntax_error;
-    token = strtok(NULL, " \t\n"); // FROM
-    if (!token || strcasecmp(token, "FROM") != 0) goto syntax_error;
-    table_name = strtok(NULL, " \t\n"); // table_name
-    if (!table_name) goto syntax_error;
-    token = strtok(NULL, " \t\n"); // WHERE
-    if (!token || strcasecmp(token, "WHERE") != 0) goto syntax_error;
-
-    where_col = strtok(NULL, " \t\n="); // id
-    if (!where_col) goto syntax_error;
-    size_t len = strlen(where_col);
-    if (len > 0 && where_col[len - 1] == '=') where_col[len - 1] = '\0';
-    where_col = trim_whitespace(where_col);
-
-    token = strtok(NULL, " \t\n"); // Should be '=' or part of '=value'
-    if (!token) goto syntax_error;
-    if (strcmp(token, "=") != 0) {
-        if (token[0] == '=') {
-             where_val_str = token + 1;
-             if (strlen(where_val_str) == 0) goto syntax_error;
-        } else { goto syntax_error; }
-    } else {
-        where_val_str = strtok(NULL, " \t\n");
-        if (!where_val_str) goto syntax_error;
+// Handle EXECUTE name(arg1, arg2, ...);
+// Arguments are tokenized like statement values, so 'quoted, text' works.
+void handle_execute(char* original_input) {
+    Tokenizer tokenizer;
+    tokenizer_init(&tokenizer, original_input);
+    tokenizer_next(&tokenizer); // EXECUTE
+
+    char name[MAX_STATEMENT_NAME_LEN];
+    Token token = tokenizer_next(&tokenizer);
+    if (token.type != TOK_IDENT || token.length >= MAX_STATEMENT_NAME_LEN) goto syntax_error;
+    memcpy(name, token.start, token.length);
+    name[token.length] = '\0';
+
+    PreparedStatement* stmt = stmt_find(db, name);
+    if (!stmt) {
+        fprintf(stderr, "Error: No prepared statement named '%s'.\n", name);
+        return;
     }
-    where_val_str = trim_whitespace(where_val_str);
-    if (strlen(where_val_str) == 0) goto syntax_error;
-    // --- End Parsing ---
-
-
-    // --- Schema and PK Validation (same as before) ---
-    TableSchema* schema = find_table_schema(table_name);
-    if (!schema) { fprintf(stderr, "Error: Table '%s' not found.\n", table_name); return; }
-    if (schema->pk_column_index == -1) { fprintf(stderr, "Error: Table '%s' lacks primary key for WHERE.\n", table_name); return; }
-    const ColumnDefinition* pk_col_def = &schema->columns[schema->pk_column_index];
-    if (strcmp(where_col, pk_col_def->name) != 0) { fprintf(stderr, "Error: WHERE clause must use PK ('%s').\n", pk_col_def->name); return; }
-    if (pk_col_def->type != COL_TYPE_INT) { fprintf(stderr, "Error: WHERE clause only supports INT PK.\n"); return; }
-    // --- End Validation ---
-
-    // --- Convert PK Value (same as before) ---
-    char *endptr; errno = 0; long pk_val_long = strtol(where_val_str, &endptr, 10);
-    if (endptr == where_val_str || *endptr != '\0' || errno == ERANGE || (errno!=0 && pk_val_long==0)) { fprintf(stderr, "Error: Invalid integer '%s'.\n", where_val_str); return; }
-    if (pk_val_long > INT_MAX || pk_val_long < INT_MIN) { fprintf(stderr, "Error: Integer '%s' out of range.\n", where_val_str); return; }
-    int pk_val = (int)pk_val_long;
-    // --- End Convert PK Value ---
-
-
-    // --- Execute select_row and handle returned data ---
-    printf("Executing: SELECT * FROM %s WHERE %s = %d\n", table_name, pk_col_def->name, pk_val);
-
-    void* found_row_data = NULL; // Pointer to hold the data buffer
-    int result = select_row(table_name, pk_val, &found_row_data); // Call the modified function
-
-    if (result == 0) { // Found
-        // Check if data was actually returned (should always be true if result is 0)
-        if (found_row_data) {
-            printf("--- Row Found ---\n");
-            // Process the data - here we just print it
-            print_row(schema, found_row_data);
-            // CRITICAL: Free the memory allocated by select_row
-            free(found_row_data);
-            printf("---------------\n1 row found.\n");
-        } else {
-            // This case indicates an internal logic error in select_row
-            fprintf(stderr, "Internal Error: select_row returned success (0) but output data pointer is NULL.\n");
+
+    // Bind arguments left to right
+    int num_args = 0;
+    token = tokenizer_next(&tokenizer);
+    if (token.type == TOK_LPAREN) {
+        token = tokenizer_next(&tokenizer);
+        while (token.type != TOK_RPAREN || num_args > 0) {
+            char value[MAX_INPUT_LEN];
+            if (token.type == TOK_STRING) {
+                sql_unescape_copy(token.start, token.length, token.has_escapes, value, sizeof(value));
+            } else if (token.type == TOK_INT || token.type == TOK_IDENT) {
+                sql_unescape_copy(token.start, token.length, 0, value, sizeof(value));
+            } else {
+                goto syntax_error;
+            }
+            if (stmt_bind_text(stmt, num_args, value) != 0) return;
+            num_args++;
+            token = tokenizer_next(&tokenizer);
+            if (token.type == TOK_RPAREN) break;
+            if (token.type != TOK_COMMA) goto syntax_error;
+            token = tokenizer_next(&tokenizer);
         }
-    } else if (result == 1) { // Not Found
-         printf("Record with PK %d not found in table '%s'.\n", pk_val, table_name); // Print message here now
-         printf("0 rows found.\n");
-    } else { // Error (-1)
-         // Error messages should have been printed inside select_row or its callees
-         printf("Select failed (error code %d).\n", result);
+        token = tokenizer_next(&tokenizer);
+    }
+    if (token.type == TOK_SEMICOLON) token = tokenizer_next(&tokenizer);
+    if (token.type != TOK_EOF) goto syntax_error;
+
+    if (num_args != stmt->num_params) {
+        fprintf(stderr, "Error: Statement '%s' takes %d argument(s), got %d.\n", name, stmt->num_params, num_args);
+        return;
     }
-    return; // Done with this command
+
+    execute_and_report(stmt);
+    return;
 
 syntax_error:
-    fprintf(stderr, "Syntax error parsing SELECT statement. Expected: SELECT * FROM table WHERE pk_col = value;\n");
+    fprintf(stderr, "Syntax error. Expected: EXECUTE name(arg1, arg2, ...);\n");
 }
 
 // --- Main Loop ---
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [data_directory]\n", argv[0]);
+        return 1;
+    }
     printf("Starting Mini Database Engine...\n");
 
-    // Initialize database
-    if (init_database() != 0) {
+    // Open the database (DATA_DIR unless a directory is given)
+    db = open_database(argc == 2 ? argv[1] : DATA_DIR);
+    if (!db) {
         fprintf(stderr, "Database initialization failed. Exiting.\n");
         return 1;
     }
     printf("Database initialized. Enter SQL-like commands.\n");
     printf("Supported:\n");
-    printf("  INSERT INTO table VALUES (val1, val2, ...);\n");
-    printf("  SELECT * FROM table WHERE pk_col = value;\n");
+    printf("  INSERT INTO table [(col, ...)] VALUES (val1, val2, ...)[, (...) ...];\n");
+    printf("  SELECT *|col,... FROM table [WHERE cond];  (cond: col op value, AND, OR, NOT)\n");
+    printf("  SELECT [col, ...] COUNT(*)|SUM|MIN|MAX|AVG(col), ... FROM table [WHERE cond] [GROUP BY col, ...];\n");
+    printf("  SELECT ... FROM table JOIN table2 ON col = col [WHERE cond] ...;  (columns as table.col)\n");
+    printf("  SELECT ... [ORDER BY col|aggregate [ASC|DESC], ...] [LIMIT n];  (keys must be in the select list)\n");
+    printf("  CREATE TABLE table (col INT [PRIMARY KEY] | col STRING(n), ...) [WITH (cow, direct)];\n");
+    printf("  DROP TABLE table;\n");
+    printf("  EXPLAIN SELECT ...;\n");
+    printf("  PREPARE name AS statement;  (use ? for parameters)\n");
+    printf("  EXECUTE name(arg1, ...);\n");
+    printf("  DEALLOCATE name;\n");
+    printf("  ANALYZE [table];\n");
+    printf("  REINDEX [table];  (rebuild the primary key index from the data file)\n");
+    printf("  CHECKPOINT;\n");
+    printf("  VERIFY [table];\n");
     printf("  EXIT; or QUIT;\n");
 
 
@@ -437,18 +432,56 @@ int main() {
         if (strcasecmp(first_word, "EXIT") == 0 || strcasecmp(first_word, "QUIT") == 0) {
             printf("Exiting.\n");
             break; // Exit the loop
+        } else if (strcasecmp(first_word, "CHECKPOINT") == 0) {
+             checkpoint_database(db);
+             printf("Checkpoint complete.\n");
+        } else if (strcasecmp(first_word, "VERIFY") == 0) {
+             char* table_name = strtok(NULL, " \t\n");
+             long bad = verify_database(db, table_name, stdout);
+             if (bad == 0) {
+                 printf("Verify complete: no corruption found.\n");
+             } else if (bad > 0) {
+                 printf("Verify complete: %ld corrupted item(s) found.\n", bad);
+             } else {
+                 printf("Verify failed.\n");
+             }
         } else if (strcasecmp(first_word, "INSERT") == 0) {
              handle_insert(input_buffer); // Pass original buffer
         } else if (strcasecmp(first_word, "SELECT") == 0) {
              handle_select(input_buffer); // Pass original buffer
+        } else if (strcasecmp(first_word, "UPDATE") == 0 || strcasecmp(first_word, "DELETE") == 0 ||
+                   strcasecmp(first_word, "CREATE") == 0 || strcasecmp(first_word, "DROP") == 0) {
+             run_statement(input_buffer); // UPDATE and DELETE are parsed but report they are not executable yet
+        } else if (strcasecmp(first_word, "ANALYZE") == 0) {
+             handle_analyze(strtok(NULL, " \t\n"));
+        } else if (strcasecmp(first_word, "REINDEX") == 0) {
+             handle_reindex(strtok(NULL, " \t\n"));
+        } else if (strcasecmp(first_word, "EXPLAIN") == 0) {
+             handle_explain(input_buffer);
+        } else if (strcasecmp(first_word, "PREPARE") == 0) {
+             handle_prepare(input_buffer);
+        } else if (strcasecmp(first_word, "EXECUTE") == 0) {
+             handle_execute(input_buffer);
+        } else if (strcasecmp(first_word, "DEALLOCATE") == 0) {
+             char* name = strtok(NULL, " \t\n");
+             if (!name) {
+                 fprintf(stderr, "Syntax error. Expected: DEALLOCATE name;\n");
+             } else if (stmt_deallocate(db, name) == 0) {
+                 printf("Deallocated statement '%s'.\n", name);
+             } else {
+                 fprintf(stderr, "Error: No prepared statement named '%s'.\n", name);
+             }
         } else {
             fprintf(stderr, "Error: Unknown command '%s'.\n", first_word);
         }
         // No need to free command_copy anymore
     }
 
+    // Statements point into the schema, so drop them first
+    stmt_deallocate_all(db);
+
     // Shutdown database
-    shutdown_database();
+    close_database(db);
 
     return 0;
 }
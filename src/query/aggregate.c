@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "aggregate.h"
+
+#define AGG_INITIAL_CAPACITY 64 // Slots in a new table (power of two)
+
+// Running state of one aggregate within one group
+typedef struct {
+    int64_t count;
+    int64_t sum;
+    int min;
+    int max;
+} Accumulator;
+
+static Accumulator* slot_accumulators(const AggTable* table, char* slot) {
+    return (Accumulator*)(slot + ((table->key_size + 7) & ~(size_t)7));
+}
+
+static char* slot_at(const AggTable* table, size_t index) {
+    return table->slots + index * table->slot_size;
+}
+
+/**
+ * Hash a packed key (FNV-1a, then mixed). Never returns 0, which marks an
+ * empty slot.
+ */
+static uint64_t hash_key(const char* key, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+static int alloc_slots(AggTable* table, size_t capacity) {
+    table->hashes = calloc(capacity, sizeof(uint64_t));
+    table->slots = malloc(capacity * table->slot_size);
+    if (!table->hashes || !table->slots) {
+        perror("Failed to allocate memory for aggregation hash table");
+        free(table->hashes);
+        free(table->slots);
+        table->hashes = NULL;
+        table->slots = NULL;
+        return -1;
+    }
+    table->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Create an aggregation table for a plan with an aggregation.
+ * @return 0 on success, -1 on error.
+ */
+int agg_init(AggTable* table, const QueryPlan* plan) {
+    memset(table, 0, sizeof(AggTable));
+    table->plan = plan;
+    const PlanAggregation* agg = plan->aggregation;
+    if (!(table->key_offsets = malloc(((size_t)agg->num_group_cols + 1) * sizeof(size_t)))) {
+        perror("Failed to allocate memory for aggregation key");
+        return -1;
+    }
+    for (int g = 0; g < agg->num_group_cols; g++) {
+        table->key_offsets[g] = table->key_size;
+        table->key_size += plan->schema->columns[agg->group_cols[g]].size;
+    }
+    table->slot_size = ((table->key_size + 7) & ~(size_t)7) + (size_t)agg->num_aggregates * sizeof(Accumulator);
+    if (table->slot_size == 0) table->slot_size = sizeof(Accumulator);
+    if (!(table->key = malloc(table->key_size + 1))) {
+        perror("Failed to allocate memory for aggregation key");
+        agg_free(table);
+        return -1;
+    }
+    if (alloc_slots(table, AGG_INITIAL_CAPACITY) != 0) {
+        agg_free(table);
+        return -1;
+    }
+    return 0;
+}
+
+void agg_free(AggTable* table) {
+    if (!table) return;
+    free(table->hashes);
+    free(table->slots);
+    free(table->key);
+    free(table->key_offsets);
+    memset(table, 0, sizeof(AggTable));
+}
+
+/**
+ * Double the table, moving each group to its slot in the new one.
+ * @return 0 on success, -1 on error.
+ */
+static int grow(AggTable* table) {
+    AggTable old = *table;
+    if (alloc_slots(table, old.capacity * 2) != 0) {
+        *table = old;
+        return -1;
+    }
+    size_t mask = table->capacity - 1;
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.hashes[i] == 0) continue;
+        size_t index = (size_t)old.hashes[i] & mask;
+        while (table->hashes[index] != 0) index = (index + 1) & mask;
+        table->hashes[index] = old.hashes[i];
+        memcpy(slot_at(table, index), slot_at(&old, i), table->slot_size);
+    }
+    free(old.hashes);
+    free(old.slots);
+    return 0;
+}
+
+/**
+ * Find the slot of a key, claiming a fresh group if it is new.
+ * @return The slot, or NULL on allocation failure.
+ */
+static char* find_group(AggTable* table, const char* key, uint64_t hash) {
+    if ((table->count + 1) * 10 > table->capacity * 7 && grow(table) != 0) return NULL;
+    size_t mask = table->capacity - 1;
+    size_t index = (size_t)hash & mask;
+    while (table->hashes[index] != 0) {
+        if (table->hashes[index] == hash && memcmp(slot_at(table, index), key, table->key_size) == 0) {
+            return slot_at(table, index);
+        }
+        index = (index + 1) & mask;
+    }
+
+    char* slot = slot_at(table, index);
+    table->hashes[index] = hash;
+    table->count++;
+    memcpy(slot, key, table->key_size);
+    Accumulator* acc = slot_accumulators(table, slot);
+    for (int a = 0; a < table->plan->aggregation->num_aggregates; a++) {
+        acc[a] = (Accumulator){0, 0, INT_MAX, INT_MIN};
+    }
+    return slot;
+}
+
+/**
+ * Fold a row into its group.
+ * @return 0 on success, -1 on error.
+ */
+int agg_add(AggTable* table, const void* row) {
+    const TableSchema* schema = table->plan->schema;
+    const PlanAggregation* agg = table->plan->aggregation;
+    for (int g = 0; g < agg->num_group_cols; g++) {
+        const ColumnDefinition* col = &schema->columns[agg->group_cols[g]];
+        const char* field = (const char*)row + col->offset;
+        char* dest = table->key + table->key_offsets[g];
+        if (col->type == COL_TYPE_STRING) {
+            strncpy(dest, field, col->size); // Zero-pads, so equal strings have equal keys
+        } else {
+            memcpy(dest, field, col->size);
+        }
+    }
+    char* slot = find_group(table, table->key, hash_key(table->key, table->key_size));
+    if (!slot) return -1;
+
+    Accumulator* acc = slot_accumulators(table, slot);
+    for (int a = 0; a < agg->num_aggregates; a++) {
+        acc[a].count++;
+        int col_index = agg->aggregates[a].col_index;
+        if (col_index < 0 || schema->columns[col_index].type != COL_TYPE_INT) continue;
+        int value;
+        memcpy(&value, (const char*)row + schema->columns[col_index].offset, sizeof(int));
+        acc[a].sum += value;
+        if (value < acc[a].min) acc[a].min = value;
+        if (value > acc[a].max) acc[a].max = value;
+    }
+    return 0;
+}
+
+/**
+ * Fold the groups of a partial table (from a scan worker) into another.
+ * @return 0 on success, -1 on error.
+ */
+int agg_merge(AggTable* into, const AggTable* from) {
+    int num_aggregates = into->plan->aggregation->num_aggregates;
+    for (size_t i = 0; i < from->capacity; i++) {
+        if (from->hashes[i] == 0) continue;
+        char* source = slot_at(from, i);
+        char* slot = find_group(into, source, from->hashes[i]);
+        if (!slot) return -1;
+        Accumulator* acc = slot_accumulators(into, slot);
+        const Accumulator* other = slot_accumulators(from, source);
+        for (int a = 0; a < num_aggregates; a++) {
+            acc[a].count += other[a].count;
+            acc[a].sum += other[a].sum;
+            if (other[a].min < acc[a].min) acc[a].min = other[a].min;
+            if (other[a].max > acc[a].max) acc[a].max = other[a].max;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Write one group as an output row. Groups without rows (only the implicit
+ * group of an aggregate over no rows) report 0 for every aggregate.
+ */
+static void build_output_row(const AggTable* table, char* slot, char* out) {
+    const QueryPlan* plan = table->plan;
+    const PlanAggregation* agg = plan->aggregation;
+    const Accumulator* acc = slot_accumulators(table, slot);
+    for (int i = 0; i < plan->output->num_columns; i++) {
+        char* dest = out + plan->output->columns[i].offset;
+        int source = agg->output_map[i];
+        if (source < agg->num_group_cols) {
+            memcpy(dest, slot + table->key_offsets[source], plan->output->columns[i].size);
+            continue;
+        }
+        const Accumulator* a = &acc[source - agg->num_group_cols];
+        int64_t long_value = 0;
+        int int_value = 0;
+        double double_value = 0.0;
+        switch (agg->aggregates[source - agg->num_group_cols].func) {
+            case AGG_COUNT: long_value = a->count; break;
+            case AGG_SUM:   long_value = a->sum; break;
+            case AGG_MIN:   int_value = a->count ? a->min : 0; break;
+            case AGG_MAX:   int_value = a->count ? a->max : 0; break;
+            case AGG_AVG:   double_value = a->count ? (double)a->sum / (double)a->count : 0.0; break;
+            case AGG_NONE:  break;
+        }
+        switch (plan->output->columns[i].type) {
+            case COL_TYPE_LONG:   memcpy(dest, &long_value, sizeof(long_value)); break;
+            case COL_TYPE_DOUBLE: memcpy(dest, &double_value, sizeof(double_value)); break;
+            default:              memcpy(dest, &int_value, sizeof(int_value)); break;
+        }
+    }
+}
+
+/**
+ * Deliver every group to a sink. An aggregate without GROUP BY always
+ * produces one row, even over no input rows.
+ * @return Number of rows delivered, or -1 on error.
+ */
+long agg_emit(const AggTable* table, RowSink sink, void* ctx) {
+    const QueryPlan* plan = table->plan;
+    char* out = malloc(plan->output->row_size > 0 ? plan->output->row_size : 1);
+    char* empty = calloc(1, table->slot_size);
+    if (!out || !empty) {
+        perror("Failed to allocate memory for aggregate output");
+        free(out);
+        free(empty);
+        return -1;
+    }
+    long delivered = 0;
+    if (table->count == 0 && plan->aggregation->num_group_cols == 0) {
+        build_output_row(table, empty, out);
+        delivered++;
+        sink(plan->output, out, ctx);
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->hashes[i] == 0) continue;
+        build_output_row(table, slot_at(table, i), out);
+        delivered++;
+        if (sink(plan->output, out, ctx) != 0) break;
+    }
+    free(out);
+    free(empty);
+    return delivered;
+}
@@ -0,0 +1,43 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdint.h>
+#include "planner.h"
+#include "executor.h"
+
+// --- Hash Aggregation ---
+// Groups rows by the plan's GROUP BY key in an open-addressing hash table
+// with linear probing. Slot hashes live in their own array, so a probe
+// walks consecutive 8-byte entries and only compares keys on a hash match;
+// keys and accumulators are packed together in a second array. Without
+// GROUP BY every row falls into the single group with the empty key.
+// A parallel scan gives each worker its own table and merges them at the
+// end, so workers never share a group.
+
+typedef struct {
+    const QueryPlan* plan;
+    size_t key_size;          // Packed GROUP BY key (STRING columns zero-padded)
+    size_t slot_size;         // Key (rounded up to 8 bytes) plus accumulators
+    size_t* key_offsets;      // Offset of each GROUP BY column in the key
+    size_t capacity;          // Slots (power of two)
+    size_t count;             // Groups in use
+    uint64_t* hashes;         // Per slot; 0 marks an empty slot
+    char* slots;              // capacity * slot_size bytes
+    char* key;                // Scratch buffer for the key being looked up
+} AggTable;
+
+// Returns 0 on success, -1 on error (reported).
+int agg_init(AggTable* table, const QueryPlan* plan);
+void agg_free(AggTable* table);
+
+// Fold a (matching) table row into its group. Returns 0, or -1 on error.
+int agg_add(AggTable* table, const void* row);
+
+// Fold every group of `from` into `into`. Returns 0, or -1 on error.
+int agg_merge(AggTable* into, const AggTable* from);
+
+// Pass each group to the sink as a row of the plan's output schema.
+// Returns the number of rows delivered, or -1 on error.
+long agg_emit(const AggTable* table, RowSink sink, void* ctx);
+
+#endif // AGGREGATE_H
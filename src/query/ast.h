@@ -0,0 +1,156 @@
+#ifndef AST_H
+#define AST_H
+
+#include "../structs.h"
+
+// --- SQL Abstract Syntax Tree ---
+// Produced by parse_statement. Names and literals are spans into the
+// statement text (no copies), and every node lives in the parser's arena,
+// so the text and the arena must outlive the tree.
+
+typedef struct {
+    const char* start;
+    int length;
+} Span;
+
+typedef enum {
+    EXPR_COLUMN,    // Column reference (or bare word used as a string value)
+    EXPR_INT,       // Integer literal
+    EXPR_STRING,    // 'quoted' string literal
+    EXPR_PARAM,     // ? placeholder
+    EXPR_COMPARE,   // left op right
+    EXPR_AND,
+    EXPR_OR,
+    EXPR_NOT        // NOT left
+} ExprType;
+
+typedef enum {
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_LE,
+    CMP_GT,
+    CMP_GE
+} CompareOp;
+
+typedef struct Expr {
+    ExprType type;
+    Span text;           // Column name or literal text (strings: inside the quotes)
+    int has_escapes;     // EXPR_STRING: text contains '' sequences
+    long int_value;      // EXPR_INT
+    int param_index;     // EXPR_PARAM: 0-based, in order of appearance
+    CompareOp op;        // EXPR_COMPARE
+    struct Expr* left;
+    struct Expr* right;
+} Expr;
+
+typedef enum {
+    AGG_NONE,            // Plain column
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+} AggregateFunc;
+
+typedef struct {
+    AggregateFunc func;
+    Span column;         // Column (or aggregate argument); empty for COUNT(*)
+} SelectItem;
+
+// ORDER BY key: a select list column or aggregate
+typedef struct {
+    SelectItem item;
+    int descending;
+} OrderItem;
+
+// Column names in a SELECT may be qualified: the span then covers the
+// whole "table.column" text.
+typedef struct {
+    Span table;
+    Span join_table;     // [INNER] JOIN table ON join_on (length 0 if absent)
+    Expr* join_on;
+    int select_all;      // SELECT *
+    SelectItem* columns; // Select list (when not select_all)
+    int num_columns;
+    Expr* where;         // NULL if absent
+    Span* group_by;
+    int num_group_by;
+    OrderItem* order_by;
+    int num_order_by;
+    long limit;          // -1 if absent
+} SelectStmt;
+
+typedef struct {
+    Span table;
+    Span* columns;       // Optional column list (NULL = all columns in order)
+    int num_columns;
+    Expr** values;       // num_rows * row_width, row-major
+    int num_rows;
+    int row_width;
+} InsertStmt;
+
+typedef struct {
+    Span table;
+    Span* columns;       // SET column = value, ...
+    Expr** values;
+    int num_assignments;
+    Expr* where;
+} UpdateStmt;
+
+typedef struct {
+    Span table;
+    Expr* where;
+} DeleteStmt;
+
+typedef struct {
+    Span name;
+    ColumnType type;
+    int size;            // STRING(n) length; 0 for INT
+    int primary_key;
+} ColumnDefAst;
+
+typedef struct {
+    Span table;
+    ColumnDefAst* columns;
+    int num_columns;
+    Span* options;       // WITH (cow, direct)
+    int num_options;
+} CreateTableStmt;
+
+typedef struct {
+    Span table;
+} DropTableStmt;
+
+typedef enum {
+    AST_SELECT,
+    AST_INSERT,
+    AST_UPDATE,
+    AST_DELETE,
+    AST_CREATE_TABLE,
+    AST_DROP_TABLE
+} StatementKind;
+
+typedef struct {
+    StatementKind kind;
+    int num_params;      // Number of ? placeholders
+    union {
+        SelectStmt select;
+        InsertStmt insert;
+        UpdateStmt update;
+        DeleteStmt del;
+        CreateTableStmt create_table;
+        DropTableStmt drop_table;
+    };
+} Statement;
+
+// 1 if a span equals a NUL-terminated name (case-sensitive, like the catalog)
+int span_equals(Span span, const char* name);
+
+// Copy a span into a NUL-terminated buffer (truncating); returns `out`.
+char* span_copy(Span span, char* out, size_t out_size);
+
+// Copy a string literal, turning '' into '; returns `out`.
+char* expr_string_copy(const Expr* expr, char* out, size_t out_size);
+
+#endif // AST_H
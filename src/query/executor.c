@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "executor.h"
+#include "aggregate.h"
+#include "join.h"
+#include "../util/extsort.h"
+#include "../database/database.h"
+#include "../database/scan.h"
+#include "../database/zonemap.h"
+#include "../btree/btree.h"
+#include "../cache/row_cache.h"
+
+// Values a bounded INT column can take in matching rows
+typedef struct {
+    int col_index;
+    int low;
+    int high;
+} ScanRange;
+
+typedef struct {
+    const QueryPlan* plan;
+    RowSink sink;
+    void* ctx;
+    long delivered;
+    int stopped;              // Sink asked to stop (read by scan workers)
+    int error;
+    int parallel;             // 1 while scan workers share this state
+    pthread_mutex_t lock;     // Serializes sink calls from scan workers
+    char* output_row;         // Projected row handed to the sink (NULL for SELECT *)
+    AggTable* groups;         // Aggregating: matching rows are folded in here
+
+    ScanRange* ranges;        // Zone map pruning: one per bounded INT column
+    int num_ranges;
+} ExecState;
+
+// --- Predicate Evaluation ---
+
+/**
+ * Evaluate a predicate against a row.
+ * @param plan Plan owning the predicate's constants.
+ * @param pred Predicate (NULL matches every row).
+ * @param row Row data.
+ * @return 1 if the row matches, 0 otherwise.
+ */
+int predicate_matches(const QueryPlan* plan, const Predicate* pred, const void* row) {
+    if (!pred) return 1;
+    switch (pred->type) {
+        case PRED_AND:
+            return predicate_matches(plan, pred->left, row) && predicate_matches(plan, pred->right, row);
+        case PRED_OR:
+            return predicate_matches(plan, pred->left, row) || predicate_matches(plan, pred->right, row);
+        case PRED_NOT:
+            return !predicate_matches(plan, pred->left, row);
+        case PRED_COMPARE:
+            break;
+    }
+
+    const ColumnDefinition* col = &plan->schema->columns[pred->col_index];
+    const char* left = (const char*)row + col->offset;
+    const char* right = (pred->rhs_col_index >= 0)
+                            ? (const char*)row + plan->schema->columns[pred->rhs_col_index].offset
+                            : plan_constant(plan, pred->const_row) + col->offset;
+    int cmp;
+    if (col->type == COL_TYPE_INT) {
+        int a, b;
+        memcpy(&a, left, sizeof(int));
+        memcpy(&b, right, sizeof(int));
+        cmp = (a > b) - (a < b);
+    } else {
+        cmp = strncmp(left, right, col->size); // Stored strings are NUL-terminated within their size
+    }
+    switch (pred->op) {
+        case CMP_EQ: return cmp == 0;
+        case CMP_NE: return cmp != 0;
+        case CMP_LT: return cmp < 0;
+        case CMP_LE: return cmp <= 0;
+        case CMP_GT: return cmp > 0;
+        case CMP_GE: return cmp >= 0;
+    }
+    return 0;
+}
+
+/**
+ * Copy the projected columns of a row into the output row.
+ */
+static const void* project_row(const QueryPlan* plan, const void* row, char* output_row) {
+    const TableSchema* output = plan->output;
+    for (int i = 0; i < output->num_columns; i++) {
+        const ColumnDefinition* col = &plan->schema->columns[plan->projection[i]];
+        memcpy(output_row + output->columns[i].offset, (const char*)row + col->offset, col->size);
+    }
+    return output_row;
+}
+
+/**
+ * Filter a row and pass it (projected) to the sink.
+ * @return 1 if the query should stop, 0 to continue.
+ */
+static int deliver(ExecState* state, const void* row) {
+    const QueryPlan* plan = state->plan;
+    if (!predicate_matches(plan, plan->filter, row)) return 0;
+    if (state->parallel) pthread_mutex_lock(&state->lock);
+    if (!state->stopped) {
+        state->delivered++;
+        if (state->output_row) row = project_row(plan, row, state->output_row);
+        if (state->sink(plan->output, row, state->ctx) != 0) {
+            __atomic_store_n(&state->stopped, 1, __ATOMIC_RELAXED);
+        }
+    }
+    int stop = state->stopped;
+    if (state->parallel) pthread_mutex_unlock(&state->lock);
+    return stop;
+}
+
+/**
+ * Pass a row on: into a group table when aggregating, else to the sink.
+ * @param groups The caller's group table (a scan worker's own, or the
+ *               state's); ignored unless the plan aggregates.
+ * @return 1 if the query should stop, 0 to continue.
+ */
+static int consume(ExecState* state, AggTable* groups, const void* row) {
+    if (!state->plan->aggregation) return deliver(state, row);
+    if (!predicate_matches(state->plan, state->plan->filter, row)) return 0;
+    if (agg_add(groups, row) != 0) {
+        state->error = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// --- Access Paths ---
+
+static int run_point_lookup(ExecState* state) {
+    TableSchema* schema = state->plan->schema;
+    int low = INT_MIN, high = INT_MAX;
+    if (!plan_column_range(state->plan, schema->pk_column_index, &low, &high) || low != high) {
+        return 0; // Contradictory bounds such as id = 1 AND id = 2
+    }
+    void* row = NULL;
+    int result = select_row_from(schema, low, &row);
+    if (result < 0) return -1;
+    if (result == 0) {
+        consume(state, state->groups, row);
+        free(row);
+    }
+    return 0;
+}
+
+typedef struct {
+    ExecState* state;
+    char* record;  // Holds one record
+} RangeScan;
+
+static int visit_index_entry(int key, long offset, void* arg) {
+    RangeScan* scan = (RangeScan*)arg;
+    const TableSchema* schema = scan->state->plan->schema;
+    // Rows still in the row cache skip the read; scanned rows are not added
+    if (!row_cache_get(schema->row_cache, key, scan->record) &&
+        read_row_at(schema, key, offset, scan->record) != 0) {
+        scan->state->error = 1;
+        return 1;
+    }
+    return consume(scan->state, scan->state->groups, scan->record);
+}
+
+static int run_index_range_scan(ExecState* state) {
+    const TableSchema* schema = state->plan->schema;
+    int low = INT_MIN, high = INT_MAX;
+    if (!plan_column_range(state->plan, schema->pk_column_index, &low, &high)) return 0;
+
+    RangeScan scan = {state, malloc(schema->record_size)};
+    if (!scan.record) {
+        perror("Error allocating memory for range scan");
+        return -1;
+    }
+    int status = btree_for_each_range(schema->pk_index, low, high, visit_index_entry, &scan);
+    free(scan.record);
+    return (status < 0 || state->error) ? -1 : 0;
+}
+
+typedef struct {
+    ExecState* state;
+    off_t first_block;  // Blocks [first_block, end_block) of the data file
+    off_t end_block;
+    off_t data_end;     // End of the last whole record when the query started
+    AggTable* groups;   // Group table this task aggregates into (if aggregating)
+} ScanTask;
+
+static int block_may_match(const ExecState* state, off_t block) {
+    const ZoneMap* map = state->plan->schema->zone_map;
+    for (int i = 0; i < state->num_ranges; i++) {
+        const ScanRange* range = &state->ranges[i];
+        if (!zone_map_may_contain(map, (int)block, range->col_index, range->low, range->high)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Scan a run of blocks, reading each stretch of blocks the zone map cannot
+ * rule out as one sequential range.
+ */
+static void scan_blocks(ScanTask* task) {
+    ExecState* state = task->state;
+    const TableSchema* schema = state->plan->schema;
+    off_t record_size = (off_t)schema->record_size;
+
+    ScanReader reader;
+    if (scan_reader_open(&reader, schema, 0, 0) != 0) {
+        state->error = 1;
+        return;
+    }
+    off_t block = task->first_block;
+    while (block < task->end_block && !__atomic_load_n(&state->stopped, __ATOMIC_RELAXED)) {
+        off_t first_block = block;
+        while (first_block < task->end_block && !block_may_match(state, first_block)) first_block++;
+        if (first_block == task->end_block) break;
+        block = first_block + 1;
+        while (block < task->end_block && block_may_match(state, block)) block++;
+
+        // Rows belong to the block holding their first byte
+        off_t range_start = (first_block * ZONE_MAP_BLOCK_SIZE + record_size - 1) / record_size * record_size;
+        off_t range_end = (block * ZONE_MAP_BLOCK_SIZE + record_size - 1) / record_size * record_size;
+        if (range_end > task->data_end) range_end = task->data_end;
+        scan_reader_reset(&reader, range_start, range_end);
+
+        const char* record;
+        while ((record = scan_reader_next(&reader, NULL)) != NULL) {
+            if (consume(state, task->groups, record)) break;
+        }
+        if (reader.error) {
+            state->error = 1; // Already reported
+            break;
+        }
+    }
+    scan_reader_close(&reader);
+}
+
+static void* scan_worker(void* arg) {
+    scan_blocks((ScanTask*)arg);
+    io_thread_cleanup();
+    return NULL;
+}
+
+static int run_full_scan(ExecState* state) {
+    const QueryPlan* plan = state->plan;
+    const TableSchema* schema = plan->schema;
+
+    // Each bounded INT column narrows the blocks worth reading
+    if (plan->num_bounds > 0 && !(state->ranges = malloc((size_t)plan->num_bounds * sizeof(ScanRange)))) {
+        perror("Error allocating memory for scan ranges");
+        return -1;
+    }
+    for (int i = 0; i < plan->num_bounds; i++) {
+        int col_index = plan->bounds[i].col_index;
+        int seen = 0;
+        for (int j = 0; j < state->num_ranges; j++) seen |= (state->ranges[j].col_index == col_index);
+        if (seen) continue;
+        int low = INT_MIN, high = INT_MAX;
+        if (!plan_column_range(plan, col_index, &low, &high)) return 0; // No row can match
+        state->ranges[state->num_ranges++] = (ScanRange){col_index, low, high};
+    }
+
+    off_t data_end = schema->data_size / (off_t)schema->record_size * (off_t)schema->record_size;
+    off_t num_blocks = (data_end + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE;
+    int num_threads = plan_scan_threads(plan);
+    if (num_threads <= 1) {
+        ScanTask task = {state, 0, num_blocks, data_end, state->groups};
+        scan_blocks(&task);
+        return state->error ? -1 : 0;
+    }
+
+    // Split the file into contiguous block runs, one per worker. When
+    // aggregating, each worker fills a partial group table of its own.
+    ScanTask tasks[MAX_SCAN_THREADS];
+    AggTable partials[MAX_SCAN_THREADS];
+    pthread_t threads[MAX_SCAN_THREADS];
+    int started[MAX_SCAN_THREADS] = {0};
+    if (plan->aggregation) {
+        for (int i = 0; i < num_threads; i++) {
+            if (agg_init(&partials[i], plan) != 0) {
+                while (--i >= 0) agg_free(&partials[i]);
+                return -1;
+            }
+        }
+    }
+    pthread_mutex_init(&state->lock, NULL);
+    state->parallel = 1;
+    for (int i = 0; i < num_threads; i++) {
+        tasks[i] = (ScanTask){state, num_blocks * i / num_threads, num_blocks * (i + 1) / num_threads, data_end,
+                              plan->aggregation ? &partials[i] : NULL};
+        if (pthread_create(&threads[i], NULL, scan_worker, &tasks[i]) == 0) {
+            started[i] = 1;
+        } else {
+            scan_blocks(&tasks[i]); // Fall back to scanning inline
+        }
+    }
+    for (int i = 0; i < num_threads; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+    state->parallel = 0;
+    pthread_mutex_destroy(&state->lock);
+    if (plan->aggregation) {
+        for (int i = 0; i < num_threads; i++) {
+            if (!state->error && agg_merge(state->groups, &partials[i]) != 0) state->error = 1;
+            agg_free(&partials[i]);
+        }
+    }
+    return state->error ? -1 : 0;
+}
+
+static int emit_joined_row(const void* row, void* ctx) {
+    ExecState* state = (ExecState*)ctx;
+    return consume(state, state->groups, row);
+}
+
+/**
+ * Produce the plan's rows: from its join, or from its table's access path.
+ * @return 0 on success, -1 on error.
+ */
+static int run_rows(ExecState* state) {
+    if (state->plan->join) {
+        int status = join_execute(state->plan, emit_joined_row, state);
+        return (status < 0 || state->error) ? -1 : 0;
+    }
+    switch (state->plan->access) {
+        case ACCESS_POINT_LOOKUP:
+            return run_point_lookup(state);
+        case ACCESS_INDEX_RANGE_SCAN:
+            return run_index_range_scan(state);
+        case ACCESS_FULL_SCAN:
+            return run_full_scan(state);
+    }
+    return -1;
+}
+
+// --- ORDER BY ---
+
+/**
+ * Compare two output rows by the plan's ORDER BY keys.
+ */
+static int compare_output_rows(const void* a, const void* b, void* ctx) {
+    const QueryPlan* plan = (const QueryPlan*)ctx;
+    for (int i = 0; i < plan->num_sort_keys; i++) {
+        const ColumnDefinition* col = &plan->output->columns[plan->sort_keys[i].col_index];
+        const char* left = (const char*)a + col->offset;
+        const char* right = (const char*)b + col->offset;
+        int cmp = 0;
+        switch (col->type) {
+            case COL_TYPE_INT: {
+                int x, y;
+                memcpy(&x, left, sizeof(x));
+                memcpy(&y, right, sizeof(y));
+                cmp = (x > y) - (x < y);
+                break;
+            }
+            case COL_TYPE_LONG: {
+                int64_t x, y;
+                memcpy(&x, left, sizeof(x));
+                memcpy(&y, right, sizeof(y));
+                cmp = (x > y) - (x < y);
+                break;
+            }
+            case COL_TYPE_DOUBLE: {
+                double x, y;
+                memcpy(&x, left, sizeof(x));
+                memcpy(&y, right, sizeof(y));
+                cmp = (x > y) - (x < y);
+                break;
+            }
+            case COL_TYPE_STRING:
+                cmp = strncmp(left, right, col->size);
+                break;
+        }
+        if (cmp != 0) return plan->sort_keys[i].descending ? -cmp : cmp;
+    }
+    return 0;
+}
+
+// --- LIMIT ---
+
+typedef struct {
+    RowSink sink;
+    void* ctx;
+    long remaining;
+} LimitedSink;
+
+// Sink of a query with a LIMIT: stops the query once it has passed on the
+// last row allowed, which ends scans (and their workers) early
+static int limited_sink(const TableSchema* schema, const void* row, void* ctx) {
+    LimitedSink* limited = (LimitedSink*)ctx;
+    int stop = limited->sink(schema, row, limited->ctx);
+    return stop || --limited->remaining == 0;
+}
+
+// Sink of an ordered query: every output row goes into the sort
+static int sort_sink(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    return sort_add((ExternalSort*)ctx, row) != 0;
+}
+
+/**
+ * Sort the collected output rows and deliver them in order.
+ * @return Number of rows delivered, or -1 on error.
+ */
+static long emit_sorted(const QueryPlan* plan, ExternalSort* sorter, RowSink sink, void* ctx) {
+    if (sort_finish(sorter) != 0) return -1;
+    long delivered = 0;
+    const void* row;
+    while ((row = sort_next(sorter)) != NULL) {
+        delivered++;
+        if (sink(plan->output, row, ctx) != 0) break;
+    }
+    return sorter->error ? -1 : delivered;
+}
+
+/**
+ * Run a query plan, passing each matching row to `sink`.
+ * @param plan The plan (its parameters must be bound).
+ * @param sink Row callback; a nonzero return stops the query.
+ * @param ctx Passed through to the sink.
+ * @return Number of rows delivered, or -1 on error.
+ */
+long execute_plan(const QueryPlan* plan, RowSink sink, void* ctx) {
+    if (!plan || !sink) return -1;
+    if (plan->limit == 0) return 0;
+    LimitedSink limited = {sink, ctx, plan->limit};
+    if (plan->limit > 0) {
+        sink = limited_sink;
+        ctx = &limited;
+    }
+    int sorting = plan->sort_keys && !plan->index_order;
+    ExecState state;
+    memset(&state, 0, sizeof(state));
+    state.plan = plan;
+    state.sink = sink;
+    state.ctx = ctx;
+    if (plan->projection && !(state.output_row = malloc(plan->output->row_size > 0 ? plan->output->row_size : 1))) {
+        perror("Error allocating memory for projected row");
+        return -1;
+    }
+    ExternalSort sorter;
+    if (sorting) {
+        if (sort_init(&sorter, plan->output->row_size, SORT_MEMORY_BUDGET, plan->schema->db->data_dir,
+                      compare_output_rows, (void*)plan) != 0 ||
+            (plan->limit > 0 && sort_set_limit(&sorter, (size_t)plan->limit) < 0)) {
+            sort_free(&sorter);
+            free(state.output_row);
+            return -1;
+        }
+        state.sink = sort_sink; // Rows reach the caller's sink once sorted
+        state.ctx = &sorter;
+    }
+    AggTable groups;
+    int status = 0;
+    if (plan->aggregation) {
+        if (agg_init(&groups, plan) == 0) {
+            state.groups = &groups;
+        } else {
+            status = -1;
+        }
+    }
+
+    if (status == 0) status = run_rows(&state);
+    free(state.output_row);
+    free(state.ranges);
+    if (state.groups) {
+        if (status == 0) state.delivered = agg_emit(state.groups, state.sink, state.ctx);
+        agg_free(state.groups);
+        if (state.delivered < 0) status = -1;
+    }
+    if (sorting) {
+        if (status == 0 && sorter.error) status = -1;
+        if (status == 0) state.delivered = emit_sorted(plan, &sorter, sink, ctx);
+        sort_free(&sorter);
+        if (state.delivered < 0) status = -1;
+    }
+    return (status < 0) ? -1 : state.delivered;
+}
@@ -0,0 +1,28 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "planner.h"
+
+// --- Plan Execution ---
+// Runs a query plan and hands every matching row to a sink callback, laid
+// out as the plan's output schema (only the selected columns). The row
+// pointer refers to the executor's buffers and is only valid during the
+// call. Point lookups and index range scans deliver rows in primary key
+// order; a parallel full scan serializes calls to the sink but delivers
+// rows from its workers in no particular order. An aggregating plan
+// delivers its groups (in no particular order) after the scan completes.
+// With ORDER BY, all output rows are collected by an external sort first
+// (or a top-N heap under a LIMIT) and delivered in order at the end, unless
+// the plan reads them in order from the primary key index. A LIMIT stops
+// the query as soon as that many rows have been delivered.
+
+// Return nonzero to stop the query early (see RowCallback).
+typedef RowCallback RowSink;
+
+// 1 if the row satisfies the predicate (NULL matches everything).
+int predicate_matches(const QueryPlan* plan, const Predicate* pred, const void* row);
+
+// Run a plan. Returns the number of rows delivered, or -1 on error.
+long execute_plan(const QueryPlan* plan, RowSink sink, void* ctx);
+
+#endif // EXECUTOR_H
@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "join.h"
+#include "executor.h"
+#include "../database/database.h"
+#include "../util/extsort.h"
+
+#define JOIN_SPILL_PARTITIONS (1 << JOIN_SPILL_PARTITION_BITS)
+#define SPILL_READ_ROWS 256 // Rows read back from a partition file at a time
+
+// Build rows with a chained hash table over their join keys
+typedef struct {
+    size_t row_size;
+    char* rows;              // num_rows rows, back to back
+    uint64_t* hashes;        // Join key hash of each row
+    size_t num_rows;
+    size_t capacity;
+    int hash_shift;          // Leading hash bits all rows share (their spill partition); 0 if not spilling
+    int radix_bits;          // Rows are clustered by the radix_bits after those
+    size_t* cluster_base;    // Per cluster: its first bucket in heads
+    uint64_t* cluster_mask;  // Per cluster: bucket count - 1
+    int32_t* heads;          // Per bucket: first row, or -1
+    int32_t* next;           // Per row: next row in its bucket, or -1
+} JoinTable;
+
+typedef struct {
+    const QueryPlan* plan;
+    const JoinPlan* join;
+    JoinEmit emit;
+    void* ctx;
+    char* joined;            // Output row in the joined layout
+    JoinTable table;
+    FILE* spill[2][JOIN_SPILL_PARTITIONS]; // Partition files per input, once spilling
+    int spilling;
+    int stopped;
+    int error;
+} JoinState;
+
+// --- Join Keys ---
+
+static uint64_t key_hash(const TableSchema* schema, int col_index, const char* row) {
+    const ColumnDefinition* col = &schema->columns[col_index];
+    const char* field = row + col->offset;
+    size_t length = (col->type == COL_TYPE_STRING) ? strnlen(field, col->size) : col->size;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)field[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static int keys_equal(const JoinState* js, const char* build_row, const char* probe_row) {
+    int build_side = js->join->build_side;
+    const TableSchema* build = js->join->inputs[build_side]->schema;
+    const TableSchema* probe = js->join->inputs[1 - build_side]->schema;
+    const ColumnDefinition* a = &build->columns[js->join->key_cols[build_side]];
+    const ColumnDefinition* b = &probe->columns[js->join->key_cols[1 - build_side]];
+    const char* x = build_row + a->offset;
+    const char* y = probe_row + b->offset;
+    if (a->type != COL_TYPE_STRING) return memcmp(x, y, a->size) == 0;
+    size_t length = strnlen(x, a->size);
+    return length == strnlen(y, b->size) && memcmp(x, y, length) == 0;
+}
+
+/**
+ * Pass one pair of matching rows on in the joined layout.
+ * @param rows Row of the FROM table and row of the JOIN table.
+ * @return 1 if the join should stop, 0 to continue.
+ */
+static int emit_joined(JoinState* js, const char* rows[2]) {
+    size_t left_size = js->join->inputs[0]->schema->row_size;
+    memcpy(js->joined, rows[0], left_size);
+    memcpy(js->joined + left_size, rows[1], js->join->inputs[1]->schema->row_size);
+    if (js->emit(js->joined, js->ctx) != 0) js->stopped = 1;
+    return js->stopped;
+}
+
+// --- Hash Table ---
+
+static void table_clear_index(JoinTable* table) {
+    free(table->cluster_base);
+    free(table->cluster_mask);
+    free(table->heads);
+    free(table->next);
+    table->cluster_base = NULL;
+    table->cluster_mask = NULL;
+    table->heads = NULL;
+    table->next = NULL;
+}
+
+static void table_free(JoinTable* table) {
+    table_clear_index(table);
+    free(table->rows);
+    free(table->hashes);
+    memset(table, 0, sizeof(JoinTable));
+}
+
+static int table_append(JoinTable* table, const void* row, uint64_t hash) {
+    if (table->num_rows == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+        if (capacity > INT32_MAX) {
+            fprintf(stderr, "Error: Hash join build input has too many rows.\n");
+            return -1;
+        }
+        char* rows = realloc(table->rows, capacity * table->row_size);
+        if (rows) table->rows = rows;
+        uint64_t* hashes = realloc(table->hashes, capacity * sizeof(uint64_t));
+        if (hashes) table->hashes = hashes;
+        if (!rows || !hashes) {
+            perror("Failed to allocate memory for hash join build rows");
+            return -1;
+        }
+        table->capacity = capacity;
+    }
+    memcpy(table->rows + table->num_rows * table->row_size, row, table->row_size);
+    table->hashes[table->num_rows++] = hash;
+    return 0;
+}
+
+// Every row of a spill partition has the same leading hash bits, so
+// clusters are picked by the bits that follow them
+static size_t cluster_of(const JoinTable* table, uint64_t hash) {
+    return table->radix_bits ? (size_t)((hash << table->hash_shift) >> (64 - table->radix_bits)) : 0;
+}
+
+static size_t bucket_of(const JoinTable* table, uint64_t hash) {
+    size_t cluster = cluster_of(table, hash);
+    return table->cluster_base[cluster] + (size_t)(hash & table->cluster_mask[cluster]);
+}
+
+/**
+ * Radix bits for the current rows: enough clusters that each holds about
+ * JOIN_RADIX_CLUSTER_BYTES of rows.
+ */
+static int choose_radix_bits(const JoinTable* table) {
+    size_t bytes = table->num_rows * table->row_size;
+    int bits = 0;
+    while (bits < JOIN_RADIX_MAX_BITS && (bytes >> bits) > JOIN_RADIX_CLUSTER_BYTES) bits++;
+    return bits;
+}
+
+/**
+ * Index the appended rows: cluster them by hash (a counting sort on the
+ * radix_bits below hash_shift), then chain each cluster's rows into its own
+ * buckets.
+ * @return 0 on success, -1 on error.
+ */
+static int table_build(JoinTable* table, int radix_bits) {
+    size_t clusters = (size_t)1 << radix_bits;
+    table->radix_bits = radix_bits;
+    size_t* counts = calloc(clusters, sizeof(size_t));
+    table->cluster_base = malloc(clusters * sizeof(size_t));
+    table->cluster_mask = malloc(clusters * sizeof(uint64_t));
+    table->next = malloc((table->num_rows ? table->num_rows : 1) * sizeof(int32_t));
+    if (!counts || !table->cluster_base || !table->cluster_mask || !table->next) {
+        perror("Failed to allocate memory for hash join table");
+        free(counts);
+        return -1;
+    }
+    for (size_t i = 0; i < table->num_rows; i++) counts[cluster_of(table, table->hashes[i])]++;
+
+    if (radix_bits > 0) {
+        // Scatter rows into cluster order; counts become each cluster's next slot
+        char* rows = malloc(table->num_rows * table->row_size);
+        uint64_t* hashes = malloc(table->num_rows * sizeof(uint64_t));
+        size_t* cursor = malloc(clusters * sizeof(size_t));
+        if (!rows || !hashes || !cursor) {
+            perror("Failed to allocate memory for radix clustering");
+            free(rows);
+            free(hashes);
+            free(cursor);
+            free(counts);
+            return -1;
+        }
+        size_t position = 0;
+        for (size_t c = 0; c < clusters; c++) {
+            cursor[c] = position;
+            position += counts[c];
+        }
+        for (size_t i = 0; i < table->num_rows; i++) {
+            size_t slot = cursor[cluster_of(table, table->hashes[i])]++;
+            memcpy(rows + slot * table->row_size, table->rows + i * table->row_size, table->row_size);
+            hashes[slot] = table->hashes[i];
+        }
+        free(cursor);
+        free(table->rows);
+        free(table->hashes);
+        table->rows = rows;
+        table->hashes = hashes;
+        table->capacity = table->num_rows;
+    }
+
+    size_t buckets = 0;
+    for (size_t c = 0; c < clusters; c++) {
+        size_t size = 1;
+        while (size < counts[c]) size *= 2;
+        table->cluster_base[c] = buckets;
+        table->cluster_mask[c] = size - 1;
+        buckets += size;
+    }
+    free(counts);
+    if (!(table->heads = malloc(buckets * sizeof(int32_t)))) {
+        perror("Failed to allocate memory for hash join buckets");
+        return -1;
+    }
+    memset(table->heads, 0xff, buckets * sizeof(int32_t)); // -1: empty bucket
+    for (size_t i = 0; i < table->num_rows; i++) {
+        size_t bucket = bucket_of(table, table->hashes[i]);
+        table->next[i] = table->heads[bucket];
+        table->heads[bucket] = (int32_t)i;
+    }
+    return 0;
+}
+
+/**
+ * Join a probe row with every build row that has the same key.
+ * @return 1 if the join should stop, 0 to continue.
+ */
+static int probe_table(JoinState* js, const char* probe_row, uint64_t hash) {
+    const JoinTable* table = &js->table;
+    int build_side = js->join->build_side;
+    const char* rows[2];
+    rows[1 - build_side] = probe_row;
+    for (int32_t i = table->heads[bucket_of(table, hash)]; i >= 0; i = table->next[i]) {
+        const char* build_row = table->rows + (size_t)i * table->row_size;
+        if (table->hashes[i] != hash || !keys_equal(js, build_row, probe_row)) continue;
+        rows[build_side] = build_row;
+        if (emit_joined(js, rows)) return 1;
+    }
+    return 0;
+}
+
+// --- Spilling ---
+
+// Spill partition of a hash: the JOIN_SPILL_PARTITION_BITS bits after the
+// first `shift` bits (which earlier partitioning already used)
+static int partition_of(uint64_t hash, int shift) {
+    return (int)((hash << shift) >> (64 - JOIN_SPILL_PARTITION_BITS));
+}
+
+static int write_spill_row(FILE* file, const void* row, size_t row_size) {
+    if (fwrite(row, row_size, 1, file) != 1) {
+        perror("Failed to write hash join spill file");
+        return -1;
+    }
+    return 0;
+}
+
+static int spill_row(JoinState* js, int side, const void* row, uint64_t hash) {
+    return write_spill_row(js->spill[side][partition_of(hash, 0)], row, js->join->inputs[side]->schema->row_size);
+}
+
+/**
+ * Switch to a partitioned join: open the partition files of both inputs
+ * and move the build rows gathered so far into them.
+ * @return 0 on success, -1 on error.
+ */
+static int start_spilling(JoinState* js) {
+    for (int side = 0; side < 2; side++) {
+        for (int p = 0; p < JOIN_SPILL_PARTITIONS; p++) {
+            if (!(js->spill[side][p] = open_temp_file(js->plan->schema->db->data_dir, "hash join spill file"))) return -1;
+        }
+    }
+    js->spilling = 1;
+    JoinTable* table = &js->table;
+    for (size_t i = 0; i < table->num_rows; i++) {
+        if (spill_row(js, js->join->build_side, table->rows + i * table->row_size, table->hashes[i]) != 0) return -1;
+    }
+    table->num_rows = 0;
+    return 0;
+}
+
+static void close_partition_files(FILE* files[2][JOIN_SPILL_PARTITIONS]) {
+    for (int side = 0; side < 2; side++) {
+        for (int p = 0; p < JOIN_SPILL_PARTITIONS; p++) {
+            if (files[side][p]) fclose(files[side][p]);
+            files[side][p] = NULL;
+        }
+    }
+}
+
+// Bytes written to a spill file
+static long spill_size(FILE* file) {
+    if (fseek(file, 0, SEEK_END) != 0) return -1;
+    return ftell(file);
+}
+
+static int join_partition(JoinState* js, FILE* files[2], int shift);
+
+/**
+ * Split a pair of partition files that is too large to join in memory on
+ * the next JOIN_SPILL_PARTITION_BITS bits of the hash, and join the pieces.
+ * @param shift Leading hash bits the rows of `files` already share.
+ * @return 0 on success, -1 on error.
+ */
+static int repartition(JoinState* js, FILE* files[2], int shift, char* buffer) {
+    FILE* parts[2][JOIN_SPILL_PARTITIONS];
+    memset(parts, 0, sizeof(parts));
+    int status = 0;
+    for (int side = 0; side < 2 && status == 0; side++) {
+        const TableSchema* schema = js->join->inputs[side]->schema;
+        for (int p = 0; p < JOIN_SPILL_PARTITIONS && status == 0; p++) {
+            if (!(parts[side][p] = open_temp_file(js->plan->schema->db->data_dir, "hash join spill file"))) status = -1;
+        }
+        rewind(files[side]);
+        size_t count;
+        while (status == 0 && (count = fread(buffer, schema->row_size, SPILL_READ_ROWS, files[side])) > 0) {
+            for (size_t i = 0; i < count && status == 0; i++) {
+                const char* row = buffer + i * schema->row_size;
+                uint64_t hash = key_hash(schema, js->join->key_cols[side], row);
+                status = write_spill_row(parts[side][partition_of(hash, shift)], row, schema->row_size);
+            }
+        }
+        if (status == 0 && ferror(files[side])) {
+            perror("Failed to read hash join spill file");
+            status = -1;
+        }
+    }
+    for (int p = 0; p < JOIN_SPILL_PARTITIONS && status == 0 && !js->stopped; p++) {
+        FILE* pair[2] = {parts[0][p], parts[1][p]};
+        status = join_partition(js, pair, shift + JOIN_SPILL_PARTITION_BITS);
+    }
+    close_partition_files(parts);
+    return status;
+}
+
+/**
+ * Join one pair of partition files: load the build partition into the
+ * table, then stream the probe partition past it. A build partition over
+ * the memory budget (skewed keys) is split again first, at most
+ * JOIN_SPILL_MAX_SPLITS times; rows that still share their hash bits then
+ * (mostly one key) are loaded whole.
+ * @param files Build and probe partition, indexed by input side.
+ * @param shift Leading hash bits every row of the partition shares.
+ * @return 0 on success, -1 on error.
+ */
+static int join_partition(JoinState* js, FILE* files[2], int shift) {
+    int build_side = js->join->build_side;
+    int probe_side = 1 - build_side;
+    const TableSchema* schemas[2] = {js->join->inputs[0]->schema, js->join->inputs[1]->schema};
+    size_t row_size = schemas[build_side]->row_size > schemas[probe_side]->row_size
+                          ? schemas[build_side]->row_size : schemas[probe_side]->row_size;
+    char* buffer = malloc(SPILL_READ_ROWS * row_size);
+    if (!buffer) {
+        perror("Failed to allocate memory for hash join partition");
+        return -1;
+    }
+
+    long build_bytes = spill_size(files[build_side]);
+    if (build_bytes < 0) {
+        perror("Failed to read hash join spill file");
+        free(buffer);
+        return -1;
+    }
+    if ((size_t)build_bytes > js->join->memory_budget &&
+        shift < JOIN_SPILL_PARTITION_BITS * (1 + JOIN_SPILL_MAX_SPLITS)) {
+        int status = repartition(js, files, shift, buffer);
+        free(buffer);
+        return status;
+    }
+
+    JoinTable* table = &js->table;
+    table_clear_index(table);
+    table->num_rows = 0;
+    table->hash_shift = shift;
+    int status = 0;
+    FILE* file = files[build_side];
+    rewind(file);
+    size_t count;
+    while (status == 0 && (count = fread(buffer, schemas[build_side]->row_size, SPILL_READ_ROWS, file)) > 0) {
+        for (size_t i = 0; i < count && status == 0; i++) {
+            const char* row = buffer + i * schemas[build_side]->row_size;
+            status = table_append(table, row, key_hash(schemas[build_side], js->join->key_cols[build_side], row));
+        }
+    }
+    if (status == 0) status = table_build(table, choose_radix_bits(table));
+
+    file = files[probe_side];
+    rewind(file);
+    while (status == 0 && !js->stopped &&
+           (count = fread(buffer, schemas[probe_side]->row_size, SPILL_READ_ROWS, file)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const char* row = buffer + i * schemas[probe_side]->row_size;
+            if (probe_table(js, row, key_hash(schemas[probe_side], js->join->key_cols[probe_side], row))) break;
+        }
+    }
+    if (status == 0 && (ferror(files[build_side]) || ferror(file))) {
+        perror("Failed to read hash join spill file");
+        status = -1;
+    }
+    free(buffer);
+    return status;
+}
+
+// --- Hash Join ---
+
+static int build_sink(const TableSchema* schema, const void* row, void* ctx) {
+    JoinState* js = (JoinState*)ctx;
+    int side = js->join->build_side;
+    uint64_t hash = key_hash(schema, js->join->key_cols[side], row);
+    if (js->spilling) {
+        if (spill_row(js, side, row, hash) != 0) js->error = 1;
+    } else if (table_append(&js->table, row, hash) != 0) {
+        js->error = 1;
+    } else if (js->table.num_rows * js->table.row_size > js->join->memory_budget && start_spilling(js) != 0) {
+        js->error = 1;
+    }
+    return js->error;
+}
+
+static int probe_sink(const TableSchema* schema, const void* row, void* ctx) {
+    JoinState* js = (JoinState*)ctx;
+    int side = 1 - js->join->build_side;
+    uint64_t hash = key_hash(schema, js->join->key_cols[side], row);
+    if (!js->spilling) return probe_table(js, row, hash);
+    if (spill_row(js, side, row, hash) != 0) js->error = 1;
+    return js->error;
+}
+
+static int run_hash_join(JoinState* js) {
+    const JoinPlan* join = js->join;
+    js->table.row_size = join->inputs[join->build_side]->schema->row_size;
+    if (execute_plan(join->inputs[join->build_side], build_sink, js) < 0 || js->error) return -1;
+    if (!js->spilling && table_build(&js->table, choose_radix_bits(&js->table)) != 0) return -1;
+    if (execute_plan(join->inputs[1 - join->build_side], probe_sink, js) < 0 || js->error) return -1;
+    for (int p = 0; js->spilling && p < JOIN_SPILL_PARTITIONS && !js->stopped; p++) {
+        FILE* pair[2] = {js->spill[0][p], js->spill[1][p]};
+        if (join_partition(js, pair, JOIN_SPILL_PARTITION_BITS) != 0) return -1;
+    }
+    return 0;
+}
+
+// --- Index Nested-Loop Join ---
+
+static int index_lookup_sink(const TableSchema* schema, const void* row, void* ctx) {
+    JoinState* js = (JoinState*)ctx;
+    int outer = js->join->outer_side;
+    const QueryPlan* inner = js->join->inputs[1 - outer];
+    int key;
+    memcpy(&key, (const char*)row + schema->columns[js->join->key_cols[outer]].offset, sizeof(int));
+
+    void* match = NULL;
+    int result = select_row_from(inner->schema, key, &match);
+    if (result < 0) {
+        js->error = 1;
+        return 1;
+    }
+    if (result > 0) return 0; // No row with that key
+    int stop = 0;
+    if (predicate_matches(inner, inner->filter, match)) {
+        const char* rows[2];
+        rows[outer] = row;
+        rows[1 - outer] = match;
+        stop = emit_joined(js, rows);
+    }
+    free(match);
+    return stop;
+}
+
+/**
+ * Run the join of a plan, passing each joined row to `emit`.
+ * @param plan Plan with a join.
+ * @param emit Receives rows in the plan's joined layout; nonzero stops.
+ * @param ctx Passed through to emit.
+ * @return 0 on success, -1 on error.
+ */
+int join_execute(const QueryPlan* plan, JoinEmit emit, void* ctx) {
+    if (!plan || !plan->join || !emit) return -1;
+    JoinState js;
+    memset(&js, 0, sizeof(js));
+    js.plan = plan;
+    js.join = plan->join;
+    js.emit = emit;
+    js.ctx = ctx;
+    if (!(js.joined = malloc(plan->schema->row_size))) {
+        perror("Failed to allocate memory for joined row");
+        return -1;
+    }
+
+    int status;
+    if (js.join->method == JOIN_INDEX_NESTED_LOOP) {
+        status = (execute_plan(js.join->inputs[js.join->outer_side], index_lookup_sink, &js) < 0 || js.error) ? -1 : 0;
+    } else {
+        status = run_hash_join(&js);
+    }
+    close_partition_files(js.spill);
+    table_free(&js.table);
+    free(js.joined);
+    return status;
+}
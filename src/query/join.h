@@ -0,0 +1,32 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "planner.h"
+
+// --- Join Execution ---
+// Runs the two inputs of a join plan and combines matching rows into the
+// plan's joined layout (FROM table columns, then JOIN table columns).
+//
+// Hash join: the build input's rows are copied into memory and indexed by
+// a chained hash table on the join key. Builds larger than a cache are
+// radix-clustered first (rows grouped by the leading bits of their hash,
+// each cluster with its own bucket array), so building and probing a
+// cluster stays within cache. The probe input then streams past the table.
+// If the build rows exceed the plan's memory budget, both inputs are
+// instead split by the leading hash bits into partition files under the
+// data directory and joined one partition at a time, clustered on the bits
+// after those. A partition still over the budget is split again on the
+// next bits; one that many rows with the same key keep too large is loaded
+// whole regardless.
+//
+// Index nested-loop join: the outer input is scanned and every row looks
+// up the other table by primary key (Bloom filter, row cache and index).
+
+// Return nonzero to stop the join early.
+typedef int (*JoinEmit)(const void* joined_row, void* ctx);
+
+// Run the join of `plan` (plan->join must be set). Returns 0 on success or
+// when `emit` stopped it, -1 on error (reported).
+int join_execute(const QueryPlan* plan, JoinEmit emit, void* ctx);
+
+#endif // JOIN_H
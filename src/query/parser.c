@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include "parser.h"
+#include "tokenizer.h"
+
+typedef struct {
+    Tokenizer tokenizer;
+    Token current;        // One token of lookahead
+    Arena* arena;
+    int num_params;
+    int failed;
+    char* error;
+    size_t error_size;
+} Parser;
+
+// --- Span Helpers ---
+
+int span_equals(Span span, const char* name) {
+    return (int)strlen(name) == span.length && strncmp(span.start, name, span.length) == 0;
+}
+
+char* span_copy(Span span, char* out, size_t out_size) {
+    if (out_size == 0) return out;
+    size_t len = (size_t)span.length < out_size - 1 ? (size_t)span.length : out_size - 1;
+    memcpy(out, span.start, len);
+    out[len] = '\0';
+    return out;
+}
+
+char* expr_string_copy(const Expr* expr, char* out, size_t out_size) {
+    return sql_unescape_copy(expr->text.start, expr->text.length, expr->has_escapes, out, out_size);
+}
+
+// --- Token Handling ---
+
+static void advance(Parser* p) {
+    p->current = tokenizer_next(&p->tokenizer);
+}
+
+/**
+ * Record the first syntax error (later ones are consequences of it).
+ */
+static void fail(Parser* p, const char* expected) {
+    if (p->failed) return;
+    p->failed = 1;
+    if (!p->error) return;
+    int position = (int)(p->current.start - p->tokenizer.input) + 1;
+    if (p->current.type == TOK_EOF) {
+        snprintf(p->error, p->error_size, "Syntax error at end of input: expected %s", expected);
+    } else if (p->current.type == TOK_ERROR && *p->current.start == '\'') {
+        snprintf(p->error, p->error_size, "Syntax error at position %d: unterminated string literal", position);
+    } else {
+        snprintf(p->error, p->error_size, "Syntax error at position %d near '%.*s': expected %s",
+                 position, p->current.length > 20 ? 20 : p->current.length, p->current.start, expected);
+    }
+}
+
+static int accept(Parser* p, TokenType type) {
+    if (p->current.type != type) return 0;
+    advance(p);
+    return 1;
+}
+
+static int accept_keyword(Parser* p, const char* keyword) {
+    if (!token_is_keyword(&p->current, keyword)) return 0;
+    advance(p);
+    return 1;
+}
+
+static int expect(Parser* p, TokenType type) {
+    if (accept(p, type)) return 1;
+    fail(p, token_type_name(type));
+    return 0;
+}
+
+static int expect_keyword(Parser* p, const char* keyword) {
+    if (accept_keyword(p, keyword)) return 1;
+    fail(p, keyword);
+    return 0;
+}
+
+static int expect_identifier(Parser* p, Span* out) {
+    if (p->current.type != TOK_IDENT) {
+        fail(p, "identifier");
+        return 0;
+    }
+    out->start = p->current.start;
+    out->length = p->current.length;
+    advance(p);
+    return 1;
+}
+
+/**
+ * column := identifier ['.' identifier]; a qualified name is one span
+ * covering "table.column".
+ */
+static int expect_column(Parser* p, Span* out) {
+    if (!expect_identifier(p, out)) return 0;
+    if (!accept(p, TOK_DOT)) return 1;
+    Span column;
+    if (!expect_identifier(p, &column)) return 0;
+    out->length = (int)(column.start + column.length - out->start);
+    return 1;
+}
+
+static void* alloc(Parser* p, size_t size) {
+    void* ptr = arena_alloc(p->arena, size);
+    if (!ptr && !p->failed) {
+        p->failed = 1;
+        if (p->error) snprintf(p->error, p->error_size, "Out of memory while parsing");
+    }
+    return ptr;
+}
+
+/**
+ * Make room for one more element in an arena-allocated array (doubling).
+ * @return The (possibly moved) array, or NULL on allocation failure.
+ */
+static void* reserve(Parser* p, void* array, int count, int* capacity, size_t elem_size) {
+    if (count < *capacity) return array;
+    int new_capacity = *capacity ? *capacity * 2 : 4;
+    void* grown = alloc(p, (size_t)new_capacity * elem_size);
+    if (!grown) return NULL;
+    if (count > 0) memcpy(grown, array, (size_t)count * elem_size);
+    *capacity = new_capacity;
+    return grown;
+}
+
+// --- Expressions ---
+
+static Expr* new_expr(Parser* p, ExprType type) {
+    Expr* expr = alloc(p, sizeof(Expr));
+    if (expr) expr->type = type;
+    return expr;
+}
+
+/**
+ * operand := column | integer | 'string' | ?
+ */
+static Expr* parse_operand(Parser* p) {
+    Token token = p->current;
+    Expr* expr = NULL;
+    switch (token.type) {
+        case TOK_IDENT:
+            if (!(expr = new_expr(p, EXPR_COLUMN))) return NULL;
+            return expect_column(p, &expr->text) ? expr : NULL;
+        case TOK_INT: {
+            errno = 0;
+            long value = strtol(token.start, NULL, 10);
+            if (errno == ERANGE || value < INT_MIN || value > INT_MAX) {
+                fail(p, "integer within INT range");
+                return NULL;
+            }
+            expr = new_expr(p, EXPR_INT);
+            if (expr) expr->int_value = value;
+            break;
+        }
+        case TOK_STRING:
+            expr = new_expr(p, EXPR_STRING);
+            if (expr) expr->has_escapes = token.has_escapes;
+            break;
+        case TOK_PARAM:
+            expr = new_expr(p, EXPR_PARAM);
+            if (expr) expr->param_index = p->num_params++;
+            break;
+        default:
+            fail(p, "value, column or '?'");
+            return NULL;
+    }
+    if (!expr) return NULL;
+    expr->text.start = token.start;
+    expr->text.length = token.length;
+    advance(p);
+    return expr;
+}
+
+static Expr* parse_or(Parser* p);
+
+/**
+ * comparison := '(' condition ')' | NOT comparison | operand op operand
+ */
+static Expr* parse_comparison(Parser* p) {
+    if (accept_keyword(p, "NOT")) {
+        Expr* expr = new_expr(p, EXPR_NOT);
+        if (!expr) return NULL;
+        expr->left = parse_comparison(p);
+        return expr->left ? expr : NULL;
+    }
+    if (accept(p, TOK_LPAREN)) {
+        Expr* inner = parse_or(p);
+        if (!inner || !expect(p, TOK_RPAREN)) return NULL;
+        return inner;
+    }
+
+    Expr* left = parse_operand(p);
+    if (!left) return NULL;
+    CompareOp op;
+    switch (p->current.type) {
+        case TOK_EQ: op = CMP_EQ; break;
+        case TOK_NE: op = CMP_NE; break;
+        case TOK_LT: op = CMP_LT; break;
+        case TOK_LE: op = CMP_LE; break;
+        case TOK_GT: op = CMP_GT; break;
+        case TOK_GE: op = CMP_GE; break;
+        default:
+            fail(p, "comparison operator");
+            return NULL;
+    }
+    advance(p);
+    Expr* right = parse_operand(p);
+    if (!right) return NULL;
+
+    Expr* expr = new_expr(p, EXPR_COMPARE);
+    if (!expr) return NULL;
+    expr->op = op;
+    expr->left = left;
+    expr->right = right;
+    return expr;
+}
+
+/**
+ * and := comparison (AND comparison)*
+ */
+static Expr* parse_and(Parser* p) {
+    Expr* left = parse_comparison(p);
+    while (left && accept_keyword(p, "AND")) {
+        Expr* expr = new_expr(p, EXPR_AND);
+        if (!expr) return NULL;
+        expr->left = left;
+        expr->right = parse_comparison(p);
+        if (!expr->right) return NULL;
+        left = expr;
+    }
+    return left;
+}
+
+/**
+ * condition := and (OR and)*
+ */
+static Expr* parse_or(Parser* p) {
+    Expr* left = parse_and(p);
+    while (left && accept_keyword(p, "OR")) {
+        Expr* expr = new_expr(p, EXPR_OR);
+        if (!expr) return NULL;
+        expr->left = left;
+        expr->right = parse_and(p);
+        if (!expr->right) return NULL;
+        left = expr;
+    }
+    return left;
+}
+
+static Expr* parse_optional_where(Parser* p) {
+    if (!accept_keyword(p, "WHERE")) return NULL;
+    return parse_or(p);
+}
+
+/**
+ * Parse `identifier (',' identifier)*` into an arena array; with
+ * `qualified`, each name may be a table.column reference.
+ * @return Number of identifiers, or -1 on error.
+ */
+static int parse_identifier_list(Parser* p, Span** out, int qualified) {
+    Span* items = NULL;
+    int count = 0, capacity = 0;
+    do {
+        if (!(items = reserve(p, items, count, &capacity, sizeof(Span)))) return -1;
+        if (!(qualified ? expect_column(p, &items[count]) : expect_identifier(p, &items[count]))) return -1;
+        count++;
+    } while (accept(p, TOK_COMMA));
+    *out = items;
+    return count;
+}
+
+static AggregateFunc aggregate_func(Span name) {
+    static const char* names[] = {"COUNT", "SUM", "MIN", "MAX", "AVG"};
+    Token token = {TOK_IDENT, name.start, name.length, 0};
+    for (int i = 0; i < 5; i++) {
+        if (token_is_keyword(&token, names[i])) return (AggregateFunc)(AGG_COUNT + i);
+    }
+    return AGG_NONE;
+}
+
+/**
+ * select_item := column | aggregate '(' column ')' | COUNT '(' '*' ')'
+ */
+static int parse_select_item(Parser* p, SelectItem* item) {
+    Span name;
+    if (!expect_identifier(p, &name)) return 0;
+    if (p->current.type != TOK_LPAREN) {
+        item->func = AGG_NONE;
+        item->column = name;
+        if (!accept(p, TOK_DOT)) return 1;
+        Span column;
+        if (!expect_identifier(p, &column)) return 0;
+        item->column.length = (int)(column.start + column.length - name.start);
+        return 1;
+    }
+    if ((item->func = aggregate_func(name)) == AGG_NONE) {
+        fail(p, "COUNT, SUM, MIN, MAX or AVG");
+        return 0;
+    }
+    advance(p);
+    if (item->func == AGG_COUNT && accept(p, TOK_STAR)) {
+        item->column.start = name.start;
+        item->column.length = 0;
+    } else if (!expect_column(p, &item->column)) {
+        return 0;
+    }
+    return expect(p, TOK_RPAREN);
+}
+
+// --- Statements ---
+
+static void parse_select(Parser* p, SelectStmt* stmt) {
+    stmt->limit = -1;
+    if (accept(p, TOK_STAR)) {
+        stmt->select_all = 1;
+    } else {
+        int capacity = 0;
+        do {
+            stmt->columns = reserve(p, stmt->columns, stmt->num_columns, &capacity, sizeof(SelectItem));
+            if (!stmt->columns || !parse_select_item(p, &stmt->columns[stmt->num_columns])) return;
+            stmt->num_columns++;
+        } while (accept(p, TOK_COMMA));
+    }
+    if (!expect_keyword(p, "FROM") || !expect_identifier(p, &stmt->table)) return;
+
+    int inner = accept_keyword(p, "INNER");
+    if (inner ? expect_keyword(p, "JOIN") : accept_keyword(p, "JOIN")) {
+        if (!expect_identifier(p, &stmt->join_table) || !expect_keyword(p, "ON")) return;
+        if (!(stmt->join_on = parse_comparison(p))) return;
+    } else if (p->failed) {
+        return;
+    }
+
+    if (token_is_keyword(&p->current, "WHERE")) {
+        stmt->where = parse_optional_where(p);
+        if (!stmt->where) return;
+    }
+
+    if (accept_keyword(p, "GROUP")) {
+        if (!expect_keyword(p, "BY")) return;
+        if ((stmt->num_group_by = parse_identifier_list(p, &stmt->group_by, 1)) < 0) return;
+    }
+
+    if (accept_keyword(p, "ORDER")) {
+        if (!expect_keyword(p, "BY")) return;
+        int capacity = 0;
+        do {
+            stmt->order_by = reserve(p, stmt->order_by, stmt->num_order_by, &capacity, sizeof(OrderItem));
+            if (!stmt->order_by) return;
+            OrderItem* item = &stmt->order_by[stmt->num_order_by];
+            if (!parse_select_item(p, &item->item)) return;
+            if (accept_keyword(p, "DESC")) {
+                item->descending = 1;
+            } else {
+                accept_keyword(p, "ASC");
+            }
+            stmt->num_order_by++;
+        } while (accept(p, TOK_COMMA));
+    }
+
+    if (accept_keyword(p, "LIMIT")) {
+        if (p->current.type != TOK_INT || p->current.start[0] == '-') {
+            fail(p, "non-negative LIMIT");
+            return;
+        }
+        stmt->limit = strtol(p->current.start, NULL, 10);
+        advance(p);
+    }
+}
+
+static void parse_insert(Parser* p, InsertStmt* stmt) {
+    if (!expect_keyword(p, "INTO") || !expect_identifier(p, &stmt->table)) return;
+    if (accept(p, TOK_LPAREN)) {
+        if ((stmt->num_columns = parse_identifier_list(p, &stmt->columns, 0)) < 0) return;
+        if (!expect(p, TOK_RPAREN)) return;
+    }
+    if (!expect_keyword(p, "VALUES")) return;
+
+    int count = 0, capacity = 0;
+    do {
+        if (!expect(p, TOK_LPAREN)) return;
+        int width = 0;
+        do {
+            if (!(stmt->values = reserve(p, stmt->values, count, &capacity, sizeof(Expr*)))) return;
+            if (!(stmt->values[count] = parse_operand(p))) return;
+            count++;
+            width++;
+        } while (accept(p, TOK_COMMA));
+        if (!expect(p, TOK_RPAREN)) return;
+
+        if (stmt->num_rows == 0) {
+            stmt->row_width = width;
+        } else if (width != stmt->row_width) {
+            fail(p, "the same number of values in every row");
+            return;
+        }
+        stmt->num_rows++;
+    } while (accept(p, TOK_COMMA));
+}
+
+static void parse_update(Parser* p, UpdateStmt* stmt) {
+    if (!expect_identifier(p, &stmt->table) || !expect_keyword(p, "SET")) return;
+    int columns_capacity = 0, values_capacity = 0;
+    do {
+        stmt->columns = reserve(p, stmt->columns, stmt->num_assignments, &columns_capacity, sizeof(Span));
+        stmt->values = reserve(p, stmt->values, stmt->num_assignments, &values_capacity, sizeof(Expr*));
+        if (!stmt->columns || !stmt->values) return;
+        if (!expect_identifier(p, &stmt->columns[stmt->num_assignments]) || !expect(p, TOK_EQ)) return;
+        if (!(stmt->values[stmt->num_assignments] = parse_operand(p))) return;
+        stmt->num_assignments++;
+    } while (accept(p, TOK_COMMA));
+    if (token_is_keyword(&p->current, "WHERE")) {
+        stmt->where = parse_optional_where(p);
+    }
+}
+
+static void parse_delete(Parser* p, DeleteStmt* stmt) {
+    if (!expect_keyword(p, "FROM") || !expect_identifier(p, &stmt->table)) return;
+    if (token_is_keyword(&p->current, "WHERE")) {
+        stmt->where = parse_optional_where(p);
+    }
+}
+
+static void parse_create_table(Parser* p, CreateTableStmt* stmt) {
+    if (!expect_keyword(p, "TABLE") || !expect_identifier(p, &stmt->table) || !expect(p, TOK_LPAREN)) return;
+    int capacity = 0;
+    do {
+        stmt->columns = reserve(p, stmt->columns, stmt->num_columns, &capacity, sizeof(ColumnDefAst));
+        if (!stmt->columns) return;
+        ColumnDefAst* col = &stmt->columns[stmt->num_columns];
+        if (!expect_identifier(p, &col->name)) return;
+        if (accept_keyword(p, "INT")) {
+            col->type = COL_TYPE_INT;
+        } else if (accept_keyword(p, "STRING")) {
+            col->type = COL_TYPE_STRING;
+            if (!expect(p, TOK_LPAREN)) return;
+            if (p->current.type != TOK_INT || p->current.start[0] == '-') {
+                fail(p, "string length");
+                return;
+            }
+            col->size = atoi(p->current.start);
+            advance(p);
+            if (!expect(p, TOK_RPAREN)) return;
+        } else {
+            fail(p, "column type INT or STRING(n)");
+            return;
+        }
+        if (accept_keyword(p, "PRIMARY")) {
+            if (!expect_keyword(p, "KEY")) return;
+            col->primary_key = 1;
+        }
+        stmt->num_columns++;
+    } while (accept(p, TOK_COMMA));
+    if (!expect(p, TOK_RPAREN)) return;
+
+    if (accept_keyword(p, "WITH")) {
+        if (!expect(p, TOK_LPAREN)) return;
+        if ((stmt->num_options = parse_identifier_list(p, &stmt->options, 0)) < 0) return;
+        expect(p, TOK_RPAREN);
+    }
+}
+
+/**
+ * Parse one SQL statement into an AST.
+ * @param sql Statement text (must outlive the AST).
+ * @param arena Arena for the nodes.
+ * @param error Receives a message on failure (may be NULL).
+ * @param error_size Size of the error buffer.
+ * @return The statement, or NULL on a syntax error.
+ */
+Statement* parse_statement(const char* sql, Arena* arena, char* error, size_t error_size) {
+    Parser parser;
+    memset(&parser, 0, sizeof(parser));
+    Parser* p = &parser;
+    p->arena = arena;
+    p->error = error;
+    p->error_size = error_size;
+    if (error && error_size > 0) error[0] = '\0';
+    tokenizer_init(&p->tokenizer, sql);
+    advance(p);
+
+    Statement* stmt = alloc(p, sizeof(Statement));
+    if (!stmt) return NULL;
+
+    if (accept_keyword(p, "SELECT")) {
+        stmt->kind = AST_SELECT;
+        parse_select(p, &stmt->select);
+    } else if (accept_keyword(p, "INSERT")) {
+        stmt->kind = AST_INSERT;
+        parse_insert(p, &stmt->insert);
+    } else if (accept_keyword(p, "UPDATE")) {
+        stmt->kind = AST_UPDATE;
+        parse_update(p, &stmt->update);
+    } else if (accept_keyword(p, "DELETE")) {
+        stmt->kind = AST_DELETE;
+        parse_delete(p, &stmt->del);
+    } else if (accept_keyword(p, "CREATE")) {
+        stmt->kind = AST_CREATE_TABLE;
+        parse_create_table(p, &stmt->create_table);
+    } else if (accept_keyword(p, "DROP")) {
+        stmt->kind = AST_DROP_TABLE;
+        if (expect_keyword(p, "TABLE")) expect_identifier(p, &stmt->drop_table.table);
+    } else {
+        fail(p, "SELECT, INSERT, UPDATE, DELETE, CREATE or DROP");
+    }
+
+    if (!p->failed) {
+        accept(p, TOK_SEMICOLON);
+        if (p->current.type != TOK_EOF) fail(p, "end of statement");
+    }
+    if (p->failed) return NULL;
+    stmt->num_params = p->num_params;
+    return stmt;
+}
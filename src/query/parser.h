@@ -0,0 +1,28 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "ast.h"
+#include "../util/arena.h"
+
+// --- Recursive-Descent SQL Parser ---
+//   SELECT * | item, ... FROM t [[INNER] JOIN t2 ON col = col] [WHERE cond] [GROUP BY col, ...]
+//          [ORDER BY col [ASC|DESC], ...] [LIMIT n]
+//   INSERT INTO t [(col, ...)] VALUES (v, ...)[, (v, ...) ...]
+//   UPDATE t SET col = v, ... [WHERE cond]
+//   DELETE FROM t [WHERE cond]
+//   CREATE TABLE t (col INT [PRIMARY KEY] | col STRING(n), ...) [WITH (option, ...)]
+//   DROP TABLE t
+// cond combines `operand op operand` comparisons (=, !=, <>, <, <=, >, >=)
+// with AND, OR, NOT and parentheses. Values are integers, 'strings', bare
+// words (strings, as the REPL always accepted) or ? parameters. A select
+// item is a column or COUNT(*), COUNT(col), SUM, MIN, MAX or AVG(col).
+// Columns in a SELECT may be written table.column.
+
+#define PARSE_ERROR_LEN 256
+
+// Parse one statement (an optional trailing ';' is allowed). Nodes are
+// allocated from `arena`. Returns the statement, or NULL with a message in
+// `error` (if non-NULL).
+Statement* parse_statement(const char* sql, Arena* arena, char* error, size_t error_size);
+
+#endif // PARSER_H
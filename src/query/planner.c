@@ -0,0 +1,1195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "planner.h"
+#include "../database/database.h"
+#include "../database/zonemap.h"
+#include "../database/stats.h"
+#include "../util/extsort.h"
+
+#define MAX_LITERAL_LEN 1024 // Longest literal value accepted in statement text
+
+// Selectivities assumed when nothing is known about the values (System R defaults)
+#define DEFAULT_EQ_SELECTIVITY 0.1
+#define DEFAULT_RANGE_SELECTIVITY (1.0 / 3.0)
+
+// --- Name Resolution ---
+
+/**
+ * Resolve a table name; errors are reported.
+ */
+TableSchema* resolve_table(Database* db, Span name) {
+    char table_name[MAX_TABLE_NAME_LEN];
+    span_copy(name, table_name, sizeof(table_name));
+    TableSchema* schema = find_table_schema(db, table_name);
+    if (!schema) {
+        fprintf(stderr, "Error: Table '%.*s' not found.\n", name.length, name.start);
+    }
+    return schema;
+}
+
+/**
+ * Find a column by name. "table.column" matches a column of that table; in
+ * a join's row layout (whose columns are all named table.column) a plain
+ * name matches the one column with that suffix.
+ * @return Column index, -1 if there is none, -2 if the name is ambiguous.
+ */
+static int find_column_index(const TableSchema* schema, Span name) {
+    const char* dot = memchr(name.start, '.', (size_t)name.length);
+    if (dot && !schema->joined) {
+        Span table = {name.start, (int)(dot - name.start)};
+        if (!span_equals(table, schema->name)) return -1;
+        name.length -= (int)(dot + 1 - name.start);
+        name.start = dot + 1;
+    }
+    int found = -1;
+    for (int i = 0; i < schema->num_columns; i++) {
+        const char* col_name = schema->columns[i].name;
+        if (span_equals(name, col_name)) return i;
+        const char* suffix = strchr(col_name, '.');
+        if (!dot && suffix && span_equals(name, suffix + 1)) {
+            if (found >= 0) return -2;
+            found = i;
+        }
+    }
+    return found;
+}
+
+/**
+ * Resolve a column name within a table; errors are reported.
+ * @return Column index, or -1 if the table has no such column.
+ */
+int resolve_column(const TableSchema* schema, Span name) {
+    int col_index = find_column_index(schema, name);
+    if (col_index == -2) {
+        fprintf(stderr, "Error: Column name '%.*s' is ambiguous; qualify it with its table.\n", name.length, name.start);
+        return -1;
+    }
+    if (col_index < 0) {
+        fprintf(stderr, "Error: Column '%.*s' not found in table '%s'.\n", name.length, name.start, schema->name);
+    }
+    return col_index;
+}
+
+/**
+ * Encode a literal into column `col_index` of a row buffer. Integers go
+ * straight into INT columns; everything else is converted from its text.
+ * @return 0 on success, -1 on error.
+ */
+int encode_literal(const TableSchema* schema, void* row_data, int col_index, const Expr* value) {
+    const ColumnDefinition* col = &schema->columns[col_index];
+    char text[MAX_LITERAL_LEN];
+
+    switch (value->type) {
+        case EXPR_INT:
+            if (col->type == COL_TYPE_INT) { // The parser has range-checked it
+                int v = (int)value->int_value;
+                memcpy((char*)row_data + col->offset, &v, sizeof(int));
+                return 0;
+            }
+            span_copy(value->text, text, sizeof(text));
+            break;
+        case EXPR_STRING:
+            expr_string_copy(value, text, sizeof(text));
+            break;
+        case EXPR_COLUMN:
+            span_copy(value->text, text, sizeof(text)); // Bare word: taken as text
+            break;
+        default:
+            fprintf(stderr, "Error: Expected a value for column '%s'.\n", col->name);
+            return -1;
+    }
+    return set_value_by_index(schema, row_data, col_index, text);
+}
+
+// --- Predicate Resolution ---
+
+static CompareOp flip_op(CompareOp op) {
+    switch (op) {
+        case CMP_LT: return CMP_GT;
+        case CMP_LE: return CMP_GE;
+        case CMP_GT: return CMP_LT;
+        case CMP_GE: return CMP_LE;
+        default: return op;
+    }
+}
+
+static int count_comparisons(const Expr* expr) {
+    if (!expr) return 0;
+    if (expr->type == EXPR_COMPARE) return 1;
+    return count_comparisons(expr->left) + count_comparisons(expr->right);
+}
+
+char* plan_constant(const QueryPlan* plan, int const_row) {
+    return plan->constants + (size_t)const_row * plan->schema->row_size;
+}
+
+/**
+ * Resolve `a op b`: one side must be a column of the table; the other is a
+ * column or a constant. A bare word names a column if the table has one by
+ * that name, else it is text (as in INSERT).
+ */
+static int build_compare(QueryPlan* plan, Predicate* pred, const Expr* expr) {
+    const TableSchema* schema = plan->schema;
+    const Expr* column = expr->left;
+    const Expr* value = expr->right;
+    CompareOp op = expr->op;
+    if (column->type != EXPR_COLUMN || find_column_index(schema, column->text) < 0) {
+        if (value->type == EXPR_COLUMN && find_column_index(schema, value->text) >= 0) {
+            column = expr->right;
+            value = expr->left;
+            op = flip_op(op);
+        }
+    }
+    if (column->type != EXPR_COLUMN) {
+        fprintf(stderr, "Error: A comparison in WHERE must involve a column of '%s'.\n", schema->name);
+        return -1;
+    }
+    pred->type = PRED_COMPARE;
+    pred->op = op;
+    if ((pred->col_index = resolve_column(schema, column->text)) < 0) return -1;
+
+    if (value->type == EXPR_COLUMN && find_column_index(schema, value->text) == -2) {
+        return resolve_column(schema, value->text); // Reports the ambiguity
+    }
+    if (value->type == EXPR_COLUMN && (pred->rhs_col_index = find_column_index(schema, value->text)) >= 0) {
+        if (schema->columns[pred->rhs_col_index].type != schema->columns[pred->col_index].type) {
+            fprintf(stderr, "Error: Cannot compare columns '%s' and '%s' of different types.\n",
+                    schema->columns[pred->col_index].name, schema->columns[pred->rhs_col_index].name);
+            return -1;
+        }
+        return 0;
+    }
+
+    pred->const_row = plan->num_constants++;
+    if (value->type == EXPR_PARAM) {
+        pred->param_index = value->param_index;
+        plan->params[value->param_index].schema = schema;
+        plan->params[value->param_index].col_index = pred->col_index;
+        plan->params[value->param_index].row_data = plan_constant(plan, pred->const_row);
+        return 0;
+    }
+    return encode_literal(schema, plan_constant(plan, pred->const_row), pred->col_index, value);
+}
+
+static Predicate* build_predicate(QueryPlan* plan, const Expr* expr) {
+    Predicate* pred = arena_alloc(&plan->arena, sizeof(Predicate));
+    if (!pred) {
+        perror("Failed to allocate memory for predicate");
+        return NULL;
+    }
+    pred->rhs_col_index = -1;
+    pred->const_row = -1;
+    pred->param_index = -1;
+
+    switch (expr->type) {
+        case EXPR_AND:
+        case EXPR_OR:
+            pred->type = (expr->type == EXPR_AND) ? PRED_AND : PRED_OR;
+            if (!(pred->left = build_predicate(plan, expr->left))) return NULL;
+            if (!(pred->right = build_predicate(plan, expr->right))) return NULL;
+            return pred;
+        case EXPR_NOT:
+            pred->type = PRED_NOT;
+            if (!(pred->left = build_predicate(plan, expr->left))) return NULL;
+            return pred;
+        case EXPR_COMPARE:
+            return (build_compare(plan, pred, expr) == 0) ? pred : NULL;
+        default:
+            fprintf(stderr, "Error: Expected a comparison in WHERE near '%.*s'.\n",
+                    expr->text.length, expr->text.start);
+            return NULL;
+    }
+}
+
+static int is_bound(const QueryPlan* plan, const Predicate* pred) {
+    return pred->type == PRED_COMPARE && pred->rhs_col_index < 0 && pred->op != CMP_NE &&
+           plan->schema->columns[pred->col_index].type == COL_TYPE_INT;
+}
+
+/**
+ * Collect INT column bounds from the top-level AND chain.
+ */
+static void collect_bounds(QueryPlan* plan, const Predicate* pred) {
+    if (pred->type == PRED_AND) {
+        collect_bounds(plan, pred->left);
+        collect_bounds(plan, pred->right);
+    } else if (is_bound(plan, pred)) {
+        ColumnBound* bound = &plan->bounds[plan->num_bounds++];
+        bound->col_index = pred->col_index;
+        bound->op = pred->op;
+        bound->const_row = pred->const_row;
+        bound->param_index = pred->param_index;
+    }
+}
+
+// --- Estimates ---
+
+static int constant_int(const QueryPlan* plan, int const_row, int col_index) {
+    int value;
+    memcpy(&value, plan_constant(plan, const_row) + plan->schema->columns[col_index].offset, sizeof(int));
+    return value;
+}
+
+/**
+ * Narrow [*low, *high] to the values of INT column `col_index` allowed by the bounds.
+ * @return 0 if no value can match, else 1.
+ */
+int plan_column_range(const QueryPlan* plan, int col_index, int* low, int* high) {
+    for (int i = 0; i < plan->num_bounds; i++) {
+        const ColumnBound* bound = &plan->bounds[i];
+        if (bound->col_index != col_index) continue;
+        int v = constant_int(plan, bound->const_row, col_index);
+        switch (bound->op) {
+            case CMP_EQ:
+                if (v > *low) *low = v;
+                if (v < *high) *high = v;
+                break;
+            case CMP_LT:
+                if (v == INT_MIN) return 0;
+                if (v - 1 < *high) *high = v - 1;
+                break;
+            case CMP_LE:
+                if (v < *high) *high = v;
+                break;
+            case CMP_GT:
+                if (v == INT_MAX) return 0;
+                if (v + 1 > *low) *low = v + 1;
+                break;
+            case CMP_GE:
+                if (v > *low) *low = v;
+                break;
+            case CMP_NE:
+                break;
+        }
+    }
+    return *low <= *high;
+}
+
+/**
+ * Fraction of [min, max] covered by [low, high], assuming uniform values.
+ */
+static double range_fraction(long low, long high, long min, long max) {
+    if (low < min) low = min;
+    if (high > max) high = max;
+    if (low > high) return 0.0;
+    return (double)(high - low + 1) / (double)(max - min + 1);
+}
+
+long plan_table_rows(const QueryPlan* plan) {
+    return (long)(plan->schema->data_size / (off_t)plan->schema->record_size);
+}
+
+/**
+ * Fraction of rows with INT column value in [low, high]: from the ANALYZE
+ * histogram if there is one, else uniform over the zone maps' min/max.
+ * @return The fraction, or -1 if nothing is known about the column.
+ */
+static double value_range_selectivity(const QueryPlan* plan, int col_index, long low, long high) {
+    const TableSchema* schema = plan->schema;
+    if (schema->stats) {
+        double selectivity = stats_range_selectivity(schema->stats, col_index, low, high);
+        if (selectivity >= 0.0) return selectivity;
+    }
+    int min, max;
+    if (zone_map_column_range(schema->zone_map, col_index, &min, &max)) {
+        return range_fraction(low, high, min, max);
+    }
+    return -1.0;
+}
+
+/**
+ * Fraction of rows equal to one value: from ANALYZE (the histogram when the
+ * INT value is known, else 1/distinct), 1/rows for the primary key, else a
+ * default.
+ * @param value The value, or NULL if unknown (parameter, STRING column).
+ */
+static double eq_selectivity(const QueryPlan* plan, int col_index, const long* value) {
+    const TableSchema* schema = plan->schema;
+    if (schema->stats && schema->stats->row_count > 0) {
+        if (value) return stats_eq_selectivity(schema->stats, col_index, *value);
+        return 1.0 / (double)stats_distinct(schema->stats, col_index);
+    }
+    if (col_index == schema->pk_column_index && plan_table_rows(plan) > 0) {
+        return 1.0 / (double)plan_table_rows(plan);
+    }
+    return DEFAULT_EQ_SELECTIVITY;
+}
+
+/**
+ * Selectivity of `column op constant|column`. A literal on an INT column is
+ * checked against the histogram (or zone map range); otherwise fixed
+ * defaults are used.
+ */
+static double compare_selectivity(const QueryPlan* plan, const Predicate* pred) {
+    if (pred->rhs_col_index < 0 && pred->param_index < 0 &&
+        plan->schema->columns[pred->col_index].type == COL_TYPE_INT) {
+        long v = constant_int(plan, pred->const_row, pred->col_index);
+        double eq = eq_selectivity(plan, pred->col_index, &v);
+        long low = LONG_MIN, high = LONG_MAX;
+        switch (pred->op) {
+            case CMP_EQ:
+            case CMP_NE: low = high = v; break;
+            case CMP_LT: high = v - 1; break;
+            case CMP_LE: high = v; break;
+            case CMP_GT: low = v + 1; break;
+            case CMP_GE: low = v; break;
+        }
+        double in_range = value_range_selectivity(plan, pred->col_index, low, high);
+        if (in_range >= 0.0) {
+            if (pred->op == CMP_EQ) return (in_range > 0.0) ? eq : 0.0;
+            if (pred->op == CMP_NE) return (in_range > 0.0) ? 1.0 - eq : 1.0;
+            return in_range;
+        }
+    }
+    double eq = eq_selectivity(plan, pred->col_index, NULL);
+    switch (pred->op) {
+        case CMP_EQ: return eq;
+        case CMP_NE: return 1.0 - eq;
+        default: return DEFAULT_RANGE_SELECTIVITY;
+    }
+}
+
+static double predicate_selectivity(const QueryPlan* plan, const Predicate* pred) {
+    if (!pred) return 1.0;
+    double left, right;
+    switch (pred->type) {
+        case PRED_AND:
+            return predicate_selectivity(plan, pred->left) * predicate_selectivity(plan, pred->right);
+        case PRED_OR:
+            left = predicate_selectivity(plan, pred->left);
+            right = predicate_selectivity(plan, pred->right);
+            return left + right - left * right;
+        case PRED_NOT:
+            return 1.0 - predicate_selectivity(plan, pred->left);
+        case PRED_COMPARE:
+            return compare_selectivity(plan, pred);
+    }
+    return 1.0;
+}
+
+/**
+ * Fraction of rows inside the bounds on one INT column.
+ */
+static double bounds_selectivity(const QueryPlan* plan, int col_index) {
+    int has_param = 0, has_bound = 0;
+    for (int i = 0; i < plan->num_bounds; i++) {
+        if (plan->bounds[i].col_index != col_index) continue;
+        has_bound = 1;
+        if (plan->bounds[i].param_index >= 0) has_param = 1;
+    }
+    if (!has_bound) return 1.0;
+    if (has_param) return DEFAULT_RANGE_SELECTIVITY;
+    int low = INT_MIN, high = INT_MAX;
+    if (!plan_column_range(plan, col_index, &low, &high)) return 0.0;
+    long value = low;
+    double in_range = value_range_selectivity(plan, col_index, low, high);
+    if (in_range < 0.0) return (low == high) ? eq_selectivity(plan, col_index, &value) : DEFAULT_RANGE_SELECTIVITY;
+    if (low == high && in_range > 0.0) return eq_selectivity(plan, col_index, &value); // Duplicates are not spread evenly
+    return in_range;
+}
+
+static long round_rows(double rows) {
+    if (rows <= 0.0) return 0;
+    if (rows < 1.0) return 1;
+    return (long)(rows + 0.5);
+}
+
+/**
+ * Selectivity of the top-level AND chain apart from its bounds.
+ */
+static double residual_selectivity(const QueryPlan* plan, const Predicate* pred) {
+    if (pred->type == PRED_AND) {
+        return residual_selectivity(plan, pred->left) * residual_selectivity(plan, pred->right);
+    }
+    return is_bound(plan, pred) ? 1.0 : predicate_selectivity(plan, pred);
+}
+
+/**
+ * Distinct values of a join column: from ANALYZE, else assumed unique.
+ */
+static double key_distinct(const QueryPlan* input, int col_index) {
+    const TableStats* stats = input->schema->stats;
+    if (stats && stats->row_count > 0) return (double)stats_distinct(stats, col_index);
+    long rows = plan_table_rows(input);
+    return rows > 0 ? (double)rows : 1.0;
+}
+
+/**
+ * Rows of an equi-join: |A| * |B| / max(distinct(a), distinct(b)), times
+ * the selectivity of the conditions evaluated on the joined rows.
+ */
+static long join_estimate_rows(const QueryPlan* plan) {
+    const JoinPlan* join = plan->join;
+    double distinct = key_distinct(join->inputs[0], join->key_cols[0]);
+    double other = key_distinct(join->inputs[1], join->key_cols[1]);
+    if (other > distinct) distinct = other;
+    double rows = (double)plan_estimate_rows(join->inputs[0]) * (double)plan_estimate_rows(join->inputs[1]) / distinct;
+    if (plan->filter) rows *= predicate_selectivity(plan, plan->filter);
+    return round_rows(rows);
+}
+
+long plan_estimate_rows(const QueryPlan* plan) {
+    if (plan->join) return join_estimate_rows(plan);
+    // Bounds on the same column are combined into one range (id > 10 AND
+    // id < 20 is not two independent filters); the rest multiply
+    double selectivity = plan->filter ? residual_selectivity(plan, plan->filter) : 1.0;
+    for (int i = 0; i < plan->num_bounds; i++) {
+        int seen = 0;
+        for (int j = 0; j < i; j++) seen |= (plan->bounds[j].col_index == plan->bounds[i].col_index);
+        if (!seen) selectivity *= bounds_selectivity(plan, plan->bounds[i].col_index);
+    }
+    long rows = plan_table_rows(plan);
+    long estimate = round_rows((double)rows * selectivity);
+    if (plan->access == ACCESS_POINT_LOOKUP && estimate > 1) estimate = 1;
+    return estimate;
+}
+
+int plan_scan_threads(const QueryPlan* plan) {
+    off_t size = plan->schema->data_size;
+    if (size < PARALLEL_SCAN_MIN_BYTES) return 1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long threads = (cpus > 0) ? cpus : 1;
+    if (threads > MAX_SCAN_THREADS) threads = MAX_SCAN_THREADS;
+    long blocks = (long)((size + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE);
+    if (threads > blocks) threads = blocks;
+    return (int)threads;
+}
+
+// --- Planning ---
+
+// Cost of reading the whole data file, in sequential page reads
+static double scan_cost(const QueryPlan* plan) {
+    return (double)plan->schema->data_size / IO_ALIGNMENT + 1.0;
+}
+
+/**
+ * Pick the access path. An equality on the INT primary key means a point
+ * lookup; other pk bounds use the index when fetching the estimated rows
+ * one by one is cheaper than reading the whole file sequentially.
+ */
+static void choose_access_path(QueryPlan* plan) {
+    const TableSchema* schema = plan->schema;
+    int pk = schema->pk_column_index;
+    plan->access = ACCESS_FULL_SCAN;
+    if (pk < 0 || !schema->pk_index || schema->columns[pk].type != COL_TYPE_INT) return;
+
+    int has_bound = 0;
+    for (int i = 0; i < plan->num_bounds; i++) {
+        if (plan->bounds[i].col_index != pk) continue;
+        if (plan->bounds[i].op == CMP_EQ) {
+            plan->access = ACCESS_POINT_LOOKUP;
+            return;
+        }
+        has_bound = 1;
+    }
+    if (!has_bound) return;
+
+    double fetch_cost = (double)plan_table_rows(plan) * bounds_selectivity(plan, pk) * PLAN_ROW_FETCH_COST;
+    if (fetch_cost <= scan_cost(plan)) plan->access = ACCESS_INDEX_RANGE_SCAN;
+}
+
+/**
+ * ORDER BY the primary key (ascending) needs no sort when rows come from
+ * the index, which returns them in key order. With a LIMIT, a full scan
+ * becomes an index walk if fetching rows one by one until LIMIT of them
+ * matched is cheaper than reading the whole file (and sorting it).
+ */
+static void choose_sort_order(QueryPlan* plan) {
+    const TableSchema* schema = plan->schema;
+    if (!plan->sort_keys || plan->aggregation || plan->join) return;
+    const PlanSortKey* key = &plan->sort_keys[0];
+    int source = plan->projection ? plan->projection[key->col_index] : key->col_index;
+    if (source != schema->pk_column_index || key->descending) return;
+    if (plan->access == ACCESS_FULL_SCAN) {
+        if (plan->limit < 0 || !schema->pk_index || schema->columns[source].type != COL_TYPE_INT) return;
+        double rows = (double)plan_table_rows(plan);
+        double matches = (double)plan_estimate_rows(plan);
+        double fetched = (matches > 0) ? (double)plan->limit * rows / matches : rows;
+        if (fetched > rows) fetched = rows;
+        if (fetched * PLAN_ROW_FETCH_COST > scan_cost(plan)) return;
+        plan->access = ACCESS_INDEX_RANGE_SCAN;
+    }
+    plan->index_order = 1;
+}
+
+static TableSchema* new_output_schema(QueryPlan* plan, int max_columns) {
+    TableSchema* output = arena_alloc(&plan->arena, sizeof(TableSchema));
+    ColumnDefinition* columns = arena_alloc(&plan->arena, (size_t)(max_columns + 1) * sizeof(ColumnDefinition));
+    if (!output || !columns) {
+        perror("Failed to allocate memory for query output schema");
+        return NULL;
+    }
+    memset(output, 0, sizeof(TableSchema));
+    output->columns = columns;
+    strcpy(output->name, plan->schema->name);
+    output->db = plan->schema->db;
+    output->table_id = -1;
+    output->pk_column_index = -1;
+    output->joined = plan->schema->joined; // Keeps table.column names resolvable
+    return output;
+}
+
+/**
+ * Append a column to an output schema, packed after the previous ones.
+ */
+static void add_output_column(TableSchema* output, const ColumnDefinition* col) {
+    ColumnDefinition* out_col = &output->columns[output->num_columns++];
+    *out_col = *col;
+    out_col->offset = output->row_size;
+    output->row_size += out_col->size;
+    output->record_size = output->row_size;
+}
+
+/**
+ * Resolve a SELECT column list into the plan's output schema: the listed
+ * columns in order.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int build_projection(QueryPlan* plan, const SelectStmt* select) {
+    const TableSchema* schema = plan->schema;
+    TableSchema* output = new_output_schema(plan, select->num_columns);
+    plan->projection = arena_alloc(&plan->arena, (size_t)select->num_columns * sizeof(int));
+    if (!output || !plan->projection) {
+        perror("Failed to allocate memory for query projection");
+        return -1;
+    }
+    for (int i = 0; i < select->num_columns; i++) {
+        int col_index = resolve_column(schema, select->columns[i].column);
+        if (col_index < 0) return -1;
+        plan->projection[i] = col_index;
+        if (col_index == schema->pk_column_index) output->pk_column_index = i;
+        add_output_column(output, &schema->columns[col_index]);
+    }
+    plan->output = output;
+    return 0;
+}
+
+static const char* aggregate_names[] = {"", "count", "sum", "min", "max", "avg"};
+
+/**
+ * Resolve GROUP BY and the aggregates of the select list. Plain columns in
+ * the list must be GROUP BY columns; SUM, AVG, MIN and MAX need INT columns.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int build_aggregation(QueryPlan* plan, const SelectStmt* select) {
+    const TableSchema* schema = plan->schema;
+    if (select->select_all) {
+        fprintf(stderr, "Error: SELECT * cannot be combined with GROUP BY.\n");
+        return -1;
+    }
+    TableSchema* output = new_output_schema(plan, select->num_columns);
+    PlanAggregation* agg = arena_alloc(&plan->arena, sizeof(PlanAggregation));
+    if (!output) return -1;
+    if (!agg) {
+        perror("Failed to allocate memory for aggregation");
+        return -1;
+    }
+    memset(agg, 0, sizeof(PlanAggregation));
+    agg->group_cols = arena_alloc(&plan->arena, (size_t)(select->num_group_by + 1) * sizeof(int));
+    agg->aggregates = arena_alloc(&plan->arena, (size_t)select->num_columns * sizeof(PlanAggregate));
+    agg->output_map = arena_alloc(&plan->arena, (size_t)select->num_columns * sizeof(int));
+    if (!agg->group_cols || !agg->aggregates || !agg->output_map) {
+        perror("Failed to allocate memory for aggregation");
+        return -1;
+    }
+    for (int i = 0; i < select->num_group_by; i++) {
+        if ((agg->group_cols[i] = resolve_column(schema, select->group_by[i])) < 0) return -1;
+    }
+    agg->num_group_cols = select->num_group_by;
+
+    // Aggregate outputs are numbered after the group columns; fix them up below
+    for (int i = 0; i < select->num_columns; i++) {
+        const SelectItem* item = &select->columns[i];
+        int col_index = -1;
+        if (item->column.length > 0 && (col_index = resolve_column(schema, item->column)) < 0) return -1;
+
+        if (item->func == AGG_NONE) {
+            int group = -1;
+            for (int g = 0; g < agg->num_group_cols && group < 0; g++) {
+                if (agg->group_cols[g] == col_index) group = g;
+            }
+            if (group < 0) {
+                fprintf(stderr, "Error: Column '%s' must appear in GROUP BY or inside an aggregate.\n",
+                        schema->columns[col_index].name);
+                return -1;
+            }
+            agg->output_map[i] = group;
+            add_output_column(output, &schema->columns[col_index]);
+            continue;
+        }
+
+        if (item->func != AGG_COUNT && schema->columns[col_index].type != COL_TYPE_INT) {
+            fprintf(stderr, "Error: %s() needs an INT column; '%s' is not.\n",
+                    aggregate_names[item->func], schema->columns[col_index].name);
+            return -1;
+        }
+        PlanAggregate* aggregate = &agg->aggregates[agg->num_aggregates];
+        aggregate->func = item->func;
+        aggregate->col_index = col_index;
+        agg->output_map[i] = -1 - agg->num_aggregates++;
+
+        ColumnDefinition col = {0};
+        int arg_len = (int)sizeof(col.name) - 8; // Room for "count(" and ")"
+        snprintf(col.name, sizeof(col.name), "%s(%.*s)", aggregate_names[item->func], arg_len,
+                 col_index >= 0 ? schema->columns[col_index].name : "*");
+        switch (item->func) {
+            case AGG_MIN:
+            case AGG_MAX:   col.type = COL_TYPE_INT;    col.size = sizeof(int);     break;
+            case AGG_AVG:   col.type = COL_TYPE_DOUBLE; col.size = sizeof(double);  break;
+            default:        col.type = COL_TYPE_LONG;   col.size = sizeof(int64_t); break;
+        }
+        add_output_column(output, &col);
+    }
+    for (int i = 0; i < select->num_columns; i++) {
+        if (agg->output_map[i] < 0) agg->output_map[i] = agg->num_group_cols - 1 - agg->output_map[i];
+    }
+    plan->aggregation = agg;
+    plan->output = output;
+    return 0;
+}
+
+static int has_aggregates(const SelectStmt* select) {
+    for (int i = 0; i < select->num_columns; i++) {
+        if (select->columns[i].func != AGG_NONE) return 1;
+    }
+    return select->num_group_by > 0;
+}
+
+/**
+ * Find the output column of an aggregate of the select list.
+ * @return Output column index, or -1 if the list has no such aggregate.
+ */
+static int find_aggregate_output(const QueryPlan* plan, const SelectItem* item) {
+    const PlanAggregation* agg = plan->aggregation;
+    if (!agg) return -1;
+    int col_index = -1;
+    if (item->column.length > 0 && (col_index = find_column_index(plan->schema, item->column)) < 0) return -1;
+    for (int i = 0; i < plan->output->num_columns; i++) {
+        int source = agg->output_map[i];
+        if (source < agg->num_group_cols) continue;
+        const PlanAggregate* aggregate = &agg->aggregates[source - agg->num_group_cols];
+        if (aggregate->func == item->func && aggregate->col_index == col_index) return i;
+    }
+    return -1;
+}
+
+/**
+ * Resolve ORDER BY against the output schema: each key must be a column
+ * (any column for SELECT *) or an aggregate of the select list.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int build_order(QueryPlan* plan, const SelectStmt* select) {
+    if (select->num_order_by == 0) return 0;
+    plan->sort_keys = arena_alloc(&plan->arena, (size_t)select->num_order_by * sizeof(PlanSortKey));
+    if (!plan->sort_keys) {
+        perror("Failed to allocate memory for ORDER BY");
+        return -1;
+    }
+    for (int i = 0; i < select->num_order_by; i++) {
+        const SelectItem* item = &select->order_by[i].item;
+        int col_index = (item->func == AGG_NONE) ? find_column_index(plan->output, item->column)
+                                                 : find_aggregate_output(plan, item);
+        if (col_index == -2) {
+            fprintf(stderr, "Error: ORDER BY column '%.*s' is ambiguous; qualify it with its table.\n",
+                    item->column.length, item->column.start);
+            return -1;
+        }
+        if (col_index < 0) {
+            if (item->func == AGG_NONE) {
+                if (resolve_column(plan->schema, item->column) < 0) return -1;
+                fprintf(stderr, "Error: ORDER BY column '%.*s' is not in the select list.\n",
+                        item->column.length, item->column.start);
+            } else {
+                fprintf(stderr, "Error: ORDER BY %s(%.*s) is not in the select list.\n", aggregate_names[item->func],
+                        item->column.length > 0 ? item->column.length : 1,
+                        item->column.length > 0 ? item->column.start : "*");
+            }
+            return -1;
+        }
+        plan->sort_keys[i] = (PlanSortKey){col_index, select->order_by[i].descending};
+    }
+    plan->num_sort_keys = select->num_order_by;
+    return 0;
+}
+
+/**
+ * Allocate an empty plan over a table (or join row layout) with room for
+ * `max_constants` constants and `num_params` parameters.
+ * @return The plan, or NULL on error (reported).
+ */
+static QueryPlan* new_plan(TableSchema* schema, int max_constants, int num_params) {
+    QueryPlan* plan = calloc(1, sizeof(QueryPlan));
+    if (!plan) {
+        perror("Failed to allocate memory for QueryPlan");
+        return NULL;
+    }
+    arena_init(&plan->arena);
+    plan->schema = schema;
+    plan->output = schema;
+    plan->num_params = num_params;
+    plan->limit = -1;
+    plan->constants = calloc(max_constants > 0 ? (size_t)max_constants : 1, schema->row_size);
+    plan->params = arena_alloc(&plan->arena, (num_params > 0 ? (size_t)num_params : 1) * sizeof(PlanParam));
+    plan->bounds = arena_alloc(&plan->arena, (max_constants > 0 ? (size_t)max_constants : 1) * sizeof(ColumnBound));
+    if (!plan->constants || !plan->params || !plan->bounds) {
+        perror("Failed to allocate memory for query plan");
+        plan_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+/**
+ * Resolve the select list into the plan's output (aggregation, projection,
+ * or the whole row for SELECT *) and its ORDER BY.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int build_output(QueryPlan* plan, const SelectStmt* select) {
+    int status = 0;
+    if (has_aggregates(select)) {
+        status = build_aggregation(plan, select);
+    } else if (!select->select_all) {
+        status = build_projection(plan, select);
+    }
+    return (status == 0) ? build_order(plan, select) : -1;
+}
+
+// --- Joins ---
+
+/**
+ * Row layout of a join: the FROM table's columns followed by the JOIN
+ * table's, each named table.column. The plan owns it (freed by plan_free).
+ */
+static TableSchema* build_join_schema(const TableSchema* left, const TableSchema* right) {
+    TableSchema* schema = calloc(1, sizeof(TableSchema));
+    if (schema) schema->columns = calloc((size_t)(left->num_columns + right->num_columns), sizeof(ColumnDefinition));
+    if (!schema || !schema->columns) {
+        perror("Failed to allocate memory for join schema");
+        free(schema);
+        return NULL;
+    }
+    snprintf(schema->name, sizeof(schema->name), "%.30s JOIN %.25s", left->name, right->name);
+    schema->db = left->db;
+    schema->table_id = -1;
+    schema->joined = 1;
+    schema->pk_column_index = -1;
+    const TableSchema* tables[2] = {left, right};
+    for (int t = 0; t < 2; t++) {
+        for (int i = 0; i < tables[t]->num_columns; i++) {
+            ColumnDefinition* col = &schema->columns[schema->num_columns++];
+            *col = tables[t]->columns[i];
+            snprintf(col->name, sizeof(col->name), "%.31s.%.31s", tables[t]->name, tables[t]->columns[i].name);
+            col->offset += schema->row_size;
+        }
+        schema->row_size += tables[t]->row_size;
+    }
+    schema->record_size = schema->row_size;
+    return schema;
+}
+
+/**
+ * Which join inputs an expression refers to: bit 0 for the FROM table,
+ * bit 1 for the JOIN table.
+ */
+static int expr_tables(const QueryPlan* plan, const Expr* expr) {
+    if (!expr) return 0;
+    if (expr->type == EXPR_COLUMN) {
+        return (find_column_index(plan->join->inputs[0]->schema, expr->text) >= 0 ? 1 : 0) |
+               (find_column_index(plan->join->inputs[1]->schema, expr->text) >= 0 ? 2 : 0);
+    }
+    return expr_tables(plan, expr->left) | expr_tables(plan, expr->right);
+}
+
+static Predicate* and_predicates(QueryPlan* plan, Predicate* left, Predicate* right) {
+    if (!left || !right) return left ? left : right;
+    Predicate* pred = arena_alloc(&plan->arena, sizeof(Predicate));
+    if (!pred) {
+        perror("Failed to allocate memory for predicate");
+        return NULL;
+    }
+    memset(pred, 0, sizeof(Predicate));
+    pred->type = PRED_AND;
+    pred->rhs_col_index = -1;
+    pred->const_row = -1;
+    pred->param_index = -1;
+    pred->left = left;
+    pred->right = right;
+    return pred;
+}
+
+/**
+ * Push each conjunct of the top-level AND chain down to the input whose
+ * table is the only one it mentions; conjuncts over both tables (or
+ * neither) are evaluated on the joined rows.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int split_conjuncts(QueryPlan* plan, const Expr* expr) {
+    if (expr->type == EXPR_AND) {
+        return (split_conjuncts(plan, expr->left) == 0 && split_conjuncts(plan, expr->right) == 0) ? 0 : -1;
+    }
+    int tables = expr_tables(plan, expr);
+    QueryPlan* target = (tables == 1) ? plan->join->inputs[0] : (tables == 2) ? plan->join->inputs[1] : plan;
+    Predicate* pred = build_predicate(target, expr);
+    if (!pred) return -1;
+    target->filter = and_predicates(target, target->filter, pred);
+    return target->filter ? 0 : -1;
+}
+
+/**
+ * Resolve `ON a = b`: one column of each table, of the same type.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int resolve_join_key(QueryPlan* plan, const Expr* on) {
+    JoinPlan* join = plan->join;
+    if (on->type != EXPR_COMPARE || on->op != CMP_EQ || on->left->type != EXPR_COLUMN ||
+        on->right->type != EXPR_COLUMN) {
+        fprintf(stderr, "Error: JOIN ... ON must compare a column of each table with '='.\n");
+        return -1;
+    }
+    const Expr* sides[2] = {on->left, on->right};
+    for (int swap = 0; swap < 2; swap++) {
+        int left = find_column_index(join->inputs[0]->schema, sides[swap]->text);
+        int right = find_column_index(join->inputs[1]->schema, sides[1 - swap]->text);
+        if (left < 0 || right < 0) continue;
+        const ColumnDefinition* left_col = &join->inputs[0]->schema->columns[left];
+        const ColumnDefinition* right_col = &join->inputs[1]->schema->columns[right];
+        if (left_col->type != right_col->type) {
+            fprintf(stderr, "Error: Cannot join columns '%s' and '%s' of different types.\n",
+                    left_col->name, right_col->name);
+            return -1;
+        }
+        join->key_cols[0] = left;
+        join->key_cols[1] = right;
+        return 0;
+    }
+    fprintf(stderr, "Error: JOIN ... ON must compare a column of '%s' with a column of '%s'.\n",
+            join->inputs[0]->schema->name, join->inputs[1]->schema->name);
+    return -1;
+}
+
+/**
+ * Estimated cost of running an input plan, in sequential page reads.
+ */
+static double input_cost(const QueryPlan* input) {
+    switch (input->access) {
+        case ACCESS_POINT_LOOKUP:
+            return PLAN_ROW_FETCH_COST;
+        case ACCESS_INDEX_RANGE_SCAN:
+            return (double)plan_estimate_rows(input) * PLAN_ROW_FETCH_COST;
+        case ACCESS_FULL_SCAN:
+            break;
+    }
+    return (double)input->schema->data_size / IO_ALIGNMENT + 1.0;
+}
+
+/**
+ * Hash join reads both inputs once and hashes the smaller. When one join
+ * column is its table's INT primary key, looking up each row of the other
+ * input in that index is cheaper if the other input is small.
+ */
+static void choose_join_method(QueryPlan* plan) {
+    JoinPlan* join = plan->join;
+    long rows[2] = {plan_estimate_rows(join->inputs[0]), plan_estimate_rows(join->inputs[1])};
+    join->method = JOIN_HASH;
+    join->build_side = (rows[1] <= rows[0]) ? 1 : 0;
+    double best = input_cost(join->inputs[0]) + input_cost(join->inputs[1]);
+    for (int outer = 0; outer < 2; outer++) {
+        const TableSchema* inner = join->inputs[1 - outer]->schema;
+        int key = join->key_cols[1 - outer];
+        if (key != inner->pk_column_index || !inner->pk_index || inner->columns[key].type != COL_TYPE_INT) continue;
+        double cost = input_cost(join->inputs[outer]) + (double)rows[outer] * PLAN_ROW_FETCH_COST;
+        if (cost < best) {
+            best = cost;
+            join->method = JOIN_INDEX_NESTED_LOOP;
+            join->outer_side = outer;
+        }
+    }
+}
+
+/**
+ * Plan `FROM a JOIN b ON key`: each table gets its own input plan (with the
+ * WHERE conjuncts that only concern it, so it can use its index and zone
+ * maps), and the join produces rows in the combined layout.
+ */
+static QueryPlan* plan_join(Database* db, const SelectStmt* select, int num_params) {
+    TableSchema* tables[2] = {resolve_table(db, select->table), resolve_table(db, select->join_table)};
+    if (!tables[0] || !tables[1]) return NULL;
+    if (tables[0] == tables[1]) {
+        fprintf(stderr, "Error: Joining table '%s' with itself is not supported.\n", tables[0]->name);
+        return NULL;
+    }
+    TableSchema* schema = build_join_schema(tables[0], tables[1]);
+    if (!schema) return NULL;
+    int max_constants = count_comparisons(select->where);
+    QueryPlan* plan = new_plan(schema, max_constants, num_params);
+    if (!plan) {
+        free(schema->columns);
+        free(schema);
+        return NULL;
+    }
+    if (!(plan->join = arena_alloc(&plan->arena, sizeof(JoinPlan)))) {
+        perror("Failed to allocate memory for join plan");
+        free(schema->columns);
+        free(schema);
+        plan_free(plan);
+        return NULL;
+    }
+    memset(plan->join, 0, sizeof(JoinPlan));
+    plan->join->memory_budget = JOIN_MEMORY_BUDGET;
+    for (int i = 0; i < 2; i++) {
+        if (!(plan->join->inputs[i] = new_plan(tables[i], max_constants, num_params))) {
+            plan_free(plan);
+            return NULL;
+        }
+        plan->join->inputs[i]->params = plan->params; // Parameters are numbered across the statement
+    }
+
+    if (resolve_join_key(plan, select->join_on) != 0 || build_output(plan, select) != 0 ||
+        (select->where && split_conjuncts(plan, select->where) != 0)) {
+        plan_free(plan);
+        return NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        QueryPlan* input = plan->join->inputs[i];
+        if (input->filter) collect_bounds(input, input->filter);
+        choose_access_path(input);
+    }
+    choose_join_method(plan);
+    plan->limit = select->limit;
+    return plan;
+}
+
+/**
+ * Plan a SELECT: resolve the table and WHERE clause and pick an access path.
+ * @param db Database the tables are looked up in.
+ * @param select Parsed statement (only needed during the call).
+ * @param num_params Number of '?' parameters in the statement.
+ * @return The plan, or NULL on error (reported).
+ */
+QueryPlan* plan_select(Database* db, const SelectStmt* select, int num_params) {
+    if (select->join_on) return plan_join(db, select, num_params);
+    TableSchema* schema = resolve_table(db, select->table);
+    if (!schema) return NULL;
+
+    QueryPlan* plan = new_plan(schema, count_comparisons(select->where), num_params);
+    if (!plan) return NULL;
+    if (build_output(plan, select) != 0 ||
+        (select->where && !(plan->filter = build_predicate(plan, select->where)))) {
+        plan_free(plan);
+        return NULL;
+    }
+    if (plan->filter) collect_bounds(plan, plan->filter);
+    plan->limit = select->limit;
+    choose_access_path(plan);
+    choose_sort_order(plan);
+    return plan;
+}
+
+void plan_free(QueryPlan* plan) {
+    if (!plan) return;
+    if (plan->join) { // Owns the joined row layout; a table may already be dropped
+        plan_free(plan->join->inputs[0]);
+        plan_free(plan->join->inputs[1]);
+        free(plan->schema->columns);
+        free(plan->schema);
+    }
+    arena_free(&plan->arena);
+    free(plan->constants);
+    free(plan);
+}
+
+// --- EXPLAIN ---
+
+static void explain_operand(const QueryPlan* plan, const Predicate* pred, FILE* out) {
+    const ColumnDefinition* col = &plan->schema->columns[pred->col_index];
+    if (pred->rhs_col_index >= 0) {
+        fprintf(out, "%s", plan->schema->columns[pred->rhs_col_index].name);
+    } else if (pred->param_index >= 0) {
+        fprintf(out, "$%d", pred->param_index + 1);
+    } else if (col->type == COL_TYPE_INT) {
+        fprintf(out, "%d", constant_int(plan, pred->const_row, pred->col_index));
+    } else {
+        const char* text = plan_constant(plan, pred->const_row) + col->offset;
+        fprintf(out, "'%.*s'", (int)strnlen(text, col->size), text);
+    }
+}
+
+static void explain_predicate(const QueryPlan* plan, const Predicate* pred, FILE* out) {
+    static const char* op_names[] = {"=", "!=", "<", "<=", ">", ">="};
+    switch (pred->type) {
+        case PRED_AND:
+        case PRED_OR:
+            fprintf(out, "(");
+            explain_predicate(plan, pred->left, out);
+            fprintf(out, pred->type == PRED_AND ? " AND " : " OR ");
+            explain_predicate(plan, pred->right, out);
+            fprintf(out, ")");
+            break;
+        case PRED_NOT:
+            fprintf(out, "NOT ");
+            explain_predicate(plan, pred->left, out);
+            break;
+        case PRED_COMPARE:
+            fprintf(out, "%s %s ", plan->schema->columns[pred->col_index].name, op_names[pred->op]);
+            explain_operand(plan, pred, out);
+            break;
+    }
+}
+
+static void explain_aggregation(const QueryPlan* plan, FILE* out, const char* indent) {
+    const PlanAggregation* agg = plan->aggregation;
+    fprintf(out, "%s  Hash Aggregate:", indent);
+    int listed = 0;
+    for (int i = 0; i < plan->output->num_columns; i++) {
+        if (agg->output_map[i] < agg->num_group_cols) continue;
+        fprintf(out, "%s %s", listed++ ? "," : "", plan->output->columns[i].name);
+    }
+    for (int g = 0; g < agg->num_group_cols; g++) {
+        fprintf(out, g ? ", %s" : " grouped by %s", plan->schema->columns[agg->group_cols[g]].name);
+    }
+    if (!plan->join && plan->access == ACCESS_FULL_SCAN && plan_scan_threads(plan) > 1) {
+        fprintf(out, " (partial tables per worker, merged)");
+    }
+    fprintf(out, "\n");
+
+    // Groups: product of the key columns' distinct counts, at most the row estimate
+    if (agg->num_group_cols > 0 && plan->schema->stats) {
+        double groups = 1.0;
+        for (int g = 0; g < agg->num_group_cols; g++) {
+            groups *= (double)stats_distinct(plan->schema->stats, agg->group_cols[g]);
+        }
+        long rows = plan_estimate_rows(plan);
+        fprintf(out, "%s  Estimated groups: %ld\n", indent, groups < (double)rows ? round_rows(groups) : rows);
+    }
+}
+
+static void explain_sort(const QueryPlan* plan, FILE* out, const char* indent) {
+    fprintf(out, "%s  %s:", indent, plan->index_order ? "Order" : "Sort");
+    for (int i = 0; i < plan->num_sort_keys; i++) {
+        fprintf(out, "%s %s%s", i ? "," : "", plan->output->columns[plan->sort_keys[i].col_index].name,
+                plan->sort_keys[i].descending ? " DESC" : "");
+    }
+    if (plan->index_order) {
+        fprintf(out, " (primary key index order; no sort)\n");
+    } else if (plan->limit > 0 &&
+               (size_t)plan->limit <= sort_memory_records(plan->output->row_size, SORT_MEMORY_BUDGET)) {
+        fprintf(out, " (top-N heap of %ld rows)\n", plan->limit);
+    } else {
+        fprintf(out, " (external merge sort; spills runs to disk over %d MiB)\n", SORT_MEMORY_BUDGET / (1024 * 1024));
+    }
+}
+
+static void explain_access(const QueryPlan* plan, FILE* out, const char* indent) {
+    const TableSchema* schema = plan->schema;
+    const char* pk_name = (schema->pk_column_index >= 0) ? schema->columns[schema->pk_column_index].name : "";
+    int low = INT_MIN, high = INT_MAX;
+    int has_params = 0;
+    for (int i = 0; i < plan->num_bounds; i++) has_params |= (plan->bounds[i].param_index >= 0);
+
+    switch (plan->access) {
+        case ACCESS_POINT_LOOKUP:
+            fprintf(out, "%sPoint Lookup on %s using primary key index (%s)\n", indent, schema->name, pk_name);
+            break;
+        case ACCESS_INDEX_RANGE_SCAN:
+            fprintf(out, "%sIndex Range Scan on %s using primary key index (%s", indent, schema->name, pk_name);
+            if (!has_params) {
+                if (plan_column_range(plan, schema->pk_column_index, &low, &high)) {
+                    fprintf(out, " in [%d, %d]", low, high);
+                } else {
+                    fprintf(out, ": empty range");
+                }
+            }
+            fprintf(out, ")\n");
+            break;
+        case ACCESS_FULL_SCAN: {
+            int threads = plan_scan_threads(plan);
+            if (threads > 1) {
+                fprintf(out, "%sParallel Full Scan on %s (%d workers)\n", indent, schema->name, threads);
+            } else {
+                fprintf(out, "%sFull Scan on %s\n", indent, schema->name);
+            }
+            int pruning = 0;
+            for (int i = 0; i < plan->num_bounds && schema->zone_map; i++) {
+                int seen = 0;
+                for (int j = 0; j < i; j++) seen |= (plan->bounds[j].col_index == plan->bounds[i].col_index);
+                if (seen) continue;
+                if (!pruning) fprintf(out, "%s  Zone map pruning on:", indent);
+                fprintf(out, "%s %s", pruning ? "," : "", schema->columns[plan->bounds[i].col_index].name);
+                pruning = 1;
+            }
+            if (pruning) fprintf(out, "\n");
+            break;
+        }
+    }
+}
+
+static void explain_plan(const QueryPlan* plan, FILE* out, const char* indent);
+
+static void explain_join(const QueryPlan* plan, FILE* out, const char* indent) {
+    const JoinPlan* join = plan->join;
+    const QueryPlan* inputs[2] = {join->inputs[0], join->inputs[1]};
+    const char* keys[2] = {inputs[0]->schema->columns[join->key_cols[0]].name,
+                           inputs[1]->schema->columns[join->key_cols[1]].name};
+    char child[64];
+    snprintf(child, sizeof(child), "%s    ", indent);
+    if (join->method == JOIN_INDEX_NESTED_LOOP) {
+        const QueryPlan* inner = inputs[1 - join->outer_side];
+        fprintf(out, "%sIndex Nested-Loop Join on %s.%s = %s.%s (lookups in %s primary key index)\n", indent,
+                inputs[0]->schema->name, keys[0], inputs[1]->schema->name, keys[1], inner->schema->name);
+        fprintf(out, "%s  Outer input:\n", indent);
+        explain_plan(inputs[join->outer_side], out, child);
+        if (inner->filter) {
+            fprintf(out, "%s  Inner filter: ", indent);
+            explain_predicate(inner, inner->filter, out);
+            fprintf(out, "\n");
+        }
+        return;
+    }
+    fprintf(out, "%sHash Join on %s.%s = %s.%s (build side: %s; spills to disk over %zu MiB)\n", indent,
+            inputs[0]->schema->name, keys[0], inputs[1]->schema->name, keys[1],
+            inputs[join->build_side]->schema->name, join->memory_budget / (1024 * 1024));
+    fprintf(out, "%s  Build input:\n", indent);
+    explain_plan(inputs[join->build_side], out, child);
+    fprintf(out, "%s  Probe input:\n", indent);
+    explain_plan(inputs[1 - join->build_side], out, child);
+}
+
+static void explain_plan(const QueryPlan* plan, FILE* out, const char* indent) {
+    if (plan->join) {
+        explain_join(plan, out, indent);
+    } else {
+        explain_access(plan, out, indent);
+    }
+    if (plan->projection) {
+        fprintf(out, "%s  Output:", indent);
+        for (int i = 0; i < plan->output->num_columns; i++) {
+            fprintf(out, "%s %s", i ? "," : "", plan->output->columns[i].name);
+        }
+        fprintf(out, "\n");
+    }
+    if (plan->filter) {
+        fprintf(out, "%s  Filter: ", indent);
+        explain_predicate(plan, plan->filter, out);
+        fprintf(out, "\n");
+    }
+    if (plan->join) {
+        fprintf(out, "%s  Estimated rows: %ld\n", indent, plan_estimate_rows(plan));
+    } else {
+        fprintf(out, "%s  Estimated rows: %ld of ~%ld (%s)\n", indent, plan_estimate_rows(plan), plan_table_rows(plan),
+                plan->schema->stats ? "ANALYZE statistics" : "no statistics, run ANALYZE");
+    }
+    if (plan->aggregation) explain_aggregation(plan, out, indent);
+    if (plan->sort_keys) explain_sort(plan, out, indent);
+    if (plan->limit >= 0) fprintf(out, "%s  Limit: %ld\n", indent, plan->limit);
+}
+
+/**
+ * Print the access path (or join and its inputs), filter and row estimate
+ * of a plan.
+ */
+void plan_explain(const QueryPlan* plan, FILE* out) {
+    explain_plan(plan, out, "");
+}
@@ -0,0 +1,168 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "../util/arena.h"
+
+// --- Query Planner ---
+// Turns a parsed SELECT into a plan: the WHERE clause is resolved against
+// the schema (columns become indexes, literals are encoded into constant
+// rows) and an access path is chosen:
+//   point lookup      pk = value somewhere in the top-level AND chain
+//   index range scan  pk bounded by <, <=, >, >= and cheaper than a scan
+//   full scan         everything else; zone maps prune blocks using the
+//                     INT bounds, and large tables are split across threads
+// The whole WHERE clause is still evaluated on every row the access path
+// produces, so the path only has to return a superset of the matches.
+// A column list is resolved into an output schema: the executor copies just
+// those fields out of each matching row, so consumers only see (and format)
+// the columns that were asked for.
+//
+// A join plans each table as an input of its own (WHERE conjuncts that
+// mention only that table are pushed down to it) and picks a hash join or,
+// when one join column is an INT primary key and the other input is small,
+// an index nested-loop join. Joined rows hold both tables' columns, named
+// table.column; the remaining conditions, projection and aggregation
+// apply to them as to single-table rows. With aggregates or GROUP BY, matching
+// rows are folded into a hash table of groups instead, and the output rows
+// are the groups (COUNT and SUM are LONG, AVG is DOUBLE). ORDER BY names
+// columns or aggregates of the select list; the output rows are sorted by
+// an external merge sort that spills runs to disk past SORT_MEMORY_BUDGET,
+// or with a LIMIT by a heap of the first LIMIT rows. Ordering by the
+// primary key needs no sort when the rows come from the index, and a LIMIT
+// makes a scan walk the index (stopping early) when that is cheaper.
+// Costs are based on row estimates from ANALYZE statistics (histograms and
+// distinct counts) when the table has them, else on the zone maps' min/max
+// values and default selectivities.
+
+typedef enum {
+    ACCESS_POINT_LOOKUP,
+    ACCESS_INDEX_RANGE_SCAN,
+    ACCESS_FULL_SCAN
+} AccessPath;
+
+typedef enum {
+    PRED_COMPARE,
+    PRED_AND,
+    PRED_OR,
+    PRED_NOT
+} PredicateType;
+
+typedef struct Predicate {
+    PredicateType type;
+    CompareOp op;            // PRED_COMPARE: column op (column | constant)
+    int col_index;           // Left column
+    int rhs_col_index;       // Right column, or -1 when comparing with a constant
+    int const_row;           // Constant: row of plan->constants holding it in column col_index
+    int param_index;         // Constant bound from a '?' parameter, else -1
+    struct Predicate* left;  // AND/OR/NOT operands
+    struct Predicate* right;
+} Predicate;
+
+// `column op constant` on an INT column from the top-level AND chain of the
+// WHERE clause; every matching row satisfies it.
+typedef struct {
+    int col_index;
+    CompareOp op;
+    int const_row;
+    int param_index;
+} ColumnBound;
+
+// Where parameter `i` is bound: column col_index of a constant row of the
+// plan (or join input) that uses it.
+typedef struct {
+    const TableSchema* schema;
+    int col_index;
+    char* row_data;
+} PlanParam;
+
+// One aggregate of the select list.
+typedef struct {
+    AggregateFunc func;
+    int col_index;           // Argument column; -1 for COUNT(*)
+} PlanAggregate;
+
+// GROUP BY key and aggregates. Output column i is group column
+// output_map[i] when that is < num_group_cols, else aggregate
+// output_map[i] - num_group_cols.
+typedef struct {
+    int* group_cols;
+    int num_group_cols;
+    PlanAggregate* aggregates;
+    int num_aggregates;
+    int* output_map;
+} PlanAggregation;
+
+// ORDER BY key: a column of the output schema.
+typedef struct {
+    int col_index;
+    int descending;
+} PlanSortKey;
+
+typedef enum {
+    JOIN_HASH,               // Hash the build input, stream the other past it
+    JOIN_INDEX_NESTED_LOOP   // Look up each outer row in the other table's pk index
+} JoinMethod;
+
+typedef struct JoinPlan {
+    JoinMethod method;
+    struct QueryPlan* inputs[2]; // FROM and JOIN table, each with its own WHERE conjuncts
+    int key_cols[2];         // ON column in each input's table
+    int build_side;          // JOIN_HASH: input loaded into the hash table (the smaller)
+    int outer_side;          // JOIN_INDEX_NESTED_LOOP: input scanned; the other is looked up
+    size_t memory_budget;    // JOIN_HASH: build bytes held in memory before spilling (JOIN_MEMORY_BUDGET)
+} JoinPlan;
+
+typedef struct QueryPlan {
+    TableSchema* schema;
+    AccessPath access;
+    Predicate* filter;       // Whole WHERE clause; NULL matches every row
+    ColumnBound* bounds;
+    int num_bounds;
+    char* constants;         // num_constants rows of row_size bytes
+    int num_constants;
+    PlanParam* params;
+    int num_params;
+    TableSchema* output;     // Shape of result rows (schema itself for SELECT *)
+    int* projection;         // Source column of each output column; NULL for SELECT *
+    PlanAggregation* aggregation; // NULL unless the query aggregates (then projection is NULL)
+    JoinPlan* join;          // Two-table join: schema is the joined row layout, access unused
+    PlanSortKey* sort_keys;  // ORDER BY; NULL if the output is unordered
+    int num_sort_keys;
+    int index_order;         // Rows arrive in ORDER BY order (pk index walk): no sort
+    long limit;              // LIMIT; -1 if absent
+    Arena arena;             // Predicates, bounds, params and the output schema
+} QueryPlan;
+
+// Plan a SELECT (num_params = '?' count of the statement). Errors are
+// reported; returns NULL on error.
+QueryPlan* plan_select(struct Database* db, const SelectStmt* select, int num_params);
+void plan_free(QueryPlan* plan);
+
+// Row of plan->constants holding constant `const_row`
+char* plan_constant(const QueryPlan* plan, int const_row);
+
+// Narrow [*low, *high] to the values of INT column `col_index` allowed by
+// the bounds. Returns 0 if no value can match, else 1.
+int plan_column_range(const QueryPlan* plan, int col_index, int* low, int* high);
+
+// Estimated rows in the table and rows the plan returns (current constants).
+long plan_table_rows(const QueryPlan* plan);
+long plan_estimate_rows(const QueryPlan* plan);
+
+// Worker threads a full scan of the table would use right now.
+int plan_scan_threads(const QueryPlan* plan);
+
+// Describe the plan (EXPLAIN).
+void plan_explain(const QueryPlan* plan, FILE* out);
+
+// Name resolution; errors are reported. resolve_column returns -1 if absent.
+TableSchema* resolve_table(struct Database* db, Span name);
+int resolve_column(const TableSchema* schema, Span name);
+
+// Encode a literal (integer, string or bare word) into column `col_index`
+// of a row buffer. Returns 0 on success, -1 on error (reported).
+int encode_literal(const TableSchema* schema, void* row_data, int col_index, const Expr* value);
+
+#endif // PLANNER_H
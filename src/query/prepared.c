@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prepared.h"
+#include "parser.h"
+#include "planner.h"
+#include "../database/database.h"
+
+#define MAX_LITERAL_LEN 1024 // Longest literal value accepted in statement text
+
+// --- Prepare ---
+
+static PreparedStatement* new_statement(StatementType type, TableSchema* schema, int num_rows, int num_params) {
+    PreparedStatement* stmt = calloc(1, sizeof(PreparedStatement));
+    if (!stmt) {
+        perror("Failed to allocate memory for PreparedStatement");
+        return NULL;
+    }
+    stmt->rows = calloc(num_rows > 0 ? (size_t)num_rows : 1, schema->row_size);
+    stmt->params = calloc(num_params > 0 ? (size_t)num_params : 1, sizeof(StatementParam));
+    if (!stmt->rows || !stmt->params) {
+        perror("Failed to allocate memory for statement buffers");
+        stmt_finalize(stmt);
+        return NULL;
+    }
+    stmt->type = type;
+    stmt->schema = schema;
+    stmt->num_rows = num_rows;
+    stmt->num_params = num_params;
+    return stmt;
+}
+
+/**
+ * Encode a value expression into column `col_index` of a row, or record it
+ * as a parameter slot if it is a '?'.
+ * @return 0 on success, -1 on error.
+ */
+static int compile_value(PreparedStatement* stmt, const Expr* value, char* row_data, int col_index) {
+    if (value->type == EXPR_PARAM) {
+        stmt->params[value->param_index].schema = stmt->schema;
+        stmt->params[value->param_index].column = &stmt->schema->columns[col_index];
+        stmt->params[value->param_index].row_data = row_data;
+        return 0;
+    }
+    return encode_literal(stmt->schema, row_data, col_index, value);
+}
+
+/**
+ * Resolve the column list of an INSERT into the table column each value
+ * goes to (all columns in order if there is no list).
+ * @return Number of values per row, or -1 on error (reported).
+ */
+static int resolve_insert_targets(const TableSchema* schema, const InsertStmt* ins, int* targets) {
+    int width;
+    if (ins->columns) {
+        width = ins->num_columns;
+        if (width > schema->num_columns) {
+            fprintf(stderr, "Error: Table '%s' has only %d columns.\n", schema->name, schema->num_columns);
+            return -1;
+        }
+        for (int i = 0; i < width; i++) {
+            if ((targets[i] = resolve_column(schema, ins->columns[i])) < 0) return -1;
+            for (int j = 0; j < i; j++) {
+                if (targets[j] == targets[i]) {
+                    fprintf(stderr, "Error: Column '%s' listed twice.\n", schema->columns[targets[i]].name);
+                    return -1;
+                }
+            }
+        }
+        if (schema->pk_column_index >= 0) {
+            int has_pk = 0;
+            for (int i = 0; i < width; i++) has_pk |= (targets[i] == schema->pk_column_index);
+            if (!has_pk) {
+                fprintf(stderr, "Error: INSERT into '%s' must set primary key column '%s'.\n",
+                        schema->name, schema->columns[schema->pk_column_index].name);
+                return -1;
+            }
+        }
+    } else {
+        width = schema->num_columns;
+        for (int i = 0; i < width; i++) targets[i] = i;
+    }
+    if (ins->row_width != width) {
+        fprintf(stderr, "Error: INSERT into '%s' needs exactly %d values per tuple.\n", schema->name, width);
+        return -1;
+    }
+    return width;
+}
+
+/**
+ * INSERT INTO table [(col, ...)] VALUES (v|?, ...)[, ...]
+ * Columns left out of the column list are zero.
+ */
+static PreparedStatement* compile_insert(Database* db, const InsertStmt* ins, int num_params) {
+    TableSchema* schema = resolve_table(db, ins->table);
+    if (!schema) return NULL;
+
+    int* targets = malloc(((size_t)schema->num_columns + 1) * sizeof(int));
+    if (!targets) {
+        perror("Failed to allocate memory for INSERT columns");
+        return NULL;
+    }
+    int width = resolve_insert_targets(schema, ins, targets);
+    PreparedStatement* stmt = (width >= 0) ? new_statement(STMT_INSERT, schema, ins->num_rows, num_params) : NULL;
+    for (int r = 0; stmt && r < ins->num_rows; r++) {
+        for (int i = 0; i < width; i++) {
+            char* row_data = stmt->rows + (size_t)r * schema->row_size;
+            if (compile_value(stmt, ins->values[(size_t)r * width + i], row_data, targets[i]) != 0) {
+                stmt_finalize(stmt);
+                stmt = NULL;
+                break;
+            }
+        }
+    }
+    free(targets);
+    if (stmt) {
+        stmt->table_ids[0] = schema->table_id;
+        stmt->num_tables = 1;
+    }
+    return stmt;
+}
+
+/**
+ * SELECT * FROM table [WHERE condition]: planned now, parameters are bound
+ * into the plan's constants.
+ */
+static PreparedStatement* compile_select(Database* db, const SelectStmt* sel, int num_params) {
+    QueryPlan* plan = plan_select(db, sel, num_params);
+    if (!plan) return NULL;
+    PreparedStatement* stmt = new_statement(STMT_SELECT, plan->schema, 0, num_params);
+    if (!stmt) {
+        plan_free(plan);
+        return NULL;
+    }
+    stmt->plan = plan;
+    if (plan->join) {
+        stmt->table_ids[0] = plan->join->inputs[0]->schema->table_id;
+        stmt->table_ids[1] = plan->join->inputs[1]->schema->table_id;
+        stmt->num_tables = 2;
+    } else {
+        stmt->table_ids[0] = plan->schema->table_id;
+        stmt->num_tables = 1;
+    }
+    for (int i = 0; i < num_params; i++) {
+        stmt->params[i].schema = plan->params[i].schema;
+        stmt->params[i].column = &plan->params[i].schema->columns[plan->params[i].col_index];
+        stmt->params[i].row_data = plan->params[i].row_data;
+    }
+    return stmt;
+}
+
+/**
+ * Statement holding a table definition (CREATE/DROP TABLE), with room for
+ * `num_columns` columns.
+ */
+static PreparedStatement* new_ddl_statement(StatementType type, Span table, int num_columns) {
+    if (table.length >= MAX_TABLE_NAME_LEN) {
+        fprintf(stderr, "Error: Table name '%.*s' is too long (max %d characters).\n",
+                table.length, table.start, MAX_TABLE_NAME_LEN - 1);
+        return NULL;
+    }
+    PreparedStatement* stmt = calloc(1, sizeof(PreparedStatement));
+    TableSchema* schema = calloc(1, sizeof(TableSchema));
+    ColumnDefinition* columns = calloc(num_columns > 0 ? (size_t)num_columns : 1, sizeof(ColumnDefinition));
+    if (!stmt || !schema || !columns) {
+        perror("Failed to allocate memory for table definition");
+        free(stmt);
+        free(schema);
+        free(columns);
+        return NULL;
+    }
+    stmt->type = type;
+    stmt->schema = schema;
+    schema->columns = columns;
+    schema->table_id = -1;
+    schema->pk_column_index = -1;
+    span_copy(table, schema->name, sizeof(schema->name));
+    return stmt;
+}
+
+/**
+ * Lay out one CREATE TABLE column after the previous ones, as the catalog
+ * loader would.
+ * @return 0 on success, -1 on error (reported).
+ */
+static int define_column(TableSchema* schema, const ColumnDefAst* def) {
+    ColumnDefinition* col = &schema->columns[schema->num_columns];
+    if (def->name.length >= MAX_COLUMN_NAME_LEN) {
+        fprintf(stderr, "Error: Column name '%.*s' is too long (max %d characters).\n",
+                def->name.length, def->name.start, MAX_COLUMN_NAME_LEN - 1);
+        return -1;
+    }
+    span_copy(def->name, col->name, sizeof(col->name));
+    if (find_column(schema, col->name)) { // Only the columns defined so far are searched
+        fprintf(stderr, "Error: Column '%s' defined twice.\n", col->name);
+        return -1;
+    }
+    col->type = def->type;
+    if (def->type == COL_TYPE_STRING) {
+        if (def->size <= 0 || def->size > MAX_STRING_COLUMN_SIZE) {
+            fprintf(stderr, "Error: STRING column '%s' needs a length from 1 to %d.\n", col->name, MAX_STRING_COLUMN_SIZE);
+            return -1;
+        }
+        col->size = (size_t)def->size;
+    } else {
+        col->size = sizeof(int);
+    }
+    if (def->primary_key) {
+        if (schema->pk_column_index != -1) {
+            fprintf(stderr, "Error: Table '%s' has more than one primary key.\n", schema->name);
+            return -1;
+        }
+        if (col->type != COL_TYPE_INT) {
+            fprintf(stderr, "Error: Primary key column '%s' must be INT.\n", col->name);
+            return -1;
+        }
+        col->is_primary_key = 1;
+        schema->pk_column_index = schema->num_columns;
+    }
+    col->offset = schema->row_size;
+    schema->row_size += col->size;
+    schema->record_size = schema->row_size + ROW_CHECKSUM_SIZE;
+    schema->num_columns++;
+    return 0;
+}
+
+/**
+ * CREATE TABLE table (col type [PRIMARY KEY], ...) [WITH (option, ...)]
+ * The definition is checked now; the table is created on execution.
+ */
+static PreparedStatement* compile_create_table(const CreateTableStmt* create) {
+    PreparedStatement* stmt = new_ddl_statement(STMT_CREATE_TABLE, create->table, create->num_columns);
+    if (!stmt) return NULL;
+    TableSchema* schema = stmt->schema;
+    for (int i = 0; i < create->num_options; i++) {
+        if (span_equals(create->options[i], "cow")) {
+            schema->pk_index_flags |= BTREE_FLAG_COW;
+        } else if (span_equals(create->options[i], "direct")) {
+            schema->io_flags |= IO_OPEN_DIRECT;
+        } else {
+            fprintf(stderr, "Error: Unknown table option '%.*s' (expected cow or direct).\n",
+                    create->options[i].length, create->options[i].start);
+            stmt_finalize(stmt);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < create->num_columns; i++) {
+        if (define_column(schema, &create->columns[i]) != 0) {
+            stmt_finalize(stmt);
+            return NULL;
+        }
+    }
+    return stmt;
+}
+
+/**
+ * Parse a statement and resolve its table and columns.
+ * @param db Database the statement runs against.
+ * @param sql Statement text.
+ * @return The prepared statement, or NULL on error.
+ */
+PreparedStatement* stmt_prepare(Database* db, const char* sql) {
+    if (!db || !sql) return NULL;
+    char error[PARSE_ERROR_LEN];
+    Arena parse_arena; // AST nodes only live until the statement is resolved
+    arena_init(&parse_arena);
+
+    PreparedStatement* stmt = NULL;
+    Statement* ast = parse_statement(sql, &parse_arena, error, sizeof(error));
+    if (!ast) {
+        fprintf(stderr, "%s\n", error);
+    } else if (ast->kind == AST_INSERT) {
+        stmt = compile_insert(db, &ast->insert, ast->num_params);
+    } else if (ast->kind == AST_SELECT) {
+        stmt = compile_select(db, &ast->select, ast->num_params);
+    } else if (ast->kind == AST_CREATE_TABLE) {
+        stmt = compile_create_table(&ast->create_table);
+    } else if (ast->kind == AST_DROP_TABLE) {
+        stmt = new_ddl_statement(STMT_DROP_TABLE, ast->drop_table.table, 0);
+    } else {
+        fprintf(stderr, "Error: UPDATE and DELETE are not supported yet.\n");
+    }
+    if (stmt) stmt->db = db;
+    arena_free(&parse_arena);
+    return stmt;
+}
+
+void stmt_finalize(PreparedStatement* stmt) {
+    if (!stmt) return;
+    if (stmt->type == STMT_CREATE_TABLE || stmt->type == STMT_DROP_TABLE) {
+        free(stmt->schema->columns);
+        free(stmt->schema);
+    }
+    plan_free(stmt->plan);
+    free(stmt->params);
+    free(stmt->rows);
+    free(stmt);
+}
+
+// --- Bind & Execute ---
+
+static int check_param(const PreparedStatement* stmt, int index) {
+    if (!stmt || index < 0 || index >= stmt->num_params) {
+        fprintf(stderr, "Error: Parameter index %d out of range (statement has %d).\n",
+                index, stmt ? stmt->num_params : 0);
+        return -1;
+    }
+    return stmt_check_tables(stmt); // Parameters point into the tables' columns
+}
+
+/**
+ * Bind an integer parameter.
+ * @return 0 on success, -1 on error.
+ */
+int stmt_bind_int(PreparedStatement* stmt, int index, int value) {
+    if (check_param(stmt, index) != 0) return -1;
+    StatementParam* param = &stmt->params[index];
+    if (param->column->type != COL_TYPE_INT) {
+        fprintf(stderr, "Error: Parameter %d binds to non-INT column '%s'.\n", index, param->column->name);
+        return -1;
+    }
+    memcpy(param->row_data + param->column->offset, &value, sizeof(int));
+    param->bound = 1;
+    return 0;
+}
+
+/**
+ * Bind a parameter from text, converted according to its column's type.
+ * @return 0 on success, -1 on error.
+ */
+int stmt_bind_text(PreparedStatement* stmt, int index, const char* value) {
+    if (check_param(stmt, index) != 0) return -1;
+    StatementParam* param = &stmt->params[index];
+    int col_index = (int)(param->column - param->schema->columns);
+    if (set_value_by_index(param->schema, param->row_data, col_index, value) != 0) return -1;
+    param->bound = 1;
+    return 0;
+}
+
+/**
+ * Execute a prepared statement with its current bindings.
+ * @param stmt The statement.
+ * @param sink SELECT only: receives each result row (see execute_plan).
+ * @param ctx Passed through to the sink.
+ * @return INSERT: 0 on success, 1 for duplicate key, -1 on error.
+ *         SELECT: number of rows, or -1 on error.
+ */
+long stmt_execute(PreparedStatement* stmt, RowSink sink, void* ctx) {
+    if (!stmt) return -1;
+    for (int i = 0; i < stmt->num_params; i++) {
+        if (!stmt->params[i].bound) {
+            fprintf(stderr, "Error: Not all %d parameter(s) are bound.\n", stmt->num_params);
+            return -1;
+        }
+    }
+    if (stmt_check_tables(stmt) != 0) return -1;
+    switch (stmt->type) {
+        case STMT_INSERT:
+            if (stmt->num_rows == 1) return insert_row_into(stmt->schema, stmt->rows);
+            return insert_rows_into(stmt->schema, stmt->rows, stmt->num_rows);
+        case STMT_SELECT:
+            return execute_plan(stmt->plan, sink, ctx);
+        case STMT_CREATE_TABLE:
+            return create_table(stmt->db, stmt->schema);
+        case STMT_DROP_TABLE:
+            return drop_table(stmt->db, stmt->schema->name);
+    }
+    return -1;
+}
+
+/**
+ * Check that the tables a statement was prepared against still exist. IDs
+ * are never reused, so a table dropped and created again under the same
+ * name does not count.
+ * @return 0 if they all exist, -1 if one was dropped (reported).
+ */
+int stmt_check_tables(const PreparedStatement* stmt) {
+    for (int i = 0; i < stmt->num_tables; i++) {
+        if (!table_by_id(stmt->db, stmt->table_ids[i])) {
+            fprintf(stderr, "Error: A table used by this statement was dropped; prepare it again.\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// --- Named Statements ---
+// Kept in the database handle, since they point into its tables.
+
+static int find_named(const Database* db, const char* name) {
+    for (int i = 0; i < db->num_statements; i++) {
+        if (strcmp(db->statements[i]->name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Register a statement under a name, replacing any statement with that name.
+ * @return 0 on success, -1 on error (name too long or registry full).
+ */
+int stmt_register(Database* db, const char* name, PreparedStatement* stmt) {
+    if (!name || !stmt || strlen(name) >= MAX_STATEMENT_NAME_LEN) {
+        fprintf(stderr, "Error: Invalid prepared statement name.\n");
+        return -1;
+    }
+    int slot = find_named(db, name);
+    if (slot >= 0) {
+        if (db->statements[slot] != stmt) stmt_finalize(db->statements[slot]);
+    } else {
+        if (db->num_statements >= MAX_PREPARED_STATEMENTS) {
+            fprintf(stderr, "Error: Too many prepared statements (max %d).\n", MAX_PREPARED_STATEMENTS);
+            return -1;
+        }
+        slot = db->num_statements++;
+    }
+    strcpy(stmt->name, name);
+    db->statements[slot] = stmt;
+    return 0;
+}
+
+PreparedStatement* stmt_find(Database* db, const char* name) {
+    int slot = find_named(db, name);
+    return (slot >= 0) ? db->statements[slot] : NULL;
+}
+
+int stmt_deallocate(Database* db, const char* name) {
+    int slot = find_named(db, name);
+    if (slot < 0) return 1;
+    stmt_finalize(db->statements[slot]);
+    db->statements[slot] = db->statements[--db->num_statements];
+    return 0;
+}
+
+void stmt_deallocate_all(Database* db) {
+    for (int i = 0; i < db->num_statements; i++) {
+        stmt_finalize(db->statements[i]);
+    }
+    db->num_statements = 0;
+}
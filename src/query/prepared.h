@@ -0,0 +1,86 @@
+#ifndef PREPARED_H
+#define PREPARED_H
+
+#include "../structs.h"
+#include "planner.h"
+#include "executor.h"
+
+// --- Prepared Statements ---
+// A statement is parsed once; its table and columns are resolved to schema
+// pointers and its literal values are encoded into row buffers up front.
+// SELECTs are planned at the same time. Executing a statement only copies
+// bound parameters into those buffers and runs the rows or the plan, so
+// repeated queries skip parsing, name lookups and value conversion of the
+// fixed parts. The REPL runs every INSERT and SELECT through here as an
+// unnamed statement.
+//
+// Executable forms ('?' marks a parameter, numbered from 0 left to right):
+//   INSERT INTO table [(col, ...)] VALUES (v|?, ...)[, (v|?, ...) ...]
+//   SELECT * | item, ... FROM table [JOIN table2 ON col = col] [WHERE condition]
+//          [GROUP BY col, ...] [ORDER BY item [ASC|DESC], ...] [LIMIT n]
+//     (item: column, COUNT(*) or COUNT/SUM/MIN/MAX/AVG(column))
+//   CREATE TABLE table (col INT [PRIMARY KEY] | col STRING(n), ...) [WITH (cow, direct)]
+//   DROP TABLE table
+//
+// A statement remembers the IDs of the tables it uses; once one of them is
+// dropped, executing it fails instead of touching the freed table.
+//
+// Results stream out through a callback: the engine never prints rows.
+// Each row is handed over in place (zero-copy) and is only valid during
+// the call; a caller that keeps rows copies them.
+
+typedef enum {
+    STMT_INSERT,
+    STMT_SELECT,
+    STMT_CREATE_TABLE,
+    STMT_DROP_TABLE
+} StatementType;
+
+typedef struct {
+    const TableSchema* schema;      // Table (or join row layout) of the column
+    const ColumnDefinition* column; // Column the parameter binds to
+    char* row_data;                 // Row buffer it writes (INSERT row or plan constant)
+    int bound;                      // 1 once a value has been bound
+} StatementParam;
+
+typedef struct PreparedStatement {
+    char name[MAX_STATEMENT_NAME_LEN];   // Registered name ("" if unnamed)
+    StatementType type;
+    struct Database* db;
+    TableSchema* schema;                 // Resolved at prepare time; CREATE/DROP: the table's definition (owned)
+    int table_ids[2];                    // Tables used (FROM and JOIN table)
+    int num_tables;
+    StatementParam* params;
+    int num_params;
+    char* rows;                          // INSERT rows, literals pre-encoded
+    int num_rows;
+    QueryPlan* plan;                     // SELECT plan
+} PreparedStatement;
+
+// Parse and resolve a statement against `db`. Returns NULL (message
+// printed) on error.
+PreparedStatement* stmt_prepare(struct Database* db, const char* sql);
+void stmt_finalize(PreparedStatement* stmt);
+
+// Bind parameter `index`; values stay bound across executions.
+// Return 0 on success, -1 on error (bad index or value).
+int stmt_bind_int(PreparedStatement* stmt, int index, int value);
+int stmt_bind_text(PreparedStatement* stmt, int index, const char* value);
+
+// Run the statement. INSERT: returns insert_row/insert_rows codes. SELECT:
+// passes each result row to `sink` (laid out as stmt->plan->output) and
+// returns the row count, or -1. A nonzero return from `sink` ends the query.
+// CREATE/DROP TABLE: 0, 1 if the table exists / does not exist, or -1.
+long stmt_execute(PreparedStatement* stmt, RowSink sink, void* ctx);
+
+// 0 if every table the statement uses still exists, else -1 (reported).
+int stmt_check_tables(const PreparedStatement* stmt);
+
+// Named statements (PREPARE / EXECUTE / DEALLOCATE), kept per database.
+// Registering a name that exists replaces (and finalizes) the old statement.
+int stmt_register(struct Database* db, const char* name, PreparedStatement* stmt);
+PreparedStatement* stmt_find(struct Database* db, const char* name);
+int stmt_deallocate(struct Database* db, const char* name);  // 0 if removed, 1 if not found
+void stmt_deallocate_all(struct Database* db);               // Call before close_database()
+
+#endif // PREPARED_H
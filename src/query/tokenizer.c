@@ -0,0 +1,125 @@
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+#include "tokenizer.h"
+
+void tokenizer_init(Tokenizer* tokenizer, const char* input) {
+    tokenizer->input = input;
+    tokenizer->pos = input;
+}
+
+static Token make_token(TokenType type, const char* start, int length) {
+    Token token = {type, start, length, 0};
+    return token;
+}
+
+/**
+ * Scan the next token.
+ * @param tokenizer The tokenizer.
+ * @return The token; TOK_EOF at the end of input (repeatedly).
+ */
+Token tokenizer_next(Tokenizer* tokenizer) {
+    const char* p = tokenizer->pos;
+    while (isspace((unsigned char)*p)) p++;
+    const char* start = p;
+    Token token;
+
+    if (*p == '\0') {
+        token = make_token(TOK_EOF, p, 0);
+    } else if (isalpha((unsigned char)*p) || *p == '_') {
+        while (isalnum((unsigned char)*p) || *p == '_') p++;
+        token = make_token(TOK_IDENT, start, (int)(p - start));
+    } else if (isdigit((unsigned char)*p) || (*p == '-' && isdigit((unsigned char)p[1]))) {
+        p++;
+        while (isdigit((unsigned char)*p)) p++;
+        token = make_token(TOK_INT, start, (int)(p - start));
+    } else if (*p == '\'') {
+        // '' inside the literal stands for one quote
+        int has_escapes = 0;
+        p++;
+        while (*p) {
+            if (*p == '\'') {
+                if (p[1] != '\'') break;
+                has_escapes = 1;
+                p++;
+            }
+            p++;
+        }
+        if (*p != '\'') {
+            tokenizer->pos = p;
+            return make_token(TOK_ERROR, start, (int)(p - start));
+        }
+        token = make_token(TOK_STRING, start + 1, (int)(p - start - 1));
+        token.has_escapes = has_escapes;
+        p++;
+    } else {
+        TokenType type = TOK_ERROR;
+        int length = 1;
+        switch (*p) {
+            case '(': type = TOK_LPAREN; break;
+            case ')': type = TOK_RPAREN; break;
+            case ',': type = TOK_COMMA; break;
+            case ';': type = TOK_SEMICOLON; break;
+            case '*': type = TOK_STAR; break;
+            case '.': type = TOK_DOT; break;
+            case '?': type = TOK_PARAM; break;
+            case '=': type = TOK_EQ; break;
+            case '!':
+                if (p[1] == '=') { type = TOK_NE; length = 2; }
+                break;
+            case '<':
+                if (p[1] == '=') { type = TOK_LE; length = 2; }
+                else if (p[1] == '>') { type = TOK_NE; length = 2; }
+                else type = TOK_LT;
+                break;
+            case '>':
+                if (p[1] == '=') { type = TOK_GE; length = 2; }
+                else type = TOK_GT;
+                break;
+        }
+        p += length;
+        token = make_token(type, start, length);
+    }
+    tokenizer->pos = p;
+    return token;
+}
+
+int token_is_keyword(const Token* token, const char* keyword) {
+    return token->type == TOK_IDENT && (int)strlen(keyword) == token->length &&
+           strncasecmp(token->start, keyword, token->length) == 0;
+}
+
+const char* token_type_name(TokenType type) {
+    switch (type) {
+        case TOK_EOF: return "end of input";
+        case TOK_ERROR: return "invalid token";
+        case TOK_IDENT: return "identifier";
+        case TOK_INT: return "integer";
+        case TOK_STRING: return "string";
+        case TOK_PARAM: return "'?'";
+        case TOK_LPAREN: return "'('";
+        case TOK_RPAREN: return "')'";
+        case TOK_COMMA: return "','";
+        case TOK_SEMICOLON: return "';'";
+        case TOK_STAR: return "'*'";
+        case TOK_DOT: return "'.'";
+        case TOK_EQ: return "'='";
+        case TOK_NE: return "'!='";
+        case TOK_LT: return "'<'";
+        case TOK_LE: return "'<='";
+        case TOK_GT: return "'>'";
+        case TOK_GE: return "'>='";
+    }
+    return "token";
+}
+
+char* sql_unescape_copy(const char* start, int length, int has_escapes, char* out, size_t out_size) {
+    if (out_size == 0) return out;
+    size_t n = 0;
+    for (int i = 0; i < length && n < out_size - 1; i++) {
+        out[n++] = start[i];
+        if (has_escapes && start[i] == '\'') i++; // Skip the second quote of ''
+    }
+    out[n] = '\0';
+    return out;
+}
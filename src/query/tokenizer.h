@@ -0,0 +1,56 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+
+// --- SQL Tokenizer ---
+// Zero-copy: tokens are spans into the caller's input buffer, which must
+// outlive them. Keywords are returned as TOK_IDENT and recognized with
+// token_is_keyword (case-insensitive).
+
+typedef enum {
+    TOK_EOF,
+    TOK_ERROR,      // Unterminated string or unexpected character
+    TOK_IDENT,      // Identifier or keyword
+    TOK_INT,        // Integer literal, optionally with a leading '-'
+    TOK_STRING,     // 'quoted' literal; span excludes the quotes
+    TOK_PARAM,      // ?
+    TOK_LPAREN,
+    TOK_RPAREN,
+    TOK_COMMA,
+    TOK_SEMICOLON,
+    TOK_STAR,
+    TOK_DOT,
+    TOK_EQ,         // =
+    TOK_NE,         // != or <>
+    TOK_LT,
+    TOK_LE,
+    TOK_GT,
+    TOK_GE
+} TokenType;
+
+typedef struct {
+    TokenType type;
+    const char* start;  // First character of the token in the input
+    int length;
+    int has_escapes;    // TOK_STRING: contains '' (an escaped quote)
+} Token;
+
+typedef struct {
+    const char* input;
+    const char* pos;    // Next character to scan
+} Tokenizer;
+
+void tokenizer_init(Tokenizer* tokenizer, const char* input);
+Token tokenizer_next(Tokenizer* tokenizer);
+
+// 1 if the token is the identifier `keyword` (case-insensitive)
+int token_is_keyword(const Token* token, const char* keyword);
+
+const char* token_type_name(TokenType type);
+
+// Copy string literal text into a NUL-terminated buffer (truncating),
+// turning each '' into ' when has_escapes is set; returns `out`.
+char* sql_unescape_copy(const char* start, int length, int has_escapes, char* out, size_t out_size);
+
+#endif // TOKENIZER_H
@@ -2,8 +2,10 @@
 #define STRUCTS_H
 
 #include "constants.h"
+#include "io/io.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 // // Row structure for users table
 // typedef struct {
@@ -14,7 +16,10 @@
 // Supported Column Types
 typedef enum {
     COL_TYPE_INT,
-    COL_TYPE_STRING
+    COL_TYPE_STRING,
+    // Query results only (aggregates); tables store INT and STRING
+    COL_TYPE_LONG,     // 64-bit integer
+    COL_TYPE_DOUBLE
     // Add more types here (FLOAT, DATE, etc.)
 } ColumnType;
 
@@ -34,44 +39,76 @@ typedef struct {
     int node_size;     // Size of each node in bytes
     int root_id;       // ID of the root node
     int next_id;       // Next available node ID
+    int flags;         // BTREE_FLAG_* options fixed at creation
     // Add padding if needed to ensure consistent HEADER_SIZE
-    char padding[HEADER_SIZE - (5 * sizeof(int))];
+    char padding[HEADER_SIZE - (6 * sizeof(int))];
 } BTreeHeader;
 
+// Node structure for both leaf and internal nodes
+typedef struct {
+    int is_leaf;       // 1 if leaf, 0 if internal
+    int num_keys;      // Number of keys currently in the node
+    int keys[M-1];     // Array of keys (max M-1 keys)
+    long offsets[M-1]; // Array of offsets (only used if leaf)
+    int children[M];   // Child node IDs (used if not leaf)
+    int next_leaf;     // ID of the next leaf node (used if leaf)
+    uint32_t checksum; // CRC32C of all bytes before this field (set by write_node)
+} Node;
+
+// In-memory copy of an upper-level node kept resident in the handle
+typedef struct {
+    int node_id;
+    Node node;
+} PinnedNode;
+
 // Structure to hold state for one B+ Tree instance
 typedef struct {
-    FILE *fp;               // File pointer for this specific index file
+    IoFile *file;           // Open index file
     BTreeHeader header;     // Header info for this index file
+    int header_dirty;       // 1 if header has changes not yet written to disk
     char index_path[MAX_PATH_LEN]; // Path to the index file (for error messages)
+    PinnedNode* pinned;     // Root and top BTREE_PINNED_LEVELS levels, kept in sync by write_node
+    int num_pinned;
+    int pinned_capacity;    // Max nodes in the pinned levels (1 + M + ... + M^(levels-1))
 } BTreeHandle;
 
 // Table Schema Definition
 typedef struct TableSchema { // Give it a name for self-reference if needed
     char name[MAX_TABLE_NAME_LEN];
-    ColumnDefinition columns[MAX_COLUMNS];
+    struct Database* db;  // Database the table belongs to
+    int table_id;         // Index in the database's table registry (-1 for join and result layouts)
+    uint64_t name_hash;   // Hash of name, set on registration
+    struct TableSchema* hash_next; // Next table in the same registry hash bucket
+    ColumnDefinition* columns;  // num_columns column definitions
     int num_columns;
     size_t row_size;
+    size_t record_size;   // On-disk size of a row: row_size + ROW_CHECKSUM_SIZE trailer
     int pk_column_index;
     BTreeHandle* pk_index; // Pointer to the handle for the primary key index
+    int pk_index_flags;    // BTREE_FLAG_* used when creating the index
+    int io_flags;          // Extra IO_OPEN_* flags for the data and index files
+    struct RowCache* row_cache; // Hot-row cache keyed by primary key (NULL if disabled)
+    struct BloomFilter* pk_filter; // Bloom filter over primary keys (NULL if disabled)
+    struct ZoneMap* zone_map;   // Per-block min/max of INT columns for scans (NULL if disabled)
+    struct TableStats* stats;   // Row count and value distributions from ANALYZE (NULL if never analyzed)
     char table_dir[MAX_PATH_LEN]; // Directory path for this table
     char data_path[MAX_PATH_LEN]; // Path to the data file
+    IoFile* data_file;    // Data file, open for the lifetime of the database
+    off_t data_size;      // Bytes in the data file; appends go here
+    int joined;           // 1 for the row layout of a join (columns named table.column, no files)
 } TableSchema;
 
-// Node structure for both leaf and internal nodes
-typedef struct {
-    int is_leaf;       // 1 if leaf, 0 if internal
-    int num_keys;      // Number of keys currently in the node
-    int keys[M-1];     // Array of keys (max M-1 keys)
-    long offsets[M-1]; // Array of offsets (only used if leaf)
-    int children[M];   // Child node IDs (used if not leaf)
-    int next_leaf;     // ID of the next leaf node (used if leaf)
-} Node;
+// Receives one result row laid out as `schema`. The row points into the
+// engine's buffers (no copy is made) and is only valid during the call.
+// Return nonzero to stop producing rows.
+typedef int (*RowCallback)(const TableSchema* schema, const void* row, void* ctx);
 
 // Structure to hold insertion result
 typedef struct {
     int split_occurred;  // 1 if split occurred, 0 otherwise
     int separator_key;   // Key to insert into parent if split
     int new_node_id;     // ID of the new node if split
+    int node_id;         // ID the node now lives at (a fresh ID under copy-on-write)
 } InsertResult;
 
 #endif
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+void arena_init(Arena* arena) {
+    arena->head = NULL;
+}
+
+/**
+ * Allocate zeroed memory from the arena.
+ * @param arena The arena.
+ * @param size Bytes needed.
+ * @return Pointer to the memory, or NULL on allocation failure.
+ */
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    ArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t chunk_size = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(ArenaChunk) + chunk_size);
+        if (!chunk) return NULL;
+        chunk->next = arena->head;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        arena->head = chunk;
+    }
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * Drop every allocation, keeping the oldest chunk so steady-state use does
+ * not touch malloc.
+ * @param arena The arena.
+ */
+void arena_reset(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk && chunk->next) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    if (chunk) chunk->used = 0;
+    arena->head = chunk;
+}
+
+void arena_free(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+}
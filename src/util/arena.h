@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for short-lived objects that die together (e.g. the AST of
+// one statement). Allocation is a pointer increment; everything is released
+// at once by arena_reset or arena_free.
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t used;
+    size_t size;
+    _Alignas(16) char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk* head; // Chunk currently allocated from
+} Arena;
+
+#define ARENA_CHUNK_SIZE 4096
+
+void arena_init(Arena* arena);
+
+// Zeroed, 16-byte aligned memory; NULL on allocation failure.
+void* arena_alloc(Arena* arena, size_t size);
+
+// Release all allocations but keep the first chunk for reuse.
+void arena_reset(Arena* arena);
+
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
@@ -0,0 +1,67 @@
+#include <string.h>
+#include "crc32c.h"
+
+#define CRC32C_POLY 0x82F63B78U // Reflected Castagnoli polynomial
+
+static uint32_t crc_table[256];
+static int crc_table_ready = 0;
+
+static void init_crc_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc_table[i] = crc;
+    }
+    crc_table_ready = 1;
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t len) {
+    if (!crc_table_ready) init_crc_table();
+    while (len--) {
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char* p, size_t len) {
+    uint64_t crc64 = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (len--) {
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    }
+    return crc;
+}
+
+static int has_sse42(void) {
+    static int cached = -1;
+    if (cached < 0) cached = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    return cached;
+}
+#endif
+
+/**
+ * Compute the CRC32C of a buffer.
+ * @param data Bytes to checksum.
+ * @param len Number of bytes.
+ * @return The checksum.
+ */
+uint32_t crc32c(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (has_sse42()) {
+        return ~crc32c_hw(~0U, p, len);
+    }
+#endif
+    return ~crc32c_sw(~0U, p, len);
+}
@@ -0,0 +1,11 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32C (Castagnoli) used to checksum index nodes and data records.
+// Uses the SSE4.2 crc32 instruction when the CPU has it, a table otherwise.
+uint32_t crc32c(const void* data, size_t len);
+
+#endif // CRC32C_H
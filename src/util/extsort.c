@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "extsort.h"
+#include "../constants.h"
+
+#define SORT_INSERTION_THRESHOLD 16 // Slices this short are insertion sorted
+#define SORT_INITIAL_RECORDS 256    // First allocation of the record buffer
+
+/**
+ * Create an anonymous temp file in a directory (unlinked right away).
+ * @param dir Directory to create it in (the database's data directory).
+ * @param purpose Description used in error messages.
+ * @return The file, or NULL on error.
+ */
+FILE* open_temp_file(const char* dir, const char* purpose) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/tmp_XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create %s: %s\n", purpose, strerror(errno));
+        return NULL;
+    }
+    unlink(path);
+    FILE* file = fdopen(fd, "w+b");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s: %s\n", purpose, strerror(errno));
+        close(fd);
+    }
+    return file;
+}
+
+static int fail(ExternalSort* sort) {
+    sort->error = 1;
+    return -1;
+}
+
+/**
+ * Records that fit in a memory budget, counting the two pointers each one
+ * needs while it is sorted (at least 2).
+ */
+size_t sort_memory_records(size_t record_size, size_t memory_budget) {
+    size_t records = memory_budget / ((record_size > 0 ? record_size : 1) + 2 * sizeof(char*));
+    return records < 2 ? 2 : records;
+}
+
+/**
+ * Prepare an empty sort.
+ * @param memory_budget Bytes of records (and their sort pointers) kept in
+ *                      memory before a sorted run is written to disk.
+ * @param temp_dir Directory for run files; must outlive the sort.
+ * @return 0 on success, -1 on error.
+ */
+int sort_init(ExternalSort* sort, size_t record_size, size_t memory_budget, const char* temp_dir,
+              SortCompare compare, void* ctx) {
+    memset(sort, 0, sizeof(ExternalSort));
+    sort->temp_dir = temp_dir;
+    sort->record_size = record_size > 0 ? record_size : 1;
+    sort->max_records = sort_memory_records(sort->record_size, memory_budget);
+    sort->compare = compare;
+    sort->ctx = ctx;
+    if (!(sort->current = malloc(sort->record_size))) {
+        perror("Failed to allocate memory for sort");
+        return -1;
+    }
+    return 0;
+}
+
+// --- Top-N Heap ---
+
+static uint64_t record_seq(const ExternalSort* sort, const char* record) {
+    return sort->seqs[(size_t)(record - sort->records) / sort->record_size];
+}
+
+/**
+ * 1 if record a comes after record b in the output; of two equal records
+ * the one added later comes after.
+ */
+static int comes_after(const ExternalSort* sort, const char* a, const char* b) {
+    int cmp = sort->compare(a, b, sort->ctx);
+    return cmp > 0 || (cmp == 0 && record_seq(sort, a) > record_seq(sort, b));
+}
+
+static void swap_entries(char** heap, size_t i, size_t j) {
+    char* tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+static void sift_up(ExternalSort* sort, size_t i) {
+    char** heap = sort->order;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!comes_after(sort, heap[i], heap[parent])) return;
+        swap_entries(heap, i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(ExternalSort* sort, size_t i, size_t n) {
+    char** heap = sort->order;
+    for (;;) {
+        size_t last = i, left = 2 * i + 1, right = left + 1;
+        if (left < n && comes_after(sort, heap[left], heap[last])) last = left;
+        if (right < n && comes_after(sort, heap[right], heap[last])) last = right;
+        if (last == i) return;
+        swap_entries(heap, i, last);
+        i = last;
+    }
+}
+
+/**
+ * Limit the sort to its first `limit` records. The heap's arrays are
+ * allocated up front, so the limit must fit in the memory budget.
+ * @return 1 if the top-N heap is used, 0 if the limit is too large, -1 on error.
+ */
+int sort_set_limit(ExternalSort* sort, size_t limit) {
+    if (limit == 0 || limit > sort->max_records || sort->num_records > 0 || sort->num_runs > 0) return 0;
+    sort->records = malloc(limit * sort->record_size);
+    sort->order = malloc(limit * sizeof(char*));
+    sort->seqs = malloc(limit * sizeof(uint64_t));
+    if (!sort->records || !sort->order || !sort->seqs) {
+        perror("Failed to allocate memory for top-N sort");
+        return fail(sort);
+    }
+    sort->capacity = limit;
+    sort->limit = limit;
+    return 1;
+}
+
+/**
+ * Offer a record to the heap of the best `limit` records. Until the heap is
+ * full every record goes in; after that, a record only replaces the worst
+ * one kept (the heap's root) if it comes before it.
+ */
+static void heap_add(ExternalSort* sort, const void* record) {
+    uint64_t seq = sort->added++;
+    char* slot;
+    if (sort->num_records < sort->limit) {
+        slot = sort->records + sort->num_records * sort->record_size;
+        sort->order[sort->num_records] = slot;
+    } else if (sort->compare(record, sort->order[0], sort->ctx) < 0) {
+        slot = sort->order[0]; // Ties keep the earlier record
+    } else {
+        return;
+    }
+    memcpy(slot, record, sort->record_size);
+    sort->seqs[(size_t)(slot - sort->records) / sort->record_size] = seq;
+    if (sort->num_records < sort->limit) {
+        sift_up(sort, sort->num_records++);
+    } else {
+        sift_down(sort, 0, sort->num_records);
+    }
+}
+
+// --- In-Memory Sort ---
+
+/**
+ * Stable merge sort of record pointers. `scratch` holds n / 2 pointers:
+ * only the left half is copied out before the halves are merged.
+ */
+static void merge_sort(const ExternalSort* sort, char** items, char** scratch, size_t n) {
+    if (n <= SORT_INSERTION_THRESHOLD) {
+        for (size_t i = 1; i < n; i++) {
+            char* item = items[i];
+            size_t j = i;
+            while (j > 0 && sort->compare(items[j - 1], item, sort->ctx) > 0) {
+                items[j] = items[j - 1];
+                j--;
+            }
+            items[j] = item;
+        }
+        return;
+    }
+    size_t half = n / 2;
+    merge_sort(sort, items, scratch, half);
+    merge_sort(sort, items + half, scratch, n - half);
+    if (sort->compare(items[half - 1], items[half], sort->ctx) <= 0) return; // Already in order
+
+    memcpy(scratch, items, half * sizeof(char*));
+    size_t i = 0, j = half, k = 0;
+    while (i < half && j < n) {
+        // Ties take the left record, which was added first
+        items[k++] = (sort->compare(items[j], scratch[i], sort->ctx) < 0) ? items[j++] : scratch[i++];
+    }
+    while (i < half) items[k++] = scratch[i++];
+}
+
+/**
+ * Sort the buffered records into sort->order.
+ * @return 0 on success, -1 on error.
+ */
+static int sort_buffer(ExternalSort* sort) {
+    size_t n = sort->num_records;
+    char** order = realloc(sort->order, (n > 0 ? n : 1) * sizeof(char*));
+    char** scratch = malloc((n / 2 + 1) * sizeof(char*));
+    if (order) sort->order = order;
+    if (!order || !scratch) {
+        perror("Failed to allocate memory for sort");
+        free(scratch);
+        return fail(sort);
+    }
+    for (size_t i = 0; i < n; i++) order[i] = sort->records + i * sort->record_size;
+    merge_sort(sort, order, scratch, n);
+    free(scratch);
+    return 0;
+}
+
+/**
+ * Sort the buffered records and write them to a new run file.
+ * @return 0 on success, -1 on error.
+ */
+static int spill_run(ExternalSort* sort) {
+    if (sort_buffer(sort) != 0) return -1;
+    if (sort->num_runs == sort->runs_capacity) {
+        int capacity = sort->runs_capacity ? sort->runs_capacity * 2 : 8;
+        FILE** runs = realloc(sort->runs, (size_t)capacity * sizeof(FILE*));
+        if (!runs) {
+            perror("Failed to allocate memory for sort runs");
+            return fail(sort);
+        }
+        sort->runs = runs;
+        sort->runs_capacity = capacity;
+    }
+    FILE* file = open_temp_file(sort->temp_dir, "sort run file");
+    if (!file) return fail(sort);
+    for (size_t i = 0; i < sort->num_records; i++) {
+        if (fwrite(sort->order[i], sort->record_size, 1, file) != 1) {
+            perror("Failed to write sort run file");
+            fclose(file);
+            return fail(sort);
+        }
+    }
+    sort->runs[sort->num_runs++] = file;
+    sort->num_records = 0;
+    return 0;
+}
+
+/**
+ * Buffer a record, first writing out a run if the buffer is full.
+ * @return 0 on success, -1 on error.
+ */
+int sort_add(ExternalSort* sort, const void* record) {
+    if (sort->error) return -1;
+    if (sort->limit > 0) {
+        heap_add(sort, record);
+        return 0;
+    }
+    if (sort->num_records == sort->max_records && spill_run(sort) != 0) return -1;
+    if (sort->num_records == sort->capacity) {
+        size_t capacity = sort->capacity ? sort->capacity * 2 : SORT_INITIAL_RECORDS;
+        if (capacity > sort->max_records) capacity = sort->max_records;
+        char* records = realloc(sort->records, capacity * sort->record_size);
+        if (!records) {
+            perror("Failed to allocate memory for sort buffer");
+            return fail(sort);
+        }
+        sort->records = records;
+        sort->capacity = capacity;
+    }
+    memcpy(sort->records + sort->num_records * sort->record_size, record, sort->record_size);
+    sort->num_records++;
+    return 0;
+}
+
+// --- Merging Runs ---
+
+static size_t reader_capacity(const ExternalSort* sort) {
+    size_t records = SORT_RUN_BUFFER_BYTES / sort->record_size;
+    return records > 0 ? records : 1;
+}
+
+/**
+ * Read the next block of records of a run.
+ * @return 0 on success (done set at the end of the run), -1 on error.
+ */
+static int reader_fill(ExternalSort* sort, SortRunReader* reader) {
+    reader->count = fread(reader->buffer, sort->record_size, reader_capacity(sort), reader->file);
+    reader->pos = 0;
+    if (reader->count == 0) {
+        if (ferror(reader->file)) {
+            perror("Failed to read sort run file");
+            return fail(sort);
+        }
+        reader->done = 1;
+    }
+    return 0;
+}
+
+/**
+ * 1 if run `a`'s current record comes before run `b`'s. Exhausted runs lose
+ * to everything; index num_readers is the sentinel used while building the
+ * tree and wins against everything. Ties go to the earlier run, which holds
+ * the earlier records.
+ */
+static int beats(const ExternalSort* sort, int a, int b) {
+    if (a == sort->num_readers) return 1;
+    if (b == sort->num_readers) return 0;
+    const SortRunReader* ra = &sort->readers[a];
+    const SortRunReader* rb = &sort->readers[b];
+    if (ra->done) return 0;
+    if (rb->done) return 1;
+    int cmp = sort->compare(ra->buffer + ra->pos * sort->record_size,
+                            rb->buffer + rb->pos * sort->record_size, sort->ctx);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/**
+ * Replay the matches on the path from run s's leaf to the root: at each
+ * node the loser stays behind and the winner moves up. Leaves are the
+ * virtual nodes k..2k-1, so run s plays first at node (s + k) / 2.
+ */
+static void adjust(ExternalSort* sort, int s) {
+    for (int t = (s + sort->num_readers) / 2; t > 0; t /= 2) {
+        if (beats(sort, sort->tree[t], s)) {
+            int loser = s;
+            s = sort->tree[t];
+            sort->tree[t] = loser;
+        }
+    }
+    sort->tree[0] = s;
+}
+
+static void end_merge(ExternalSort* sort) {
+    for (int i = 0; i < sort->num_readers; i++) {
+        free(sort->readers[i].buffer);
+        if (sort->readers[i].file) fclose(sort->readers[i].file);
+    }
+    free(sort->readers);
+    free(sort->tree);
+    sort->readers = NULL;
+    sort->tree = NULL;
+    sort->num_readers = 0;
+}
+
+/**
+ * Start merging `k` run files (the readers take ownership of them).
+ * @return 0 on success, -1 on error.
+ */
+static int start_merge(ExternalSort* sort, FILE** files, int k) {
+    sort->readers = calloc((size_t)k, sizeof(SortRunReader));
+    sort->tree = malloc((size_t)k * sizeof(int));
+    if (!sort->readers || !sort->tree) {
+        perror("Failed to allocate memory for sort merge");
+        free(sort->readers);
+        free(sort->tree);
+        sort->readers = NULL;
+        sort->tree = NULL;
+        for (int i = 0; i < k; i++) fclose(files[i]);
+        return fail(sort);
+    }
+    sort->num_readers = k;
+    for (int i = 0; i < k; i++) sort->readers[i].file = files[i];
+    for (int i = 0; i < k; i++) {
+        SortRunReader* reader = &sort->readers[i];
+        rewind(reader->file);
+        if (!(reader->buffer = malloc(reader_capacity(sort) * sort->record_size))) {
+            perror("Failed to allocate memory for sort merge");
+            return fail(sort);
+        }
+        if (reader_fill(sort, reader) != 0) return -1;
+    }
+
+    // Every node starts out holding the sentinel; each run's first match
+    // pushes one sentinel further up, until only real runs remain
+    for (int t = 0; t < k; t++) sort->tree[t] = k;
+    for (int s = k - 1; s >= 0; s--) adjust(sort, s);
+    return 0;
+}
+
+/**
+ * Take the smallest current record of the runs being merged.
+ * @return A copy of it, or NULL when all runs are exhausted or on error.
+ */
+static const void* merge_next(ExternalSort* sort) {
+    int winner = sort->tree[0];
+    SortRunReader* reader = &sort->readers[winner];
+    if (reader->done) return NULL;
+    memcpy(sort->current, reader->buffer + reader->pos * sort->record_size, sort->record_size);
+    if (++reader->pos == reader->count && reader_fill(sort, reader) != 0) return NULL;
+    adjust(sort, winner);
+    return sort->current;
+}
+
+/**
+ * Merge the first SORT_MERGE_FANIN runs into one, which takes their place
+ * at the front (so earlier records stay in earlier runs).
+ * @return 0 on success, -1 on error.
+ */
+static int merge_pass(ExternalSort* sort) {
+    FILE* out = open_temp_file(sort->temp_dir, "sort run file");
+    if (!out) return fail(sort);
+    int status = start_merge(sort, sort->runs, SORT_MERGE_FANIN);
+    const void* record;
+    while (status == 0 && (record = merge_next(sort)) != NULL) {
+        if (fwrite(record, sort->record_size, 1, out) != 1) {
+            perror("Failed to write sort run file");
+            status = fail(sort);
+        }
+    }
+    if (sort->error) status = -1;
+    end_merge(sort);
+
+    // The group's files were closed by end_merge either way
+    sort->num_runs -= SORT_MERGE_FANIN - 1;
+    memmove(sort->runs + 1, sort->runs + SORT_MERGE_FANIN, (size_t)(sort->num_runs - 1) * sizeof(FILE*));
+    sort->runs[0] = out;
+    return status;
+}
+
+/**
+ * Finish adding records. A top-N heap is sorted in place and an in-memory
+ * sort sorts its buffer; a sort that spilled writes the rest as a final run
+ * and merges the runs.
+ * @return 0 on success, -1 on error.
+ */
+int sort_finish(ExternalSort* sort) {
+    if (sort->error) return -1;
+    if (sort->limit > 0) {
+        // Heap sort: move the worst remaining record behind the heap each step
+        for (size_t n = sort->num_records; n > 1; n--) {
+            swap_entries(sort->order, 0, n - 1);
+            sift_down(sort, 0, n - 1);
+        }
+        sort->finished = 1;
+        return 0;
+    }
+    if (sort->num_runs == 0) {
+        if (sort_buffer(sort) != 0) return -1;
+        sort->finished = 1;
+        return 0;
+    }
+    if (sort->num_records > 0 && spill_run(sort) != 0) return -1;
+    free(sort->records); // The merge's read buffers take over the memory
+    free(sort->order);
+    sort->records = NULL;
+    sort->order = NULL;
+    sort->num_records = sort->capacity = 0;
+
+    while (sort->num_runs > SORT_MERGE_FANIN) {
+        if (merge_pass(sort) != 0) return -1;
+    }
+    int num_runs = sort->num_runs;
+    sort->num_runs = 0; // Owned by the readers now
+    if (start_merge(sort, sort->runs, num_runs) != 0) return -1;
+    sort->finished = 1;
+    return 0;
+}
+
+/**
+ * Return the next record in order.
+ * @return The record, or NULL at the end or on error (sort->error set).
+ */
+const void* sort_next(ExternalSort* sort) {
+    if (!sort->finished || sort->error) return NULL;
+    if (sort->readers) return merge_next(sort);
+    if (sort->next == sort->num_records) return NULL;
+    return sort->order[sort->next++];
+}
+
+void sort_free(ExternalSort* sort) {
+    if (!sort) return;
+    end_merge(sort);
+    for (int i = 0; i < sort->num_runs; i++) fclose(sort->runs[i]);
+    free(sort->runs);
+    free(sort->records);
+    free(sort->order);
+    free(sort->seqs);
+    free(sort->current);
+    memset(sort, 0, sizeof(ExternalSort));
+}
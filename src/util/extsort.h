@@ -0,0 +1,94 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- External Merge Sort ---
+// Sorts fixed-size records by a caller-supplied comparison. Records are
+// buffered in memory up to a budget; when the budget fills, the buffer is
+// sorted (a stable merge sort over record pointers) and written out as a
+// run to an anonymous temp file in a given directory. At the end the runs
+// are merged through a loser tree: each step replays one leaf-to-root path
+// of log2(runs) comparisons to find the next record. More than
+// SORT_MERGE_FANIN runs are first merged in groups into longer runs.
+// A sort that fits in memory never touches disk. The sort is stable:
+// records that compare equal come out in the order they were added.
+// A sort limited to its first N records (top-N) instead keeps them in a
+// bounded max-heap: each new record is compared with the worst one kept
+// and only copied in if it beats it.
+
+// Negative, zero or positive, as for qsort.
+typedef int (*SortCompare)(const void* a, const void* b, void* ctx);
+
+typedef struct {
+    FILE* file;
+    char* buffer;            // Records read ahead from the run
+    size_t count;            // Records in buffer
+    size_t pos;              // Next record in buffer
+    int done;                // Run exhausted
+} SortRunReader;
+
+typedef struct {
+    size_t record_size;
+    size_t max_records;      // Records held in memory before a run is written
+    const char* temp_dir;    // Where run files are created
+    SortCompare compare;
+    void* ctx;
+
+    char* records;           // Buffered records
+    size_t num_records;
+    size_t capacity;
+    char** order;            // Sorted pointers into records (in-memory result); top-N: the heap
+    size_t next;             // Next entry of order to return
+    size_t limit;            // Top-N: records kept (0 = all)
+    uint64_t* seqs;          // Top-N: arrival number of each record slot (breaks ties)
+    uint64_t added;          // Top-N: records added so far
+
+    FILE** runs;             // Sorted runs on disk
+    int num_runs;
+    int runs_capacity;
+
+    SortRunReader* readers;  // Final merge: one reader per run
+    int* tree;               // Loser tree: tree[0] winner, tree[1..k-1] losers
+    int num_readers;
+    char* current;           // Copy of the record last returned by a merge
+    int finished;            // sort_finish done; sort_next may be called
+    int error;               // 1 after an allocation or I/O error (reported)
+} ExternalSort;
+
+// Create an empty sort of `record_size`-byte records that keeps at most
+// about `memory_budget` bytes of records in memory; runs beyond that go to
+// temp files in `temp_dir`. Returns 0, or -1.
+int sort_init(ExternalSort* sort, size_t record_size, size_t memory_budget, const char* temp_dir,
+              SortCompare compare, void* ctx);
+
+// Records of `record_size` bytes a sort keeps in memory within the budget.
+size_t sort_memory_records(size_t record_size, size_t memory_budget);
+
+// Keep only the first `limit` records of the order; call before adding.
+// Returns 1 if they fit in the memory budget and a top-N heap is used, 0 if
+// not (all records are sorted; the caller stops reading after `limit`),
+// -1 on error.
+int sort_set_limit(ExternalSort* sort, size_t limit);
+
+// Add a record (copied). Returns 0, or -1 on error.
+int sort_add(ExternalSort* sort, const void* record);
+
+// Stop adding and prepare to return the records in order. Returns 0, or -1.
+int sort_finish(ExternalSort* sort);
+
+// Next record in sorted order, or NULL when done or on error (sort->error
+// set). The pointer is valid until the next call.
+const void* sort_next(ExternalSort* sort);
+
+// Free buffers and close (and thereby delete) the run files.
+void sort_free(ExternalSort* sort);
+
+// Create an anonymous read/write temp file in directory `dir`; it is
+// unlinked at once, so it disappears when closed. `purpose` names it in
+// errors. Returns NULL on error (reported).
+FILE* open_temp_file(const char* dir, const char* purpose);
+
+#endif // EXTSORT_H
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <strings.h>
+#include "log.h"
+
+#define LOG_LEVEL_UNSET 99 // log_threshold before DB_LOG_LEVEL is read
+
+static const char* level_names[] = {"error", "warn", "info", "debug"};
+
+int log_threshold = LOG_LEVEL_UNSET;
+
+static void init_level(void) {
+    LogLevel level = LOG_LEVEL_WARN;
+    const char* env = getenv("DB_LOG_LEVEL");
+    if (env && log_parse_level(env, &level) != 0) {
+        fprintf(stderr, "Warning: Unknown DB_LOG_LEVEL '%s'; using 'warn'.\n", env);
+    }
+    log_threshold = level;
+}
+
+/**
+ * Parse a level name.
+ * @param name "error", "warn", "info" or "debug" (any case).
+ * @param level Receives the level.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int log_parse_level(const char* name, LogLevel* level) {
+    for (int i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, level_names[i]) == 0) {
+            *level = (LogLevel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void log_set_level(LogLevel level) {
+    log_threshold = level;
+}
+
+LogLevel log_get_level(void) {
+    if (log_threshold == LOG_LEVEL_UNSET) init_level();
+    return (LogLevel)log_threshold;
+}
+
+void log_message(LogLevel level, const char* format, ...) {
+    if ((int)level > (int)log_get_level()) return;
+    flockfile(stderr); // Keep lines of concurrent threads whole
+    fprintf(stderr, "[%s] ", level_names[level]);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+}
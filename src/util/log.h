@@ -0,0 +1,51 @@
+#ifndef LOG_H
+#define LOG_H
+
+// --- Leveled Logging ---
+// Diagnostics of the engine (not query results) go through these macros to
+// stderr, prefixed with their level. A message is written only if its level
+// is at or below the runtime level, which defaults to warnings and is set by
+// the DB_LOG_LEVEL environment variable (error, warn, info or debug) or
+// log_set_level. The check happens before any argument is formatted.
+//
+// Debug messages sit on hot paths (every insert, every B+ tree split). They
+// are compiled out entirely when LOG_COMPILE_LEVEL is below LOG_LEVEL_DEBUG,
+// which is the default for release builds (NDEBUG defined).
+
+typedef enum {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+} LogLevel;
+
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Current runtime level; read through log_enabled. Until the first message
+// it admits everything so that message reads DB_LOG_LEVEL.
+extern int log_threshold;
+
+#define log_enabled(level) ((level) <= LOG_COMPILE_LEVEL && (int)(level) <= log_threshold)
+
+#define log_error(...) do { if (log_enabled(LOG_LEVEL_ERROR)) log_message(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#define log_warn(...)  do { if (log_enabled(LOG_LEVEL_WARN))  log_message(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#define log_info(...)  do { if (log_enabled(LOG_LEVEL_INFO))  log_message(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#define log_debug(...) do { if (log_enabled(LOG_LEVEL_DEBUG)) log_message(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+
+// Write one message (printf format, no trailing newline needed) if `level`
+// is enabled. Use the macros above instead of calling this directly.
+void log_message(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void log_set_level(LogLevel level);
+LogLevel log_get_level(void);
+
+// Parse a level name (case-insensitive). Returns 0 and sets *level, or -1.
+int log_parse_level(const char* name, LogLevel* level);
+
+#endif // LOG_H
@@ -0,0 +1,151 @@
+#include "test_support.h"
+#include "unity.h"
+#include "api/dbengine.h"
+
+#define NUM_ROWS 3000 // Rows of 100+ bytes: more than one in-memory cursor batch
+
+// Uses the default products table: prod_id INT, description STRING(100), price INT
+
+static DbHandle* db;
+
+static long run(const char* sql) {
+    DbQuery* query = db_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(query, sql);
+    long status = db_execute(query);
+    db_finalize(query);
+    return status;
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    db = db_open(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+    DbQuery* insert = db_prepare(db, "INSERT INTO products VALUES (?, ?, 0)");
+    TEST_ASSERT_NOT_NULL(insert);
+    char body[32];
+    for (int id = 1; id <= NUM_ROWS; id++) {
+        snprintf(body, sizeof(body), "product %d", id);
+        TEST_ASSERT_EQUAL_INT(0, db_bind_int(insert, 0, id));
+        TEST_ASSERT_EQUAL_INT(0, db_bind_text(insert, 1, body));
+        TEST_ASSERT_EQUAL_INT64(0, db_execute(insert));
+    }
+    db_finalize(insert);
+}
+
+void tearDown(void) {
+    db_close(db);
+    test_remove_dir();
+}
+
+static void test_cursor_steps_through_every_row(void) {
+    DbQuery* query = db_prepare(db, "SELECT prod_id, description FROM products ORDER BY prod_id");
+    TEST_ASSERT_NOT_NULL(query);
+    DbCursor* cursor = db_query(query);
+    TEST_ASSERT_NOT_NULL(cursor);
+
+    TEST_ASSERT_EQUAL_INT(2, db_column_count(cursor));
+    TEST_ASSERT_EQUAL_STRING("prod_id", db_column_name(cursor, 0));
+    TEST_ASSERT_EQUAL_STRING("description", db_column_name(cursor, 1));
+    TEST_ASSERT_EQUAL_INT(DB_TYPE_INT, db_column_type(cursor, 0));
+    TEST_ASSERT_EQUAL_INT(DB_TYPE_TEXT, db_column_type(cursor, 1));
+    TEST_ASSERT_NULL(db_column_name(cursor, 2));
+
+    int rows = 0;
+    char expected[32];
+    while (db_cursor_next(cursor) == 1) {
+        rows++;
+        TEST_ASSERT_EQUAL_INT(rows, db_column_int(cursor, 0));
+        snprintf(expected, sizeof(expected), "product %d", rows);
+        TEST_ASSERT_EQUAL_STRING(expected, db_column_text(cursor, 1));
+    }
+    TEST_ASSERT_EQUAL_INT(NUM_ROWS, rows);
+    TEST_ASSERT_EQUAL_INT(0, db_cursor_next(cursor)); // Stays at the end
+    TEST_ASSERT_EQUAL_INT(0, db_cursor_close(cursor));
+    db_finalize(query);
+}
+
+static void test_aggregate_columns(void) {
+    DbQuery* query = db_prepare(db, "SELECT COUNT(*), AVG(prod_id) FROM products WHERE prod_id <= ?");
+    TEST_ASSERT_NOT_NULL(query);
+    TEST_ASSERT_EQUAL_INT(0, db_bind_int(query, 0, 10));
+    DbCursor* cursor = db_query(query);
+    TEST_ASSERT_NOT_NULL(cursor);
+    TEST_ASSERT_EQUAL_INT(1, db_cursor_next(cursor));
+    TEST_ASSERT_EQUAL_INT(DB_TYPE_LONG, db_column_type(cursor, 0));
+    TEST_ASSERT_EQUAL_INT(DB_TYPE_DOUBLE, db_column_type(cursor, 1));
+    TEST_ASSERT_EQUAL_INT64(10, db_column_long(cursor, 0));
+    TEST_ASSERT_EQUAL_STRING("5.5000", db_column_text(cursor, 1));
+    TEST_ASSERT_EQUAL_INT(0, db_cursor_next(cursor));
+    db_cursor_close(cursor);
+    db_finalize(query);
+}
+
+static void test_cursors_and_writes_interleave(void) {
+    DbQuery* query = db_prepare(db, "SELECT prod_id FROM products");
+    TEST_ASSERT_NOT_NULL(query);
+    DbCursor* first = db_query(query);
+    DbCursor* second = db_query(query);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+
+    // Each cursor holds the result as of db_query: rows inserted or a table
+    // dropped while they are open do not change what they return
+    long sum_first = 0, sum_second = 0;
+    int rows = 0;
+    while (db_cursor_next(first) == 1) {
+        sum_first += db_column_int(first, 0);
+        if (++rows == 10) TEST_ASSERT_EQUAL_INT64(0, run("INSERT INTO products VALUES (5000, 'late', 0)"));
+        if (db_cursor_next(second) == 1) sum_second += db_column_int(second, 0);
+    }
+    TEST_ASSERT_EQUAL_INT64(0, run("DROP TABLE products"));
+    while (db_cursor_next(second) == 1) sum_second += db_column_int(second, 0);
+    long expected = (long)NUM_ROWS * (NUM_ROWS + 1) / 2;
+    TEST_ASSERT_EQUAL_INT64(expected, sum_first);
+    TEST_ASSERT_EQUAL_INT64(expected, sum_second);
+    db_cursor_close(first);
+    db_cursor_close(second);
+
+    TEST_ASSERT_NULL(db_query(query)); // Its table is gone
+    db_finalize(query);
+}
+
+static void test_early_close_and_errors(void) {
+    DbQuery* query = db_prepare(db, "SELECT * FROM products");
+    DbCursor* cursor = db_query(query);
+    TEST_ASSERT_NOT_NULL(cursor);
+    TEST_ASSERT_EQUAL_INT(1, db_cursor_next(cursor));
+    TEST_ASSERT_EQUAL_INT(0, db_cursor_close(cursor));
+    db_finalize(query);
+
+    TEST_ASSERT_NULL(db_prepare(db, "SELECT * FROM nowhere"));
+    query = db_prepare(db, "INSERT INTO products VALUES (?, 'x', 0)");
+    TEST_ASSERT_NULL(db_query(query)); // Not a SELECT
+    TEST_ASSERT_EQUAL_INT(-1, db_bind_int(query, 1, 0));
+    TEST_ASSERT_EQUAL_INT(0, db_bind_int(query, 0, 1));
+    TEST_ASSERT_EQUAL_INT64(1, db_execute(query)); // Duplicate key
+    db_finalize(query);
+
+    const char* batch[] = {"4001", "a", "1", "4002", "b", "2"};
+    TEST_ASSERT_EQUAL_INT(0, db_insert_batch(db, "products", 2, 3, batch));
+    TEST_ASSERT_EQUAL_INT(1, db_insert_batch(db, "products", 2, 3, batch));
+    TEST_ASSERT_EQUAL_INT(-1, db_insert_batch(db, "products", 1, 2, batch));
+    TEST_ASSERT_EQUAL_INT64(NUM_ROWS + 2, run("SELECT * FROM products"));
+}
+
+static void test_reopen_keeps_rows(void) {
+    db_close(db);
+    db = db_open(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+    TEST_ASSERT_EQUAL_INT64(NUM_ROWS, run("SELECT prod_id FROM products WHERE prod_id > 0"));
+    TEST_ASSERT_EQUAL_INT64(1, run("SELECT prod_id FROM products WHERE prod_id = 1234"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cursor_steps_through_every_row);
+    RUN_TEST(test_aggregate_columns);
+    RUN_TEST(test_cursors_and_writes_interleave);
+    RUN_TEST(test_early_close_and_errors);
+    RUN_TEST(test_reopen_keeps_rows);
+    return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include "test_support.h"
+#include "unity.h"
+#include "btree/btree.h"
+#include "cache/bloom.h"
+
+#define NUM_KEYS 20000 // Several times the smallest filter's capacity
+
+static BTreeHandle* tree;
+static BloomFilter* filter;
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    filter = NULL;
+}
+
+void tearDown(void) {
+    bloom_filter_close(filter);
+    close_btree(tree);
+    test_remove_dir();
+}
+
+static int key_at(int i) {
+    return (int)((i * 7919L) % 1000003) * 2; // Even keys only; odd ones are absent
+}
+
+// Insert keys [from, to) the way the engine does: index first, then filter
+static void insert_keys(int from, int to) {
+    for (int i = from; i < to; i++) {
+        btree_insert(tree, key_at(i), i);
+        TEST_ASSERT_EQUAL_INT(0, bloom_filter_add(filter, key_at(i)));
+    }
+}
+
+static void assert_no_false_negatives(BloomFilter* f, int count) {
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, bloom_filter_may_contain(f, key_at(i)), "false negative");
+    }
+}
+
+static void test_no_false_negatives_across_rebuilds(void) {
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    size_t initial_capacity = filter->capacity;
+    insert_keys(0, NUM_KEYS);
+    TEST_ASSERT_TRUE(filter->capacity > initial_capacity); // It had to grow
+    TEST_ASSERT_EQUAL_UINT64(NUM_KEYS, filter->num_keys);
+    assert_no_false_negatives(filter, NUM_KEYS);
+
+    // Absent keys are mostly rejected (about 1% false positives)
+    int maybe = 0;
+    for (int i = 0; i < 10000; i++) maybe += bloom_filter_may_contain(filter, 2 * i + 1);
+    TEST_ASSERT_TRUE(maybe < 500);
+}
+
+static void test_saved_filter_loads_complete(void) {
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    insert_keys(0, NUM_KEYS / 2);
+    bloom_filter_close(filter);
+
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    TEST_ASSERT_EQUAL_INT(0, filter->dirty); // Loaded, not rebuilt
+    assert_no_false_negatives(filter, NUM_KEYS / 2);
+    insert_keys(NUM_KEYS / 2, NUM_KEYS);
+    assert_no_false_negatives(filter, NUM_KEYS);
+}
+
+static void test_unsaved_filter_is_rebuilt(void) {
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    insert_keys(0, 100);
+    TEST_ASSERT_EQUAL_INT(0, bloom_filter_save(filter));
+    insert_keys(100, 1000); // Not saved: the file is marked dirty
+
+    // Opening the file now (as after a crash) must not trust the saved bits
+    BloomFilter* recovered = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(recovered);
+    assert_no_false_negatives(recovered, 1000);
+    bloom_filter_close(recovered);
+}
+
+static void test_discard_removes_the_file(void) {
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    insert_keys(0, 100);
+    bloom_filter_discard(filter);
+    filter = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, access(test_path("pk.bloom"), F_OK));
+
+    // A NULL filter answers "may contain" and ignores adds
+    TEST_ASSERT_EQUAL_INT(1, bloom_filter_may_contain(NULL, 12345));
+    TEST_ASSERT_EQUAL_INT(0, bloom_filter_add(NULL, 12345));
+
+    filter = bloom_filter_open(test_path("pk.bloom"), tree);
+    TEST_ASSERT_NOT_NULL(filter);
+    assert_no_false_negatives(filter, 100);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_no_false_negatives_across_rebuilds);
+    RUN_TEST(test_saved_filter_loads_complete);
+    RUN_TEST(test_unsaved_filter_is_rebuilt);
+    RUN_TEST(test_discard_removes_the_file);
+    return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include "test_support.h"
+#include "unity.h"
+#include "btree/btree.h"
+
+#define NUM_KEYS 2000
+
+static BTreeHandle* tree;
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    tree = NULL;
+}
+
+void tearDown(void) {
+    close_btree(tree);
+    test_remove_dir();
+}
+
+// Keys in a scrambled order, so inserts hit every part of the tree
+static int scrambled(int i) {
+    return (int)((i * 7919L) % 100003) + 1;
+}
+
+static void assert_all_found(int count) {
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_INT64((long)scrambled(i) * 10, search(tree, scrambled(i)));
+    }
+}
+
+static void test_insert_and_search(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    for (int i = 0; i < NUM_KEYS; i++) btree_insert(tree, scrambled(i), (long)scrambled(i) * 10);
+    assert_all_found(NUM_KEYS);
+    TEST_ASSERT_EQUAL_INT64(-1, search(tree, 0));
+    TEST_ASSERT_EQUAL_INT64(-1, search(tree, 100004));
+}
+
+static int count_visit(int key, long offset, void* ctx) {
+    int* state = ctx; // [0] = count, [1] = previous key, [2] = out of order
+    if (state[0] > 0 && key <= state[1]) state[2] = 1;
+    if (offset != (long)key * 10) state[2] = 1;
+    state[1] = key;
+    state[0]++;
+    return 0;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static void test_batch_insert_matches_single_inserts(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    // Several batches of sorted keys that interleave with each other
+    int keys[NUM_KEYS / 4];
+    long offsets[NUM_KEYS / 4];
+    for (int b = 0; b < 4; b++) {
+        for (int i = 0; i < NUM_KEYS / 4; i++) keys[i] = scrambled(b * (NUM_KEYS / 4) + i);
+        qsort(keys, NUM_KEYS / 4, sizeof(int), compare_ints);
+        for (int i = 0; i < NUM_KEYS / 4; i++) offsets[i] = (long)keys[i] * 10;
+        TEST_ASSERT_EQUAL_INT(0, btree_insert_batch(tree, keys, offsets, NUM_KEYS / 4));
+    }
+    // A batch of one goes through the same path
+    int one = 100050;
+    long one_offset = 1000500;
+    TEST_ASSERT_EQUAL_INT(0, btree_insert_batch(tree, &one, &one_offset, 1));
+    TEST_ASSERT_EQUAL_INT64(1000500, search(tree, 100050));
+    assert_all_found(NUM_KEYS);
+
+    int sorted[NUM_KEYS];
+    long found[NUM_KEYS];
+    for (int i = 0; i < NUM_KEYS; i++) sorted[i] = scrambled(i);
+    qsort(sorted, NUM_KEYS, sizeof(int), compare_ints);
+    TEST_ASSERT_EQUAL_INT(0, btree_search_batch(tree, sorted, NUM_KEYS, found));
+    for (int i = 0; i < NUM_KEYS; i++) TEST_ASSERT_EQUAL_INT64((long)sorted[i] * 10, found[i]);
+
+    int checked = 0;
+    TEST_ASSERT_EQUAL_INT(0, btree_verify(tree, &checked));
+    TEST_ASSERT_TRUE(checked > 0);
+}
+
+static void test_pinned_levels_follow_root_splits(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    for (int i = 0; i < NUM_KEYS; i++) btree_insert(tree, scrambled(i), (long)scrambled(i) * 10);
+    TEST_ASSERT_EQUAL_INT(tree->header.root_id, tree->pinned[0].node_id);
+    TEST_ASSERT_TRUE(tree->num_pinned > 1);
+    TEST_ASSERT_TRUE(tree->num_pinned <= tree->pinned_capacity);
+    int pinned = tree->num_pinned;
+    close_btree(tree);
+
+    // Pinning the reopened file from disk gives the same levels, so the
+    // write-through copies matched what was written
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_INT(pinned, tree->num_pinned);
+    assert_all_found(NUM_KEYS);
+    btree_insert(tree, 100050, 1000500);
+    TEST_ASSERT_EQUAL_INT64(1000500, search(tree, 100050));
+}
+
+static void test_checkpoint_writes_deferred_header(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    for (int i = 0; i < NUM_KEYS; i++) btree_insert(tree, scrambled(i), (long)scrambled(i) * 10);
+    TEST_ASSERT_EQUAL_INT(1, tree->header_dirty);
+    btree_checkpoint(tree);
+    TEST_ASSERT_EQUAL_INT(0, tree->header_dirty);
+}
+
+static void test_reopen_without_checkpoint_recovers_next_id(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    for (int i = 0; i < NUM_KEYS; i++) btree_insert(tree, scrambled(i), (long)scrambled(i) * 10);
+    // The nodes are in the file but the header is never checkpointed
+
+    // A second handle sees the file as it is after a crash
+    BTreeHandle* recovered = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(recovered);
+    TEST_ASSERT_EQUAL_INT(tree->header.next_id, recovered->header.next_id);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        TEST_ASSERT_EQUAL_INT64((long)scrambled(i) * 10, search(recovered, scrambled(i)));
+    }
+    close_btree(recovered);
+}
+
+static void test_cow_commits_each_insert(void) {
+    tree = init_btree(test_path("pk.idx"), BTREE_FLAG_COW, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    int first_root = tree->header.root_id;
+    for (int i = 0; i < 200; i++) btree_insert(tree, scrambled(i), (long)scrambled(i) * 10);
+    TEST_ASSERT_NOT_EQUAL(first_root, tree->header.root_id);
+
+    // A second handle opened without closing the first sees every
+    // committed insert, as after a crash
+    BTreeHandle* reader = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(reader);
+    TEST_ASSERT_TRUE(reader->header.flags & BTREE_FLAG_COW);
+    for (int i = 0; i < 200; i++) {
+        TEST_ASSERT_EQUAL_INT64((long)scrambled(i) * 10, search(reader, scrambled(i)));
+    }
+    close_btree(reader);
+}
+
+static void test_range_walk(void) {
+    tree = init_btree(test_path("pk.idx"), 0, 0);
+    TEST_ASSERT_NOT_NULL(tree);
+    for (int key = 1; key <= 500; key++) btree_insert(tree, key, (long)key * 10);
+    int state[3] = {0, 0, 0};
+    TEST_ASSERT_EQUAL_INT(0, btree_for_each_range(tree, 100, 199, count_visit, state));
+    TEST_ASSERT_EQUAL_INT(100, state[0]);
+    TEST_ASSERT_EQUAL_INT(199, state[1]);
+    TEST_ASSERT_EQUAL_INT(0, state[2]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_and_search);
+    RUN_TEST(test_batch_insert_matches_single_inserts);
+    RUN_TEST(test_pinned_levels_follow_root_splits);
+    RUN_TEST(test_checkpoint_writes_deferred_header);
+    RUN_TEST(test_reopen_without_checkpoint_recovers_next_id);
+    RUN_TEST(test_cow_commits_each_insert);
+    RUN_TEST(test_range_walk);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include "test_support.h"
+#include "unity.h"
+#include "util/extsort.h"
+#include "constants.h"
+
+#define NUM_RECORDS 20000
+#define RUN_RECORDS 100 // Memory budget of the spilling sorts, in records: 200 runs
+
+typedef struct {
+    int key;
+    int seq;      // Order of sort_add, to check stability
+    char pad[8];
+} Record;
+
+// Budget that holds `records` records (each also costs two pointers)
+#define BUDGET(records) ((records) * (sizeof(Record) + 2 * sizeof(char*)))
+
+static ExternalSort sort;
+
+// Run files go to the test's directory
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    memset(&sort, 0, sizeof(sort));
+}
+
+void tearDown(void) {
+    sort_free(&sort);
+    test_remove_dir();
+}
+
+static int compare_keys(const void* a, const void* b, void* ctx) {
+    (void)ctx;
+    int x = ((const Record*)a)->key, y = ((const Record*)b)->key;
+    return (x > y) - (x < y);
+}
+
+// Add NUM_RECORDS records whose keys repeat (1000 distinct, scrambled)
+static void add_records(void) {
+    Record record;
+    memset(&record, 0, sizeof(record));
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        record.key = (int)((i * 7919L) % 1000);
+        record.seq = i;
+        TEST_ASSERT_EQUAL_INT(0, sort_add(&sort, &record));
+    }
+}
+
+// Every record comes back once, by key, and equal keys in the order added
+static void check_sorted(void) {
+    TEST_ASSERT_EQUAL_INT(0, sort_finish(&sort));
+    const Record* record;
+    Record previous = {-1, -1, {0}};
+    long count = 0, seq_sum = 0;
+    while ((record = sort_next(&sort)) != NULL) {
+        TEST_ASSERT_TRUE(record->key >= previous.key);
+        if (record->key == previous.key) TEST_ASSERT_TRUE(record->seq > previous.seq);
+        previous = *record;
+        seq_sum += record->seq;
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT(0, sort.error);
+    TEST_ASSERT_EQUAL_INT64(NUM_RECORDS, count);
+    TEST_ASSERT_EQUAL_INT64((long)NUM_RECORDS * (NUM_RECORDS - 1) / 2, seq_sum);
+}
+
+static void test_sort_in_memory(void) {
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), SORT_MEMORY_BUDGET, test_dir, compare_keys, NULL));
+    add_records();
+    TEST_ASSERT_EQUAL_INT(0, sort.num_runs);
+    check_sorted();
+}
+
+static void test_sort_spills_runs(void) {
+    // Fewer runs than SORT_MERGE_FANIN: one merge
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), BUDGET(NUM_RECORDS / 50), test_dir, compare_keys, NULL));
+    add_records();
+    TEST_ASSERT_TRUE(sort.num_runs > 1);
+    TEST_ASSERT_TRUE(sort.num_runs <= SORT_MERGE_FANIN);
+    check_sorted();
+}
+
+static void test_sort_merges_in_passes(void) {
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), BUDGET(RUN_RECORDS), test_dir, compare_keys, NULL));
+    add_records();
+    TEST_ASSERT_TRUE(sort.num_runs > SORT_MERGE_FANIN);
+    check_sorted();
+    TEST_ASSERT_TRUE(sort.num_readers <= SORT_MERGE_FANIN);
+}
+
+// The heap keeps the first records of the stable order: the lowest keys,
+// and among equal keys the first added
+static void test_sort_top_n(void) {
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), BUDGET(RUN_RECORDS), test_dir, compare_keys, NULL));
+    TEST_ASSERT_EQUAL_INT(1, sort_set_limit(&sort, 50));
+    add_records();
+    TEST_ASSERT_EQUAL_INT(0, sort.num_runs);
+    TEST_ASSERT_EQUAL_INT(0, sort_finish(&sort));
+    const Record* record;
+    int previous_seq = -1;
+    long count = 0;
+    while ((record = sort_next(&sort)) != NULL) {
+        // Each key is added NUM_RECORDS / 1000 times, 1000 records apart
+        TEST_ASSERT_EQUAL_INT(count / (NUM_RECORDS / 1000), record->key);
+        if (count % (NUM_RECORDS / 1000) != 0) TEST_ASSERT_EQUAL_INT(previous_seq + 1000, record->seq);
+        previous_seq = record->seq;
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT64(50, count);
+
+    // Past the budget the sort keeps everything
+    sort_free(&sort);
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), BUDGET(RUN_RECORDS), test_dir, compare_keys, NULL));
+    TEST_ASSERT_EQUAL_INT(0, sort_set_limit(&sort, 10 * RUN_RECORDS));
+}
+
+static void test_empty_sort(void) {
+    TEST_ASSERT_EQUAL_INT(0, sort_init(&sort, sizeof(Record), BUDGET(RUN_RECORDS), test_dir, compare_keys, NULL));
+    TEST_ASSERT_EQUAL_INT(0, sort_finish(&sort));
+    TEST_ASSERT_NULL(sort_next(&sort));
+    TEST_ASSERT_EQUAL_INT(0, sort.error);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sort_in_memory);
+    RUN_TEST(test_sort_spills_runs);
+    RUN_TEST(test_sort_merges_in_passes);
+    RUN_TEST(test_sort_top_n);
+    RUN_TEST(test_empty_sort);
+    return UNITY_END();
+}
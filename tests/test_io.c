@@ -0,0 +1,154 @@
+#include "test_support.h"
+#include "unity.h"
+#include "io/io.h"
+
+#define BLOCK 4096
+#define NUM_BLOCKS 256 // More reads than one ring holds in flight
+
+static IoFile* file;
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    file = NULL;
+}
+
+void tearDown(void) {
+    io_close(file);
+    io_thread_cleanup();
+    test_remove_dir();
+}
+
+// Every byte of block b is (b + i) & 0xff, so misplaced reads show up
+static void fill_block(unsigned char* buf, int b) {
+    for (int i = 0; i < BLOCK; i++) buf[i] = (unsigned char)(b + i);
+}
+
+static void write_blocks(void) {
+    file = io_open(test_path("data"), IO_OPEN_CREATE);
+    TEST_ASSERT_NOT_NULL(file);
+    unsigned char buf[BLOCK];
+    for (int b = 0; b < NUM_BLOCKS; b++) {
+        fill_block(buf, b);
+        TEST_ASSERT_EQUAL_INT(BLOCK, io_pwrite(file, buf, BLOCK, (off_t)b * BLOCK));
+    }
+    TEST_ASSERT_EQUAL_INT(0, io_sync(file));
+    TEST_ASSERT_EQUAL_INT64((off_t)NUM_BLOCKS * BLOCK, io_size(file));
+}
+
+static void check_batch_reads(IoBackend backend) {
+    io_set_backend(backend);
+    write_blocks();
+
+    static unsigned char bufs[NUM_BLOCKS + 1][BLOCK];
+    IoRequest reqs[NUM_BLOCKS + 1];
+    for (int b = 0; b < NUM_BLOCKS; b++) {
+        int block = (b * 37) % NUM_BLOCKS; // Out of order
+        reqs[b] = (IoRequest){file, bufs[b], BLOCK, (off_t)block * BLOCK, -1, 0, 0};
+    }
+    // A read that starts half a block before the end is short
+    reqs[NUM_BLOCKS] = (IoRequest){file, bufs[NUM_BLOCKS], BLOCK, (off_t)NUM_BLOCKS * BLOCK - BLOCK / 2, -1, 0, 0};
+
+    TEST_ASSERT_EQUAL_INT(0, io_read_batch(reqs, NUM_BLOCKS + 1));
+    unsigned char expected[BLOCK];
+    for (int b = 0; b < NUM_BLOCKS; b++) {
+        TEST_ASSERT_TRUE(reqs[b].done);
+        TEST_ASSERT_EQUAL_INT(BLOCK, reqs[b].result);
+        fill_block(expected, (b * 37) % NUM_BLOCKS);
+        TEST_ASSERT_EQUAL_MEMORY(expected, bufs[b], BLOCK);
+    }
+    TEST_ASSERT_EQUAL_INT(BLOCK / 2, reqs[NUM_BLOCKS].result);
+    fill_block(expected, NUM_BLOCKS - 1);
+    TEST_ASSERT_EQUAL_MEMORY(expected + BLOCK / 2, bufs[NUM_BLOCKS], BLOCK / 2);
+}
+
+static void test_batch_reads_with_pread(void) {
+    check_batch_reads(IO_BACKEND_PREAD);
+}
+
+static void test_batch_reads_with_io_uring(void) {
+    check_batch_reads(IO_BACKEND_IO_URING); // Falls back to pread without a ring
+}
+
+static void test_submit_then_wait_in_any_order(void) {
+    io_set_backend(IO_BACKEND_IO_URING);
+    write_blocks();
+    unsigned char bufs[4][BLOCK], expected[BLOCK];
+    IoRequest reqs[4];
+    for (int i = 0; i < 4; i++) reqs[i] = (IoRequest){file, bufs[i], BLOCK, (off_t)(i * 10) * BLOCK, -1, 0, 0};
+    TEST_ASSERT_EQUAL_INT(0, io_read_submit(reqs, 4));
+    for (int i = 3; i >= 0; i--) {
+        TEST_ASSERT_EQUAL_INT(BLOCK, io_read_wait(&reqs[i]));
+        fill_block(expected, i * 10);
+        TEST_ASSERT_EQUAL_MEMORY(expected, bufs[i], BLOCK);
+    }
+}
+
+static void test_registered_buffers(void) {
+    io_set_backend(IO_BACKEND_IO_URING);
+    write_blocks();
+    static unsigned char frames[2][BLOCK];
+    void* bufs[2] = {frames[0], frames[1]};
+    int registered = io_register_buffers(bufs, BLOCK, 2);
+    TEST_ASSERT_TRUE(registered == 0 || registered == 1);
+    // The thread's set is not replaced while it is registered
+    if (registered == 0) TEST_ASSERT_EQUAL_INT(1, io_register_buffers(bufs, BLOCK, 2));
+
+    int index = (registered == 0) ? 1 : -1;
+    IoRequest req = {file, frames[1], BLOCK, 7 * BLOCK, index, 0, 0};
+    TEST_ASSERT_EQUAL_INT(0, io_read_batch(&req, 1));
+    unsigned char expected[BLOCK];
+    fill_block(expected, 7);
+    TEST_ASSERT_EQUAL_MEMORY(expected, frames[1], BLOCK);
+    if (registered == 0) io_unregister_buffers();
+
+    // The pread backend never registers
+    io_set_backend(IO_BACKEND_PREAD);
+    TEST_ASSERT_EQUAL_INT(1, io_register_buffers(bufs, BLOCK, 2));
+}
+
+static void test_direct_unaligned_writes_go_through_bounce_frames(void) {
+    file = io_open(test_path("direct"), IO_OPEN_CREATE | IO_OPEN_DIRECT);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_INT(1, file->direct);
+
+    // 60-byte records, as a table appends rows
+    unsigned char record[60], out[60];
+    for (int r = 0; r < 100; r++) {
+        memset(record, r + 1, sizeof(record));
+        TEST_ASSERT_EQUAL_INT(sizeof(record), io_pwrite(file, record, sizeof(record), (off_t)r * 60));
+    }
+    TEST_ASSERT_EQUAL_INT64(6000, io_size(file));
+    for (int r = 0; r < 100; r++) {
+        memset(record, r + 1, sizeof(record));
+        TEST_ASSERT_EQUAL_INT(sizeof(record), io_pread(file, out, sizeof(out), (off_t)r * 60));
+        TEST_ASSERT_EQUAL_MEMORY(record, out, sizeof(record));
+    }
+
+    // The last block is written whole: the file ends in zero padding
+    struct stat st;
+    TEST_ASSERT_EQUAL_INT(0, stat(test_path("direct"), &st));
+    TEST_ASSERT_EQUAL_INT64(2 * IO_ALIGNMENT, st.st_size);
+    unsigned char* frame = io_alloc_aligned(IO_ALIGNMENT);
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_EQUAL_INT(IO_ALIGNMENT, io_pread(file, frame, IO_ALIGNMENT, IO_ALIGNMENT));
+    for (int i = 6000 - IO_ALIGNMENT; i < IO_ALIGNMENT; i++) TEST_ASSERT_EQUAL_UINT8(0, frame[i]);
+
+    // Aligned requests go straight to the device
+    memset(frame, 0xab, IO_ALIGNMENT);
+    TEST_ASSERT_EQUAL_INT(IO_ALIGNMENT, io_pwrite(file, frame, IO_ALIGNMENT, 2 * IO_ALIGNMENT));
+    TEST_ASSERT_EQUAL_INT64(3 * IO_ALIGNMENT, io_size(file));
+    memset(frame, 0, IO_ALIGNMENT);
+    TEST_ASSERT_EQUAL_INT(IO_ALIGNMENT, io_pread(file, frame, IO_ALIGNMENT, 2 * IO_ALIGNMENT));
+    TEST_ASSERT_EQUAL_UINT8(0xab, frame[IO_ALIGNMENT - 1]);
+    io_free_aligned(frame);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_reads_with_pread);
+    RUN_TEST(test_batch_reads_with_io_uring);
+    RUN_TEST(test_submit_then_wait_in_any_order);
+    RUN_TEST(test_registered_buffers);
+    RUN_TEST(test_direct_unaligned_writes_go_through_bounce_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,46 @@
+#include "test_support.h"
+#include "unity.h"
+#include "util/log.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Runs first: the level is read from the environment on first use
+static void test_level_comes_from_environment(void) {
+    TEST_ASSERT_EQUAL_INT(0, setenv("DB_LOG_LEVEL", "Info", 1));
+    TEST_ASSERT_EQUAL_INT(LOG_LEVEL_INFO, log_get_level());
+    TEST_ASSERT_TRUE(log_enabled(LOG_LEVEL_WARN));
+    TEST_ASSERT_TRUE(log_enabled(LOG_LEVEL_INFO));
+    TEST_ASSERT_FALSE(log_enabled(LOG_LEVEL_DEBUG));
+}
+
+static void test_parse_and_set_level(void) {
+    LogLevel level = LOG_LEVEL_ERROR;
+    TEST_ASSERT_EQUAL_INT(0, log_parse_level("DEBUG", &level));
+    TEST_ASSERT_EQUAL_INT(LOG_LEVEL_DEBUG, level);
+    TEST_ASSERT_EQUAL_INT(-1, log_parse_level("verbose", &level));
+    TEST_ASSERT_EQUAL_INT(LOG_LEVEL_DEBUG, level); // Unchanged
+
+    log_set_level(LOG_LEVEL_ERROR);
+    TEST_ASSERT_TRUE(log_enabled(LOG_LEVEL_ERROR));
+    TEST_ASSERT_FALSE(log_enabled(LOG_LEVEL_WARN));
+    log_set_level(LOG_LEVEL_DEBUG);
+    TEST_ASSERT_EQUAL_INT(LOG_COMPILE_LEVEL == LOG_LEVEL_DEBUG, log_enabled(LOG_LEVEL_DEBUG));
+}
+
+// Arguments of a disabled message are never evaluated
+static void test_disabled_message_skips_arguments(void) {
+    int evaluated = 0;
+    log_set_level(LOG_LEVEL_WARN);
+    log_info("value %d", ++evaluated);
+    TEST_ASSERT_EQUAL_INT(0, evaluated);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_level_comes_from_environment);
+    RUN_TEST(test_parse_and_set_level);
+    RUN_TEST(test_disabled_message_skips_arguments);
+    return UNITY_END();
+}
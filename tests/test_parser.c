@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include "unity.h"
+#include "query/parser.h"
+
+static Arena arena;
+static char error[PARSE_ERROR_LEN];
+
+void setUp(void) {
+    arena_init(&arena);
+    error[0] = '\0';
+}
+
+void tearDown(void) {
+    arena_free(&arena);
+}
+
+static Statement* parse(const char* sql) {
+    arena_reset(&arena);
+    error[0] = '\0';
+    return parse_statement(sql, &arena, error, sizeof(error));
+}
+
+static void assert_rejected(const char* sql) {
+    TEST_ASSERT_NULL_MESSAGE(parse(sql), sql);
+    TEST_ASSERT_TRUE_MESSAGE(error[0] != '\0', "no error message");
+}
+
+static void test_select_star_with_where(void) {
+    Statement* stmt = parse("SELECT * FROM users WHERE id = 5;");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_SELECT, stmt->kind);
+    TEST_ASSERT_TRUE(span_equals(stmt->select.table, "users"));
+    TEST_ASSERT_TRUE(stmt->select.select_all);
+    TEST_ASSERT_EQUAL_INT64(-1, stmt->select.limit);
+    Expr* where = stmt->select.where;
+    TEST_ASSERT_NOT_NULL(where);
+    TEST_ASSERT_EQUAL_INT(EXPR_COMPARE, where->type);
+    TEST_ASSERT_EQUAL_INT(CMP_EQ, where->op);
+    TEST_ASSERT_TRUE(span_equals(where->left->text, "id"));
+    TEST_ASSERT_EQUAL_INT(EXPR_INT, where->right->type);
+    TEST_ASSERT_EQUAL_INT64(5, where->right->int_value);
+}
+
+static void test_select_full_grammar(void) {
+    Statement* stmt = parse("SELECT name, COUNT(*), SUM(price) FROM users "
+                            "WHERE NOT (price < 10 OR name <> 'it''s') AND id >= ? "
+                            "GROUP BY name ORDER BY price DESC, name LIMIT 7");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    SelectStmt* select = &stmt->select;
+    TEST_ASSERT_EQUAL_INT(1, stmt->num_params);
+    TEST_ASSERT_FALSE(select->select_all);
+    TEST_ASSERT_EQUAL_INT(3, select->num_columns);
+    TEST_ASSERT_TRUE(span_equals(select->columns[0].column, "name"));
+    TEST_ASSERT_EQUAL_INT(AGG_COUNT, select->columns[1].func);
+    TEST_ASSERT_EQUAL_INT(AGG_SUM, select->columns[2].func);
+    TEST_ASSERT_EQUAL_INT(EXPR_AND, select->where->type);
+    TEST_ASSERT_EQUAL_INT(EXPR_NOT, select->where->left->type);
+    TEST_ASSERT_EQUAL_INT(EXPR_PARAM, select->where->right->right->type);
+    TEST_ASSERT_EQUAL_INT(1, select->num_group_by);
+    TEST_ASSERT_EQUAL_INT(2, select->num_order_by);
+    TEST_ASSERT_TRUE(select->order_by[0].descending);
+    TEST_ASSERT_FALSE(select->order_by[1].descending);
+    TEST_ASSERT_EQUAL_INT64(7, select->limit);
+
+    char text[16];
+    Expr* quoted = select->where->left->left->right->right;
+    TEST_ASSERT_EQUAL_INT(EXPR_STRING, quoted->type);
+    TEST_ASSERT_EQUAL_STRING("it's", expr_string_copy(quoted, text, sizeof(text)));
+}
+
+static void test_insert_forms(void) {
+    Statement* stmt = parse("INSERT INTO users VALUES (1, 'a'), (2, ?), (3, bare)");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_INSERT, stmt->kind);
+    TEST_ASSERT_EQUAL_INT(3, stmt->insert.num_rows);
+    TEST_ASSERT_EQUAL_INT(2, stmt->insert.row_width);
+    TEST_ASSERT_EQUAL_INT(1, stmt->num_params);
+    TEST_ASSERT_NULL(stmt->insert.columns);
+
+    stmt = parse("INSERT INTO users (name, id) VALUES ('b', 4)");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(2, stmt->insert.num_columns);
+    TEST_ASSERT_TRUE(span_equals(stmt->insert.columns[0], "name"));
+}
+
+static void test_ddl(void) {
+    Statement* stmt = parse("CREATE TABLE t (id INT PRIMARY KEY, name STRING(20)) WITH (cow, direct)");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_CREATE_TABLE, stmt->kind);
+    CreateTableStmt* create = &stmt->create_table;
+    TEST_ASSERT_EQUAL_INT(2, create->num_columns);
+    TEST_ASSERT_TRUE(create->columns[0].primary_key);
+    TEST_ASSERT_EQUAL_INT(COL_TYPE_STRING, create->columns[1].type);
+    TEST_ASSERT_EQUAL_INT(20, create->columns[1].size);
+    TEST_ASSERT_EQUAL_INT(2, create->num_options);
+
+    stmt = parse("DROP TABLE t");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_DROP_TABLE, stmt->kind);
+    TEST_ASSERT_TRUE(span_equals(stmt->drop_table.table, "t"));
+}
+
+static void test_update_and_delete(void) {
+    Statement* stmt = parse("UPDATE users SET name = 'x', age = 3 WHERE id = 1");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_UPDATE, stmt->kind);
+    TEST_ASSERT_EQUAL_INT(2, stmt->update.num_assignments);
+
+    stmt = parse("DELETE FROM users");
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, error);
+    TEST_ASSERT_EQUAL_INT(AST_DELETE, stmt->kind);
+    TEST_ASSERT_NULL(stmt->del.where);
+}
+
+static void test_rejects_malformed_statements(void) {
+    assert_rejected("");
+    assert_rejected("SELEC * FROM users");
+    assert_rejected("SELECT FROM users");
+    assert_rejected("SELECT * users");
+    assert_rejected("SELECT * FROM users WHERE");
+    assert_rejected("SELECT * FROM users WHERE id = ");
+    assert_rejected("SELECT * FROM users WHERE (id = 1");
+    assert_rejected("SELECT * FROM users LIMIT x");
+    assert_rejected("SELECT * FROM users extra");
+    assert_rejected("SELECT COUNT(* FROM users");
+    assert_rejected("SELECT * FROM users JOIN orders");
+    assert_rejected("INSERT INTO users VALUES (1, 'a'");
+    assert_rejected("INSERT INTO users VALUES (1, 'a'), (2)");
+    assert_rejected("INSERT users VALUES (1)");
+    assert_rejected("SELECT * FROM users WHERE name = 'unterminated");
+    assert_rejected("CREATE TABLE t (id INT PRIMARY KEY, name STRING)");
+    assert_rejected("CREATE TABLE t ()");
+    assert_rejected("DROP TABLE");
+    assert_rejected("SELECT * FROM users; SELECT * FROM users");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_select_star_with_where);
+    RUN_TEST(test_select_full_grammar);
+    RUN_TEST(test_insert_forms);
+    RUN_TEST(test_ddl);
+    RUN_TEST(test_update_and_delete);
+    RUN_TEST(test_rejects_malformed_statements);
+    return UNITY_END();
+}
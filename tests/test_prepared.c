@@ -0,0 +1,85 @@
+#include "test_support.h"
+#include "unity.h"
+#include "database/database.h"
+#include "query/prepared.h"
+#include "constants.h"
+
+static Database* db;
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+}
+
+void tearDown(void) {
+    stmt_deallocate_all(db);
+    close_database(db);
+    test_remove_dir();
+}
+
+static int copy_row(const TableSchema* schema, const void* row, void* ctx) {
+    memcpy(ctx, row, schema->row_size);
+    return 0;
+}
+
+static void test_bound_values_are_inserted_and_selected(void) {
+    PreparedStatement* insert = stmt_prepare(db, "INSERT INTO users VALUES (?, ?)");
+    TEST_ASSERT_NOT_NULL(insert);
+    TEST_ASSERT_EQUAL_INT(2, insert->num_params);
+    TEST_ASSERT_EQUAL_INT(-1, stmt_execute(insert, NULL, NULL)); // Nothing bound yet
+    char name[32];
+    for (int id = 1; id <= 50; id++) {
+        snprintf(name, sizeof(name), "user %d", id);
+        TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(insert, 0, id));
+        TEST_ASSERT_EQUAL_INT(0, stmt_bind_text(insert, 1, name));
+        TEST_ASSERT_EQUAL_INT(0, stmt_execute(insert, NULL, NULL));
+    }
+    TEST_ASSERT_EQUAL_INT(1, stmt_execute(insert, NULL, NULL)); // Still bound: duplicate key
+    TEST_ASSERT_EQUAL_INT(-1, stmt_bind_int(insert, 2, 0));
+    stmt_finalize(insert);
+
+    PreparedStatement* select = stmt_prepare(db, "SELECT * FROM users WHERE id = ?");
+    TEST_ASSERT_NOT_NULL(select);
+    char row[256] = "";
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(select, 0, 42));
+    TEST_ASSERT_EQUAL_INT64(1, stmt_execute(select, copy_row, row));
+    TEST_ASSERT_EQUAL_INT(42, *(int*)row);
+    TEST_ASSERT_EQUAL_STRING("user 42", row + sizeof(int));
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(select, 0, 51));
+    TEST_ASSERT_EQUAL_INT64(0, stmt_execute(select, copy_row, row));
+    stmt_finalize(select);
+
+    TEST_ASSERT_NULL(stmt_prepare(db, "SELECT * FROM nowhere WHERE id = ?"));
+}
+
+static void test_registering_a_name_again(void) {
+    PreparedStatement* first = stmt_prepare(db, "INSERT INTO users VALUES (?, 'x')");
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_EQUAL_INT(0, stmt_register(db, "add", first));
+
+    // The same statement under its own name stays alive
+    TEST_ASSERT_EQUAL_INT(0, stmt_register(db, "add", first));
+    TEST_ASSERT_EQUAL_PTR(first, stmt_find(db, "add"));
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(first, 0, 1));
+    TEST_ASSERT_EQUAL_INT(0, stmt_execute(first, NULL, NULL));
+
+    // Another statement replaces it
+    PreparedStatement* second = stmt_prepare(db, "INSERT INTO users VALUES (?, 'y')");
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL_INT(0, stmt_register(db, "add", second));
+    TEST_ASSERT_EQUAL_PTR(second, stmt_find(db, "add"));
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(second, 0, 2));
+    TEST_ASSERT_EQUAL_INT(0, stmt_execute(second, NULL, NULL));
+
+    TEST_ASSERT_EQUAL_INT(0, stmt_deallocate(db, "add"));
+    TEST_ASSERT_NULL(stmt_find(db, "add"));
+    TEST_ASSERT_EQUAL_INT(1, stmt_deallocate(db, "add"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bound_values_are_inserted_and_selected);
+    RUN_TEST(test_registering_a_name_again);
+    return UNITY_END();
+}
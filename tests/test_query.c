@@ -0,0 +1,409 @@
+#include "test_support.h"
+#include <stdint.h>
+#include "unity.h"
+#include "database/database.h"
+#include "query/prepared.h"
+#include "constants.h"
+
+#define NUM_PRODUCTS 1000 // products: prod_id 1..1000 (inserted out of order), price = prod_id % 10
+#define MAX_RESULT_ROWS 1100
+
+static Database* db;
+
+// Result rows copied out of the sink
+typedef struct {
+    const TableSchema* schema;
+    char* rows;
+    long count;
+} Result;
+
+static Result result;
+
+static long execute(const char* sql) {
+    PreparedStatement* stmt = stmt_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, sql);
+    long status = stmt_execute(stmt, NULL, NULL);
+    stmt_finalize(stmt);
+    return status;
+}
+
+static int collect(const TableSchema* schema, const void* row, void* ctx) {
+    Result* out = ctx;
+    if (out->count < MAX_RESULT_ROWS) {
+        memcpy(out->rows + (size_t)out->count * schema->row_size, row, schema->row_size);
+    }
+    out->count++;
+    return 0;
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+    char sql[128];
+    for (int i = 0; i < NUM_PRODUCTS; i++) {
+        // Scattered over the file, so zone maps cannot narrow a scan by id
+        int id = (i * 7919) % NUM_PRODUCTS + 1;
+        snprintf(sql, sizeof(sql), "INSERT INTO products VALUES (%d, 'product%d', %d)", id, id, id % 10);
+        TEST_ASSERT_EQUAL_INT64(0, execute(sql));
+    }
+    memset(&result, 0, sizeof(result));
+}
+
+void tearDown(void) {
+    free(result.rows);
+    stmt_deallocate_all(db);
+    close_database(db);
+    test_remove_dir();
+}
+
+/**
+ * Plan and run a SELECT, keeping its rows in `result`.
+ * @return The statement (the caller finalizes it), for checking its plan.
+ */
+static PreparedStatement* query(const char* sql) {
+    PreparedStatement* stmt = stmt_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, sql);
+    TEST_ASSERT_EQUAL_INT(STMT_SELECT, stmt->type);
+    free(result.rows);
+    result.schema = stmt->plan->output;
+    result.rows = malloc(MAX_RESULT_ROWS * result.schema->row_size);
+    result.count = 0;
+    TEST_ASSERT_NOT_NULL(result.rows);
+    long count = stmt_execute(stmt, collect, &result);
+    TEST_ASSERT_EQUAL_INT64(result.count, count);
+    return stmt;
+}
+
+// Numeric value of column `col` of result row `row`
+static long long value(long row, int col) {
+    const ColumnDefinition* column = &result.schema->columns[col];
+    const char* field = result.rows + (size_t)row * result.schema->row_size + column->offset;
+    if (column->type == COL_TYPE_LONG) {
+        int64_t v;
+        memcpy(&v, field, sizeof(v));
+        return v;
+    }
+    int v;
+    memcpy(&v, field, sizeof(v));
+    return v;
+}
+
+static long long column_sum(int col) {
+    long long sum = 0;
+    for (long r = 0; r < result.count; r++) sum += value(r, col);
+    return sum;
+}
+
+static void test_point_lookup(void) {
+    PreparedStatement* stmt = query("SELECT * FROM products WHERE prod_id = 42");
+    TEST_ASSERT_EQUAL_INT(ACCESS_POINT_LOOKUP, stmt->plan->access);
+    TEST_ASSERT_EQUAL_INT64(1, result.count);
+    TEST_ASSERT_EQUAL_INT64(42, value(0, 0));
+    TEST_ASSERT_EQUAL_STRING("product42", result.rows + result.schema->columns[1].offset);
+    TEST_ASSERT_EQUAL_INT64(2, value(0, 2));
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT * FROM products WHERE prod_id = 5000");
+    TEST_ASSERT_EQUAL_INT64(0, result.count);
+    stmt_finalize(stmt);
+}
+
+static void test_index_range_scan(void) {
+    PreparedStatement* stmt = query("SELECT * FROM products WHERE prod_id >= 100 AND prod_id < 105");
+    TEST_ASSERT_EQUAL_INT(ACCESS_INDEX_RANGE_SCAN, stmt->plan->access);
+    TEST_ASSERT_EQUAL_INT64(5, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(100 + r, value(r, 0)); // Key order
+    stmt_finalize(stmt);
+
+    // Most of the table: reading it sequentially is cheaper
+    stmt = query("SELECT * FROM products WHERE prod_id > 50");
+    TEST_ASSERT_EQUAL_INT(ACCESS_FULL_SCAN, stmt->plan->access);
+    TEST_ASSERT_EQUAL_INT64(950, result.count);
+    stmt_finalize(stmt);
+}
+
+static void test_full_scan_with_filter(void) {
+    PreparedStatement* stmt = query("SELECT * FROM products WHERE price = 3 OR description = 'product10'");
+    TEST_ASSERT_EQUAL_INT(ACCESS_FULL_SCAN, stmt->plan->access);
+    TEST_ASSERT_EQUAL_INT64(101, result.count);
+    TEST_ASSERT_EQUAL_INT64(3 * 100, column_sum(2)); // product10 has price 0
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT * FROM products WHERE NOT (price < 9) AND prod_id <= 100");
+    TEST_ASSERT_EQUAL_INT64(10, result.count);
+    stmt_finalize(stmt);
+}
+
+static void test_projection(void) {
+    PreparedStatement* stmt = query("SELECT price, prod_id FROM products WHERE prod_id = 42");
+    TEST_ASSERT_EQUAL_INT(2, result.schema->num_columns);
+    TEST_ASSERT_EQUAL_size_t(2 * sizeof(int), result.schema->row_size);
+    TEST_ASSERT_EQUAL_INT64(1, result.count);
+    TEST_ASSERT_EQUAL_INT64(2, value(0, 0));
+    TEST_ASSERT_EQUAL_INT64(42, value(0, 1));
+    stmt_finalize(stmt);
+
+    // Filter columns need not be selected
+    stmt = query("SELECT description FROM products WHERE price = 9 AND prod_id < 10");
+    TEST_ASSERT_EQUAL_INT64(1, result.count);
+    TEST_ASSERT_EQUAL_STRING("product9", result.rows);
+    stmt_finalize(stmt);
+
+    TEST_ASSERT_NULL(stmt_prepare(db, "SELECT nope FROM products"));
+}
+
+static void test_aggregates_and_group_by(void) {
+    PreparedStatement* stmt = query("SELECT COUNT(*), SUM(prod_id), MIN(prod_id), MAX(prod_id) FROM products");
+    TEST_ASSERT_NOT_NULL(stmt->plan->aggregation);
+    TEST_ASSERT_EQUAL_INT64(1, result.count);
+    TEST_ASSERT_EQUAL_INT(COL_TYPE_LONG, result.schema->columns[0].type);
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS, value(0, 0));
+    TEST_ASSERT_EQUAL_INT64(500500, value(0, 1));
+    TEST_ASSERT_EQUAL_INT64(1, value(0, 2));
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS, value(0, 3));
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT AVG(prod_id) FROM products WHERE prod_id <= 10");
+    TEST_ASSERT_EQUAL_INT(COL_TYPE_DOUBLE, result.schema->columns[0].type);
+    double avg;
+    memcpy(&avg, result.rows, sizeof(avg));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 5.5f, (float)avg);
+    stmt_finalize(stmt);
+
+    // Groups come out in no particular order
+    stmt = query("SELECT price, COUNT(*), SUM(prod_id) FROM products GROUP BY price");
+    TEST_ASSERT_EQUAL_INT64(10, result.count);
+    int seen = 0;
+    for (long r = 0; r < result.count; r++) {
+        long long price = value(r, 0);
+        seen |= 1 << price;
+        TEST_ASSERT_EQUAL_INT64(100, value(r, 1));
+        TEST_ASSERT_EQUAL_INT64(price == 0 ? 50500 : 49500 + 100 * price, value(r, 2));
+    }
+    TEST_ASSERT_EQUAL_INT(0x3ff, seen);
+    stmt_finalize(stmt);
+
+    TEST_ASSERT_NULL(stmt_prepare(db, "SELECT description, COUNT(*) FROM products GROUP BY price"));
+}
+
+// users: id 1..count, named by name_of(id)
+static void add_users(int count, void (*name_of)(int id, char* name, size_t size)) {
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_NOT_NULL(users);
+    char* rows = calloc(count, users->row_size);
+    TEST_ASSERT_NOT_NULL(rows);
+    for (int id = 1; id <= count; id++) {
+        char* row = rows + (size_t)(id - 1) * users->row_size;
+        memcpy(row + users->columns[0].offset, &id, sizeof(id));
+        name_of(id, row + users->columns[1].offset, users->columns[1].size);
+    }
+    TEST_ASSERT_EQUAL_INT(0, insert_rows(db, "users", rows, count));
+    free(rows);
+}
+
+static void group_name(int id, char* name, size_t size) {
+    snprintf(name, size, "group%d", id % 10);
+}
+
+static void test_join(void) {
+    add_users(9, group_name);
+    PreparedStatement* stmt = query("SELECT products.prod_id, users.name FROM products JOIN users ON products.price = users.id "
+                                    "WHERE products.prod_id <= 100");
+    TEST_ASSERT_NOT_NULL(stmt->plan->join);
+    TEST_ASSERT_EQUAL_INT64(90, result.count); // Price 0 has no user
+    TEST_ASSERT_EQUAL_INT64(5050 - (10 + 100) * 10 / 2, column_sum(0));
+    char expected[16];
+    for (long r = 0; r < result.count; r++) {
+        snprintf(expected, sizeof(expected), "group%d", (int)(value(r, 0) % 10));
+        TEST_ASSERT_EQUAL_STRING(expected, result.rows + (size_t)r * result.schema->row_size + result.schema->columns[1].offset);
+    }
+    stmt_finalize(stmt);
+}
+
+// Half the users share one name, so one partition stays over any budget
+static void skewed_name(int id, char* name, size_t size) {
+    snprintf(name, size, "product%d", id <= 250 ? 1 : id);
+}
+
+static void test_hash_join_spills_over_small_budget(void) {
+    add_users(500, skewed_name);
+    const char* sql = "SELECT users.id, products.prod_id FROM users JOIN products ON users.name = products.description";
+    for (int pass = 0; pass < 2; pass++) {
+        PreparedStatement* stmt = stmt_prepare(db, sql);
+        TEST_ASSERT_NOT_NULL(stmt);
+        TEST_ASSERT_EQUAL_INT(JOIN_HASH, stmt->plan->join->method);
+        // Spill to partition files, split them again and load the skewed one whole
+        if (pass == 1) stmt->plan->join->memory_budget = 1024;
+        free(result.rows);
+        result.schema = stmt->plan->output;
+        result.rows = malloc(MAX_RESULT_ROWS * result.schema->row_size);
+        result.count = 0;
+        TEST_ASSERT_EQUAL_INT64(500, stmt_execute(stmt, collect, &result));
+        TEST_ASSERT_EQUAL_INT64(125250, column_sum(0));
+        TEST_ASSERT_EQUAL_INT64(250 + (251 + 500) * 250 / 2, column_sum(1));
+        for (long r = 0; r < result.count; r++) {
+            TEST_ASSERT_EQUAL_INT64(value(r, 0) <= 250 ? 1 : value(r, 0), value(r, 1));
+        }
+        stmt_finalize(stmt);
+    }
+}
+
+#define SCAN_ROWS 100000 // Past PARALLEL_SCAN_MIN_BYTES of 112-byte records
+
+static int count_rows(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    (void)row;
+    (*(long*)ctx)++; // Calls from the scan workers are serialized
+    return 0;
+}
+
+static void test_parallel_full_scan(void) {
+    // Rows appended without index entries: a full scan only reads the data file
+    TableSchema* products = find_table_schema(db, "products");
+    char row[256];
+    for (int id = NUM_PRODUCTS + 1; id <= NUM_PRODUCTS + SCAN_ROWS; id++) {
+        memset(row, 0, products->row_size);
+        memcpy(row + products->columns[0].offset, &id, sizeof(id));
+        int price = id % 10;
+        memcpy(row + products->columns[2].offset, &price, sizeof(price));
+        TEST_ASSERT_NOT_EQUAL(-1, append_row_to_file(products, row));
+    }
+    PreparedStatement* stmt = stmt_prepare(db, "SELECT * FROM products WHERE price = 3");
+    TEST_ASSERT_NOT_NULL(stmt);
+    TEST_ASSERT_EQUAL_INT(ACCESS_FULL_SCAN, stmt->plan->access);
+    long delivered = 0;
+    TEST_ASSERT_EQUAL_INT64((NUM_PRODUCTS + SCAN_ROWS) / 10, stmt_execute(stmt, count_rows, &delivered));
+    TEST_ASSERT_EQUAL_INT64((NUM_PRODUCTS + SCAN_ROWS) / 10, delivered);
+    stmt_finalize(stmt);
+
+    // Each worker aggregates on its own; the partial groups are merged
+    stmt = query("SELECT price, COUNT(*) FROM products GROUP BY price");
+    TEST_ASSERT_EQUAL_INT64(10, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64((NUM_PRODUCTS + SCAN_ROWS) / 10, value(r, 1));
+    stmt_finalize(stmt);
+}
+
+static void test_bound_parameters(void) {
+    PreparedStatement* stmt = stmt_prepare(db, "SELECT * FROM products WHERE prod_id > ? AND price = ?");
+    TEST_ASSERT_NOT_NULL(stmt);
+    result.schema = stmt->plan->output;
+    result.rows = malloc(MAX_RESULT_ROWS * result.schema->row_size);
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(stmt, 0, 900));
+    TEST_ASSERT_EQUAL_INT(0, stmt_bind_int(stmt, 1, 7));
+    TEST_ASSERT_EQUAL_INT64(10, stmt_execute(stmt, collect, &result));
+    TEST_ASSERT_EQUAL_INT(-1, stmt_bind_int(stmt, 2, 0)); // No such parameter
+    stmt_finalize(stmt);
+}
+
+static void test_order_by(void) {
+    PreparedStatement* stmt = query("SELECT prod_id FROM products ORDER BY prod_id DESC");
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS - r, value(r, 0));
+    stmt_finalize(stmt);
+
+    // Sorted by price, then by prod_id within a price
+    stmt = query("SELECT prod_id, price FROM products WHERE prod_id <= 100 ORDER BY price, prod_id");
+    TEST_ASSERT_EQUAL_INT64(100, result.count);
+    for (long r = 0; r < result.count; r++) {
+        TEST_ASSERT_EQUAL_INT64(r / 10, value(r, 1));
+        TEST_ASSERT_EQUAL_INT64((r / 10 == 0) ? (r % 10 + 1) * 10 : r % 10 * 10 + r / 10, value(r, 0));
+    }
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT price, COUNT(*) FROM products GROUP BY price ORDER BY COUNT(*) DESC, price DESC");
+    TEST_ASSERT_EQUAL_INT64(10, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(9 - r, value(r, 0));
+    stmt_finalize(stmt);
+}
+
+static void test_limit(void) {
+    // The index returns rows in key order: the scan walks it and stops early
+    PreparedStatement* stmt = query("SELECT prod_id FROM products ORDER BY prod_id LIMIT 5");
+    TEST_ASSERT_EQUAL_INT(1, stmt->plan->index_order);
+    TEST_ASSERT_EQUAL_INT(ACCESS_INDEX_RANGE_SCAN, stmt->plan->access);
+    TEST_ASSERT_EQUAL_INT64(5, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(r + 1, value(r, 0));
+    stmt_finalize(stmt);
+
+    // Top-N heap: the first rows of the stable full sort
+    stmt = query("SELECT prod_id, price FROM products ORDER BY price DESC LIMIT 3");
+    TEST_ASSERT_EQUAL_INT(0, stmt->plan->index_order);
+    TEST_ASSERT_EQUAL_INT64(3, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(9, value(r, 1));
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT * FROM products WHERE price = 3 LIMIT 7");
+    TEST_ASSERT_EQUAL_INT64(7, result.count);
+    for (long r = 0; r < result.count; r++) TEST_ASSERT_EQUAL_INT64(3, value(r, 2));
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT * FROM products LIMIT 0");
+    TEST_ASSERT_EQUAL_INT64(0, result.count);
+    stmt_finalize(stmt);
+
+    stmt = query("SELECT * FROM products WHERE prod_id < 4 LIMIT 10"); // Fewer rows than the limit
+    TEST_ASSERT_EQUAL_INT64(3, result.count);
+    stmt_finalize(stmt);
+}
+
+static void test_create_and_drop_table(void) {
+    TEST_ASSERT_EQUAL_INT64(0, execute("CREATE TABLE notes (id INT PRIMARY KEY, body STRING(40)) WITH (cow)"));
+    TEST_ASSERT_EQUAL_INT64(1, execute("CREATE TABLE notes (id INT PRIMARY KEY)"));
+    TEST_ASSERT_EQUAL_INT64(1, execute("CREATE TABLE products (id INT PRIMARY KEY)"));
+    TEST_ASSERT_EQUAL_INT64(0, execute("INSERT INTO notes VALUES (1, 'first'), (2, 'second')"));
+
+    // The catalog is saved: the table and its rows are there after a reopen
+    close_database(db);
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+    TableSchema* notes = find_table_schema(db, "notes");
+    TEST_ASSERT_NOT_NULL(notes);
+    TEST_ASSERT_EQUAL_INT(2, notes->num_columns);
+    PreparedStatement* stmt = query("SELECT body FROM notes WHERE id = 2");
+    TEST_ASSERT_EQUAL_INT64(1, result.count);
+    TEST_ASSERT_EQUAL_STRING("second", result.rows);
+    stmt_finalize(stmt);
+
+    // A statement over a dropped table fails instead of touching it
+    stmt = stmt_prepare(db, "SELECT * FROM notes");
+    TEST_ASSERT_NOT_NULL(stmt);
+    TEST_ASSERT_EQUAL_INT64(0, execute("DROP TABLE notes"));
+    TEST_ASSERT_EQUAL_INT64(-1, stmt_execute(stmt, collect, &result));
+    stmt_finalize(stmt);
+    TEST_ASSERT_NULL(find_table_schema(db, "notes"));
+    TEST_ASSERT_EQUAL_INT64(1, execute("DROP TABLE notes"));
+
+    // A table created again under the same name starts empty
+    TEST_ASSERT_EQUAL_INT64(0, execute("CREATE TABLE notes (id INT PRIMARY KEY, body STRING(40))"));
+    stmt = query("SELECT * FROM notes");
+    TEST_ASSERT_EQUAL_INT64(0, result.count);
+    stmt_finalize(stmt);
+    stmt = query("SELECT COUNT(*) FROM products"); // Other tables are untouched
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS, value(0, 0));
+    stmt_finalize(stmt);
+}
+
+static void test_statement_errors(void) {
+    TEST_ASSERT_NULL(stmt_prepare(db, "SELECT * FROM products WHERE nope = 1"));
+    TEST_ASSERT_NULL(stmt_prepare(db, "SELECT * FROM missing"));
+    TEST_ASSERT_EQUAL_INT64(1, execute("INSERT INTO products VALUES (1, 'dup', 0)"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_point_lookup);
+    RUN_TEST(test_index_range_scan);
+    RUN_TEST(test_full_scan_with_filter);
+    RUN_TEST(test_projection);
+    RUN_TEST(test_aggregates_and_group_by);
+    RUN_TEST(test_join);
+    RUN_TEST(test_hash_join_spills_over_small_budget);
+    RUN_TEST(test_parallel_full_scan);
+    RUN_TEST(test_bound_parameters);
+    RUN_TEST(test_order_by);
+    RUN_TEST(test_limit);
+    RUN_TEST(test_create_and_drop_table);
+    RUN_TEST(test_statement_errors);
+    return UNITY_END();
+}
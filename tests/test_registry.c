@@ -0,0 +1,105 @@
+#include "test_support.h"
+#include "unity.h"
+#include "database/database.h"
+#include "query/prepared.h"
+#include "constants.h"
+
+#define NUM_TABLES 100  // More than the old fixed table array held
+#define NUM_COLUMNS 80  // Columns of the last table, past the old column limit
+
+static Database* db;
+
+// A catalog of NUM_TABLES tables t0..t99: id plus one value column each,
+// except the last one, which has NUM_COLUMNS int columns c0.. after its id
+static void write_catalog(void) {
+    FILE* meta = fopen(test_path(METADATA_FILE), "w");
+    TEST_ASSERT_NOT_NULL(meta);
+    fprintf(meta, "format:%d\n", DATA_FORMAT_VERSION);
+    for (int t = 0; t < NUM_TABLES; t++) {
+        fprintf(meta, "table:t%d\ncolumn:id:int:primary_key\n", t);
+        if (t < NUM_TABLES - 1) {
+            fprintf(meta, "column:v:int\n");
+        } else {
+            for (int c = 0; c < NUM_COLUMNS; c++) fprintf(meta, "column:c%d:int\n", c);
+        }
+    }
+    fclose(meta);
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    write_catalog();
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+}
+
+void tearDown(void) {
+    close_database(db);
+    test_remove_dir();
+}
+
+static int ignore_row(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    (void)row;
+    (void)ctx;
+    return 0;
+}
+
+// INSERT: its status; SELECT: the number of rows
+static long execute(const char* sql) {
+    PreparedStatement* stmt = stmt_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, sql);
+    long status = stmt_execute(stmt, ignore_row, NULL);
+    stmt_finalize(stmt);
+    return status;
+}
+
+static void test_every_table_is_found_by_name_and_id(void) {
+    TEST_ASSERT_EQUAL_INT(NUM_TABLES, db->num_tables);
+    char name[16];
+    for (int t = 0; t < NUM_TABLES; t++) {
+        snprintf(name, sizeof(name), "t%d", t);
+        TableSchema* schema = find_table_schema(db, name);
+        TEST_ASSERT_NOT_NULL_MESSAGE(schema, name);
+        TEST_ASSERT_EQUAL_STRING(name, schema->name);
+        TEST_ASSERT_EQUAL_PTR(schema, table_by_id(db, schema->table_id));
+    }
+    TEST_ASSERT_NULL(find_table_schema(db, "t100"));
+    TEST_ASSERT_NULL(table_by_id(db, -1));
+    TEST_ASSERT_NULL(table_by_id(db, NUM_TABLES));
+
+    // A second table of the same name is refused
+    TableSchema duplicate;
+    memset(&duplicate, 0, sizeof(duplicate));
+    strcpy(duplicate.name, "t7");
+    TEST_ASSERT_EQUAL_INT(1, registry_add(db, &duplicate));
+}
+
+static void test_wide_table(void) {
+    TableSchema* wide = find_table_schema(db, "t99");
+    TEST_ASSERT_NOT_NULL(wide);
+    TEST_ASSERT_EQUAL_INT(NUM_COLUMNS + 1, wide->num_columns);
+    TEST_ASSERT_EQUAL_size_t((NUM_COLUMNS + 1) * sizeof(int), wide->row_size);
+
+    char sql[1024];
+    int len = snprintf(sql, sizeof(sql), "INSERT INTO t99 VALUES (1");
+    for (int c = 0; c < NUM_COLUMNS; c++) len += snprintf(sql + len, sizeof(sql) - len, ", %d", c * 10);
+    snprintf(sql + len, sizeof(sql) - len, ")");
+    TEST_ASSERT_EQUAL_INT64(0, execute(sql));
+    TEST_ASSERT_EQUAL_INT64(1, execute("SELECT c79 FROM t99 WHERE c79 = 790 AND c0 = 0"));
+    TEST_ASSERT_EQUAL_INT64(0, execute("INSERT INTO t42 VALUES (1, 2)"));
+
+    // Rows and the catalog survive a reopen
+    close_database(db);
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+    TEST_ASSERT_EQUAL_INT64(1, execute("SELECT * FROM t99 WHERE id = 1"));
+    TEST_ASSERT_EQUAL_INT64(1, execute("SELECT * FROM t42 WHERE v = 2"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_table_is_found_by_name_and_id);
+    RUN_TEST(test_wide_table);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "cache/row_cache.h"
+
+#define ROW_SIZE 16
+#define CAPACITY (ROW_CACHE_SHARDS * 4) // Four rows per shard
+
+static RowCache* cache;
+
+void setUp(void) {
+    cache = row_cache_create(ROW_SIZE, CAPACITY);
+    TEST_ASSERT_NOT_NULL(cache);
+}
+
+void tearDown(void) {
+    row_cache_destroy(cache);
+}
+
+static void make_row(char* row, int key) {
+    memset(row, 0, ROW_SIZE);
+    snprintf(row, ROW_SIZE, "row %d", key);
+}
+
+static void test_get_returns_what_was_put(void) {
+    char row[ROW_SIZE], out[ROW_SIZE];
+    make_row(row, 42);
+    TEST_ASSERT_EQUAL_INT(0, row_cache_get(cache, 42, out));
+    row_cache_put(cache, 42, row);
+    TEST_ASSERT_EQUAL_INT(1, row_cache_get(cache, 42, out));
+    TEST_ASSERT_EQUAL_MEMORY(row, out, ROW_SIZE);
+
+    // put on a cached key replaces the row
+    make_row(row, 43);
+    row_cache_put(cache, 42, row);
+    TEST_ASSERT_EQUAL_INT(1, row_cache_get(cache, 42, out));
+    TEST_ASSERT_EQUAL_STRING("row 43", out);
+
+    RowCacheStats stats;
+    row_cache_stats(cache, &stats);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.misses);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.entries);
+}
+
+static void test_invalidate_drops_the_row(void) {
+    char row[ROW_SIZE], out[ROW_SIZE];
+    for (int key = 0; key < 10; key++) {
+        make_row(row, key);
+        row_cache_put(cache, key, row);
+    }
+    row_cache_invalidate(cache, 5);
+    row_cache_invalidate(cache, 1000); // Not cached: no effect
+    TEST_ASSERT_EQUAL_INT(0, row_cache_get(cache, 5, out));
+    for (int key = 0; key < 10; key++) {
+        if (key == 5) continue;
+        TEST_ASSERT_EQUAL_INT(1, row_cache_get(cache, key, out));
+    }
+}
+
+static void test_eviction_keeps_capacity_bound(void) {
+    char row[ROW_SIZE], out[ROW_SIZE];
+    for (int key = 0; key < CAPACITY * 20; key++) {
+        make_row(row, key);
+        row_cache_put(cache, key, row);
+    }
+    RowCacheStats stats;
+    row_cache_stats(cache, &stats);
+    TEST_ASSERT_EQUAL_UINT64(CAPACITY, stats.capacity);
+    TEST_ASSERT_TRUE(stats.entries <= CAPACITY);
+    TEST_ASSERT_TRUE(stats.entries > 0);
+
+    // Whatever survived must still hold its own row
+    int cached = 0;
+    for (int key = 0; key < CAPACITY * 20; key++) {
+        if (row_cache_get(cache, key, out)) {
+            make_row(row, key);
+            TEST_ASSERT_EQUAL_STRING(row, out);
+            cached++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT((int)stats.entries, cached);
+}
+
+static void test_referenced_rows_survive_eviction(void) {
+    char row[ROW_SIZE], out[ROW_SIZE];
+    const int hot[2] = {7, 8};
+    for (int h = 0; h < 2; h++) {
+        make_row(row, hot[h]);
+        row_cache_put(cache, hot[h], row);
+    }
+    // Cold keys stream through while the hot keys are read after every put
+    for (int cold = 100000; cold < 100000 + CAPACITY * 10; cold++) {
+        make_row(row, cold);
+        row_cache_put(cache, cold, row);
+        for (int h = 0; h < 2; h++) row_cache_get(cache, hot[h], out);
+    }
+    for (int h = 0; h < 2; h++) {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(1, row_cache_get(cache, hot[h], out), "hot key was evicted");
+    }
+    // The first cold keys were never read and are gone
+    TEST_ASSERT_EQUAL_INT(0, row_cache_get(cache, 100000, out));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_get_returns_what_was_put);
+    RUN_TEST(test_invalidate_drops_the_row);
+    RUN_TEST(test_eviction_keeps_capacity_bound);
+    RUN_TEST(test_referenced_rows_survive_eviction);
+    return UNITY_END();
+}
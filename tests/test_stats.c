@@ -0,0 +1,111 @@
+#include "test_support.h"
+#include "unity.h"
+#include "database/database.h"
+#include "database/stats.h"
+#include "query/prepared.h"
+#include "constants.h"
+
+// products: prod_id 1..NUM_PRODUCTS; even ids cost 0, odd ids cost id % 1000,
+// so price has one value on half the rows and 500 rare ones
+#define NUM_PRODUCTS 20000
+#define BATCH_ROWS 1000
+#define PRICE_DISTINCT 501
+
+static Database* db;
+static TableSchema* products;
+
+static void make_product(char* row, int id) {
+    memset(row, 0, products->row_size);
+    int price = (id % 2 == 0) ? 0 : id % 1000;
+    memcpy(row + products->columns[0].offset, &id, sizeof(id));
+    snprintf(row + products->columns[1].offset, products->columns[1].size, "p%d", id);
+    memcpy(row + products->columns[2].offset, &price, sizeof(price));
+}
+
+// Open (or reopen) the database in the test's directory
+static void open_db(void) {
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+}
+
+static void close_db(void) {
+    close_database(db);
+    db = NULL;
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+    open_db();
+    products = find_table_schema(db, "products");
+    TEST_ASSERT_NOT_NULL(products);
+    char* rows = malloc((size_t)BATCH_ROWS * products->row_size);
+    TEST_ASSERT_NOT_NULL(rows);
+    for (int first = 1; first <= NUM_PRODUCTS; first += BATCH_ROWS) {
+        for (int i = 0; i < BATCH_ROWS; i++) make_product(rows + (size_t)i * products->row_size, first + i);
+        TEST_ASSERT_EQUAL_INT(0, insert_rows(db, "products", rows, BATCH_ROWS));
+    }
+    free(rows);
+}
+
+void tearDown(void) {
+    close_db();
+    test_remove_dir();
+}
+
+// Estimated result rows of a SELECT, as the planner sees it
+static long estimate(const char* sql) {
+    PreparedStatement* stmt = stmt_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, sql);
+    long rows = plan_estimate_rows(stmt->plan);
+    stmt_finalize(stmt);
+    return rows;
+}
+
+static void test_analyze_estimates(void) {
+    TEST_ASSERT_NULL(products->stats);
+    TEST_ASSERT_EQUAL_INT(0, analyze_table(products));
+    const TableStats* stats = products->stats;
+    TEST_ASSERT_NOT_NULL(stats);
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS, stats->row_count);
+
+    // HyperLogLog with 2^10 registers: about 3% standard error
+    TEST_ASSERT_INT_WITHIN(NUM_PRODUCTS / 10, NUM_PRODUCTS, stats_distinct(stats, 0));
+    TEST_ASSERT_INT_WITHIN(NUM_PRODUCTS / 10, NUM_PRODUCTS, stats_distinct(stats, 1));
+    TEST_ASSERT_INT_WITHIN(PRICE_DISTINCT / 10, PRICE_DISTINCT, stats_distinct(stats, 2));
+
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 0.25f, (float)stats_range_selectivity(stats, 0, 1, NUM_PRODUCTS / 4));
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, 0.0f, (float)stats_range_selectivity(stats, 0, NUM_PRODUCTS + 1, 2 * NUM_PRODUCTS));
+    TEST_ASSERT_TRUE(stats_range_selectivity(stats, 1, 0, 1) < 0); // STRING: no histogram
+
+    // The frequent value fills repeated histogram boundaries; rare ones get 1/distinct
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.5f, (float)stats_eq_selectivity(stats, 2, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f / PRICE_DISTINCT, (float)stats_eq_selectivity(stats, 2, 7));
+
+    TEST_ASSERT_INT_WITHIN(NUM_PRODUCTS / 20, NUM_PRODUCTS / 4, estimate("SELECT * FROM products WHERE prod_id <= 5000"));
+    TEST_ASSERT_INT_WITHIN(NUM_PRODUCTS / 10, NUM_PRODUCTS / 2, estimate("SELECT * FROM products WHERE price = 0"));
+    TEST_ASSERT_TRUE(estimate("SELECT * FROM products WHERE price = 7") < 100);
+}
+
+static void test_statistics_follow_inserts_and_restarts(void) {
+    TEST_ASSERT_EQUAL_INT(0, analyze_table(products));
+    char row[256];
+    make_product(row, NUM_PRODUCTS + 1);
+    TEST_ASSERT_EQUAL_INT(0, insert_row(db, "products", row));
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS + 1, products->stats->row_count);
+    long distinct = stats_distinct(products->stats, 0);
+
+    close_db();
+    open_db();
+    products = find_table_schema(db, "products");
+    TEST_ASSERT_NOT_NULL(products->stats);
+    TEST_ASSERT_EQUAL_INT64(NUM_PRODUCTS + 1, products->stats->row_count);
+    TEST_ASSERT_EQUAL_INT64(distinct, stats_distinct(products->stats, 0));
+    TEST_ASSERT_NULL(find_table_schema(db, "users")->stats); // Never analyzed
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_analyze_estimates);
+    RUN_TEST(test_statistics_follow_inserts_and_restarts);
+    return UNITY_END();
+}
@@ -0,0 +1,515 @@
+#include "test_support.h"
+#include "unity.h"
+#include "database/database.h"
+#include "btree/btree.h"
+#include "io/io.h"
+#include "database/scan.h"
+#include "database/zonemap.h"
+#include "cache/bloom.h"
+#include "query/prepared.h"
+#include "constants.h"
+
+#define NUM_ROWS 100
+
+static Database* db;
+
+// Open (or reopen) the database in the test's directory
+static void open_db(void) {
+    db = open_database(test_dir);
+    TEST_ASSERT_NOT_NULL(db);
+}
+
+static void close_db(void) {
+    close_database(db);
+    db = NULL;
+}
+
+void setUp(void) {
+    TEST_ASSERT_NOT_NULL(test_make_dir());
+}
+
+void tearDown(void) {
+    close_db();
+    test_remove_dir();
+}
+
+static void make_user(char* row, size_t row_size, int id) {
+    memset(row, 0, row_size);
+    memcpy(row, &id, sizeof(id));
+    snprintf(row + sizeof(int), row_size - sizeof(int), "user %d", id);
+}
+
+static void insert_users(int count) {
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_NOT_NULL(users);
+    char row[256];
+    for (int id = 1; id <= count; id++) {
+        make_user(row, users->row_size, id);
+        TEST_ASSERT_EQUAL_INT(0, insert_row(db, "users", row));
+    }
+}
+
+// Overwrite one byte of a file in place
+static void flip_byte(const char* path, long offset) {
+    FILE* fp = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL_INT(0, fseek(fp, offset, SEEK_SET));
+    int c = fgetc(fp);
+    TEST_ASSERT_EQUAL_INT(0, fseek(fp, offset, SEEK_SET));
+    fputc(c ^ 0x5a, fp);
+    fclose(fp);
+}
+
+static void test_rows_carry_checksums(void) {
+    open_db();
+    insert_users(NUM_ROWS);
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_EQUAL_size_t(users->row_size + ROW_CHECKSUM_SIZE, users->record_size);
+
+    struct stat st;
+    TEST_ASSERT_EQUAL_INT(0, stat(users->data_path, &st));
+    TEST_ASSERT_EQUAL_INT64((long)NUM_ROWS * users->record_size, st.st_size);
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+}
+
+static void test_corrupted_row_is_rejected_and_verified(void) {
+    open_db();
+    insert_users(NUM_ROWS);
+    TableSchema* users = find_table_schema(db, "users");
+    char data_path[MAX_PATH_LEN];
+    strcpy(data_path, users->data_path);
+    size_t record_size = users->record_size;
+    close_db();
+
+    flip_byte(data_path, 41 * (long)record_size + 8); // Inside the name of id 42
+
+    open_db();
+    void* row = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, select_row(db, "users", 42, &row));
+    TEST_ASSERT_NULL(row);
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", 43, &row));
+    TEST_ASSERT_EQUAL_STRING("user 43", (char*)row + sizeof(int));
+    free(row);
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, "products", NULL));
+
+    // The report names each file checked
+    FILE* report = tmpfile();
+    TEST_ASSERT_NOT_NULL(report);
+    TEST_ASSERT_EQUAL_INT(1, verify_database(db, "users", report));
+    rewind(report);
+    char line[MAX_PATH_LEN + 64], expected[MAX_PATH_LEN + 64];
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), report));
+    snprintf(expected, sizeof(expected), "  %s: %d rows checked, 1 corrupted\n", data_path, NUM_ROWS);
+    TEST_ASSERT_EQUAL_STRING(expected, line);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), report)); // Then the index
+    TEST_ASSERT_NOT_NULL(strstr(line, "nodes checked, 0 corrupted"));
+    fclose(report);
+}
+
+static void test_corrupted_index_node_is_verified(void) {
+    open_db();
+    insert_users(NUM_ROWS);
+    TableSchema* users = find_table_schema(db, "users");
+    char index_path[MAX_PATH_LEN];
+    strcpy(index_path, users->pk_index->index_path);
+    close_db();
+
+    flip_byte(index_path, HEADER_SIZE + 5 * (long)sizeof(Node) + 4); // Keys of node 5
+
+    open_db();
+    users = find_table_schema(db, "users");
+    int checked = 0;
+    TEST_ASSERT_EQUAL_INT(1, btree_verify(users->pk_index, &checked));
+    TEST_ASSERT_EQUAL_INT(users->pk_index->header.next_id, checked);
+    TEST_ASSERT_NULL(read_node(users->pk_index, 5));
+    TEST_ASSERT_EQUAL_INT(1, verify_database(db, NULL, NULL));
+}
+
+static void test_direct_table_ignores_block_padding(void) {
+    FILE* meta = fopen(test_path(METADATA_FILE), "w");
+    TEST_ASSERT_NOT_NULL(meta);
+    fprintf(meta, "format:%d\ntable:users:direct\ncolumn:id:int:primary_key\ncolumn:name:string:%d\n",
+            DATA_FORMAT_VERSION, NAME_LEN);
+    fclose(meta);
+
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_EQUAL_INT(1, users->data_file->direct);
+    insert_users(NUM_ROWS);
+    size_t record_size = users->record_size;
+    close_db();
+
+    open_db();
+    users = find_table_schema(db, "users");
+    TEST_ASSERT_TRUE(io_size(users->data_file) % IO_ALIGNMENT == 0);
+    TEST_ASSERT_EQUAL_INT64((off_t)NUM_ROWS * record_size, users->data_size);
+    for (int id = 1; id <= NUM_ROWS; id++) {
+        void* row = NULL;
+        TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", id, &row));
+        free(row);
+    }
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+}
+
+static void test_partial_last_row_is_overwritten(void) {
+    open_db();
+    insert_users(10);
+    char data_path[MAX_PATH_LEN];
+    strcpy(data_path, find_table_schema(db, "users")->data_path);
+    close_db();
+
+    FILE* data = fopen(data_path, "ab"); // A torn append
+    TEST_ASSERT_NOT_NULL(data);
+    fwrite("torn row", 7, 1, data);
+    fclose(data);
+
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_EQUAL_INT64(10 * (off_t)users->record_size, users->data_size);
+    char row[256];
+    make_user(row, users->row_size, 11);
+    TEST_ASSERT_EQUAL_INT(0, insert_row(db, "users", row));
+    TEST_ASSERT_EQUAL_INT64(11 * (off_t)users->record_size, io_size(users->data_file));
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", 11, &found));
+    free(found);
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+}
+
+static void test_corrupted_last_row_is_kept(void) {
+    open_db();
+    insert_users(10);
+    TableSchema* users = find_table_schema(db, "users");
+    char data_path[MAX_PATH_LEN];
+    strcpy(data_path, users->data_path);
+    size_t record_size = users->record_size;
+    close_db();
+
+    flip_byte(data_path, 9 * (long)record_size + 8);
+
+    // The whole record stays in the table, so its offset is not reused
+    open_db();
+    users = find_table_schema(db, "users");
+    TEST_ASSERT_EQUAL_INT64(10 * (off_t)record_size, users->data_size);
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, select_row(db, "users", 10, &found));
+    TEST_ASSERT_EQUAL_INT(1, verify_database(db, "users", NULL));
+
+    char row[256];
+    make_user(row, users->row_size, 11);
+    TEST_ASSERT_EQUAL_INT(0, insert_row(db, "users", row));
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", 11, &found));
+    free(found);
+    TEST_ASSERT_EQUAL_INT(-1, select_row(db, "users", 10, &found));
+}
+
+static void test_lookup_rejects_row_with_other_key(void) {
+    open_db();
+    insert_users(10);
+    TableSchema* users = find_table_schema(db, "users");
+    btree_insert(users->pk_index, 99, 4 * (long)users->record_size); // Points at id 5
+    bloom_filter_add(users->pk_filter, 99);
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, select_row(db, "users", 99, &found));
+    TEST_ASSERT_NULL(found);
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", 5, &found));
+    free(found);
+}
+
+#define BATCH_ROWS 300
+
+static void test_batch_insert_is_all_or_nothing(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_NOT_NULL(users);
+    char* rows = calloc(BATCH_ROWS, users->row_size);
+    TEST_ASSERT_NOT_NULL(rows);
+    for (int i = 0; i < BATCH_ROWS; i++) {
+        make_user(rows + (size_t)i * users->row_size, users->row_size, BATCH_ROWS - i); // Descending
+    }
+    TEST_ASSERT_EQUAL_INT(0, insert_rows(db, "users", rows, BATCH_ROWS));
+    off_t size = users->data_size;
+    TEST_ASSERT_EQUAL_INT64((off_t)BATCH_ROWS * users->record_size, size);
+
+    // A duplicate inside the batch or against the table rejects every row
+    make_user(rows, users->row_size, BATCH_ROWS + 1);
+    make_user(rows + users->row_size, users->row_size, BATCH_ROWS + 1);
+    TEST_ASSERT_EQUAL_INT(1, insert_rows(db, "users", rows, 2));
+    make_user(rows + users->row_size, users->row_size, 7);
+    TEST_ASSERT_EQUAL_INT(1, insert_rows(db, "users", rows, 2));
+    TEST_ASSERT_EQUAL_INT64(size, users->data_size);
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(1, select_row(db, "users", BATCH_ROWS + 1, &found));
+    free(rows);
+
+    for (int id = 1; id <= BATCH_ROWS; id++) {
+        TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", id, &found));
+        TEST_ASSERT_EQUAL_INT(id, *(int*)found);
+        free(found);
+    }
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+}
+
+#define SCAN_ROWS 50000 // Several SCAN_READ_SIZE buffers of 58-byte records
+
+// Rows appended without index entries: scans only read the data file
+static void append_users(TableSchema* users, int count) {
+    char row[256];
+    for (int id = 1; id <= count; id++) {
+        make_user(row, users->row_size, id);
+        TEST_ASSERT_NOT_EQUAL(-1, append_row_to_file(users, row));
+    }
+}
+
+// Scan [first, last] (1-based row numbers) and check every record
+static void check_scan(TableSchema* users, int first, int last) {
+    ScanReader reader;
+    TEST_ASSERT_EQUAL_INT(0, scan_reader_open(&reader, users, (off_t)(first - 1) * users->record_size,
+                                              (off_t)last * users->record_size));
+    const char* record;
+    off_t offset;
+    int expected = first;
+    char row[256];
+    while ((record = scan_reader_next(&reader, &offset)) != NULL) {
+        TEST_ASSERT_EQUAL_INT64((off_t)(expected - 1) * users->record_size, offset);
+        make_user(row, users->row_size, expected);
+        TEST_ASSERT_EQUAL_MEMORY(row, record, users->row_size);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL_INT(0, reader.error);
+    TEST_ASSERT_EQUAL_INT(last + 1, expected);
+    scan_reader_close(&reader);
+}
+
+static void test_scan_streams_rows_across_buffers(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_TRUE(SCAN_READ_SIZE % users->record_size != 0); // Rows straddle buffers
+    append_users(users, SCAN_ROWS);
+    check_scan(users, 1, SCAN_ROWS);
+    check_scan(users, 18000, 36001); // Starts and ends mid-buffer
+    check_scan(users, 7, 7);
+}
+
+static void test_scan_of_direct_table(void) {
+    FILE* meta = fopen(test_path(METADATA_FILE), "w");
+    TEST_ASSERT_NOT_NULL(meta);
+    fprintf(meta, "format:%d\ntable:users:direct\ncolumn:id:int:primary_key\ncolumn:name:string:%d\n",
+            DATA_FORMAT_VERSION, NAME_LEN);
+    fclose(meta);
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    append_users(users, 5000);
+    check_scan(users, 1, 5000);
+    check_scan(users, 1234, 4321);
+}
+
+static void test_scan_stops_at_corrupted_row(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    append_users(users, SCAN_ROWS);
+    char data_path[MAX_PATH_LEN];
+    strcpy(data_path, users->data_path);
+    size_t record_size = users->record_size;
+    close_db();
+    flip_byte(data_path, 30000 * (long)record_size + 8); // Row 30001
+
+    open_db();
+    users = find_table_schema(db, "users");
+    ScanReader reader;
+    TEST_ASSERT_EQUAL_INT(0, scan_reader_open(&reader, users, 0, users->data_size));
+    int rows = 0;
+    while (scan_reader_next(&reader, NULL) != NULL) rows++;
+    TEST_ASSERT_EQUAL_INT(1, reader.error);
+    TEST_ASSERT_EQUAL_INT(30000, rows);
+    scan_reader_close(&reader);
+}
+
+// Blocks of the users zone map that may hold id
+static int candidate_blocks(const TableSchema* users, int id, int* block_out) {
+    int candidates = 0;
+    for (int block = 0; block < users->zone_map->num_blocks; block++) {
+        if (zone_map_may_contain(users->zone_map, block, 0, id, id)) {
+            *block_out = block;
+            candidates++;
+        }
+    }
+    return candidates;
+}
+
+static void check_zone_map_prunes(const TableSchema* users, int count) {
+    int blocks = (int)(((off_t)count * users->record_size + ZONE_MAP_BLOCK_SIZE - 1) / ZONE_MAP_BLOCK_SIZE);
+    TEST_ASSERT_EQUAL_INT(blocks, users->zone_map->num_blocks);
+    TEST_ASSERT_EQUAL_INT64(users->data_size, users->zone_map->covered);
+    const int ids[] = {1, 1130, 20000, count};
+    for (int i = 0; i < 4; i++) {
+        int block = -1;
+        TEST_ASSERT_EQUAL_INT(1, candidate_blocks(users, ids[i], &block));
+        long first_byte = (long)(ids[i] - 1) * (long)users->record_size;
+        TEST_ASSERT_EQUAL_INT(first_byte / ZONE_MAP_BLOCK_SIZE, block);
+    }
+    int block;
+    TEST_ASSERT_EQUAL_INT(0, candidate_blocks(users, count + 1, &block));
+}
+
+static int count_row(const TableSchema* schema, const void* row, void* ctx) {
+    (void)schema;
+    (void)row;
+    (*(long*)ctx)++;
+    return 0;
+}
+
+// Rows a full scan for `sql` finds, reading only the blocks the zone map allows
+static long scan_count(const char* sql) {
+    PreparedStatement* stmt = stmt_prepare(db, sql);
+    TEST_ASSERT_NOT_NULL_MESSAGE(stmt, sql);
+    TEST_ASSERT_EQUAL_INT(ACCESS_FULL_SCAN, stmt->plan->access);
+    long count = 0;
+    long delivered = stmt_execute(stmt, count_row, &count);
+    TEST_ASSERT_EQUAL_INT64(count, delivered);
+    stmt_finalize(stmt);
+    return count;
+}
+
+static void test_zone_map_prunes_blocks(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    TEST_ASSERT_NOT_NULL(users->zone_map);
+    char row[256];
+    for (int id = 1; id <= SCAN_ROWS; id++) {
+        make_user(row, users->row_size, id);
+        off_t offset = append_row_to_file(users, row);
+        zone_map_update(users->zone_map, users, offset, row);
+    }
+    check_zone_map_prunes(users, SCAN_ROWS);
+    TEST_ASSERT_EQUAL_INT64(20000, scan_count("SELECT * FROM users WHERE id >= 20000 AND id < 40000"));
+
+    // Saved at shutdown and loaded again
+    close_db();
+    open_db();
+    users = find_table_schema(db, "users");
+    check_zone_map_prunes(users, SCAN_ROWS);
+}
+
+static void test_zone_map_catches_up_with_data_file(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    append_users(users, SCAN_ROWS); // Rows the map never saw, as after a crash
+    char zone_map_path[MAX_PATH_LEN + 16];
+    snprintf(zone_map_path, sizeof(zone_map_path), "%s/users%s", users->table_dir, ZONE_MAP_EXT);
+    close_db();
+
+    open_db();
+    check_zone_map_prunes(find_table_schema(db, "users"), SCAN_ROWS);
+
+    // A missing sidecar is rebuilt from the data file
+    close_db();
+    TEST_ASSERT_EQUAL_INT(0, unlink(zone_map_path));
+    open_db();
+    check_zone_map_prunes(find_table_schema(db, "users"), SCAN_ROWS);
+    TEST_ASSERT_EQUAL_INT64(SCAN_ROWS - 1129, scan_count("SELECT * FROM users WHERE id >= 1130"));
+}
+
+static void test_reindex_and_missing_index(void) {
+    open_db();
+    insert_users(NUM_ROWS);
+    TableSchema* users = find_table_schema(db, "users");
+    char row[256];
+    for (int id = NUM_ROWS + 1; id <= 2 * NUM_ROWS; id++) { // Rows the index never saw
+        make_user(row, users->row_size, id);
+        TEST_ASSERT_NOT_EQUAL(-1, append_row_to_file(users, row));
+    }
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(1, select_row(db, "users", NUM_ROWS + 50, &found));
+
+    TEST_ASSERT_EQUAL_INT(0, rebuild_pk_index(users));
+    for (int id = 1; id <= 2 * NUM_ROWS; id++) {
+        TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", id, &found));
+        TEST_ASSERT_EQUAL_INT(id, *(int*)found);
+        free(found);
+    }
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+
+    // A deleted index is rebuilt in bulk on open
+    char index_path[MAX_PATH_LEN];
+    strcpy(index_path, users->pk_index->index_path);
+    close_db();
+    TEST_ASSERT_EQUAL_INT(0, unlink(index_path));
+    open_db();
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", 2 * NUM_ROWS, &found));
+    free(found);
+    TEST_ASSERT_EQUAL_INT(1, select_row(db, "users", 2 * NUM_ROWS + 1, &found));
+    make_user(row, users->row_size, 7);
+    TEST_ASSERT_EQUAL_INT(1, insert_row(db, "users", row)); // Still a duplicate
+}
+
+static void test_format_1_table_is_upgraded(void) {
+    open_db();
+    TableSchema* users = find_table_schema(db, "users");
+    char data_path[MAX_PATH_LEN];
+    strcpy(data_path, users->data_path);
+    size_t row_size = users->row_size;
+    close_db();
+
+    // A catalog without a format line and a data file of bare rows, as
+    // written before row checksums
+    FILE* meta = fopen(test_path(METADATA_FILE), "w");
+    TEST_ASSERT_NOT_NULL(meta);
+    fprintf(meta, "table:users\ncolumn:id:int:primary_key\ncolumn:name:string:%d\n", NAME_LEN);
+    fclose(meta);
+    FILE* data = fopen(data_path, "wb");
+    TEST_ASSERT_NOT_NULL(data);
+    char row[256];
+    for (int id = 1; id <= NUM_ROWS; id++) {
+        make_user(row, row_size, id);
+        fwrite(row, row_size, 1, data);
+    }
+    fclose(data);
+
+    open_db();
+    for (int id = 1; id <= NUM_ROWS; id++) {
+        void* found = NULL;
+        TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", id, &found));
+        make_user(row, row_size, id);
+        TEST_ASSERT_EQUAL_MEMORY(row, found, row_size);
+        free(found);
+    }
+    TEST_ASSERT_EQUAL_INT(0, verify_database(db, NULL, NULL));
+
+    char line[64];
+    int format = 0;
+    meta = fopen(test_path(METADATA_FILE), "r");
+    TEST_ASSERT_NOT_NULL(meta);
+    while (fgets(line, sizeof(line), meta)) {
+        if (strncmp(line, "format:", 7) == 0) format = atoi(line + 7);
+    }
+    fclose(meta);
+    TEST_ASSERT_EQUAL_INT(DATA_FORMAT_VERSION, format);
+
+    // Reopening the upgraded catalog leaves the data alone
+    close_db();
+    open_db();
+    void* found = NULL;
+    TEST_ASSERT_EQUAL_INT(0, select_row(db, "users", NUM_ROWS, &found));
+    free(found);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rows_carry_checksums);
+    RUN_TEST(test_corrupted_row_is_rejected_and_verified);
+    RUN_TEST(test_corrupted_index_node_is_verified);
+    RUN_TEST(test_direct_table_ignores_block_padding);
+    RUN_TEST(test_partial_last_row_is_overwritten);
+    RUN_TEST(test_corrupted_last_row_is_kept);
+    RUN_TEST(test_lookup_rejects_row_with_other_key);
+    RUN_TEST(test_batch_insert_is_all_or_nothing);
+    RUN_TEST(test_scan_streams_rows_across_buffers);
+    RUN_TEST(test_scan_of_direct_table);
+    RUN_TEST(test_scan_stops_at_corrupted_row);
+    RUN_TEST(test_zone_map_prunes_blocks);
+    RUN_TEST(test_zone_map_catches_up_with_data_file);
+    RUN_TEST(test_reindex_and_missing_index);
+    RUN_TEST(test_format_1_table_is_upgraded);
+    return UNITY_END();
+}
@@ -0,0 +1,54 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#define _XOPEN_SOURCE 700 // nftw
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <unistd.h>
+
+// --- Scratch Directories ---
+// Every test works in a fresh directory under /tmp that tearDown removes,
+// so tests never see each other's files or the REPL's db_data.
+
+static char test_dir[64];
+
+/**
+ * Create a new empty directory for one test.
+ * @return Its path (static buffer), or NULL on error.
+ */
+static inline const char* test_make_dir(void) {
+    strcpy(test_dir, "/tmp/dbengine-test.XXXXXX");
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return NULL;
+    }
+    return test_dir;
+}
+
+static inline int remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * Delete the test's directory and everything in it.
+ */
+static inline void test_remove_dir(void) {
+    if (test_dir[0]) nftw(test_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    test_dir[0] = '\0';
+}
+
+/**
+ * Path of a file inside the test's directory (static buffer).
+ */
+static inline const char* test_path(const char* name) {
+    static char path[128];
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+    return path;
+}
+
+#endif // TEST_SUPPORT_H